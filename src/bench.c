@@ -0,0 +1,212 @@
+/****************************************************************
+ *
+ * bench.c: Throughput benchmark for the force kernels
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+/****************************************************************
+ *
+ *  With bench_evals set the root process replaces the optimization
+ *  with bench_evals repeated calc_forces calls on randomly perturbed
+ *  parameter vectors (a uniform +/- 1 % jitter on every free
+ *  parameter, so the incremental caches see realistic change
+ *  patterns without drifting into unphysical regions). The report
+ *  covers the evaluation rate, the distribution of the per-call
+ *  times, the per-configuration cost distribution of the reference
+ *  evaluation and the memory footprint. This measures the force
+ *  backend the binary was built with - comparing interactions means
+ *  comparing binaries, just like for fitting.
+ *
+ ****************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <time.h>
+
+#include "potfit.h"
+
+#include "bench.h"
+#include "force.h"
+#include "memory.h"
+#include "random.h"
+#include "utils.h"
+
+/****************************************************************
+  bench_now
+****************************************************************/
+
+static double bench_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/****************************************************************
+  bench_compare_double
+****************************************************************/
+
+static int bench_compare_double(const void* a, const void* b)
+{
+  double x = *(const double*)a;
+  double y = *(const double*)b;
+
+  return (x > y) - (x < y);
+}
+
+/****************************************************************
+  bench_config_cost
+    cost share of one configuration in the assembled force vector,
+    the same terms the kernels add to the error sum (global dummy
+    and punishment constraints are not attributed to configurations)
+****************************************************************/
+
+static double bench_config_cost(const double* forces, int config_idx)
+{
+  double cost = 0.0;
+
+  for (int i = 0; i < g_config.inconf[config_idx]; i++) {
+    int n_i = 3 * (g_config.cnfstart[config_idx] + i);
+    cost += dsquare(forces[n_i + 0]) + dsquare(forces[n_i + 1]) +
+            dsquare(forces[n_i + 2]);
+  }
+
+  cost += g_param.eweight * dsquare(forces[g_calc.energy_p + config_idx]);
+
+#if defined(STRESS)
+  for (int i = 0; i < 6; i++)
+    cost += g_param.sweight *
+            dsquare(forces[g_calc.stress_p + 6 * config_idx + i]);
+#endif  // STRESS
+
+  return g_config.conf_weight[config_idx] * cost;
+}
+
+/****************************************************************
+  bench_print_memory
+    resident set size of this process from the kernel accounting
+****************************************************************/
+
+static void bench_print_memory()
+{
+  FILE* status = fopen("/proc/self/status", "r");
+  char buffer[255];
+
+  if (status == NULL)
+    return;
+
+  while (fgets(buffer, sizeof(buffer), status) != NULL) {
+    if (strncmp(buffer, "VmRSS:", 6) == 0 ||
+        strncmp(buffer, "VmHWM:", 6) == 0)
+      printf("  %s", buffer);
+  }
+
+  fclose(status);
+}
+
+/****************************************************************
+  run_benchmark
+****************************************************************/
+
+void run_benchmark()
+{
+  int num_evals = g_param.bench_evals;
+  double* xi = g_pot.opt_pot.table;
+  double* forces = g_calc.force;
+  double* base = (double*)Malloc(g_calc.ndim * sizeof(double));
+  double* times = (double*)Malloc(num_evals * sizeof(double));
+  double* costs = (double*)Malloc(g_config.nconf * sizeof(double));
+
+  printf("\nBenchmarking %d force evaluations with %d parameters\n", num_evals,
+         g_calc.ndim);
+  printf("(%d configurations, %d atoms, %d processes)\n", g_config.nconf,
+         g_config.natoms, g_mpi.num_cpus);
+  fflush(stdout);
+
+  for (int i = 0; i < g_calc.ndim; i++)
+    base[i] = xi[g_pot.opt_pot.idx[i]];
+
+  // reference evaluation: warms the caches and provides the
+  // per-configuration cost distribution
+  double cost_0 = calc_forces(xi, forces, 0);
+
+  for (int i = 0; i < g_config.nconf; i++)
+    costs[i] = bench_config_cost(forces, i);
+
+  double start = bench_now();
+
+  for (int n = 0; n < num_evals; n++) {
+    for (int i = 0; i < g_calc.ndim; i++) {
+      double jitter = 0.01 * (2.0 * eqdist() - 1.0);
+      xi[g_pot.opt_pot.idx[i]] =
+          base[i] != 0.0 ? base[i] * (1.0 + jitter) : jitter;
+    }
+
+    double t0 = bench_now();
+    calc_forces(xi, forces, 0);
+    times[n] = bench_now() - t0;
+  }
+
+  double wall = bench_now() - start;
+
+  // leave the potential as it was read
+  for (int i = 0; i < g_calc.ndim; i++)
+    xi[g_pot.opt_pot.idx[i]] = base[i];
+
+  qsort(times, num_evals, sizeof(double), bench_compare_double);
+
+  double mean = 0.0;
+  for (int n = 0; n < num_evals; n++)
+    mean += times[n];
+  mean /= num_evals;
+
+  printf("\n###### benchmark report ######\n");
+  printf("total time        = %.3f s (%.1f evals/s)\n", wall,
+         num_evals / wall);
+  printf("time per eval     = %.3f ms min / %.3f ms median / %.3f ms mean / "
+         "%.3f ms max\n",
+         1000.0 * times[0], 1000.0 * times[num_evals / 2], 1000.0 * mean,
+         1000.0 * times[num_evals - 1]);
+
+  qsort(costs, g_config.nconf, sizeof(double), bench_compare_double);
+
+  double cost_mean = 0.0;
+  for (int i = 0; i < g_config.nconf; i++)
+    cost_mean += costs[i];
+  cost_mean /= g_config.nconf;
+
+  printf("reference cost    = %f\n", cost_0);
+  printf("per-config cost   = %e min / %e median / %e mean / %e max\n",
+         costs[0], costs[g_config.nconf / 2], cost_mean,
+         costs[g_config.nconf - 1]);
+
+  printf("memory footprint (root process):\n");
+  bench_print_memory();
+
+  fflush(stdout);
+}
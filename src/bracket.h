@@ -51,4 +51,17 @@ double brent(double, double, double, double, double, double*, double*, double*,
 
 double linmin(double*, double*, double, double*, double*, double*, double*);
 
+#if defined(MPI) && !defined(EVO)
+
+// message tags for the communication with the line search helpers
+#define LINMIN_TAG_EVAL 103
+#define LINMIN_TAG_STOP 104
+
+// speculative evaluation of brent candidate points on the replica
+// group leaders, implemented in linmin.c
+void run_linmin_helper(double* forces);
+void stop_linmin_helpers();
+
+#endif  // MPI && !EVO
+
 #endif  // BRACKET_H_INCLUDED
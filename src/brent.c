@@ -36,6 +36,103 @@
 #include "memory.h"
 #include "utils.h"
 
+#if defined(MPI) && !defined(EVO)
+
+// Speculative line search: while the own group evaluates the point
+// brent actually needs, the idle replica group leaders evaluate the
+// golden section successors of the two possible outcomes (the trial
+// point replaces the minimum or merely narrows the interval). When
+// the next iteration takes a golden section step, its result is
+// already available and the own group can move on to the point after.
+
+// one candidate per possible branch outcome
+#define SPEC_MAX 2
+
+typedef struct {
+  double u;        /* position of the candidate along the line */
+  double f;        /* cost returned by the helper */
+  double* force;   /* force vector returned by the helper */
+  MPI_Request request[2]; /* outstanding receives for f and force */
+} spec_point_t;
+
+static spec_point_t spec[SPEC_MAX];
+static double* spec_vecu = NULL;
+static int spec_num = 0;     /* number of available helpers */
+static int spec_pending = 0; /* number of posted candidates */
+
+/****************************************************************
+ *
+ *  golden section step for a given interval and minimum, same
+ *  arithmetic as the fallback branch in the main brent loop
+ *
+ ****************************************************************/
+
+static double spec_golden_point(double x_left, double x_right, double z,
+                                double tol)
+{
+  double midpoint = 0.5 * (x_left + x_right);
+  double tolerance = tol * fabs(z) + ZEPS;
+  double e = (z < midpoint) ? x_right - z : -(z - x_left);
+  double d = CGOLD * e;
+
+  if (fabs(d) >= tolerance)
+    return z + d;
+
+  return z + ((d > 0) ? tolerance : -tolerance);
+}
+
+/****************************************************************
+ *
+ *  send a candidate point to a line search helper and post the
+ *  receives for its result
+ *
+ ****************************************************************/
+
+static void spec_post(int slot, double u)
+{
+  for (int j = 0; j < g_calc.ndimtot; j++)
+    spec_vecu[j] = xicom[j] + u * delcom[j];
+
+  MPI_Send(spec_vecu, g_calc.ndimtot, MPI_DOUBLE, g_mpi.group_leaders[slot + 1],
+           LINMIN_TAG_EVAL, MPI_COMM_WORLD);
+  MPI_Irecv(&spec[slot].f, 1, MPI_DOUBLE, g_mpi.group_leaders[slot + 1],
+            LINMIN_TAG_EVAL, MPI_COMM_WORLD, &spec[slot].request[0]);
+  MPI_Irecv(spec[slot].force, g_calc.mdim, MPI_DOUBLE,
+            g_mpi.group_leaders[slot + 1], LINMIN_TAG_EVAL, MPI_COMM_WORLD,
+            &spec[slot].request[1]);
+
+  spec[slot].u = u;
+}
+
+/****************************************************************
+ *
+ *  collect all outstanding candidate results; if one of them is
+ *  the point u brent is about to evaluate, copy it to f_u and the
+ *  force vector and return 1
+ *
+ ****************************************************************/
+
+static int spec_collect(double u, double* f_u, double* force)
+{
+  int hit = 0;
+
+  for (int i = 0; i < spec_pending; i++) {
+    MPI_Waitall(2, spec[i].request, MPI_STATUSES_IGNORE);
+
+    if (spec[i].u == u) {
+      *f_u = spec[i].f;
+      memcpy(force, spec[i].force, g_calc.mdim * sizeof(double));
+      hit = 1;
+    }
+  }
+
+  spec_pending = 0;
+
+  return hit;
+}
+
+#endif  // MPI && !EVO
+
 double brent(double ax, double bx, double cx, double fbx, double tol,
              double* xmin, double* xmin2, double* fxmin, double* fxmin2)
 /* take bracket (a,b,c), f(b), tol, pointers to xmin, xmin2, vectors fxmin,
@@ -57,6 +154,9 @@ double brent(double ax, double bx, double cx, double fbx, double tol,
   double f_z;
   double w_lower, w_upper;
   double *p_w, *p_z, *p_u, *p_temp;
+#if defined(MPI) && !defined(EVO)
+  int spec_hit = 0;
+#endif  // MPI && !EVO
 
   static double* vecu = NULL;
   static double* fxu = NULL; /* Vector of location u */
@@ -69,6 +169,18 @@ double brent(double ax, double bx, double cx, double fbx, double tol,
   if (vecu == NULL)
     vecu = (double*)Malloc(g_calc.ndimtot * sizeof(double));
 
+#if defined(MPI) && !defined(EVO)
+  spec_num = g_mpi.num_groups - 1;
+  if (spec_num > SPEC_MAX)
+    spec_num = SPEC_MAX;
+
+  if (spec_num > 0 && spec_vecu == NULL) {
+    spec_vecu = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+    for (j = 0; j < SPEC_MAX; j++)
+      spec[j].force = (double*)Malloc(g_calc.mdim * sizeof(double));
+  }
+#endif  // MPI && !EVO
+
   z = bx;
   f_z = fbx;
   x_left = (ax < cx ? ax : cx);
@@ -89,6 +201,11 @@ double brent(double ax, double bx, double cx, double fbx, double tol,
     w_lower = (x_left - z);
     w_upper = (x_right - z);
     if (fabs(z - midpoint) <= t2 - 0.5 * (x_right - x_left)) {
+#if defined(MPI) && !defined(EVO)
+      // drain outstanding candidates, their results are not needed
+      if (spec_pending > 0)
+        spec_collect(z, &f_u, p_u);
+#endif  // MPI && !EVO
       *xmin = z;
       *xmin2 = w;
       /* Put correct values in pointers */
@@ -138,9 +255,33 @@ double brent(double ax, double bx, double cx, double fbx, double tol,
       u = z + ((d > 0) ? tolerance : -tolerance);
     }
 
-    for (j = 0; j < g_calc.ndimtot; j++)
-      vecu[j] = xicom[j] + u * delcom[j]; /*set vecu */
-    f_u = calc_forces(vecu, p_u, 0);
+#if defined(MPI) && !defined(EVO)
+    // one of the candidates posted in the last iteration may already
+    // answer the point we are about to evaluate
+    spec_hit = (spec_pending > 0) ? spec_collect(u, &f_u, p_u) : 0;
+
+    if (spec_hit == 0 && spec_num > 0) {
+      // post the golden section successors of the two possible
+      // outcomes of u before the own group starts working on it
+      if (u < z) {
+        spec_post(0, spec_golden_point(x_left, z, u, tol));
+        if (spec_num > 1)
+          spec_post(1, spec_golden_point(u, x_right, z, tol));
+      } else {
+        spec_post(0, spec_golden_point(z, x_right, u, tol));
+        if (spec_num > 1)
+          spec_post(1, spec_golden_point(x_left, u, z, tol));
+      }
+      spec_pending = (spec_num > 1) ? 2 : 1;
+    }
+
+    if (spec_hit == 0)
+#endif  // MPI && !EVO
+    {
+      for (j = 0; j < g_calc.ndimtot; j++)
+        vecu[j] = xicom[j] + u * delcom[j]; /*set vecu */
+      f_u = calc_forces(vecu, p_u, 0);
+    }
 
     if (f_u > f_z) {
       if (u < z) {
@@ -0,0 +1,347 @@
+/****************************************************************
+ *
+ * checkpoint.c: Binary checkpoint/restart for the optimizer state
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "checkpoint.h"
+#include "random.h"
+
+#define CHECKPOINT_MAGIC 0x74667063 /* "cpft" */
+// version 2: the rng state grew by the block-refill buffer
+// version 3: the annealing record carries the convergence flag, so a
+//            resumed run does not replay an extra outer iteration
+#define CHECKPOINT_VERSION 3
+
+// file header, guards against stale or mismatched checkpoints
+typedef struct {
+  int magic;
+  int version;
+  int stage;
+  int ndim;
+  int ndimtot;
+} checkpoint_header_t;
+
+/****************************************************************
+ *
+ *  checkpoint_active
+ *      checkpointing is driven by the root process of the first
+ *      evaluation group; replica chains would need one file per
+ *      chain and are not supported
+ *
+ ****************************************************************/
+
+static int checkpoint_active()
+{
+  if (g_files.checkpointfile == NULL || strlen(g_files.checkpointfile) == 0)
+    return 0;
+
+  if (g_mpi.myid != 0)
+    return 0;
+
+#if defined(MPI)
+  if (g_mpi.num_groups > 1)
+    return 0;
+#endif  // MPI
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_open_read
+ *      open the checkpoint file and validate its header against
+ *      the current fit, returns NULL if there is no usable file
+ *
+ ****************************************************************/
+
+static FILE* checkpoint_open_read(checkpoint_header_t* header)
+{
+  if (!checkpoint_active())
+    return NULL;
+
+  FILE* file = fopen(g_files.checkpointfile, "rb");
+
+  if (file == NULL)
+    return NULL;
+
+  if (fread(header, sizeof(checkpoint_header_t), 1, file) != 1 ||
+      header->magic != CHECKPOINT_MAGIC ||
+      header->version != CHECKPOINT_VERSION || header->ndim != g_calc.ndim ||
+      header->ndimtot != g_calc.ndimtot) {
+    warning("Ignoring incompatible checkpoint file %s\n",
+            g_files.checkpointfile);
+    fclose(file);
+    return NULL;
+  }
+
+  return file;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_open_write
+ *      start a new checkpoint in a temporary file; the finished
+ *      file replaces the previous checkpoint via rename, which
+ *      keeps the old state intact if the job dies mid-write
+ *
+ ****************************************************************/
+
+static FILE* checkpoint_open_write(int stage, char* tempname)
+{
+  sprintf(tempname, "%s.tmp", g_files.checkpointfile);
+
+  FILE* file = fopen(tempname, "wb");
+
+  if (file == NULL) {
+    warning("Could not write checkpoint file %s\n", tempname);
+    return NULL;
+  }
+
+  checkpoint_header_t header;
+
+  header.magic = CHECKPOINT_MAGIC;
+  header.version = CHECKPOINT_VERSION;
+  header.stage = stage;
+  header.ndim = g_calc.ndim;
+  header.ndimtot = g_calc.ndimtot;
+
+  if (fwrite(&header, sizeof(checkpoint_header_t), 1, file) != 1 ||
+      rng_write_state(file) != 0) {
+    fclose(file);
+    remove(tempname);
+    return NULL;
+  }
+
+  return file;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_commit
+ *      atomically replace the checkpoint with the finished
+ *      temporary file
+ *
+ ****************************************************************/
+
+static void checkpoint_commit(FILE* file, const char* tempname, int complete)
+{
+  fclose(file);
+
+  if (!complete || rename(tempname, g_files.checkpointfile) != 0) {
+    warning("Could not write checkpoint file %s\n", g_files.checkpointfile);
+    remove(tempname);
+  }
+}
+
+/****************************************************************
+ *
+ *  checkpoint_stage
+ *
+ ****************************************************************/
+
+int checkpoint_stage()
+{
+  checkpoint_header_t header;
+
+  FILE* file = checkpoint_open_read(&header);
+
+  if (file == NULL)
+    return CHECKPOINT_STAGE_NONE;
+
+  fclose(file);
+
+  return header.stage;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_read_anneal
+ *      restore the state of an interrupted annealing run, returns
+ *      1 on success
+ *
+ ****************************************************************/
+
+int checkpoint_read_anneal(int* loop_counter, int* loop_again, double* T,
+                           double* T_start, double* F, double* F_opt, double* v,
+                           double* F_old, int n_old, double* xi, double* xi_opt)
+{
+  checkpoint_header_t header;
+
+  FILE* file = checkpoint_open_read(&header);
+
+  if (file == NULL)
+    return 0;
+
+  if (header.stage != CHECKPOINT_STAGE_ANNEAL) {
+    fclose(file);
+    return 0;
+  }
+
+  int stored_n_old = 0;
+  int ok = rng_read_state(file) == 0;
+
+  ok = ok && fread(loop_counter, sizeof(int), 1, file) == 1;
+  ok = ok && fread(loop_again, sizeof(int), 1, file) == 1;
+  ok = ok && fread(&stored_n_old, sizeof(int), 1, file) == 1;
+  ok = ok && stored_n_old == n_old;
+  ok = ok && fread(T, sizeof(double), 1, file) == 1;
+  ok = ok && fread(T_start, sizeof(double), 1, file) == 1;
+  ok = ok && fread(F, sizeof(double), 1, file) == 1;
+  ok = ok && fread(F_opt, sizeof(double), 1, file) == 1;
+  ok = ok && fread(v, sizeof(double), g_calc.ndim, file) == (size_t)g_calc.ndim;
+  ok = ok && fread(F_old, sizeof(double), n_old, file) == (size_t)n_old;
+  ok = ok &&
+       fread(xi, sizeof(double), g_calc.ndimtot, file) == (size_t)g_calc.ndimtot;
+  ok = ok && fread(xi_opt, sizeof(double), g_calc.ndimtot, file) ==
+                 (size_t)g_calc.ndimtot;
+
+  fclose(file);
+
+  if (!ok) {
+    warning("Ignoring truncated checkpoint file %s\n", g_files.checkpointfile);
+    return 0;
+  }
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_write_anneal
+ *
+ ****************************************************************/
+
+void checkpoint_write_anneal(int loop_counter, int loop_again, double T,
+                             double T_start, double F, double F_opt,
+                             const double* v, const double* F_old, int n_old,
+                             const double* xi, const double* xi_opt)
+{
+  if (!checkpoint_active())
+    return;
+
+  char tempname[255];
+
+  FILE* file = checkpoint_open_write(CHECKPOINT_STAGE_ANNEAL, tempname);
+
+  if (file == NULL)
+    return;
+
+  int ok = fwrite(&loop_counter, sizeof(int), 1, file) == 1;
+
+  ok = ok && fwrite(&loop_again, sizeof(int), 1, file) == 1;
+  ok = ok && fwrite(&n_old, sizeof(int), 1, file) == 1;
+  ok = ok && fwrite(&T, sizeof(double), 1, file) == 1;
+  ok = ok && fwrite(&T_start, sizeof(double), 1, file) == 1;
+  ok = ok && fwrite(&F, sizeof(double), 1, file) == 1;
+  ok = ok && fwrite(&F_opt, sizeof(double), 1, file) == 1;
+  ok = ok &&
+       fwrite(v, sizeof(double), g_calc.ndim, file) == (size_t)g_calc.ndim;
+  ok = ok && fwrite(F_old, sizeof(double), n_old, file) == (size_t)n_old;
+  ok = ok && fwrite(xi, sizeof(double), g_calc.ndimtot, file) ==
+                 (size_t)g_calc.ndimtot;
+  ok = ok && fwrite(xi_opt, sizeof(double), g_calc.ndimtot, file) ==
+                 (size_t)g_calc.ndimtot;
+
+  checkpoint_commit(file, tempname, ok);
+}
+
+/****************************************************************
+ *
+ *  checkpoint_read_powell
+ *      restore the latest iterate of an interrupted powell run,
+ *      returns 1 on success
+ *
+ ****************************************************************/
+
+int checkpoint_read_powell(double* xi)
+{
+  checkpoint_header_t header;
+
+  FILE* file = checkpoint_open_read(&header);
+
+  if (file == NULL)
+    return 0;
+
+  if (header.stage != CHECKPOINT_STAGE_POWELL) {
+    fclose(file);
+    return 0;
+  }
+
+  int ok = rng_read_state(file) == 0;
+
+  ok = ok &&
+       fread(xi, sizeof(double), g_calc.ndimtot, file) == (size_t)g_calc.ndimtot;
+
+  fclose(file);
+
+  if (!ok) {
+    warning("Ignoring truncated checkpoint file %s\n", g_files.checkpointfile);
+    return 0;
+  }
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  checkpoint_write_powell
+ *
+ ****************************************************************/
+
+void checkpoint_write_powell(const double* xi)
+{
+  if (!checkpoint_active())
+    return;
+
+  char tempname[255];
+
+  FILE* file = checkpoint_open_write(CHECKPOINT_STAGE_POWELL, tempname);
+
+  if (file == NULL)
+    return;
+
+  int ok = fwrite(xi, sizeof(double), g_calc.ndimtot, file) ==
+           (size_t)g_calc.ndimtot;
+
+  checkpoint_commit(file, tempname, ok);
+}
+
+/****************************************************************
+ *
+ *  checkpoint_remove
+ *
+ ****************************************************************/
+
+void checkpoint_remove()
+{
+  if (!checkpoint_active())
+    return;
+
+  remove(g_files.checkpointfile);
+}
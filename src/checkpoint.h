@@ -0,0 +1,67 @@
+/****************************************************************
+ *
+ * checkpoint.h: Binary checkpoint/restart for the optimizer state
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef CHECKPOINT_H_INCLUDED
+#define CHECKPOINT_H_INCLUDED
+
+/* A checkpoint holds the complete state of the running optimization
+   stage - parameter vectors, schedule variables and the rng state - so
+   an interrupted fit resumes exactly where it stopped instead of
+   restarting cold from the last written potential file. The file is
+   written atomically (temporary file plus rename), so a job killed
+   mid-write leaves the previous checkpoint intact. */
+
+#define CHECKPOINT_STAGE_NONE 0
+#define CHECKPOINT_STAGE_ANNEAL 1
+#define CHECKPOINT_STAGE_POWELL 2
+
+// stage recorded in the checkpoint file, CHECKPOINT_STAGE_NONE if there
+// is no usable checkpoint
+int checkpoint_stage();
+
+// annealing state, restored/saved at the outer loop boundary; the
+// convergence flag is part of the record so a checkpoint written at the
+// final boundary does not make the resumed run anneal one extra round
+int checkpoint_read_anneal(int* loop_counter, int* loop_again, double* T,
+                           double* T_start, double* F, double* F_opt, double* v,
+                           double* F_old, int n_old, double* xi, double* xi_opt);
+void checkpoint_write_anneal(int loop_counter, int loop_again, double T,
+                             double T_start, double F, double F_opt,
+                             const double* v, const double* F_old, int n_old,
+                             const double* xi, const double* xi_opt);
+
+// powell state, the algorithm restarts cleanly from the parameter
+// vector alone
+int checkpoint_read_powell(double* xi);
+void checkpoint_write_powell(const double* xi);
+
+// remove the checkpoint after a completed fit
+void checkpoint_remove();
+
+#endif  // CHECKPOINT_H_INCLUDED
@@ -30,6 +30,7 @@
 #include "potfit.h"
 
 #include "chempot.h"
+#include "memory.h"
 
 /****************************************************************
   swap_chem_pot
@@ -165,3 +166,50 @@ double chemical_potential(int dimension, int* positions, double* values)
 
   return 0.0;
 }
+
+/****************************************************************
+  chemical_potential_cache_prepare
+
+    The atom counts of a configuration never change during a fit, so
+    its chemical potential energy only moves when the cp parameters
+    do. The per-config values are recomputed once when the cp block
+    of the parameter vector changed and served from a cache
+    otherwise. The refill runs before the threaded config loop, so
+    the lookups inside the loop touch read-only data.
+****************************************************************/
+
+static double* cp_energy_cache = NULL;
+static double* cp_values_snapshot = NULL;
+static int cp_cache_valid = 0;
+
+void chemical_potential_cache_prepare(int dimension, double* values)
+{
+  const int num_values = g_param.ntypes + g_param.compnodes;
+
+  if (cp_energy_cache == NULL) {
+    cp_energy_cache = (double*)Malloc(g_config.nconf * sizeof(double));
+    cp_values_snapshot = (double*)Malloc(num_values * sizeof(double));
+  }
+
+  if (cp_cache_valid &&
+      memcmp(cp_values_snapshot, values, num_values * sizeof(double)) == 0)
+    return;
+
+  memcpy(cp_values_snapshot, values, num_values * sizeof(double));
+
+  for (int h = 0; h < g_config.nconf; h++)
+    cp_energy_cache[h] =
+        chemical_potential(dimension, g_config.na_type[h], values);
+
+  cp_cache_valid = 1;
+}
+
+/****************************************************************
+  chemical_potential_cached
+    serve the energy of one configuration from the prepared cache
+****************************************************************/
+
+double chemical_potential_cached(int config_idx)
+{
+  return cp_energy_cache[config_idx];
+}
@@ -32,5 +32,7 @@
 
 void init_chemical_potential(int dimension);
 double chemical_potential(int dimension, int* positions, double* values);
+void chemical_potential_cache_prepare(int dimension, double* values);
+double chemical_potential_cached(int config_idx);
 
 #endif  // CHEMPOT_H_INCLUDED
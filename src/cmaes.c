@@ -0,0 +1,445 @@
+/****************************************************************
+ *
+ * cmaes.c: Implementation of the CMA-ES algorithm for global
+ *	optimization
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+/****************************************************************
+ *
+ *  Covariance matrix adaptation evolution strategy (CMA-ES) after
+ *  Hansen. Each generation samples a small population from a
+ *  multivariate normal distribution, ranks it by the error sum and
+ *  adapts the mean, the step size and the covariance matrix of the
+ *  sampling distribution. The population of one generation is
+ *  independent, so it is evaluated through the same batch machinery
+ *  as the differential evolution trials, one vector per evaluation
+ *  group. With cmaes_sigma set, CMA-ES replaces the differential
+ *  evolution as the global stage; the eigendecomposition of the
+ *  covariance matrix uses the linear algebra library potfit is
+ *  built with anyway.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#if defined(EVO)
+
+#if defined(MKL)
+#include <mkl_lapack.h>
+#elif defined(__ACCELERATE__)
+#include <Accelerate/Accelerate.h>
+#elif defined(LAPACK)
+#include <lapacke.h>
+#else
+#error No math library defined!
+#endif  // MKL
+
+#if defined(LAPACK)
+// the reference library only ships the Fortran entry point
+void dsyev_(const char* jobz, const char* uplo, int* n, double* a, int* lda,
+            double* w, double* work, int* lwork, int* info);
+#endif  // LAPACK
+
+#include "eval_float.h"
+#include "force.h"
+#include "force_batch.h"
+#include "memory.h"
+#include "optimize.h"
+#include "potential_output.h"
+#include "random.h"
+#include "trace.h"
+#include "utils.h"
+
+#define D (g_calc.ndimtot + 2)
+
+// number of trial vectors evaluated concurrently
+#if defined(MPI)
+#define CMAES_BATCH g_mpi.num_groups
+#else
+#define CMAES_BATCH 1
+#endif  // MPI
+
+// mini-batch resampling period and the crit/evo_threshold ratio below
+// which full evaluations resume, as in the differential evolution
+#define MINIBATCH_PERIOD 10
+#define MINIBATCH_FULL_CRIT 100.0
+
+// implemented in diff_evo.c
+void evaluate_trial_batch(double** trials, double* cost, int count,
+                          double* forces);
+
+/****************************************************************
+ *
+ *  rank the population of one generation by cost
+ *
+ ****************************************************************/
+
+static void rank_population(const double* cost, int* order, int lambda)
+{
+  for (int i = 0; i < lambda; i++)
+    order[i] = i;
+
+  // insertion sort, the population is small
+  for (int i = 1; i < lambda; i++) {
+    int k = order[i];
+    int j = i - 1;
+
+    while (j >= 0 && cost[order[j]] > cost[k]) {
+      order[j + 1] = order[j];
+      j--;
+    }
+
+    order[j + 1] = k;
+  }
+}
+
+/****************************************************************
+ *
+ *  eigendecomposition of the covariance matrix: B receives the
+ *  eigenvectors, diag the square roots of the eigenvalues
+ *
+ ****************************************************************/
+
+static void decompose_covariance(const double* C, double* B, double* diag,
+                                 int n, double* work, int lwork)
+{
+  char jobz[1] = "V";
+  char uplo[1] = "U";
+  int info = 0;
+
+  // the matrix is symmetric, so the storage order does not matter;
+  // eigenvector k ends up in B[k * n + 0 .. k * n + n - 1]
+  memcpy(B, C, n * n * sizeof(double));
+
+  dsyev_(jobz, uplo, &n, B, &n, diag, work, &lwork, &info);
+
+  if (info != 0)
+    error(1, "Eigendecomposition of the CMA-ES covariance failed (info %d)\n",
+          info);
+
+  for (int i = 0; i < n; i++)
+    diag[i] = sqrt(MAX(diag[i], 1.0e-30));
+}
+
+/****************************************************************
+ *
+ *  covariance matrix adaptation evolution strategy
+ *
+ ****************************************************************/
+
+void run_cmaes(double* xi)
+{
+  const int n = g_calc.ndim;
+
+  // population size and recombination weights (Hansen's defaults)
+  const int lambda = 4 + (int)(3.0 * log((double)n));
+  const int mu = lambda / 2;
+
+  double weights[mu];
+  double weight_sum = 0.0;
+
+  for (int i = 0; i < mu; i++) {
+    weights[i] = log(mu + 0.5) - log(i + 1.0);
+    weight_sum += weights[i];
+  }
+
+  double mueff_den = 0.0;
+
+  for (int i = 0; i < mu; i++) {
+    weights[i] /= weight_sum;
+    mueff_den += weights[i] * weights[i];
+  }
+
+  const double mueff = 1.0 / mueff_den;
+
+  // learning rates and damping
+  const double cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+  const double cs = (mueff + 2.0) / (n + mueff + 5.0);
+  const double c1 = 2.0 / (dsquare(n + 1.3) + mueff);
+  const double cmu = MIN(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) /
+                                       (dsquare(n + 2.0) + mueff));
+  const double damps =
+      1.0 + 2.0 * MAX(0.0, sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+  const double chi_n =
+      sqrt((double)n) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+
+  // generations between eigendecompositions of the covariance
+  const int eigen_period = MAX(1, (int)(1.0 / ((c1 + cmu) * n * 10.0)));
+
+  // distribution state
+  double* m = (double*)Malloc(n * sizeof(double));
+  double* C = (double*)Malloc(n * n * sizeof(double));
+  double* B = (double*)Malloc(n * n * sizeof(double));
+  double* diag = (double*)Malloc(n * sizeof(double));
+  double* ps = (double*)Malloc(n * sizeof(double));
+  double* pc = (double*)Malloc(n * sizeof(double));
+  double* ym = (double*)Malloc(n * sizeof(double));
+  double* tmp = (double*)Malloc(n * sizeof(double));
+  double sigma = g_param.cmaes_sigma;
+
+  for (int i = 0; i < n; i++) {
+    m[i] = xi[g_pot.opt_pot.idx[i]];
+    C[i * n + i] = 1.0;
+    B[i * n + i] = 1.0;
+    diag[i] = 1.0;
+  }
+
+  // workspace query for the eigendecomposition
+  int lwork = -1;
+  {
+    char jobz[1] = "V";
+    char uplo[1] = "U";
+    int info = 0;
+    int nn = n;
+    double work_size = 0.0;
+
+    dsyev_(jobz, uplo, &nn, B, &nn, diag, &work_size, &lwork, &info);
+    lwork = (int)work_size;
+  }
+  double* work = (double*)Malloc(lwork * sizeof(double));
+
+  // population of one generation
+  double** trials = (double**)Malloc(lambda * sizeof(double*));
+  double* cost = (double*)Malloc(lambda * sizeof(double));
+  double** y = (double**)Malloc(lambda * sizeof(double*));
+  int* order = (int*)Malloc(lambda * sizeof(int));
+
+  for (int k = 0; k < lambda; k++) {
+    trials[k] = (double*)Malloc(D * sizeof(double));
+    memcpy(trials[k], xi, g_calc.ndimtot * sizeof(double));
+    y[k] = (double*)Malloc(n * sizeof(double));
+  }
+
+  double* best = (double*)Malloc(D * sizeof(double));
+  double* forces = (double*)Malloc(g_calc.mdim * sizeof(double));
+  double min_cost = 10e10;
+  double crit = 1000.0;
+  int gen = 0;
+  int last_eigen = 0;
+
+  memcpy(best, xi, g_calc.ndimtot * sizeof(double));
+
+  // only the cost of each trial travels back to the root process
+  gather_forces_sum_only(1);
+
+  /* a few significant digits are plenty for the stochastic search */
+  eval_float_set(1);
+
+  /* the early generations only need a rough error estimate */
+  if (g_force_batch.enabled)
+    force_batch_select(g_param.eval_batch);
+
+  printf("Starting CMA-ES with population %d and sigma %g.\n", lambda, sigma);
+  printf("Gens\t\tOptimum\t\tAverage error sum\t\tSigma\n");
+  fflush(stdout);
+
+  while (crit >= g_param.evo_threshold && min_cost >= g_param.evo_threshold) {
+    // refresh the eigendecomposition lazily, the distribution only
+    // drifts by O(c1 + cmu) per generation
+    if (gen == 0 || gen - last_eigen >= eigen_period) {
+      decompose_covariance(C, B, diag, n, work, lwork);
+      last_eigen = gen;
+    }
+
+    // sample the population: x = m + sigma * B * diag * z
+    for (int k = 0; k < lambda; k++) {
+      for (int j = 0; j < n; j++)
+        tmp[j] = diag[j] * normdist();
+
+      for (int i = 0; i < n; i++) {
+        double yi = 0.0;
+
+        for (int j = 0; j < n; j++)
+          yi += B[j * n + i] * tmp[j];
+
+        double x = m[i] + sigma * yi;
+
+#if defined(APOT) || defined(KIM)
+        double pmin = g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]]
+                                           [g_pot.apot_table.idxparam[i]];
+        double pmax = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]]
+                                           [g_pot.apot_table.idxparam[i]];
+
+        if (x > pmax)
+          x = pmax;
+        else if (x < pmin)
+          x = pmin;
+#endif  // APOT || KIM
+
+        // the adaptation sees the repaired sampling step
+        y[k][i] = (x - m[i]) / sigma;
+        trials[k][g_pot.opt_pot.idx[i]] = x;
+      }
+    }
+
+    // evaluate the generation, one trial per evaluation group
+    for (int k = 0; k < lambda; k += CMAES_BATCH)
+      evaluate_trial_batch(trials + k, cost + k, MIN(CMAES_BATCH, lambda - k),
+                           forces);
+
+    rank_population(cost, order, lambda);
+
+    double cost_sum = 0.0;
+
+    for (int k = 0; k < lambda; k++)
+      cost_sum += cost[k];
+
+    for (int k = 0; k < lambda; k++) {
+      trace_record(cost[k], 0.0, cost[k] < min_cost);
+
+      if (cost[k] < min_cost) {
+        min_cost = cost[k];
+        memcpy(best, trials[k], g_calc.ndimtot * sizeof(double));
+
+        if (g_files.tempfile && strlen(g_files.tempfile)) {
+          for (int j = 0; j < g_calc.ndim; j++)
+#if defined(APOT) || defined(KIM)
+            g_pot.apot_table.values[g_pot.apot_table.idxpot[j]]
+                                   [g_pot.apot_table.idxparam[j]] =
+                trials[k][g_pot.opt_pot.idx[j]];
+#else
+            xi[g_pot.opt_pot.idx[j]] = trials[k][g_pot.opt_pot.idx[j]];
+#endif  // APOT || KIM
+          write_pot_table_potfit_async(g_files.tempfile);
+        }
+      }
+    }
+
+    // recombination: the mean moves to the weighted mu best
+    for (int i = 0; i < n; i++) {
+      ym[i] = 0.0;
+
+      for (int k = 0; k < mu; k++)
+        ym[i] += weights[k] * y[order[k]][i];
+
+      m[i] += sigma * ym[i];
+    }
+
+    // step size control with the conjugate evolution path
+    // ps = (1 - cs) ps + sqrt(cs (2 - cs) mueff) C^(-1/2) ym
+    for (int j = 0; j < n; j++) {
+      double tj = 0.0;
+
+      for (int i = 0; i < n; i++)
+        tj += B[j * n + i] * ym[i];
+
+      tmp[j] = tj / diag[j];
+    }
+
+    double ps_norm = 0.0;
+
+    for (int i = 0; i < n; i++) {
+      double ci = 0.0;
+
+      for (int j = 0; j < n; j++)
+        ci += B[j * n + i] * tmp[j];
+
+      ps[i] = (1.0 - cs) * ps[i] + sqrt(cs * (2.0 - cs) * mueff) * ci;
+      ps_norm += ps[i] * ps[i];
+    }
+
+    ps_norm = sqrt(ps_norm);
+
+    const int hsig =
+        ps_norm / sqrt(1.0 - pow(1.0 - cs, 2.0 * (gen + 1))) / chi_n <
+        1.4 + 2.0 / (n + 1.0);
+
+    // covariance adaptation: rank-one and rank-mu updates
+    for (int i = 0; i < n; i++)
+      pc[i] = (1.0 - cc) * pc[i] +
+              hsig * sqrt(cc * (2.0 - cc) * mueff) * ym[i];
+
+    const double c_old =
+        1.0 - c1 - cmu + (1.0 - hsig) * c1 * cc * (2.0 - cc);
+
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j <= i; j++) {
+        double cij = c_old * C[i * n + j] + c1 * pc[i] * pc[j];
+
+        for (int k = 0; k < mu; k++)
+          cij += cmu * weights[k] * y[order[k]][i] * y[order[k]][j];
+
+        C[i * n + j] = cij;
+        C[j * n + i] = cij;
+      }
+    }
+
+    sigma *= exp((cs / damps) * (ps_norm / chi_n - 1.0));
+
+    crit = cost[order[lambda - 1]] - cost[order[0]];
+    gen++;
+
+    printf("%5d\t\t%15f\t%20f\t\t%.2e\n", gen, min_cost, cost_sum / lambda,
+           sigma);
+    fflush(stdout);
+
+    // the distribution has collapsed, more generations cannot move it
+    if (sigma * diag[n - 1] < 1.0e-15) {
+      printf("\nCMA-ES stopped: the sampling distribution collapsed.\n");
+      break;
+    }
+
+    /* End optimization if break flagfile exists */
+    if (g_files.flagfile && strlen(g_files.flagfile)) {
+      FILE* ff = fopen(g_files.flagfile, "r");
+
+      if (NULL != ff) {
+        printf("\nCMA-ES terminated ");
+        printf("in presence of break flagfile \"%s\"!\n\n", g_files.flagfile);
+        fclose(ff);
+        remove(g_files.flagfile);
+        break;
+      }
+    }
+
+    /* resample the mini-batch periodically to correct the drift of the
+       estimates and switch to full evaluations close to convergence;
+       the ranking only ever compares costs within one generation, so
+       no population needs to be recomputed */
+    if (g_force_batch.active) {
+      if (crit < MINIBATCH_FULL_CRIT * g_param.evo_threshold)
+        force_batch_clear();
+      else if (gen % MINIBATCH_PERIOD == 0)
+        force_batch_select(g_param.eval_batch);
+    }
+  }
+
+  /* the flagfile break can leave a subset selected */
+  force_batch_clear();
+
+  /* powell polishes in full precision */
+  eval_float_set(0);
+
+  gather_forces_sum_only(0);
+
+  printf("Finished CMA-ES after %d generations.\n", gen);
+  fflush(stdout);
+
+  memcpy(xi, best, g_calc.ndimtot * sizeof(double));
+}
+
+#endif  // EVO
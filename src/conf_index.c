@@ -0,0 +1,185 @@
+/****************************************************************
+ *
+ * conf_index.c: Online configuration importance index
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "potfit.h"
+
+#include "conf_index.h"
+#include "force_abort.h"
+#include "force_batch.h"
+
+/* the index is updated by the pair and EAM force routines and needs
+   every configuration to be evaluated on a single process */
+
+#if (defined(PAIR) || defined(EAM)) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM)
+#define CONF_INDEX_AVAILABLE
+#endif
+
+// weight of a new sample in the moving averages
+#define CONF_INDEX_DECAY 0.1
+
+static conf_index_header_t* g_conf_index_header = NULL;
+static conf_index_record_t* g_conf_index_records = NULL;
+static size_t g_conf_index_length = 0;
+
+/****************************************************************
+  init_conf_index
+    map the index file with one record slot per configuration
+****************************************************************/
+
+void init_conf_index()
+{
+  if (g_files.confindexfile == NULL || g_mpi.myid != 0)
+    return;
+
+#if !defined(CONF_INDEX_AVAILABLE)
+  warning(
+      "The configuration index is only available for serial pair and EAM "
+      "binaries, conf_index_file is ignored!\n");
+#else
+  g_conf_index_length =
+      sizeof(conf_index_header_t) + g_config.nconf * sizeof(conf_index_record_t);
+
+  int fd = open(g_files.confindexfile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0) {
+    warning("Could not open configuration index file %s, index disabled!\n",
+            g_files.confindexfile);
+    return;
+  }
+
+  if (ftruncate(fd, g_conf_index_length) != 0) {
+    warning("Could not resize configuration index file %s, index disabled!\n",
+            g_files.confindexfile);
+    close(fd);
+    return;
+  }
+
+  void* map = mmap(NULL, g_conf_index_length, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if (map == MAP_FAILED) {
+    warning("Could not map configuration index file %s, index disabled!\n",
+            g_files.confindexfile);
+    return;
+  }
+
+  g_conf_index_header = (conf_index_header_t*)map;
+  g_conf_index_records =
+      (conf_index_record_t*)((char*)map + sizeof(conf_index_header_t));
+
+  memcpy(g_conf_index_header->magic, "PFCINDX", 8);
+  g_conf_index_header->version = 1;
+  g_conf_index_header->record_size = sizeof(conf_index_record_t);
+  g_conf_index_header->nconf = g_config.nconf;
+  g_conf_index_header->evals = 0;
+
+  for (int i = 0; i < g_config.nconf; i++)
+    g_conf_index_records[i].natoms = g_config.inconf[i];
+#endif  // !CONF_INDEX_AVAILABLE
+}
+
+/****************************************************************
+  conf_index_update
+    fold the error contribution of a recomputed configuration into
+    its record; with the force cache active a configuration is only
+    recomputed when a parameter it samples has changed, so the
+    change of its contribution measures the sensitivity to exactly
+    those parameter moves
+****************************************************************/
+
+void conf_index_update(int config_idx, double error_part)
+{
+  if (g_conf_index_header == NULL)
+    return;
+
+  // mini-batch evaluations rescale the configuration weights, the
+  // contributions are not comparable to those of full evaluations
+  if (g_force_batch.active)
+    return;
+
+  conf_index_record_t* rec = g_conf_index_records + config_idx;
+
+  if (rec->updates == 0) {
+    rec->error_mean = error_part;
+  } else {
+    rec->sensitivity += CONF_INDEX_DECAY *
+                        (fabs(error_part - rec->error_part) - rec->sensitivity);
+    rec->error_mean += CONF_INDEX_DECAY * (error_part - rec->error_mean);
+  }
+
+  rec->error_part = error_part;
+  rec->updates++;
+}
+
+/****************************************************************
+  conf_index_advance
+    count a completed full evaluation; comparing the counter with
+    the per-configuration update counts shows a reader how rarely
+    each configuration responds to the optimizer's moves
+****************************************************************/
+
+void conf_index_advance()
+{
+  if (g_conf_index_header == NULL)
+    return;
+
+  // partial evaluations were not folded into the records
+  if (g_force_batch.active || g_force_abort.rejected)
+    return;
+
+  g_conf_index_header->evals++;
+}
+
+/****************************************************************
+  shutdown_conf_index
+    the kernel flushes the mapping on exit anyway, the explicit
+    sync just gets the data out earlier on a clean shutdown
+****************************************************************/
+
+void shutdown_conf_index()
+{
+  if (g_conf_index_header == NULL)
+    return;
+
+  msync(g_conf_index_header, g_conf_index_length, MS_ASYNC);
+  munmap(g_conf_index_header, g_conf_index_length);
+
+  g_conf_index_header = NULL;
+  g_conf_index_records = NULL;
+}
@@ -0,0 +1,76 @@
+/****************************************************************
+ *
+ * conf_index.h: potfit configuration importance index header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef CONF_INDEX_H_INCLUDED
+#define CONF_INDEX_H_INCLUDED
+
+#include <stdint.h>
+
+/****************************************************************
+ *
+ *  Per-configuration importance index. With the conf_index_file
+ *  parameter set, the force routines keep one fixed-size record
+ *  per configuration in a memory-mapped file: the last recomputed
+ *  error contribution, a moving average of it, and a moving
+ *  average of how much it changed per recompute. The update is a
+ *  few stores into the mapping inside the configuration loop, the
+ *  kernel writes the pages back lazily.
+ *
+ *  The index tells a reader which configurations actually
+ *  constrain the fit: a configuration with a small mean
+ *  contribution that barely moves under parameter changes is
+ *  redundant and a candidate for pruning, one with a large or
+ *  volatile contribution should come first in screening orders
+ *  and mini-batch samples. The file can be read while the fit is
+ *  still running.
+ *
+ ****************************************************************/
+
+typedef struct {
+  char magic[8];       /* "PFCINDX" */
+  int32_t version;     /* index format version */
+  int32_t record_size; /* sizeof(conf_index_record_t) */
+  int64_t nconf;       /* number of record slots (one per configuration) */
+  int64_t evals;       /* full force evaluations seen so far */
+} conf_index_header_t;
+
+typedef struct {
+  double error_part;  /* last recomputed error contribution */
+  double error_mean;  /* moving average of the error contribution */
+  double sensitivity; /* moving average of its change per recompute */
+  int32_t updates;    /* times this configuration was recomputed */
+  int32_t natoms;     /* atoms in this configuration */
+} conf_index_record_t;
+
+void init_conf_index(void);
+void conf_index_update(int config_idx, double error_part);
+void conf_index_advance(void);
+void shutdown_conf_index(void);
+
+#endif  // CONF_INDEX_H_INCLUDED
@@ -27,7 +27,16 @@
  *
  ****************************************************************/
 
+// ftruncate and posix_madvise are not visible under plain -std=c99
+#define _DEFAULT_SOURCE
+
 #include <float.h>
+#include <stdint.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #if defined(KIM)
 #include <KIM_SpeciesName.h>
@@ -39,6 +48,27 @@
 #include "memory.h"
 #include "utils.h"
 
+// configurations at least this large use the cell-list neighbor search
+#define CELL_LIST_MIN_ATOMS 500
+
+// relative padding on the squared cutoff used to prefilter neighbor
+// candidates; the padded square never rejects a distance the exact
+// comparison r <= rcut accepts, so the square root is only taken
+// for (near) neighbors
+#define SQUARE_CUTOFF_SLACK (1.0 + 1.0e-12)
+
+// binary sidecar cache for the parsed configuration file
+#define CONFIG_CACHE_MAGIC 0x63636670
+#define CONFIG_CACHE_VERSION 1
+
+// with config_stream the packed neighbor arrays live in an unlinked
+// file-backed scratch mapping instead of the heap, so the OS can write
+// cold blocks back to disk and the dataset is no longer limited by the
+// physical memory of the machine
+static char* g_soa_stream_base = NULL;
+static size_t g_soa_stream_size = 0;
+static size_t g_soa_stream_used = 0;
+
 typedef struct {
   const char* filename;
   int atom_count;
@@ -63,6 +93,50 @@ typedef struct {
 #endif  // CONTRIB
 } config_state;
 
+#if !defined(KIM)
+
+// header of the binary configuration cache, followed by the potential
+// table geometry, the mindist/rcut/rmin matrices, the per-configuration
+// data and the atom, neighbor and angle tables
+typedef struct {
+  int magic;
+  int version;
+  int features;
+  int format_type;
+  int sizeof_atom;
+  int sizeof_neigh;
+  int sizeof_angle;
+  int ntypes;
+  int ncols;
+  int nconf;
+  int natoms;
+  int num_neigh;
+  int num_angles;
+  int with_forces;
+  int with_stresses;
+  int max_atom_type;
+  long long config_mtime;
+  long long config_size;
+  double global_cell_scale;
+  double rcutmax;
+} config_cache_header_t;
+
+int config_cache_load(const char* filename, double* mindist, int* with_forces,
+                      int* with_stresses, int* max_atom_type,
+                      int num_fixed_elements);
+void config_cache_write(const char* filename, const double* mindist,
+                        int with_forces, int with_stresses, int max_atom_type,
+                        int first_conf, int first_atom);
+
+#endif  // !KIM
+
+void finalize_config_read(double* mindist, int with_forces, int with_stresses,
+                          int max_atom_type);
+
+#if !defined(KIM)
+static void reorder_atoms_morton(void);
+#endif  // !KIM
+
 void reset_cstate(config_state* cstate);
 void create_memory_for_configs(FILE* config_file, const char* filename);
 void init_atom_memory(atom_t* atom);
@@ -70,7 +144,27 @@ void read_box_vector(char const* pline, vector* pvect, const char* name, config_
 void read_chemical_elements(char* psrc, config_state* cstate);
 void init_box_vectors(config_state* cstate);
 void init_neighbors(config_state* cstate, double* mindist);
-void set_neighbor_slot(neigh_t* neighbor, int col, double r, int neighbor_slot);
+#if !defined(KIM)
+void init_neighbors_cells(config_state* cstate, double* mindist);
+void store_neighbors(int i, int count, const int* nrs, const double* ddx,
+                     const double* ddy, const double* ddz, const double* rs,
+                     double* mindist);
+static void make_image_shift_table(const config_state* cstate, double* imx,
+                                   double* imy, double* imz);
+static void compute_image_distances(const config_state* cstate, vector d,
+                                    const double* imx, const double* imy,
+                                    const double* imz, int num_images,
+                                    double* ddx, double* ddy, double* ddz,
+                                    double* rr);
+#endif  // !KIM
+// static with constant slot arguments at every call site, so the
+// compiler propagates the slot index and the per-slot bookkeeping
+// compiles to straight-line code (SLOTS is fixed per interaction)
+static void set_neighbor_slot(neigh_t* neighbor, int col, double r, int neighbor_slot);
+static void compute_spline_position(int col, double r, int* pslot, double* pshift, double* pstep);
+#if defined(APOT)
+static void update_neighbor_slots(neigh_t* neighbor, double r, int neighbor_slot);
+#endif  // APOT
 void init_angles(config_state* cstate);
 
 double make_box(config_state* cstate);
@@ -82,28 +176,24 @@ void read_sphere_center(char const* pline, config_state* cstate);
 int does_contribute(vector atom_pos, config_state* cstate);
 #endif  // CONTRIB
 
+static void read_config_file(const char* filename, int num_fixed_elements,
+                             double* mindist, int* with_forces,
+                             int* with_stresses, int* max_atom_type);
+
 /****************************************************************
   read_config
+    read all configuration files listed in the parameter file, one
+    dataset per file, and apply the per-dataset weight factors
 ****************************************************************/
 
-void read_config(const char* filename)
+void read_config(void)
 {
-  config_state cstate;
-
-  char buffer[1024];
-  char* ptr = NULL;
-  char* res = NULL;
+  int num_fixed_elements = 0;
 
   int max_atom_type = -1;
   int with_forces = 0;
   int with_stresses = 0;
 
-  fpos_t filepos;
-
-  memset(&cstate, 0, sizeof(cstate));
-
-  cstate.filename = filename;
-
   // initialize elements array if not yet done from potential file
   if (g_config.elements == NULL) {
     g_config.elements = (char const**)Malloc(g_param.ntypes * sizeof(char*));
@@ -112,7 +202,7 @@ void read_config(const char* filename)
       sprintf((char*)g_config.elements[i], "%d", i);
     }
   } else
-    cstate.num_fixed_elements = g_param.ntypes;
+    num_fixed_elements = g_param.ntypes;
 
   // initialize minimum distance array
   double* mindist = (double*)Malloc(isquare(g_param.ntypes) * sizeof(double));
@@ -121,6 +211,82 @@ void read_config(const char* filename)
   for (int i = 0; i < g_param.ntypes * g_param.ntypes; i++)
     mindist[i] = DBL_MAX;
 
+  g_config.num_datasets = g_files.num_config_files;
+  g_config.dataset_start =
+      (int*)Malloc((g_files.num_config_files + 1) * sizeof(int));
+
+  for (int n = 0; n < g_files.num_config_files; n++) {
+    g_config.dataset_start[n] = g_config.nconf;
+
+    read_config_file(g_files.config_files[n], num_fixed_elements, mindist,
+                     &with_forces, &with_stresses, &max_atom_type);
+
+    // scale the configuration weights of this dataset
+    if (g_files.config_weights[n] != 1.0)
+      for (int i = g_config.dataset_start[n]; i < g_config.nconf; i++)
+        g_config.conf_weight[i] *= g_files.config_weights[n];
+  }
+
+  g_config.dataset_start[g_files.num_config_files] = g_config.nconf;
+
+  finalize_config_read(mindist, with_forces, with_stresses, max_atom_type);
+}
+
+/****************************************************************
+  read_config_file
+    parse a single configuration file (or restore it from its
+    binary cache) and append its configurations to the tables
+****************************************************************/
+
+static void read_config_file(const char* filename, int num_fixed_elements,
+                             double* mindist, int* global_with_forces,
+                             int* global_with_stresses,
+                             int* global_max_atom_type)
+{
+  config_state cstate;
+
+  char buffer[1024];
+  char* ptr = NULL;
+  char* res = NULL;
+
+  int max_atom_type = -1;
+  int with_forces = 0;
+  int with_stresses = 0;
+
+  fpos_t filepos;
+
+  memset(&cstate, 0, sizeof(cstate));
+
+  cstate.filename = filename;
+  cstate.num_fixed_elements = num_fixed_elements;
+
+  // per-file minimum distances, so each binary cache stays independent
+  // of the other datasets it was loaded with
+  double* file_mindist = (double*)Malloc(isquare(g_param.ntypes) * sizeof(double));
+
+  for (int i = 0; i < g_param.ntypes * g_param.ntypes; i++)
+    file_mindist[i] = DBL_MAX;
+
+#if !defined(KIM)
+  // try to load the parsed configurations from the binary cache
+  if (g_param.config_cache &&
+      config_cache_load(filename, file_mindist, &with_forces, &with_stresses,
+                        &max_atom_type, cstate.num_fixed_elements)) {
+    for (int i = 0; i < g_param.ntypes * g_param.ntypes; i++)
+      mindist[i] = MIN(mindist[i], file_mindist[i]);
+    *global_with_forces += with_forces;
+    *global_with_stresses += with_stresses;
+    *global_max_atom_type = MAX(*global_max_atom_type, max_atom_type);
+    return;
+  }
+#endif  // !KIM
+
+#if !defined(KIM)
+  // base offsets of this dataset, the cache only covers the data after them
+  const int first_conf = g_config.nconf;
+  const int first_atom = g_config.natoms;
+#endif  // !KIM
+
   // open file
   FILE* config_file = fopen(filename, "r");
   if (config_file == NULL)
@@ -359,7 +525,7 @@ void read_config(const char* filename)
 
     init_box_vectors(&cstate);
 
-    init_neighbors(&cstate, mindist);
+    init_neighbors(&cstate, file_mindist);
 
     init_angles(&cstate);
 
@@ -375,6 +541,233 @@ void read_config(const char* filename)
   // the calculation of the neighbor lists is now complete
   printf( "Reading configuration file >> %s << and calculating neighbor lists ... done\n", filename);
 
+#if !defined(KIM)
+  // store the parsed configurations for faster future startups
+  if (g_param.config_cache)
+    config_cache_write(filename, file_mindist, with_forces, with_stresses,
+                       max_atom_type, first_conf, first_atom);
+#endif  // !KIM
+
+  for (int i = 0; i < g_param.ntypes * g_param.ntypes; i++)
+    mindist[i] = MIN(mindist[i], file_mindist[i]);
+  *global_with_forces += with_forces;
+  *global_with_stresses += with_stresses;
+  *global_max_atom_type = MAX(*global_max_atom_type, max_atom_type);
+}
+
+#if !defined(KIM)
+
+/****************************************************************
+  morton_key
+    interleave the bits of the three cell coordinates (10 bits
+    each), so that keys close to each other belong to cells close
+    in space
+****************************************************************/
+
+static uint32_t morton_key(uint32_t x, uint32_t y, uint32_t z)
+{
+  uint32_t key = 0;
+
+  for (int bit = 0; bit < 10; bit++) {
+    key |= ((x >> bit) & 1u) << (3 * bit + 2);
+    key |= ((y >> bit) & 1u) << (3 * bit + 1);
+    key |= ((z >> bit) & 1u) << (3 * bit);
+  }
+
+  return key;
+}
+
+typedef struct {
+  uint32_t key;
+  int idx;
+} morton_entry_t;
+
+static int compare_morton_entries(const void* a, const void* b)
+{
+  const morton_entry_t* entry_a = (const morton_entry_t*)a;
+  const morton_entry_t* entry_b = (const morton_entry_t*)b;
+
+  if (entry_a->key != entry_b->key)
+    return (entry_a->key < entry_b->key) ? -1 : 1;
+
+  // break ties in file order, so the pass is deterministic
+  return entry_a->idx - entry_b->idx;
+}
+
+/****************************************************************
+  reorder_atoms_morton
+    sort the atoms of every configuration along a Morton curve, so
+    that atoms close in space are close in memory and the neighbor
+    loops touch the atom table and the force vector in a local
+    pattern. Everything downstream (reference force vector,
+    distribution tables, packed neighbor data) is derived from the
+    reordered table, only the error report translates the atom
+    numbers back to the positions in the configuration file. The
+    binary cache is written before this pass runs and always keeps
+    the file order.
+
+    Without THREEBODY the neighbor tables are half lists (see
+    init_neighbors): each pair is stored once, on the atom with the
+    smaller number, and the kernels scatter the contribution of the
+    other side. The EAM-like density passes read the scattered
+    values in atom order, so this convention is not optional and is
+    restored after the sort by moving entries whose atoms changed
+    relative order to the other atom of their pair.
+****************************************************************/
+
+static void reorder_atoms_morton(void)
+{
+  int max_atoms = 0;
+
+  for (int i = 0; i < g_config.nconf; i++)
+    max_atoms = MAX(max_atoms, g_config.inconf[i]);
+
+  morton_entry_t* entries =
+      (morton_entry_t*)Malloc(max_atoms * sizeof(morton_entry_t));
+  atom_t* sorted = (atom_t*)Malloc(max_atoms * sizeof(atom_t));
+  int* new_pos = (int*)Malloc(max_atoms * sizeof(int));
+
+#if !defined(THREEBODY)
+  neigh_t** home_neigh = (neigh_t**)Malloc(max_atoms * sizeof(neigh_t*));
+  int* home_count = (int*)Malloc(max_atoms * sizeof(int));
+  int* home_fill = (int*)Malloc(max_atoms * sizeof(int));
+#endif  // !THREEBODY
+
+  g_config.atom_orig_idx = (int*)Malloc(g_config.natoms * sizeof(int));
+
+  for (int h = 0; h < g_config.nconf; h++) {
+    const int start = g_config.cnfstart[h];
+    const int count = g_config.inconf[h];
+    atom_t* atoms = g_config.atoms + start;
+
+    // cell coordinates relative to the bounding box of the configuration
+    vector low = atoms[0].pos;
+    vector high = atoms[0].pos;
+
+    for (int i = 1; i < count; i++) {
+      low.x = MIN(low.x, atoms[i].pos.x);
+      low.y = MIN(low.y, atoms[i].pos.y);
+      low.z = MIN(low.z, atoms[i].pos.z);
+      high.x = MAX(high.x, atoms[i].pos.x);
+      high.y = MAX(high.y, atoms[i].pos.y);
+      high.z = MAX(high.z, atoms[i].pos.z);
+    }
+
+    const double scale_x = (high.x > low.x) ? 1023.0 / (high.x - low.x) : 0.0;
+    const double scale_y = (high.y > low.y) ? 1023.0 / (high.y - low.y) : 0.0;
+    const double scale_z = (high.z > low.z) ? 1023.0 / (high.z - low.z) : 0.0;
+
+    for (int i = 0; i < count; i++) {
+      entries[i].key =
+          morton_key((uint32_t)((atoms[i].pos.x - low.x) * scale_x),
+                     (uint32_t)((atoms[i].pos.y - low.y) * scale_y),
+                     (uint32_t)((atoms[i].pos.z - low.z) * scale_z));
+      entries[i].idx = i;
+    }
+
+    qsort(entries, count, sizeof(morton_entry_t), compare_morton_entries);
+
+    for (int i = 0; i < count; i++) {
+      sorted[i] = atoms[entries[i].idx];
+      new_pos[entries[i].idx] = i;
+      g_config.atom_orig_idx[start + i] = start + entries[i].idx;
+    }
+
+    memcpy(atoms, sorted, count * sizeof(atom_t));
+
+    // the neighbor tables store global atom numbers and atoms only
+    // ever neighbor atoms of their own configuration
+    for (int i = 0; i < count; i++)
+      for (int j = 0; j < atoms[i].num_neigh; j++) {
+        neigh_t* neighbor = atoms[i].neigh + j;
+        neighbor->nr = start + new_pos[neighbor->nr - start];
+      }
+
+#if !defined(THREEBODY)
+    // rebuild the half lists: entries whose atoms changed relative
+    // order move to the other atom of their pair, the old storage is
+    // left to the allocator
+    int num_entries = 0;
+
+    for (int i = 0; i < count; i++) {
+      num_entries += atoms[i].num_neigh;
+      home_count[i] = 0;
+    }
+
+    for (int i = 0; i < count; i++)
+      for (int j = 0; j < atoms[i].num_neigh; j++) {
+        const int other = atoms[i].neigh[j].nr - start;
+        home_count[MIN(i, other)]++;
+      }
+
+    neigh_t* pool = (neigh_t*)Malloc_slab(num_entries * sizeof(neigh_t));
+
+    for (int i = 0; i < count; i++) {
+      home_neigh[i] = pool;
+      home_fill[i] = 0;
+      pool += home_count[i];
+    }
+
+    for (int i = 0; i < count; i++)
+      for (int j = 0; j < atoms[i].num_neigh; j++) {
+        const neigh_t* entry = atoms[i].neigh + j;
+        const int other = entry->nr - start;
+
+        if (other >= i) {
+          home_neigh[i][home_fill[i]++] = *entry;
+        } else {
+          neigh_t* moved = home_neigh[other] + home_fill[other]++;
+
+          *moved = *entry;
+          moved->type = atoms[i].type;
+          moved->nr = start + i;
+          moved->dist.x = -entry->dist.x;
+          moved->dist.y = -entry->dist.y;
+          moved->dist.z = -entry->dist.z;
+          moved->dist_r.x = -entry->dist_r.x;
+          moved->dist_r.y = -entry->dist_r.y;
+          moved->dist_r.z = -entry->dist_r.z;
+#if defined(EAM) || defined(ADP)
+          // the transfer function of the reverse direction belongs
+          // to the type of the new neighbor
+          set_neighbor_slot(moved, g_calc.paircol + atoms[i].type, moved->r, 1);
+#if defined(TBEAM)
+          set_neighbor_slot(
+              moved, g_calc.paircol + 2 * g_param.ntypes + atoms[i].type,
+              moved->r, 2);
+#endif  // TBEAM
+#endif  // EAM || ADP
+        }
+      }
+
+    for (int i = 0; i < count; i++) {
+      atoms[i].neigh = home_neigh[i];
+      atoms[i].num_neigh = home_count[i];
+    }
+#endif  // !THREEBODY
+  }
+}
+
+#endif  // !KIM
+
+/****************************************************************
+  finalize_config_read
+    build the reference force vector and assign the final table
+    ranges after the configurations are available, either freshly
+    parsed or loaded from the binary cache
+****************************************************************/
+
+void finalize_config_read(double* mindist, int with_forces, int with_stresses,
+                          int max_atom_type)
+{
+#if !defined(KIM)
+  // sort the atoms for locality before any data is derived from the
+  // atom table (the KIM neighbor tables are built in file order while
+  // parsing, so for KIM the flag is ignored)
+  if (g_param.atom_order)
+    reorder_atoms_morton();
+#endif  // !KIM
+
   for (int i = 0; i < g_config.nconf; i++)
     for (int j = 0; j < g_param.ntypes; j++)
       g_config.na_type[g_config.nconf][j] += g_config.na_type[i][j];
@@ -587,143 +980,624 @@ void read_config(const char* filename)
   print_minimal_distances_matrix(mindist);
 }
 
-#if defined(APOT)
+#if !defined(KIM)
 
 /****************************************************************
-  update_slots:
-    recalculate the slots of the atoms for analytic potential
+  config_cache_features
+    bitmask of the compile-time options which affect the layout of
+    the cached data
 ****************************************************************/
 
-void update_slots(void)
+int config_cache_features(void)
 {
-  for (int i = 0; i < g_config.natoms; i++) {
-    for (int j = 0; j < g_config.atoms[i].num_neigh; j++) {
-      double r = g_config.atoms[i].neigh[j].r;
-
-      // update slots for pair potential part, slot 0
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 0);
+  int features = SLOTS << 16;
 
-#if defined EAM || defined ADP || defined MEAM
-      // update slots for eam transfer functions, slot 1
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 1);
+#if defined(APOT)
+  features |= 1 << 0;
+#endif  // APOT
+#if defined(EAM)
+  features |= 1 << 1;
+#endif  // EAM
 #if defined(TBEAM)
-      // update slots for tbeam transfer functions, s-band, slot 2
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
+  features |= 1 << 2;
 #endif  // TBEAM
-#endif  // EAM || ADP || MEAM
-
+#if defined(ADP)
+  features |= 1 << 3;
+#endif  // ADP
 #if defined(MEAM)
-      // update slots for MEAM f functions, slot 2
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
+  features |= 1 << 4;
 #endif  // MEAM
-
 #if defined(ANG)
-      // update slots for angular f functions, slot 1
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 1);
-#endif // ANG
-
-#if defined(ADP)
-      // update slots for adp dipole functions, slot 2
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
-      // update slots for adp quadrupole functions, slot 3
-      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 3);
-#endif  // ADP
-
-    }  // end loop over all neighbors
-  }    // end loop over all atoms
-
-#if defined(THREEBODY) && defined(MEAM)
-  // update angular slots
-  for (int i = 0; i < g_config.natoms; i++) {
-    for (int j = 0; j < g_config.atoms[i].num_angles; j++) {
-      double rr = g_config.atoms[i].angle_part[j].cos + 1.1;
-      int col =
-          2 * g_calc.paircol + 2 * g_param.ntypes + g_config.atoms[i].type;
-      g_config.atoms[i].angle_part[j].slot =
-          (int)(rr * g_pot.calc_pot.invstep[col]);
-      g_config.atoms[i].angle_part[j].step = g_pot.calc_pot.step[col];
-      g_config.atoms[i].angle_part[j].shift =
-          (rr -
-           g_config.atoms[i].angle_part[j].slot * g_pot.calc_pot.step[col]) *
-          g_pot.calc_pot.invstep[col];
-      // move slot to the correct potential
-      g_config.atoms[i].angle_part[j].slot += g_pot.calc_pot.first[col];
-    }
-  }
-#endif  // THREEBODY && MEAM
-
-#if defined(THREEBODY) && defined(ANG)
-  // update angular slots
-  for (int i = 0; i < g_config.natoms; i++) {
-    for (int j = 0; j < g_config.atoms[i].num_angles; j++) {
-      int col = 2 * g_calc.paircol + g_config.atoms[i].type;
-      double rr = g_config.atoms[i].angle_part[j].cos - g_pot.calc_pot.begin[col];
-      g_config.atoms[i].angle_part[j].slot =
-          (int)(rr * g_pot.calc_pot.invstep[col]);
-      g_config.atoms[i].angle_part[j].step = g_pot.calc_pot.step[col];
-      g_config.atoms[i].angle_part[j].shift =
-          (rr -
-           g_config.atoms[i].angle_part[j].slot * g_pot.calc_pot.step[col]) *
-          g_pot.calc_pot.invstep[col];
-      // move slot to the correct potential
-      g_config.atoms[i].angle_part[j].slot += g_pot.calc_pot.first[col];
-    }
-  }
-#endif  // THREEBODY && ANG
-
+  features |= 1 << 5;
+#endif  // ANG
 #if defined(STIWEB)
-  g_pot.apot_table.sw.init = 0;
+  features |= 1 << 6;
 #endif  // STIWEB
-
 #if defined(TERSOFF)
-  g_pot.apot_table.tersoff.init = 0;
+  features |= 1 << 7;
 #endif  // TERSOFF
+#if defined(COULOMB)
+  features |= 1 << 8;
+#endif  // COULOMB
+#if defined(DIPOLE)
+  features |= 1 << 9;
+#endif  // DIPOLE
+#if defined(STRESS)
+  features |= 1 << 10;
+#endif  // STRESS
+#if defined(CONTRIB)
+  features |= 1 << 11;
+#endif  // CONTRIB
+
+  return features;
 }
 
 /****************************************************************
-  update_neighbor_slots
-    recalculate the slots of the neighbors for analytic potential
+  config_cache_size
+    expected total size of a cache file with the given header
 ****************************************************************/
 
-void update_neighbor_slots(neigh_t* neighbor, double r, int neighbor_slot)
+size_t config_cache_size(const config_cache_header_t* header)
 {
-  int col = neighbor->col[neighbor_slot];
+  size_t size = sizeof(config_cache_header_t);
 
-  if (r < g_pot.calc_pot.end[col]) {
-    double rr = r - g_pot.calc_pot.begin[col];
-    neighbor->slot[neighbor_slot] = (int)(rr * g_pot.calc_pot.invstep[col]);
-    neighbor->step[neighbor_slot] = g_pot.calc_pot.step[col];
-    neighbor->shift[neighbor_slot] =
-        (rr - neighbor->slot[neighbor_slot] * g_pot.calc_pot.step[col]) *
-        g_pot.calc_pot.invstep[col];
-    // move slot to the correct potential
-    neighbor->slot[neighbor_slot] += g_pot.calc_pot.first[col];
-  }
-}
+  // potential table geometry, rcut/rmin/mindist matrices
+  size += 3 * header->ncols * sizeof(double);
+  size += 3 * header->ntypes * header->ntypes * sizeof(double);
+  // conf_weight, coheng and volume
+  size += 3 * header->nconf * sizeof(double);
+#if defined(STRESS)
+  size += header->nconf * sizeof(sym_tens);
+#endif  // STRESS
+  size += header->natoms * sizeof(atom_t);
+  size += header->num_neigh * sizeof(neigh_t);
+#if defined(THREEBODY)
+  size += header->num_angles * sizeof(angle_t);
+#endif  // THREEBODY
+  // inconf, cnfstart and useforce
+  size += 3 * header->nconf * sizeof(int);
+#if defined(STRESS)
+  size += header->nconf * sizeof(int);
+#endif  // STRESS
+  size += (header->nconf + 1) * header->ntypes * sizeof(int);
+  size += header->ntypes * 15 * sizeof(char);
 
-#endif  // APOT
+  return size;
+}
 
 /****************************************************************
-  reset_cstate
+  config_cache_load
+    map the binary cache written by an earlier run and restore the
+    configurations from it, skipping the parsing and the neighbor
+    list calculation entirely
+
+    The cache is rejected whenever the configuration file or any
+    compile-time or potential table property it depends on has
+    changed, the caller then falls back to regular parsing.
 ****************************************************************/
 
-void reset_cstate(config_state* cstate)
+int config_cache_load(const char* filename, double* mindist, int* with_forces,
+                      int* with_stresses, int* max_atom_type,
+                      int num_fixed_elements)
 {
-  cstate->atom_count = 0;
-  cstate->use_force = 0;
-  cstate->have_energy = 0;
-  cstate->have_stress = 0;
-  cstate->have_stress = 0;
-  memset(&cstate->box_x, 0, 3 * sizeof(double));
-  memset(&cstate->box_y, 0, 3 * sizeof(double));
-  memset(&cstate->box_z, 0, 3 * sizeof(double));
-  memset(&cstate->tbox_x, 0, 3 * sizeof(double));
-  memset(&cstate->tbox_y, 0, 3 * sizeof(double));
-  memset(&cstate->tbox_z, 0, 3 * sizeof(double));
-  memset(&cstate->cell_scale, 0, 3 * sizeof(double));
-  cstate->have_box_vector = 0;
-  cstate->stresses = NULL;
-#if defined(CONTRIB)
+  char cachename[255];
+  struct stat config_stat;
+  struct stat cache_stat;
+  config_cache_header_t header;
+
+  if (stat(filename, &config_stat) != 0)
+    return 0;
+
+  sprintf(cachename, "%s.cache", filename);
+
+  int fd = open(cachename, O_RDONLY);
+
+  if (fd < 0)
+    return 0;
+
+  if (fstat(fd, &cache_stat) != 0 ||
+      (size_t)cache_stat.st_size < sizeof(header)) {
+    close(fd);
+    return 0;
+  }
+
+  // map privately, so the slot updates for analytic potentials and the
+  // rho/gradF scratch values stay in memory and never reach the file
+  char* map = (char*)mmap(NULL, cache_stat.st_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (map == MAP_FAILED)
+    return 0;
+
+  memcpy(&header, map, sizeof(header));
+
+  if (header.magic != CONFIG_CACHE_MAGIC ||
+      header.version != CONFIG_CACHE_VERSION ||
+      header.features != config_cache_features() ||
+      header.format_type != (int)g_pot.format_type ||
+      header.sizeof_atom != (int)sizeof(atom_t) ||
+      header.sizeof_neigh != (int)sizeof(neigh_t) ||
+      header.ntypes != g_param.ntypes ||
+      header.ncols != g_pot.calc_pot.ncols ||
+      header.config_mtime != (long long)config_stat.st_mtime ||
+      header.config_size != (long long)config_stat.st_size ||
+      header.global_cell_scale != g_param.global_cell_scale ||
+      header.rcutmax != g_config.rcutmax ||
+      (size_t)cache_stat.st_size != config_cache_size(&header)) {
+    munmap(map, cache_stat.st_size);
+    return 0;
+  }
+
+  const int nt2 = g_param.ntypes * g_param.ntypes;
+
+  // locate all data blocks inside the map
+  char* pos = map + sizeof(header);
+
+  double* begin = (double*)pos;
+  pos += header.ncols * sizeof(double);
+  double* end = (double*)pos;
+  pos += header.ncols * sizeof(double);
+  double* step = (double*)pos;
+  pos += header.ncols * sizeof(double);
+  double* rcut = (double*)pos;
+  pos += nt2 * sizeof(double);
+  double* rmin = (double*)pos;
+  pos += nt2 * sizeof(double);
+  double* cached_mindist = (double*)pos;
+  pos += nt2 * sizeof(double);
+  double* conf_weight = (double*)pos;
+  pos += header.nconf * sizeof(double);
+  double* coheng = (double*)pos;
+  pos += header.nconf * sizeof(double);
+  double* volume = (double*)pos;
+  pos += header.nconf * sizeof(double);
+#if defined(STRESS)
+  sym_tens* stress = (sym_tens*)pos;
+  pos += header.nconf * sizeof(sym_tens);
+#endif  // STRESS
+  atom_t* atoms = (atom_t*)pos;
+  pos += header.natoms * sizeof(atom_t);
+  neigh_t* neighbors = (neigh_t*)pos;
+  pos += header.num_neigh * sizeof(neigh_t);
+#if defined(THREEBODY)
+  angle_t* angles = (angle_t*)pos;
+  pos += header.num_angles * sizeof(angle_t);
+#endif  // THREEBODY
+  int* inconf = (int*)pos;
+  pos += header.nconf * sizeof(int);
+  int* cnfstart = (int*)pos;
+  pos += header.nconf * sizeof(int);
+  int* useforce = (int*)pos;
+  pos += header.nconf * sizeof(int);
+#if defined(STRESS)
+  int* usestress = (int*)pos;
+  pos += header.nconf * sizeof(int);
+#endif  // STRESS
+  int* na_type = (int*)pos;
+  pos += (header.nconf + 1) * header.ntypes * sizeof(int);
+  char* elements = pos;
+
+  // the table ranges and the neighbor counts have to match exactly
+  int num_neigh = 0;
+  int num_angles = 0;
+
+  for (int i = 0; i < header.natoms; i++) {
+    num_neigh += atoms[i].num_neigh;
+#if defined(THREEBODY)
+    num_angles += atoms[i].num_angles;
+#endif  // THREEBODY
+  }
+
+  int mismatch = (num_neigh != header.num_neigh) ||
+                 (num_angles != header.num_angles) ||
+                 memcmp(begin, g_pot.calc_pot.begin, header.ncols * sizeof(double)) ||
+                 memcmp(end, g_pot.calc_pot.end, header.ncols * sizeof(double)) ||
+                 memcmp(step, g_pot.calc_pot.step, header.ncols * sizeof(double)) ||
+                 memcmp(rcut, g_config.rcut, nt2 * sizeof(double)) ||
+                 memcmp(rmin, g_config.rmin, nt2 * sizeof(double));
+
+  // element names fixed by the potential file have to match as well
+  for (int i = 0; i < num_fixed_elements; i++)
+    if (strncmp(elements + i * 15, g_config.elements[i], 15) != 0)
+      mismatch = 1;
+
+  if (mismatch) {
+    munmap(map, cache_stat.st_size);
+    return 0;
+  }
+
+  printf("Reading configuration cache file >> %s << ... done\n", cachename);
+
+  if (num_fixed_elements == 0)
+    for (int i = 0; i < g_param.ntypes; i++)
+      memcpy((char*)g_config.elements[i], elements + i * 15, 15);
+
+  memcpy(mindist, cached_mindist, nt2 * sizeof(double));
+
+  // the cached configuration and atom indices are absolute from the run
+  // that wrote the cache, rebase them onto the current table sizes
+  const int dconf = g_config.nconf - atoms[0].conf;
+  const int datom = g_config.natoms - cnfstart[0];
+
+  if (g_files.num_config_files == 1) {
+    // single dataset: alias the mapped tables directly, the private
+    // mapping makes the rebased indices plain memory writes
+    g_config.conf_weight = conf_weight;
+    g_config.coheng = coheng;
+    g_config.volume = volume;
+#if defined(STRESS)
+    g_config.stress = stress;
+    g_config.usestress = usestress;
+#endif  // STRESS
+    g_config.atoms = atoms;
+    g_config.inconf = inconf;
+    g_config.cnfstart = cnfstart;
+    g_config.useforce = useforce;
+
+    g_config.na_type = (int**)Malloc((header.nconf + 1) * sizeof(int*));
+    for (int i = 0; i <= header.nconf; i++)
+      g_config.na_type[i] = na_type + i * header.ntypes;
+
+    // restore the per-atom pointers into the mapped tables
+    num_neigh = 0;
+    num_angles = 0;
+
+    for (int i = 0; i < header.natoms; i++) {
+      atoms[i].conf += dconf;
+      atoms[i].neigh = atoms[i].num_neigh ? neighbors + num_neigh : NULL;
+      if (datom != 0)
+        for (int j = 0; j < atoms[i].num_neigh; j++)
+          atoms[i].neigh[j].nr += datom;
+      num_neigh += atoms[i].num_neigh;
+#if defined(THREEBODY)
+      atoms[i].angle_part = atoms[i].num_angles ? angles + num_angles : NULL;
+      num_angles += atoms[i].num_angles;
+#endif  // THREEBODY
+    }
+
+    if (datom != 0)
+      for (int i = 0; i < header.nconf; i++)
+        cnfstart[i] += datom;
+
+    g_config.nconf = header.nconf;
+    g_config.natoms = header.natoms;
+  } else {
+    // several datasets: later files grow the arrays, so the mapped
+    // tables cannot be aliased, copy them into the heap instead
+    const int conf0 = g_config.nconf;
+    const int atom0 = g_config.natoms;
+    const int nconf = conf0 + header.nconf;
+
+    g_config.atoms = (atom_t*)Realloc(g_config.atoms,
+                                      (atom0 + header.natoms) * sizeof(atom_t));
+    memcpy(g_config.atoms + atom0, atoms, header.natoms * sizeof(atom_t));
+
+    neigh_t* neigh_copy = NULL;
+    if (header.num_neigh > 0) {
+      neigh_copy = (neigh_t*)Malloc(header.num_neigh * sizeof(neigh_t));
+      memcpy(neigh_copy, neighbors, header.num_neigh * sizeof(neigh_t));
+    }
+#if defined(THREEBODY)
+    angle_t* angle_copy = NULL;
+    if (header.num_angles > 0) {
+      angle_copy = (angle_t*)Malloc(header.num_angles * sizeof(angle_t));
+      memcpy(angle_copy, angles, header.num_angles * sizeof(angle_t));
+    }
+#endif  // THREEBODY
+
+    num_neigh = 0;
+    num_angles = 0;
+
+    for (int i = 0; i < header.natoms; i++) {
+      atom_t* atom = g_config.atoms + atom0 + i;
+      atom->conf += dconf;
+      atom->neigh = atom->num_neigh ? neigh_copy + num_neigh : NULL;
+      if (datom != 0)
+        for (int j = 0; j < atom->num_neigh; j++)
+          atom->neigh[j].nr += datom;
+      num_neigh += atom->num_neigh;
+#if defined(THREEBODY)
+      atom->angle_part = atom->num_angles ? angle_copy + num_angles : NULL;
+      num_angles += atom->num_angles;
+#endif  // THREEBODY
+    }
+
+    g_config.conf_weight =
+        (double*)Realloc(g_config.conf_weight, nconf * sizeof(double));
+    memcpy(g_config.conf_weight + conf0, conf_weight,
+           header.nconf * sizeof(double));
+    g_config.coheng = (double*)Realloc(g_config.coheng, nconf * sizeof(double));
+    memcpy(g_config.coheng + conf0, coheng, header.nconf * sizeof(double));
+    g_config.volume = (double*)Realloc(g_config.volume, nconf * sizeof(double));
+    memcpy(g_config.volume + conf0, volume, header.nconf * sizeof(double));
+#if defined(STRESS)
+    g_config.stress =
+        (sym_tens*)Realloc(g_config.stress, nconf * sizeof(sym_tens));
+    memcpy(g_config.stress + conf0, stress, header.nconf * sizeof(sym_tens));
+    g_config.usestress =
+        (int*)Realloc(g_config.usestress, nconf * sizeof(int));
+    memcpy(g_config.usestress + conf0, usestress, header.nconf * sizeof(int));
+#endif  // STRESS
+    g_config.inconf = (int*)Realloc(g_config.inconf, nconf * sizeof(int));
+    memcpy(g_config.inconf + conf0, inconf, header.nconf * sizeof(int));
+    g_config.useforce = (int*)Realloc(g_config.useforce, nconf * sizeof(int));
+    memcpy(g_config.useforce + conf0, useforce, header.nconf * sizeof(int));
+
+    g_config.cnfstart = (int*)Realloc(g_config.cnfstart, nconf * sizeof(int));
+    for (int i = 0; i < header.nconf; i++)
+      g_config.cnfstart[conf0 + i] = cnfstart[i] + datom;
+
+    g_config.na_type =
+        (int**)Realloc(g_config.na_type, (nconf + 1) * sizeof(int*));
+    for (int i = 0; i <= header.nconf; i++) {
+      g_config.na_type[conf0 + i] =
+          (int*)Malloc(header.ntypes * sizeof(int));
+      memcpy(g_config.na_type[conf0 + i], na_type + i * header.ntypes,
+             header.ntypes * sizeof(int));
+    }
+
+    g_config.nconf = nconf;
+    g_config.natoms = atom0 + header.natoms;
+
+    munmap(map, cache_stat.st_size);
+  }
+
+  *with_forces = header.with_forces;
+  *with_stresses = header.with_stresses;
+  *max_atom_type = header.max_atom_type;
+
+  return 1;
+}
+
+/****************************************************************
+  config_cache_write
+    store the parsed configurations, neighbor lists and angle
+    tables in a binary sidecar file next to the configuration file
+****************************************************************/
+
+void config_cache_write(const char* filename, const double* mindist,
+                        int with_forces, int with_stresses, int max_atom_type,
+                        int first_conf, int first_atom)
+{
+  char cachename[255];
+  struct stat config_stat;
+  config_cache_header_t header;
+
+  if (stat(filename, &config_stat) != 0) {
+    warning("Could not stat %s, not writing a configuration cache\n", filename);
+    return;
+  }
+
+  memset(&header, 0, sizeof(header));
+
+  header.magic = CONFIG_CACHE_MAGIC;
+  header.version = CONFIG_CACHE_VERSION;
+  header.features = config_cache_features();
+  header.format_type = (int)g_pot.format_type;
+  header.sizeof_atom = (int)sizeof(atom_t);
+  header.sizeof_neigh = (int)sizeof(neigh_t);
+#if defined(THREEBODY)
+  header.sizeof_angle = (int)sizeof(angle_t);
+#endif  // THREEBODY
+  header.ntypes = g_param.ntypes;
+  header.ncols = g_pot.calc_pot.ncols;
+  header.nconf = g_config.nconf - first_conf;
+  header.natoms = g_config.natoms - first_atom;
+  for (int i = first_atom; i < g_config.natoms; i++) {
+    header.num_neigh += g_config.atoms[i].num_neigh;
+#if defined(THREEBODY)
+    header.num_angles += g_config.atoms[i].num_angles;
+#endif  // THREEBODY
+  }
+  header.with_forces = with_forces;
+  header.with_stresses = with_stresses;
+  header.max_atom_type = max_atom_type;
+  header.config_mtime = (long long)config_stat.st_mtime;
+  header.config_size = (long long)config_stat.st_size;
+  header.global_cell_scale = g_param.global_cell_scale;
+  header.rcutmax = g_config.rcutmax;
+
+  sprintf(cachename, "%s.cache", filename);
+
+  FILE* cache_file = fopen(cachename, "wb");
+
+  if (cache_file == NULL) {
+    warning("Could not open configuration cache file %s for writing\n",
+            cachename);
+    return;
+  }
+
+  const int nt2 = g_param.ntypes * g_param.ntypes;
+
+  int ok = (fwrite(&header, sizeof(header), 1, cache_file) == 1);
+
+#define CACHE_WRITE(ptr, type, count) \
+  ok = ok && (fwrite((ptr), sizeof(type), (count), cache_file) == (size_t)(count))
+
+  CACHE_WRITE(g_pot.calc_pot.begin, double, header.ncols);
+  CACHE_WRITE(g_pot.calc_pot.end, double, header.ncols);
+  CACHE_WRITE(g_pot.calc_pot.step, double, header.ncols);
+  CACHE_WRITE(g_config.rcut, double, nt2);
+  CACHE_WRITE(g_config.rmin, double, nt2);
+  CACHE_WRITE(mindist, double, nt2);
+  CACHE_WRITE(g_config.conf_weight + first_conf, double, header.nconf);
+  CACHE_WRITE(g_config.coheng + first_conf, double, header.nconf);
+  CACHE_WRITE(g_config.volume + first_conf, double, header.nconf);
+#if defined(STRESS)
+  CACHE_WRITE(g_config.stress + first_conf, sym_tens, header.nconf);
+#endif  // STRESS
+  CACHE_WRITE(g_config.atoms + first_atom, atom_t, header.natoms);
+  for (int i = first_atom; i < g_config.natoms; i++)
+    CACHE_WRITE(g_config.atoms[i].neigh, neigh_t, g_config.atoms[i].num_neigh);
+#if defined(THREEBODY)
+  for (int i = first_atom; i < g_config.natoms; i++)
+    CACHE_WRITE(g_config.atoms[i].angle_part, angle_t,
+                g_config.atoms[i].num_angles);
+#endif  // THREEBODY
+  CACHE_WRITE(g_config.inconf + first_conf, int, header.nconf);
+  CACHE_WRITE(g_config.cnfstart + first_conf, int, header.nconf);
+  CACHE_WRITE(g_config.useforce + first_conf, int, header.nconf);
+#if defined(STRESS)
+  CACHE_WRITE(g_config.usestress + first_conf, int, header.nconf);
+#endif  // STRESS
+  for (int i = 0; i <= header.nconf; i++)
+    CACHE_WRITE(g_config.na_type[first_conf + i], int, header.ntypes);
+  for (int i = 0; i < g_param.ntypes; i++)
+    CACHE_WRITE(g_config.elements[i], char, 15);
+
+#undef CACHE_WRITE
+
+  if (fclose(cache_file) != 0)
+    ok = 0;
+
+  if (!ok) {
+    warning("Could not write configuration cache file %s\n", cachename);
+    remove(cachename);
+  } else
+    printf("Wrote configuration cache file >> %s <<\n", cachename);
+}
+
+#endif  // !KIM
+
+#if defined(APOT)
+
+/****************************************************************
+  update_slots:
+    recalculate the slots of the atoms for analytic potential
+****************************************************************/
+
+void update_slots(void)
+{
+  for (int i = 0; i < g_config.natoms; i++) {
+    for (int j = 0; j < g_config.atoms[i].num_neigh; j++) {
+      double r = g_config.atoms[i].neigh[j].r;
+
+      // update slots for pair potential part, slot 0
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 0);
+
+#if defined EAM || defined ADP || defined MEAM
+      // update slots for eam transfer functions, slot 1
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 1);
+#if defined(TBEAM)
+      // update slots for tbeam transfer functions, s-band, slot 2
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
+#endif  // TBEAM
+#endif  // EAM || ADP || MEAM
+
+#if defined(MEAM)
+      // update slots for MEAM f functions, slot 2
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
+#endif  // MEAM
+
+#if defined(ANG)
+      // update slots for angular f functions, slot 1
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 1);
+#endif // ANG
+
+#if defined(ADP)
+      // update slots for adp dipole functions, slot 2
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 2);
+      // update slots for adp quadrupole functions, slot 3
+      update_neighbor_slots(g_config.atoms[i].neigh + j, r, 3);
+#endif  // ADP
+
+    }  // end loop over all neighbors
+  }    // end loop over all atoms
+
+#if defined(THREEBODY) && defined(MEAM)
+  // update angular slots
+  for (int i = 0; i < g_config.natoms; i++) {
+    for (int j = 0; j < g_config.atoms[i].num_angles; j++) {
+      double rr = g_config.atoms[i].angle_part[j].cos + 1.1;
+      int col =
+          2 * g_calc.paircol + 2 * g_param.ntypes + g_config.atoms[i].type;
+      g_config.atoms[i].angle_part[j].slot =
+          (int)(rr * g_pot.calc_pot.invstep[col]);
+      g_config.atoms[i].angle_part[j].step = g_pot.calc_pot.step[col];
+      g_config.atoms[i].angle_part[j].shift =
+          (rr -
+           g_config.atoms[i].angle_part[j].slot * g_pot.calc_pot.step[col]) *
+          g_pot.calc_pot.invstep[col];
+      // move slot to the correct potential
+      g_config.atoms[i].angle_part[j].slot += g_pot.calc_pot.first[col];
+    }
+  }
+#endif  // THREEBODY && MEAM
+
+#if defined(THREEBODY) && defined(ANG)
+  // update angular slots
+  for (int i = 0; i < g_config.natoms; i++) {
+    for (int j = 0; j < g_config.atoms[i].num_angles; j++) {
+      int col = 2 * g_calc.paircol + g_config.atoms[i].type;
+      double rr = g_config.atoms[i].angle_part[j].cos - g_pot.calc_pot.begin[col];
+      g_config.atoms[i].angle_part[j].slot =
+          (int)(rr * g_pot.calc_pot.invstep[col]);
+      g_config.atoms[i].angle_part[j].step = g_pot.calc_pot.step[col];
+      g_config.atoms[i].angle_part[j].shift =
+          (rr -
+           g_config.atoms[i].angle_part[j].slot * g_pot.calc_pot.step[col]) *
+          g_pot.calc_pot.invstep[col];
+      // move slot to the correct potential
+      g_config.atoms[i].angle_part[j].slot += g_pot.calc_pot.first[col];
+    }
+  }
+#endif  // THREEBODY && ANG
+
+#if defined(STIWEB)
+  g_pot.apot_table.sw.init = 0;
+#endif  // STIWEB
+
+#if defined(TERSOFF)
+  g_pot.apot_table.tersoff.init = 0;
+#endif  // TERSOFF
+}
+
+/****************************************************************
+  update_neighbor_slots
+    recalculate the slots of the neighbors for analytic potential
+****************************************************************/
+
+static void update_neighbor_slots(neigh_t* neighbor, double r, int neighbor_slot)
+{
+  int col = neighbor->col[neighbor_slot];
+
+  if (r < g_pot.calc_pot.end[col]) {
+    double rr = r - g_pot.calc_pot.begin[col];
+    neighbor->slot[neighbor_slot] = (int)(rr * g_pot.calc_pot.invstep[col]);
+    neighbor->step[neighbor_slot] = g_pot.calc_pot.step[col];
+    neighbor->shift[neighbor_slot] =
+        (rr - neighbor->slot[neighbor_slot] * g_pot.calc_pot.step[col]) *
+        g_pot.calc_pot.invstep[col];
+    // move slot to the correct potential
+    neighbor->slot[neighbor_slot] += g_pot.calc_pot.first[col];
+  }
+}
+
+#endif  // APOT
+
+/****************************************************************
+  reset_cstate
+****************************************************************/
+
+void reset_cstate(config_state* cstate)
+{
+  cstate->atom_count = 0;
+  cstate->use_force = 0;
+  cstate->have_energy = 0;
+  cstate->have_stress = 0;
+  cstate->have_stress = 0;
+  memset(&cstate->box_x, 0, 3 * sizeof(double));
+  memset(&cstate->box_y, 0, 3 * sizeof(double));
+  memset(&cstate->box_z, 0, 3 * sizeof(double));
+  memset(&cstate->tbox_x, 0, 3 * sizeof(double));
+  memset(&cstate->tbox_y, 0, 3 * sizeof(double));
+  memset(&cstate->tbox_z, 0, 3 * sizeof(double));
+  memset(&cstate->cell_scale, 0, 3 * sizeof(double));
+  cstate->have_box_vector = 0;
+  cstate->stresses = NULL;
+#if defined(CONTRIB)
   cstate->have_contrib_box_vector = 0;
   cstate->n_spheres = 0;
   memset(&cstate->cbox_o, 0, 3 * sizeof(double));
@@ -765,33 +1639,51 @@ void create_memory_for_configs(FILE* config_file, const char* filename)
     }
   }
 
-  g_config.atoms = (atom_t*)Malloc(atom_count * sizeof(atom_t));
-  g_config.coheng = (double*)Malloc(config_count * sizeof(double));
+  // the tables may already hold the configurations of earlier dataset
+  // files, grow them and keep the existing entries in place
+  const int natoms = g_config.natoms + atom_count;
+  const int nconf = g_config.nconf + config_count;
+
+  g_config.atoms = (atom_t*)Realloc(g_config.atoms, natoms * sizeof(atom_t));
+  // the parser counts neighbors and atom types with ++, so the new
+  // entries have to start out zeroed like a fresh Malloc would be
+  memset(g_config.atoms + g_config.natoms, 0, atom_count * sizeof(atom_t));
 
-  g_config.conf_weight = (double*)Malloc(config_count * sizeof(double));
-  for (int i = 0; i < config_count; ++i)
+  g_config.coheng = (double*)Realloc(g_config.coheng, nconf * sizeof(double));
+
+  g_config.conf_weight =
+      (double*)Realloc(g_config.conf_weight, nconf * sizeof(double));
+  for (int i = g_config.nconf; i < nconf; ++i)
     g_config.conf_weight[i] = 1.0;
 
-  g_config.volume = (double*)Malloc(config_count * sizeof(double));
+  g_config.volume = (double*)Realloc(g_config.volume, nconf * sizeof(double));
 
 #if defined(STRESS)
-  g_config.stress = (sym_tens*)Malloc(config_count * sizeof(sym_tens));
-  g_config.usestress = (int*)Malloc(config_count * sizeof(int));
+  g_config.stress = (sym_tens*)Realloc(g_config.stress, nconf * sizeof(sym_tens));
+  memset(g_config.stress + g_config.nconf, 0, config_count * sizeof(sym_tens));
+  g_config.usestress = (int*)Realloc(g_config.usestress, nconf * sizeof(int));
+  memset(g_config.usestress + g_config.nconf, 0, config_count * sizeof(int));
 #endif  // STRESS
 
-  g_config.inconf = (int*)Malloc(config_count * sizeof(int));
-  g_config.cnfstart = (int*)Malloc(config_count * sizeof(int));
-  g_config.useforce = (int*)Malloc(config_count * sizeof(int));
-  g_config.na_type = (int**)Malloc((config_count + 1) * sizeof(int*));
-  for (int i = 0; i <= config_count; ++i)
+  g_config.inconf = (int*)Realloc(g_config.inconf, nconf * sizeof(int));
+  g_config.cnfstart = (int*)Realloc(g_config.cnfstart, nconf * sizeof(int));
+  g_config.useforce = (int*)Realloc(g_config.useforce, nconf * sizeof(int));
+  g_config.na_type = (int**)Realloc(g_config.na_type, (nconf + 1) * sizeof(int*));
+  // a fresh zeroed row also replaces the totals row of the previous file
+  for (int i = g_config.nconf; i <= nconf; ++i)
     g_config.na_type[i] = (int*)Malloc(g_param.ntypes * sizeof(int));
 
 #if defined(KIM)
-  g_config.number_of_particles = (int*)Malloc(config_count * sizeof(int));
-  g_config.species_codes = (int**)Malloc(config_count * sizeof(int*));
-  g_config.particle_contributing = (int**)Malloc(config_count * sizeof(int*));
-  g_config.coordinates = (double**)Malloc(config_count * sizeof(double*));
-  g_config.source_atom = (int**)Malloc(config_count * sizeof(int*));
+  g_config.number_of_particles =
+      (int*)Realloc(g_config.number_of_particles, nconf * sizeof(int));
+  g_config.species_codes =
+      (int**)Realloc(g_config.species_codes, nconf * sizeof(int*));
+  g_config.particle_contributing =
+      (int**)Realloc(g_config.particle_contributing, nconf * sizeof(int*));
+  g_config.coordinates =
+      (double**)Realloc(g_config.coordinates, nconf * sizeof(double*));
+  g_config.source_atom =
+      (int**)Realloc(g_config.source_atom, nconf * sizeof(int*));
 #endif // KIM
 }
 
@@ -1080,28 +1972,24 @@ void init_neighbors_kim(config_state* cstate, double* mindist, int** _atom_pos)
 
 void init_neighbors(config_state* cstate, double* mindist)
 {
+#if defined(KIM)
+  // KIM needs the per-image ghost bookkeeping of the scalar loop
   vector d;
   vector dd;
 
-#if defined(KIM)
   int* atom_pos = NULL;
   const int nx = 2 * cstate->cell_scale.x + 1;
   const int ny = 2 * cstate->cell_scale.y + 1;
   const int nz = 2 * cstate->cell_scale.z + 1;
 
   init_neighbors_kim(cstate, mindist, &atom_pos);
-#endif // KIM
 
   // compute the neighbor table
   for (int i = g_config.natoms; i < g_config.natoms + cstate->atom_count; i++) {
 
     // loop over all atoms for threebody and KIM interactions
     int num_neigh = 0;
-#if defined(THREEBODY) || defined(KIM)
     int j_start = g_config.natoms;
-#else
-    int j_start = i;
-#endif // THREEBODY || KIM
     for (int j = j_start; j < g_config.natoms + cstate->atom_count; j++)
     {
       d.x = g_config.atoms[j].pos.x - g_config.atoms[i].pos.x;
@@ -1143,15 +2031,13 @@ void init_neighbors(config_state* cstate, double* mindist)
       }
     }
     if (num_neigh) {
-      g_config.atoms[i].neigh = (neigh_t*)Malloc(num_neigh * sizeof(neigh_t));
-#if defined(KIM)
-      g_config.atoms[i].kim_neighbors = (int*)Malloc(num_neigh * sizeof(int));
-#endif // KIM
+      // one slice per atom from the common slab keeps the tables of
+      // neighboring atoms on the same pages
+      g_config.atoms[i].neigh = (neigh_t*)Malloc_slab(num_neigh * sizeof(neigh_t));
+      g_config.atoms[i].kim_neighbors = (int*)Malloc_slab(num_neigh * sizeof(int));
     }
 
-#if defined(KIM)
     int atom_idx = 0;
-#endif // KIM
 
     for (int j = j_start; j < g_config.natoms + cstate->atom_count; j++)
     {
@@ -1164,7 +2050,6 @@ void init_neighbors(config_state* cstate, double* mindist)
           for (int iz = -cstate->cell_scale.z; iz <= cstate->cell_scale.z; iz++) {
             if ((i == j) && (ix == 0) && (iy == 0) && (iz == 0))
               continue;
-#if defined(KIM)
             if ((ix == 0) && (iy == 0) && (iz == 0)) {
               atom_idx = j - j_start;
             } else {
@@ -1177,7 +2062,6 @@ void init_neighbors(config_state* cstate, double* mindist)
             }
             if (atom_pos[atom_idx] < 0)
               continue;
-#endif // KIM
             dd.x = d.x + ix * cstate->box_x.x + iy * cstate->box_y.x + iz * cstate->box_z.x;
             dd.y = d.y + ix * cstate->box_x.y + iy * cstate->box_y.y + iz * cstate->box_z.y;
             dd.z = d.z + ix * cstate->box_x.z + iy * cstate->box_y.z + iz * cstate->box_z.z;
@@ -1214,91 +2098,662 @@ void init_neighbors(config_state* cstate, double* mindist)
               n->dist.y = dd.y * r;
               n->dist.z = dd.z * r;
 
-#if defined(ADP)
-              n->sqrdist.xx = dd.x * dd.x * r * r;
-              n->sqrdist.yy = dd.y * dd.y * r * r;
-              n->sqrdist.zz = dd.z * dd.z * r * r;
-              n->sqrdist.yz = dd.y * dd.z * r * r;
-              n->sqrdist.zx = dd.z * dd.x * r * r;
-              n->sqrdist.xy = dd.x * dd.y * r * r;
-#endif  // ADP
-
               // pre-compute index and shift into potential tables
               int col = (type1 <= type2)
                             ? type1 * g_param.ntypes + type2 - ((type1 * (type1 + 1)) / 2)
                             : type2 * g_param.ntypes + type1 - ((type2 * (type2 + 1)) / 2);
               mindist[col] = MIN(mindist[col], r);
 
-#if defined(KIM)
               g_config.atoms[i].kim_neighbors[k] = atom_pos[atom_idx];
-              continue;
-#endif // KIM
+            }   // r < r_cut
+          }     /* loop over images in z direction */
+        }       /* loop over images in y direction */
+      }         /* loop over images in x direction */
+    }           /* second loop over atoms (neighbors) */
+    if (num_neigh != 0 && num_neigh != g_config.atoms[i].num_neigh)
+      error(1, "Neigh count mismatch!!");
+  }             /* first loop over atoms */
 
-              // pair potential
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 0);
+  free(atom_pos);
+#else   // KIM
 
-#if defined(EAM) || defined(ADP) || defined(MEAM)
-              /* transfer function */
-              col = g_calc.paircol + type2;
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 1);
+  // the all-pairs search below is O(N^2) per configuration, for large
+  // cells the binned search finds the same neighbors in the same order
+  if (cstate->atom_count >= CELL_LIST_MIN_ATOMS) {
+    init_neighbors_cells(cstate, mindist);
+    return;
+  }
+
+  const int csx = (int)cstate->cell_scale.x;
+  const int csy = (int)cstate->cell_scale.y;
+  const int csz = (int)cstate->cell_scale.z;
+  const int niy = 2 * csy + 1;
+  const int niz = 2 * csz + 1;
+  const int num_images = (2 * csx + 1) * niy * niz;
+  const int center = (csx * niy + csy) * niz + csz;
+
+  // batch buffers for the distances to all periodic images of one
+  // candidate neighbor
+  double* imx = (double*)malloc(num_images * sizeof(double));
+  double* imy = (double*)malloc(num_images * sizeof(double));
+  double* imz = (double*)malloc(num_images * sizeof(double));
+  double* ddx = (double*)malloc(num_images * sizeof(double));
+  double* ddy = (double*)malloc(num_images * sizeof(double));
+  double* ddz = (double*)malloc(num_images * sizeof(double));
+  double* rr = (double*)malloc(num_images * sizeof(double));
+
+  if (imx == NULL || imy == NULL || imz == NULL || ddx == NULL ||
+      ddy == NULL || ddz == NULL || rr == NULL)
+    error(1, "Could not allocate memory for the neighbor search!\n");
+
+  make_image_shift_table(cstate, imx, imy, imz);
+
+  // compute the neighbor table
+  for (int i = g_config.natoms; i < g_config.natoms + cstate->atom_count; i++) {
+    // loop over all atoms for threebody interactions
+#if defined(THREEBODY)
+    int j_start = g_config.natoms;
+#else
+    int j_start = i;
+#endif  // THREEBODY
+    const int type1 = g_config.atoms[i].type;
+
+    // first pass: count the neighbors
+    int num_neigh = 0;
+
+    for (int j = j_start; j < g_config.natoms + cstate->atom_count; j++) {
+      vector d;
+
+      d.x = g_config.atoms[j].pos.x - g_config.atoms[i].pos.x;
+      d.y = g_config.atoms[j].pos.y - g_config.atoms[i].pos.y;
+      d.z = g_config.atoms[j].pos.z - g_config.atoms[i].pos.z;
+
+      compute_image_distances(cstate, d, imx, imy, imz, num_images, ddx, ddy,
+                              ddz, rr);
+
+      const int type2 = g_config.atoms[j].type;
+      const double rcut = g_config.rcut[type1 * g_param.ntypes + type2];
+      const double rr_cut = rcut * rcut * SQUARE_CUTOFF_SLACK;
+
+      for (int e = 0; e < num_images; e++) {
+        if ((i == j) && (e == center))
+          continue;
+
+        if (rr[e] == 0.0) {
+          int ix = e / (niy * niz) - csx;
+          int iy = (e / niz) % niy - csy;
+          int iz = e % niz - csz;
+          error(0, "Overlapping atoms found in configuration %d!\n", cstate->config);
+          error(0, "Atom %d @ (%f, %f, %f)\n", i - g_config.natoms, g_config.atoms[i].pos.x, g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+          error(0, "overlaps with atom %d @ (%f, %f, %f)\n", j - g_config.natoms, g_config.atoms[j].pos.x, g_config.atoms[j].pos.y, g_config.atoms[j].pos.z);
+          error(1, "in this periodic copy of the unit cell: x=%d, y=%d, z=%d", ix, iy, iz);
+        }
+
+        // guaranteed beyond the cutoff, no need for the square root
+        if (rr[e] > rr_cut)
+          continue;
+
+        double r = sqrt(rr[e]);
+
+        if (r <= rcut) {
+          if (r <= g_config.rmin[type1 * g_param.ntypes + type2]) {
+            warning("Configuration %i: Distance %f\n", cstate->config, r);
+            warning(" atom %d (type %d) at pos: %f %f %f\n",
+                    i - g_config.natoms, type1, g_config.atoms[i].pos.x,
+                    g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+            warning(" atom %d (type %d) at pos: %f %f %f\n",
+                    j - g_config.natoms, type2, ddx[e], ddy[e], ddz[e]);
+          }
+          num_neigh++;
+        }
+      }
+    }
+
+    if (num_neigh) {
+      // one slice per atom from the common slab keeps the tables of
+      // neighboring atoms on the same pages
+      g_config.atoms[i].neigh = (neigh_t*)Malloc_slab(num_neigh * sizeof(neigh_t));
+    }
+
+    // second pass: collect the accepted neighbors, they are
+    // normalized and stored in one batch below
+    int nrs[MAX(num_neigh, 1)];
+    double acc_x[MAX(num_neigh, 1)];
+    double acc_y[MAX(num_neigh, 1)];
+    double acc_z[MAX(num_neigh, 1)];
+    double acc_r[MAX(num_neigh, 1)];
+    int acc = 0;
+
+    for (int j = j_start; j < g_config.natoms + cstate->atom_count; j++) {
+      vector d;
+
+      d.x = g_config.atoms[j].pos.x - g_config.atoms[i].pos.x;
+      d.y = g_config.atoms[j].pos.y - g_config.atoms[i].pos.y;
+      d.z = g_config.atoms[j].pos.z - g_config.atoms[i].pos.z;
+
+      compute_image_distances(cstate, d, imx, imy, imz, num_images, ddx, ddy,
+                              ddz, rr);
+
+      const int type2 = g_config.atoms[j].type;
+      const double rcut = g_config.rcut[type1 * g_param.ntypes + type2];
+      const double rr_cut = rcut * rcut * SQUARE_CUTOFF_SLACK;
+
+      for (int e = 0; e < num_images; e++) {
+        if ((i == j) && (e == center))
+          continue;
+
+        if (rr[e] > rr_cut)
+          continue;
+
+        double r = sqrt(rr[e]);
+
+        if (r <= rcut) {
+          if (r <= g_config.rmin[type1 * g_param.ntypes + type2]) {
+            warning("Configuration %i: Distance %f\n", cstate->config, r);
+            warning(" atom %d (type %d) at pos: %f %f %f\n",
+                    i - g_config.natoms, type1, g_config.atoms[i].pos.x,
+                    g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+            warning(" atom %d (type %d) at pos: %f %f %f\n",
+                    j - g_config.natoms, type2, ddx[e], ddy[e], ddz[e]);
+          }
+          nrs[acc] = j;
+          acc_x[acc] = ddx[e];
+          acc_y[acc] = ddy[e];
+          acc_z[acc] = ddz[e];
+          acc_r[acc] = r;
+          acc++;
+        }
+      }
+    }
+
+    if (acc)
+      store_neighbors(i, acc, nrs, acc_x, acc_y, acc_z, acc_r, mindist);
+
+    if (num_neigh != 0 && num_neigh != g_config.atoms[i].num_neigh)
+      error(1, "Neigh count mismatch!!");
+  } // loop over atoms
+
+  free(imx);
+  free(imy);
+  free(imz);
+  free(ddx);
+  free(ddy);
+  free(ddz);
+  free(rr);
+#endif  // KIM
+}
+
+#if !defined(KIM)
+
+/****************************************************************
+  make_image_shift_table
+    tabulate the periodic image multipliers in the (ix, iy, iz)
+    loop order of the scalar search; the integer factors are stored
+    as doubles so the batched distance loops reuse the exact
+    arithmetic of the scalar code
+****************************************************************/
+
+static void make_image_shift_table(const config_state* cstate, double* imx,
+                                   double* imy, double* imz)
+{
+  const int csx = (int)cstate->cell_scale.x;
+  const int csy = (int)cstate->cell_scale.y;
+  const int csz = (int)cstate->cell_scale.z;
+
+  int e = 0;
+
+  for (int ix = -csx; ix <= csx; ix++) {
+    for (int iy = -csy; iy <= csy; iy++) {
+      for (int iz = -csz; iz <= csz; iz++) {
+        imx[e] = ix;
+        imy[e] = iy;
+        imz[e] = iz;
+        e++;
+      }
+    }
+  }
+}
+
+/****************************************************************
+  compute_image_distances
+    distance vectors and squared distances from one atom to all
+    periodic images of a candidate neighbor in a single flat loop
+    the compiler can vectorize; the term order matches the scalar
+    code, so the results are bit-identical
+****************************************************************/
+
+static void compute_image_distances(const config_state* cstate, vector d,
+                                    const double* imx, const double* imy,
+                                    const double* imz, int num_images,
+                                    double* ddx, double* ddy, double* ddz,
+                                    double* rr)
+{
+  for (int e = 0; e < num_images; e++) {
+    ddx[e] = d.x + imx[e] * cstate->box_x.x + imy[e] * cstate->box_y.x + imz[e] * cstate->box_z.x;
+    ddy[e] = d.y + imx[e] * cstate->box_x.y + imy[e] * cstate->box_y.y + imz[e] * cstate->box_z.y;
+    ddz[e] = d.z + imx[e] * cstate->box_x.z + imy[e] * cstate->box_y.z + imz[e] * cstate->box_z.z;
+    rr[e] = ddx[e] * ddx[e] + ddy[e] * ddy[e] + ddz[e] * ddz[e];
+  }
+}
+
+/****************************************************************
+  store_neighbors
+    append all accepted neighbors of atom i to its neighbor table
+    and precompute the positions in the potential tables; the
+    normalization runs over the whole batch first, one vectorizable
+    division loop per component instead of three scalar divisions
+    per neighbor
+****************************************************************/
+
+void store_neighbors(int i, int count, const int* nrs, const double* ddx,
+                     const double* ddy, const double* ddz, const double* rs,
+                     double* mindist)
+{
+  double inv_r[count];
+  double nx[count];
+  double ny[count];
+  double nz[count];
+
+  for (int k = 0; k < count; k++)
+    inv_r[k] = 1.0 / rs[k];
+  for (int k = 0; k < count; k++)
+    nx[k] = ddx[k] / rs[k];
+  for (int k = 0; k < count; k++)
+    ny[k] = ddy[k] / rs[k];
+  for (int k = 0; k < count; k++)
+    nz[k] = ddz[k] / rs[k];
+
+  const int type1 = g_config.atoms[i].type;
+  const int k0 = g_config.atoms[i].num_neigh;
+
+  g_config.atoms[i].num_neigh += count;
+
+  for (int k = 0; k < count; k++) {
+    const int j = nrs[k];
+    const int type2 = g_config.atoms[j].type;
+    const double r = rs[k];
+
+    neigh_t* n = g_config.atoms[i].neigh + k0 + k;
+
+    memset(n, 0, sizeof(neigh_t));
+
+    n->type = type2;
+    n->nr = j;
+    n->r = r;
+    n->r2 = r * r;
+    n->inv_r = inv_r[k];
+    n->dist_r.x = nx[k];
+    n->dist_r.y = ny[k];
+    n->dist_r.z = nz[k];
+    n->dist.x = nx[k] * r;
+    n->dist.y = ny[k] * r;
+    n->dist.z = nz[k] * r;
+
+#if defined(ADP)
+    n->sqrdist.xx = nx[k] * nx[k] * r * r;
+    n->sqrdist.yy = ny[k] * ny[k] * r * r;
+    n->sqrdist.zz = nz[k] * nz[k] * r * r;
+    n->sqrdist.yz = ny[k] * nz[k] * r * r;
+    n->sqrdist.zx = nz[k] * nx[k] * r * r;
+    n->sqrdist.xy = nx[k] * ny[k] * r * r;
+#endif  // ADP
+
+    // pre-compute index and shift into potential tables
+    int col = (type1 <= type2)
+                  ? type1 * g_param.ntypes + type2 - ((type1 * (type1 + 1)) / 2)
+                  : type2 * g_param.ntypes + type1 - ((type2 * (type2 + 1)) / 2);
+    mindist[col] = MIN(mindist[col], r);
+
+    // pair potential
+    set_neighbor_slot(n, col, r, 0);
+
+#if defined(EAM) || defined(ADP) || defined(MEAM)
+    /* transfer function */
+    col = g_calc.paircol + type2;
+    set_neighbor_slot(n, col, r, 1);
 #if defined(TBEAM)
-              /* transfer function - d band */
-              col = g_calc.paircol + 2 * g_param.ntypes + type2;
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 2);
+    /* transfer function - d band */
+    col = g_calc.paircol + 2 * g_param.ntypes + type2;
+    set_neighbor_slot(n, col, r, 2);
 #endif  // TBEAM
 #endif  // EAM || ADP || MEAM
 
 #if defined(MEAM)
-              /* Store slots and stuff for f(r_ij) */
-              col = g_calc.paircol + 2 * g_param.ntypes +
-                    g_config.atoms[i].neigh[k].col[0];
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 2);
+    /* Store slots and stuff for f(r_ij) */
+    col = g_calc.paircol + 2 * g_param.ntypes + n->col[0];
+    set_neighbor_slot(n, col, r, 2);
 #endif  // MEAM
 
 #if defined(ANG)
-              /* Store slots and stuff for f(r_ij) */
-              col = g_calc.paircol + g_config.atoms[i].neigh[k].col[0];
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 1);
+    /* Store slots and stuff for f(r_ij) */
+    col = g_calc.paircol + n->col[0];
+    set_neighbor_slot(n, col, r, 1);
 #endif  // ANG
 
 #if defined(ADP)
-              /* dipole part */
-              col = g_calc.paircol + 2 * g_param.ntypes +
-                    g_config.atoms[i].neigh[k].col[0];
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 2);
-
-              /* quadrupole part */
-              col = 2 * g_calc.paircol + 2 * g_param.ntypes +
-                    g_config.atoms[i].neigh[k].col[0];
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 3);
+    /* dipole part */
+    col = g_calc.paircol + 2 * g_param.ntypes + n->col[0];
+    set_neighbor_slot(n, col, r, 2);
+
+    /* quadrupole part */
+    col = 2 * g_calc.paircol + 2 * g_param.ntypes + n->col[0];
+    set_neighbor_slot(n, col, r, 3);
 #endif  // ADP
 
 #if defined(STIWEB)
-              /* Store slots and stuff for exp. function */
-              col = g_calc.paircol + g_config.atoms[i].neigh[k].col[0];
-              set_neighbor_slot(g_config.atoms[i].neigh + k, col, r, 1);
+    /* Store slots and stuff for exp. function */
+    col = g_calc.paircol + n->col[0];
+    set_neighbor_slot(n, col, r, 1);
 #endif  // STIWEB
+  }
+}
+
+/****************************************************************
+  compare_neighbor_candidates
+    sort helper keeping the neighbor order of the direct search
+****************************************************************/
+
+int compare_neighbor_candidates(const void* a, const void* b)
+{
+  return (*(const int*)a > *(const int*)b) - (*(const int*)a < *(const int*)b);
+}
+
+/****************************************************************
+  init_neighbors_cells
+    cell-list based neighbor search with O(N) scaling, it finds
+    the same neighbors in the same order as the direct search in
+    init_neighbors and computes all distances with the identical
+    arithmetic, so the resulting neighbor tables are bit-identical
+****************************************************************/
+
+void init_neighbors_cells(config_state* cstate, double* mindist)
+{
+  const int nat = cstate->atom_count;
+  const int csx = (int)cstate->cell_scale.x;
+  const int csy = (int)cstate->cell_scale.y;
+  const int csz = (int)cstate->cell_scale.z;
+  const int nix = 2 * csx + 1;
+  const int niy = 2 * csy + 1;
+  const int niz = 2 * csz + 1;
+  const int num_images = nix * niy * niz;
+  const int num_entries = nat * num_images;
+  const int center = (csx * niy + csy) * niz + csz;
+
+  // positions of all periodic images, the entry index preserves the
+  // (neighbor, image) loop nesting of the direct search
+  double* px = (double*)malloc(num_entries * sizeof(double));
+  double* py = (double*)malloc(num_entries * sizeof(double));
+  double* pz = (double*)malloc(num_entries * sizeof(double));
+
+  if (px == NULL || py == NULL || pz == NULL)
+    error(1, "Could not allocate memory for cell-list neighbor search!\n");
+
+  int e = 0;
+
+  for (int j = 0; j < nat; j++) {
+    const atom_t* atom = g_config.atoms + g_config.natoms + j;
+    for (int ix = -csx; ix <= csx; ix++) {
+      for (int iy = -csy; iy <= csy; iy++) {
+        for (int iz = -csz; iz <= csz; iz++) {
+          px[e] = atom->pos.x + ix * cstate->box_x.x + iy * cstate->box_y.x + iz * cstate->box_z.x;
+          py[e] = atom->pos.y + ix * cstate->box_x.y + iy * cstate->box_y.y + iz * cstate->box_z.y;
+          pz[e] = atom->pos.z + ix * cstate->box_x.z + iy * cstate->box_y.z + iz * cstate->box_z.z;
+          e++;
+        }
+      }
+    }
+  }
+
+  // bin all images into cells of at least rcutmax edge length, based
+  // on the axis-aligned bounding box of all image positions
+  double min_x = px[0], max_x = px[0];
+  double min_y = py[0], max_y = py[0];
+  double min_z = pz[0], max_z = pz[0];
+
+  for (e = 1; e < num_entries; e++) {
+    min_x = MIN(min_x, px[e]);
+    max_x = MAX(max_x, px[e]);
+    min_y = MIN(min_y, py[e]);
+    max_y = MAX(max_y, py[e]);
+    min_z = MIN(min_z, pz[e]);
+    max_z = MAX(max_z, pz[e]);
+  }
+
+  const int ncx = MAX((int)((max_x - min_x) / g_config.rcutmax), 1);
+  const int ncy = MAX((int)((max_y - min_y) / g_config.rcutmax), 1);
+  const int ncz = MAX((int)((max_z - min_z) / g_config.rcutmax), 1);
+  const int num_cells = ncx * ncy * ncz;
+  const double icx = (max_x > min_x) ? ncx / (max_x - min_x) : 0.0;
+  const double icy = (max_y > min_y) ? ncy / (max_y - min_y) : 0.0;
+  const double icz = (max_z > min_z) ? ncz / (max_z - min_z) : 0.0;
+
+  int* cell_of = (int*)malloc(num_entries * sizeof(int));
+  int* cell_start = (int*)calloc(num_cells + 1, sizeof(int));
+  int* cell_entry = (int*)malloc(num_entries * sizeof(int));
+  int* candidates = (int*)malloc(num_entries * sizeof(int));
+
+  // image multipliers and batch buffers for the candidate distances
+  double* imx = (double*)malloc(num_images * sizeof(double));
+  double* imy = (double*)malloc(num_images * sizeof(double));
+  double* imz = (double*)malloc(num_images * sizeof(double));
+  double* ddx = (double*)malloc(num_entries * sizeof(double));
+  double* ddy = (double*)malloc(num_entries * sizeof(double));
+  double* ddz = (double*)malloc(num_entries * sizeof(double));
+  double* rr = (double*)malloc(num_entries * sizeof(double));
+
+  if (cell_of == NULL || cell_start == NULL || cell_entry == NULL || candidates == NULL ||
+      imx == NULL || imy == NULL || imz == NULL || ddx == NULL || ddy == NULL ||
+      ddz == NULL || rr == NULL)
+    error(1, "Could not allocate memory for cell-list neighbor search!\n");
+
+  make_image_shift_table(cstate, imx, imy, imz);
+
+  for (e = 0; e < num_entries; e++) {
+    int cx = MIN((int)((px[e] - min_x) * icx), ncx - 1);
+    int cy = MIN((int)((py[e] - min_y) * icy), ncy - 1);
+    int cz = MIN((int)((pz[e] - min_z) * icz), ncz - 1);
+    cell_of[e] = (cx * ncy + cy) * ncz + cz;
+    cell_start[cell_of[e] + 1]++;
+  }
+
+  for (int c = 0; c < num_cells; c++)
+    cell_start[c + 1] += cell_start[c];
+
+  // filling in entry order keeps each cell list sorted
+  {
+    int* fill = (int*)calloc(num_cells, sizeof(int));
+    if (fill == NULL)
+      error(1, "Could not allocate memory for cell-list neighbor search!\n");
+    for (e = 0; e < num_entries; e++)
+      cell_entry[cell_start[cell_of[e]] + fill[cell_of[e]]++] = e;
+    free(fill);
+  }
+
+  // compute the neighbor table
+  for (int i = g_config.natoms; i < g_config.natoms + nat; i++) {
+#if defined(THREEBODY)
+    int j_min = 0;
+#else
+    int j_min = i - g_config.natoms;
+#endif  // THREEBODY
+
+    // gather all image entries from the cells around atom i
+    const int cx = MIN((int)((g_config.atoms[i].pos.x - min_x) * icx), ncx - 1);
+    const int cy = MIN((int)((g_config.atoms[i].pos.y - min_y) * icy), ncy - 1);
+    const int cz = MIN((int)((g_config.atoms[i].pos.z - min_z) * icz), ncz - 1);
+
+    int num_candidates = 0;
+
+    for (int cix = MAX(cx - 1, 0); cix <= MIN(cx + 1, ncx - 1); cix++) {
+      for (int ciy = MAX(cy - 1, 0); ciy <= MIN(cy + 1, ncy - 1); ciy++) {
+        for (int ciz = MAX(cz - 1, 0); ciz <= MIN(cz + 1, ncz - 1); ciz++) {
+          int c = (cix * ncy + ciy) * ncz + ciz;
+          for (int idx = cell_start[c]; idx < cell_start[c + 1]; idx++) {
+            if (cell_entry[idx] / num_images < j_min)
+              continue;
+            candidates[num_candidates++] = cell_entry[idx];
+          }
+        }
+      }
+    }
+
+    // restore the (neighbor, image) order of the direct search
+    qsort(candidates, num_candidates, sizeof(int), compare_neighbor_candidates);
+
+    // batched distance computation for all candidates in one flat
+    // loop the compiler can vectorize
+    for (int c = 0; c < num_candidates; c++) {
+      int j = g_config.natoms + candidates[c] / num_images;
+      int image = candidates[c] % num_images;
+
+      double dx = g_config.atoms[j].pos.x - g_config.atoms[i].pos.x;
+      double dy = g_config.atoms[j].pos.y - g_config.atoms[i].pos.y;
+      double dz = g_config.atoms[j].pos.z - g_config.atoms[i].pos.z;
+
+      ddx[c] = dx + imx[image] * cstate->box_x.x + imy[image] * cstate->box_y.x + imz[image] * cstate->box_z.x;
+      ddy[c] = dy + imx[image] * cstate->box_x.y + imy[image] * cstate->box_y.y + imz[image] * cstate->box_z.y;
+      ddz[c] = dz + imx[image] * cstate->box_x.z + imy[image] * cstate->box_y.z + imz[image] * cstate->box_z.z;
+      rr[c] = ddx[c] * ddx[c] + ddy[c] * ddy[c] + ddz[c] * ddz[c];
+    }
+
+    const int type1 = g_config.atoms[i].type;
+
+    // first pass: count the neighbors
+    int num_neigh = 0;
+
+    for (int c = 0; c < num_candidates; c++) {
+      int j = g_config.natoms + candidates[c] / num_images;
+      int image = candidates[c] % num_images;
+
+      if ((i == j) && (image == center))
+        continue;
+
+      if (rr[c] == 0.0) {
+        int ix = image / (niy * niz) - csx;
+        int iy = (image / niz) % niy - csy;
+        int iz = image % niz - csz;
+        error(0, "Overlapping atoms found in configuration %d!\n", cstate->config);
+        error(0, "Atom %d @ (%f, %f, %f)\n", i - g_config.natoms, g_config.atoms[i].pos.x, g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+        error(0, "overlaps with atom %d @ (%f, %f, %f)\n", j - g_config.natoms, g_config.atoms[j].pos.x, g_config.atoms[j].pos.y, g_config.atoms[j].pos.z);
+        error(1, "in this periodic copy of the unit cell: x=%d, y=%d, z=%d", ix, iy, iz);
+      }
+
+      int type2 = g_config.atoms[j].type;
+      double rcut = g_config.rcut[type1 * g_param.ntypes + type2];
+
+      // guaranteed beyond the cutoff, no need for the square root
+      if (rr[c] > rcut * rcut * SQUARE_CUTOFF_SLACK)
+        continue;
+
+      double r = sqrt(rr[c]);
+
+      if (r <= rcut) {
+        if (r <= g_config.rmin[type1 * g_param.ntypes + type2]) {
+          warning("Configuration %i: Distance %f\n", cstate->config, r);
+          warning(" atom %d (type %d) at pos: %f %f %f\n",
+                  i - g_config.natoms, type1, g_config.atoms[i].pos.x,
+                  g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+          warning(" atom %d (type %d) at pos: %f %f %f\n",
+                  j - g_config.natoms, type2, ddx[c], ddy[c], ddz[c]);
+        }
+        num_neigh++;
+      }
+    }
+
+    if (num_neigh)
+      g_config.atoms[i].neigh = (neigh_t*)Malloc_slab(num_neigh * sizeof(neigh_t));
+
+    // second pass: collect the accepted neighbors, they are
+    // normalized and stored in one batch below
+    int nrs[MAX(num_neigh, 1)];
+    double acc_x[MAX(num_neigh, 1)];
+    double acc_y[MAX(num_neigh, 1)];
+    double acc_z[MAX(num_neigh, 1)];
+    double acc_r[MAX(num_neigh, 1)];
+    int acc = 0;
+
+    for (int c = 0; c < num_candidates; c++) {
+      int j = g_config.natoms + candidates[c] / num_images;
+      int image = candidates[c] % num_images;
+
+      if ((i == j) && (image == center))
+        continue;
+
+      int type2 = g_config.atoms[j].type;
+      double rcut = g_config.rcut[type1 * g_param.ntypes + type2];
+
+      if (rr[c] > rcut * rcut * SQUARE_CUTOFF_SLACK)
+        continue;
+
+      double r = sqrt(rr[c]);
+
+      if (r <= rcut) {
+        if (r <= g_config.rmin[type1 * g_param.ntypes + type2]) {
+          warning("Configuration %i: Distance %f\n", cstate->config, r);
+          warning(" atom %d (type %d) at pos: %f %f %f\n",
+                  i - g_config.natoms, type1, g_config.atoms[i].pos.x,
+                  g_config.atoms[i].pos.y, g_config.atoms[i].pos.z);
+          warning(" atom %d (type %d) at pos: %f %f %f\n",
+                  j - g_config.natoms, type2, ddx[c], ddy[c], ddz[c]);
+        }
+        nrs[acc] = j;
+        acc_x[acc] = ddx[c];
+        acc_y[acc] = ddy[c];
+        acc_z[acc] = ddz[c];
+        acc_r[acc] = r;
+        acc++;
+      }
+    }
+
+    if (acc)
+      store_neighbors(i, acc, nrs, acc_x, acc_y, acc_z, acc_r, mindist);
 
-            }   // r < r_cut
-          }     /* loop over images in z direction */
-        }       /* loop over images in y direction */
-      }         /* loop over images in x direction */
-    }           /* second loop over atoms (neighbors) */
     if (num_neigh != 0 && num_neigh != g_config.atoms[i].num_neigh)
       error(1, "Neigh count mismatch!!");
-  }             /* first loop over atoms */
-
-#if defined(KIM)
-  free(atom_pos);
-#endif // KIM
+  } // first loop over atoms
+
+  free(px);
+  free(py);
+  free(pz);
+  free(cell_of);
+  free(cell_start);
+  free(cell_entry);
+  free(candidates);
+  free(imx);
+  free(imy);
+  free(imz);
+  free(ddx);
+  free(ddy);
+  free(ddz);
+  free(rr);
 }
 
+#endif  // !KIM
+
 /****************************************************************
   set_neighbor_slot
     compute box transformation matrix
 ****************************************************************/
 
-void set_neighbor_slot(neigh_t* neighbor, int col, double r, int store_slot)
+static void set_neighbor_slot(neigh_t* neighbor, int col, double r, int store_slot)
+{
+  if (g_pot.format_type == POTENTIAL_FORMAT_KIM)
+    return;
+
+  neighbor->col[store_slot] = col;
+
+  compute_spline_position(col, r, &neighbor->slot[store_slot],
+                          &neighbor->shift[store_slot],
+                          &neighbor->step[store_slot]);
+}
+
+/****************************************************************
+  compute_spline_position
+    locate the spline table position of a distance r in column col
+****************************************************************/
+
+static void compute_spline_position(int col, double r, int* pslot, double* pshift,
+                                    double* pstep)
 {
   int slot = 0;
   double step = 0.0;
@@ -1355,10 +2810,9 @@ void set_neighbor_slot(neigh_t* neighbor, int col, double r, int store_slot)
     shift += 1.0;
   }
 
-  neighbor->shift[store_slot] = shift;
-  neighbor->slot[store_slot] = slot;
-  neighbor->step[store_slot] = step;
-  neighbor->col[store_slot] = col;
+  *pshift = shift;
+  *pslot = slot;
+  *pstep = step;
 }
 
 /****************************************************************
@@ -1504,6 +2958,376 @@ void init_angles(config_state* cstate)
 #endif  // THREEBODY
 }
 
+/****************************************************************
+  config_stream_create
+    back the packed neighbor arrays with an unlinked scratch file
+
+    The packed arrays are by far the largest resident object of a
+    large fit. Mapping them from a file turns them into an on-disk
+    representation the kernel pages in and out on demand, which
+    removes the memory ceiling on the dataset size. The scratch file
+    is unlinked right away, so its blocks are released automatically
+    when the process exits.
+****************************************************************/
+
+static void config_stream_create(size_t size)
+{
+  char scratchname[255];
+
+  // worker processes do not know the configuration file name
+  const char* prefix = g_files.config ? g_files.config : "potfit";
+
+  sprintf(scratchname, "%s.soa.%d", prefix, g_mpi.myid);
+
+  int fd = open(scratchname, O_RDWR | O_CREAT | O_TRUNC, 0600);
+
+  if (fd < 0 || ftruncate(fd, size) != 0) {
+    warning("Could not create scratch file %s, config_stream disabled\n",
+            scratchname);
+    if (fd >= 0) {
+      close(fd);
+      remove(scratchname);
+    }
+    return;
+  }
+
+  char* map =
+      (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  close(fd);
+  remove(scratchname);
+
+  if (map == MAP_FAILED) {
+    warning("Could not map scratch file %s, config_stream disabled\n",
+            scratchname);
+    return;
+  }
+
+  g_soa_stream_base = map;
+  g_soa_stream_size = size;
+  g_soa_stream_used = 0;
+}
+
+/****************************************************************
+  soa_alloc
+    carve a packed array out of the scratch mapping, or fall back to
+    the heap when streaming is off or setting it up failed
+****************************************************************/
+
+static void* soa_alloc(size_t size)
+{
+  // pad to keep the double arrays aligned
+  size = (size + 7) & ~(size_t)7;
+
+  if (g_soa_stream_base == NULL)
+    // huge pages when requested, first-touch zeroing either way, so
+    // the pages spread over the NUMA domains of the threads that
+    // will traverse them
+    return Malloc_huge(size);
+
+  char* block = g_soa_stream_base + g_soa_stream_used;
+
+  g_soa_stream_used += size;
+
+  return block;
+}
+
+/****************************************************************
+  build_neighbor_soa
+    repack the per-atom neighbor tables into parallel arrays
+
+    The neigh_t records are convenient to build, but the innermost force
+    loops stride over them and only use a few fields per neighbor. Once
+    the atom data has been distributed, each process packs these fields
+    into contiguous arrays, one entry per neighbor, with the atom
+    boundaries stored in neigh_soa.first.
+****************************************************************/
+
+void build_neighbor_soa(void)
+{
+  neigh_soa_t* soa = &g_config.neigh_soa;
+
+#if defined(MPI)
+  const int num_atoms = g_mpi.myatoms;
+#else
+  const int num_atoms = g_config.natoms;
+#endif  // MPI
+
+  int num_entries = 0;
+
+  for (int i = 0; i < num_atoms; i++)
+    num_entries += g_config.conf_atoms[i].num_neigh;
+
+  soa->num_entries = num_entries;
+  soa->first = (int*)Malloc((num_atoms + 1) * sizeof(int));
+
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+  int num_angles = 0;
+
+  for (int i = 0; i < num_atoms; i++)
+    num_angles += g_config.conf_atoms[i].num_angles;
+
+  soa->ang_first = (int*)Malloc((num_atoms + 1) * sizeof(int));
+#endif  // THREEBODY && (MEAM || ANG)
+
+  if (num_entries == 0)
+    return;
+
+  if (g_param.config_stream) {
+    // total size of all packed arrays, with each one padded like in
+    // soa_alloc
+    const size_t ints = ((size_t)num_entries * sizeof(int) + 7) & ~(size_t)7;
+    const size_t doubles = (size_t)num_entries * sizeof(double);
+    size_t total = 2 * ints + 8 * doubles + SLOTS * (2 * ints + 2 * doubles);
+#if defined(EAM)
+    total += ints + 2 * doubles;
+#if defined(TBEAM)
+    total += ints + 2 * doubles;
+#endif  // TBEAM
+#endif  // EAM
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+    total += (((size_t)num_angles * sizeof(int) + 7) & ~(size_t)7) +
+             2 * (size_t)num_angles * sizeof(double);
+#endif  // THREEBODY && (MEAM || ANG)
+    config_stream_create(total);
+  }
+
+  soa->type = (int*)soa_alloc(num_entries * sizeof(int));
+  soa->nr = (int*)soa_alloc(num_entries * sizeof(int));
+  soa->r = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->inv_r = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_x = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_y = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_z = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_r_x = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_r_y = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->dist_r_z = (double*)soa_alloc(num_entries * sizeof(double));
+  for (int s = 0; s < SLOTS; s++) {
+    soa->slot[s] = (int*)soa_alloc(num_entries * sizeof(int));
+    soa->shift[s] = (double*)soa_alloc(num_entries * sizeof(double));
+    soa->step[s] = (double*)soa_alloc(num_entries * sizeof(double));
+    soa->col[s] = (int*)soa_alloc(num_entries * sizeof(int));
+  }
+
+#if defined(EAM)
+  soa->slot_rev = (int*)soa_alloc(num_entries * sizeof(int));
+  soa->shift_rev = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->step_rev = (double*)soa_alloc(num_entries * sizeof(double));
+#if defined(TBEAM)
+  soa->slot_rev_s = (int*)soa_alloc(num_entries * sizeof(int));
+  soa->shift_rev_s = (double*)soa_alloc(num_entries * sizeof(double));
+  soa->step_rev_s = (double*)soa_alloc(num_entries * sizeof(double));
+#endif  // TBEAM
+#endif  // EAM
+
+#if defined(EAM) || defined(ADP)
+  // rewritten on every evaluation, so this must not end up in a
+  // file-backed stream window
+  soa->rho_grad = (double*)Malloc_huge(num_entries * sizeof(double));
+#endif  // EAM || ADP
+
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+  if (num_angles > 0) {
+    soa->ang_slot = (int*)soa_alloc(num_angles * sizeof(int));
+    soa->ang_shift = (double*)soa_alloc(num_angles * sizeof(double));
+    soa->ang_step = (double*)soa_alloc(num_angles * sizeof(double));
+  }
+#endif  // THREEBODY && (MEAM || ANG)
+
+  int n = 0;
+
+  for (int i = 0; i < num_atoms; i++) {
+    soa->first[i] = n;
+    for (int j = 0; j < g_config.conf_atoms[i].num_neigh; j++) {
+      neigh_t* neigh = g_config.conf_atoms[i].neigh + j;
+      soa->type[n] = neigh->type;
+      soa->nr[n] = neigh->nr;
+      soa->r[n] = neigh->r;
+      soa->inv_r[n] = neigh->inv_r;
+      soa->dist_x[n] = neigh->dist.x;
+      soa->dist_y[n] = neigh->dist.y;
+      soa->dist_z[n] = neigh->dist.z;
+      soa->dist_r_x[n] = neigh->dist_r.x;
+      soa->dist_r_y[n] = neigh->dist_r.y;
+      soa->dist_r_z[n] = neigh->dist_r.z;
+      // the batched spline calls evaluate every neighbor and mask
+      // nothing, so positions beyond their column end - possible for
+      // every column whose cutoff is shorter than the neighbor list
+      // cutoff - are clamped to the start of their column: the
+      // kernels discard those results behind their range guards, but
+      // the raw positions would make the batched lookups read past
+      // the column
+      for (int s = 0; s < SLOTS; s++) {
+        soa->slot[s][n] = neigh->slot[s];
+        soa->shift[s][n] = neigh->shift[s];
+        soa->step[s][n] = neigh->step[s];
+        soa->col[s][n] = neigh->col[s];
+        if (g_pot.format_type != POTENTIAL_FORMAT_KIM &&
+            neigh->r >= g_pot.calc_pot.end[neigh->col[s]]) {
+          soa->slot[s][n] = g_pot.calc_pot.first[neigh->col[s]];
+          soa->shift[s][n] = 0.0;
+        }
+      }
+#if defined(EAM)
+      // the per-neighbor slots only cover the transfer function of the
+      // neighbor's type, precompute the reverse direction as well so
+      // the kernels do not have to locate it on every evaluation
+      {
+        int col_rev = g_calc.paircol + g_config.conf_atoms[i].type;
+        if (neigh->r < g_pot.calc_pot.end[col_rev])
+          compute_spline_position(col_rev, neigh->r, &soa->slot_rev[n],
+                                  &soa->shift_rev[n], &soa->step_rev[n]);
+#if defined(TBEAM)
+        int col_rev_s = g_calc.paircol + 2 * g_param.ntypes + g_config.conf_atoms[i].type;
+        if (neigh->r < g_pot.calc_pot.end[col_rev_s])
+          compute_spline_position(col_rev_s, neigh->r, &soa->slot_rev_s[n],
+                                  &soa->shift_rev_s[n], &soa->step_rev_s[n]);
+#endif  // TBEAM
+      }
+#endif  // EAM
+      n++;
+    }
+  }
+  soa->first[num_atoms] = n;
+
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+  // pack the interpolation geometry of the angular table as well, so
+  // the force kernels can evaluate all triples of an atom in one
+  // batched spline call
+  int a = 0;
+
+  for (int i = 0; i < num_atoms; i++) {
+    soa->ang_first[i] = a;
+    for (int j = 0; j < g_config.conf_atoms[i].num_angles; j++) {
+      angle_t* angle = g_config.conf_atoms[i].angle_part + j;
+      soa->ang_slot[a] = angle->slot;
+      soa->ang_shift[a] = angle->shift;
+      soa->ang_step[a] = angle->step;
+      a++;
+    }
+  }
+  soa->ang_first[num_atoms] = a;
+#endif  // THREEBODY && (MEAM || ANG)
+
+#if (defined(PAIR) || defined(EAM)) && defined(APOT) && \
+    !defined(COULOMB) && !defined(THREEBODY) && !defined(BINDIST) && \
+    !defined(KIM)
+  // these force kernels only read the packed arrays, so the per-atom
+  // neigh_t tables just became dead weight - dropping them roughly
+  // halves the neighbor memory footprint of large datasets
+  // (tabulated potentials keep them for rescaling, the interactions
+  // and outputs excluded above still walk the tables directly)
+  for (int i = 0; i < num_atoms; i++)
+    g_config.conf_atoms[i].neigh = NULL;
+  if (g_config.atoms != NULL)
+    for (int i = 0; i < g_config.natoms; i++)
+      g_config.atoms[i].neigh = NULL;
+  Free_slab_memory();
+#endif  // (PAIR || EAM) && APOT && ...
+}
+
+/****************************************************************
+  config_stream_advise
+    pass a madvise hint for the packed data of one configuration
+****************************************************************/
+
+static void config_stream_advise(int config_idx, int advice)
+{
+  const neigh_soa_t* soa = &g_config.neigh_soa;
+
+  if (config_idx < g_mpi.firstconf ||
+      config_idx >= g_mpi.firstconf + g_mpi.myconf)
+    return;
+
+  int atom_first = g_config.cnfstart[config_idx] - g_mpi.firstatom;
+  int lo = soa->first[atom_first];
+  int hi = soa->first[atom_first + g_config.inconf[config_idx]];
+
+  if (hi <= lo)
+    return;
+
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+#define SOA_ADVISE(array)                                \
+  do {                                                   \
+    char* begin = (char*)((array) + lo);                 \
+    char* end = (char*)((array) + hi);                   \
+    begin -= (size_t)begin % page;                       \
+    posix_madvise(begin, (size_t)(end - begin), advice); \
+  } while (0)
+
+  SOA_ADVISE(soa->type);
+  SOA_ADVISE(soa->nr);
+  SOA_ADVISE(soa->r);
+  SOA_ADVISE(soa->inv_r);
+  SOA_ADVISE(soa->dist_x);
+  SOA_ADVISE(soa->dist_y);
+  SOA_ADVISE(soa->dist_z);
+  SOA_ADVISE(soa->dist_r_x);
+  SOA_ADVISE(soa->dist_r_y);
+  SOA_ADVISE(soa->dist_r_z);
+  for (int s = 0; s < SLOTS; s++) {
+    SOA_ADVISE(soa->slot[s]);
+    SOA_ADVISE(soa->shift[s]);
+    SOA_ADVISE(soa->step[s]);
+    SOA_ADVISE(soa->col[s]);
+  }
+#if defined(EAM)
+  SOA_ADVISE(soa->slot_rev);
+  SOA_ADVISE(soa->shift_rev);
+  SOA_ADVISE(soa->step_rev);
+#if defined(TBEAM)
+  SOA_ADVISE(soa->slot_rev_s);
+  SOA_ADVISE(soa->shift_rev_s);
+  SOA_ADVISE(soa->step_rev_s);
+#endif  // TBEAM
+#endif  // EAM
+
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+  {
+    int lo = soa->ang_first[atom_first];
+    int hi = soa->ang_first[atom_first + g_config.inconf[config_idx]];
+
+    if (hi > lo) {
+      SOA_ADVISE(soa->ang_slot);
+      SOA_ADVISE(soa->ang_shift);
+      SOA_ADVISE(soa->ang_step);
+    }
+  }
+#endif  // THREEBODY && (MEAM || ANG)
+
+#undef SOA_ADVISE
+}
+
+/****************************************************************
+  config_stream_prefetch
+    slide the resident window of the packed neighbor data
+
+    Called at the top of the per-configuration force loops when the
+    packed arrays are file-backed. The block of the following
+    configuration is fetched while the current one is being computed
+    and the block finished two configurations ago is released, so the
+    resident window stays small no matter how large the dataset is.
+    The hints assume the configurations are visited in order - an
+    armed abort cutoff permutes them, then this just degrades to
+    plain demand paging.
+****************************************************************/
+
+void config_stream_prefetch(int config_idx)
+{
+  if (g_soa_stream_base == NULL)
+    return;
+
+#if defined(OPENMP)
+  // the threaded force loops visit the configurations in parallel, so
+  // there is no stream order and the data is left to demand paging
+  return;
+#endif  // OPENMP
+
+  config_stream_advise(config_idx + 1, POSIX_MADV_WILLNEED);
+  config_stream_advise(config_idx - 2, POSIX_MADV_DONTNEED);
+}
+
 /****************************************************************
   make_box
 ****************************************************************/
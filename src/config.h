@@ -30,11 +30,14 @@
 #ifndef CONFIG_H_INCLUDED
 #define CONFIG_H_INCLUDED
 
-void read_config(const char* filename);
+void read_config(void);
+
+void build_neighbor_soa(void);
+
+void config_stream_prefetch(int config_idx);
 
 #if defined(APOT)
 void update_slots(void);
-void update_neighbor_slots(neigh_t* neighbor, double r, int neighbor_slot);
 #endif  // APOT
 
 #endif  // CONFIG_H_INCLUDED
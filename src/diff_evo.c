@@ -32,12 +32,17 @@
 
 #if defined(EVO)
 
+#include "eval_float.h"
 #include "force.h"
+#include "force_batch.h"
 #include "memory.h"
 #include "optimize.h"
 #include "potential_output.h"
 #include "random.h"
 #include "rescale.h"
+#include "surrogate.h"
+#include "trace.h"
+#include "uq.h"
 #include "utils.h"
 
 #define D (g_calc.ndimtot + 2)
@@ -45,12 +50,32 @@
 
 #define JR 0.6  // jumping rate for opposite algorithm
 
+// number of trial vectors evaluated concurrently
+#if defined(MPI)
+#define EVO_BATCH g_mpi.num_groups
+#else
+#define EVO_BATCH 1
+#endif  // MPI
+
+#if defined(MPI)
+// message tags for the communication with the evaluation group leaders
+#define EVO_TAG_TRIAL 101
+#define EVO_TAG_STOP 102
+#endif  // MPI
+
+// mini-batch resampling period and the crit/evo_threshold ratio below
+// which full evaluations resume
+#define MINIBATCH_PERIOD 10
+#define MINIBATCH_FULL_CRIT 100.0
+
 // boundary values for self-adapting parameters
 #define F_LOWER 0.1 /* lower value for F */
 #define F_UPPER 0.9 /* upper value for F */
 #define TAU_1 0.1   /* probability for changing F */
 #define TAU_2 0.1   /* probability for changing CR */
 
+void evaluate_trial_batch(double** trials, double* cost, int count,
+                          double* forces);
 #if defined(APOT) || defined(KIM)
 void opposite_check(double** population, double* cost, int do_init);
 void quicksort(double* cost, int start, int end, double** population);
@@ -58,6 +83,98 @@ int partition(double* cost, int start, int end, int index, double** population);
 void swap_population(double* population_1, double* population_2);
 #endif  // APOT
 
+/****************************************************************
+ *
+ *  evaluate a batch of trial vectors, one per evaluation group
+ *
+ ****************************************************************/
+
+void evaluate_trial_batch(double** trials, double* cost, int count,
+                          double* forces)
+{
+#if defined(MPI)
+  if (g_mpi.num_groups > 1) {
+    // farm out all but the first trial to the other group leaders
+    for (int i = 1; i < count; i++)
+      MPI_Send(trials[i], D, MPI_DOUBLE, g_mpi.group_leaders[i], EVO_TAG_TRIAL,
+               MPI_COMM_WORLD);
+
+    cost[0] = calc_forces(trials[0], forces, 0);
+
+    for (int i = 1; i < count; i++)
+      MPI_Recv(cost + i, 1, MPI_DOUBLE, g_mpi.group_leaders[i], EVO_TAG_TRIAL,
+               MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+    return;
+  }
+#endif  // MPI
+
+  for (int i = 0; i < count; i++)
+    cost[i] = calc_forces(trials[i], forces, 0);
+}
+
+#if defined(MPI)
+
+/****************************************************************
+ *
+ *  evaluation loop of the group leaders (world rank != 0,
+ *  group rank == 0): receive trial vectors from the root
+ *  process, evaluate them with the own group and return the cost
+ *
+ ****************************************************************/
+
+void run_evo_group_leader(double* forces)
+{
+  // Select correct spline interpolation and other functions
+  // Root process has done this earlier
+  init_force_common(1);
+  init_force(1);
+
+  double* trial = (double*)Malloc(D * sizeof(double));
+  MPI_Status status;
+
+  // only the cost of each trial travels back to the root process
+  gather_forces_sum_only(1);
+
+  while (1) {
+    MPI_Recv(trial, D, MPI_DOUBLE, 0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+
+    if (status.MPI_TAG == EVO_TAG_STOP)
+      break;
+
+    double cost = calc_forces(trial, forces, 0);
+
+    MPI_Send(&cost, 1, MPI_DOUBLE, 0, EVO_TAG_TRIAL, MPI_COMM_WORLD);
+  }
+
+  gather_forces_sum_only(0);
+
+#if defined(UQ)
+  // the workers are still needed, this leader runs its own MC chain
+  run_uq_walker();
+#endif  // UQ
+
+  // go wake up the workers of this group
+  calc_forces(NULL, NULL, 1);
+}
+
+/****************************************************************
+ *
+ *  release the group leaders when the root process is done
+ *
+ ****************************************************************/
+
+void stop_evo_group_leaders()
+{
+  double dummy = 0.0;
+
+  for (int i = 1; i < g_mpi.num_groups; i++)
+    MPI_Send(&dummy, 1, MPI_DOUBLE, g_mpi.group_leaders[i], EVO_TAG_STOP,
+             MPI_COMM_WORLD);
+}
+
+#endif  // MPI
+
 /****************************************************************
  *
  *  initialize population with random numbers
@@ -100,8 +217,8 @@ void init_population(double** pop, double* xi, double* cost)
 
   double* forces = (double*)malloc(g_calc.mdim * sizeof(double));
 
-  for (int i = 0; i < NP; i++)
-    cost[i] = calc_forces(pop[i], forces, 0);
+  for (int i = 0; i < NP; i += EVO_BATCH)
+    evaluate_trial_batch(pop + i, cost + i, MIN(EVO_BATCH, NP - i), forces);
 
 #if defined(APOT) || defined(KIM)
   opposite_check(pop, cost, 1);
@@ -186,8 +303,9 @@ void opposite_check(double** population, double* cost, int do_init)
   for (int i = 0; i < NP; i++)
     tot_cost[i] = cost[i];
 
-  for (int i = NP; i < 2 * NP; i++)
-    tot_cost[i] = calc_forces(tot_P[i], fxi, 0);
+  for (int i = NP; i < 2 * NP; i += EVO_BATCH)
+    evaluate_trial_batch(tot_P + i, tot_cost + i, MIN(EVO_BATCH, 2 * NP - i),
+                         fxi);
 
   // evaluate the NP best individuals from both populations
   // sort with quicksort and return NP best indivuals
@@ -294,12 +412,24 @@ void run_differential_evolution(double* xi)
   if (g_param.evo_threshold == 0.0)
     return;
 
+  // the evolution only ranks trials by their cost, the deviation
+  // vectors can stay distributed until powell needs them
+  gather_forces_sum_only(1);
+
+  /* a few significant digits are plenty for the stochastic search */
+  eval_float_set(1);
+
   // vector for force calculation
   double* forces = (double*)Malloc(g_calc.mdim * sizeof(double));
 
-  // vector with new configuration
-  double* trial = (double*)Malloc(D * sizeof(double));
-  memcpy(trial, xi, (D - 2) * sizeof(double));
+  // vectors with new configurations, one per evaluation group
+  double** trial = (double**)Malloc(EVO_BATCH * sizeof(double*));
+  double* trial_cost = (double*)Malloc(EVO_BATCH * sizeof(double));
+
+  for (int i = 0; i < EVO_BATCH; i++) {
+    trial[i] = (double*)Malloc(D * sizeof(double));
+    memcpy(trial[i], xi, (D - 2) * sizeof(double));
+  }
 
   // allocate memory for all configurations
   double** pop_1 = (double**)Malloc(NP * sizeof(double*));
@@ -315,6 +445,10 @@ void run_differential_evolution(double* xi)
   printf("Initializing population ... ");
   fflush(stdout);
 
+  /* the early generations only need a rough error estimate */
+  if (g_force_batch.enabled)
+    force_batch_select(g_param.eval_batch);
+
   init_population(pop_1, xi, cost);
 
   for (int i = 0; i < NP; i++) {
@@ -341,123 +475,154 @@ void run_differential_evolution(double* xi)
     max_cost = 0.0;
 
     // randomly create new populations
-    for (int i = 0; i < NP; i++) {
-      // generate random numbers
-      do
-        a = (int)floor(eqdist() * NP);
-      while (a == i);
-
-      do
-        b = (int)floor(eqdist() * NP);
-      while (b == i || b == a);
-
-      //       do
-      //         c = (int)floor(eqdist() * NP);
-      //       while (c == i || c == a || c == b);
-      //
-      //       do
-      //         d = (int)floor(eqdist() * NP);
-      //       while (d == i || d == a || d == b || d == c);
-      //
-      //       do
-      //         e = (int)floor(eqdist() * NP);
-      //       while (e == i || e == a || e == b || e == c || e == d);
-
-      int j = (int)floor(eqdist() * g_calc.ndim);
-
-      // self-adaptive parameters
-      if (eqdist() < TAU_1)
-        trial[D - 2] = F_LOWER + eqdist() * F_UPPER;
-      else
-        trial[D - 2] = pop_1[i][D - 2];
-
-      if (eqdist() < TAU_2)
-        trial[D - 1] = eqdist();
-      else
-        trial[D - 1] = pop_1[i][D - 1];
-
-      double temp = 0.0;
-
-      // create trail vectors with different methods
-      for (int k = 1; k <= g_calc.ndim; k++) {
-        if (eqdist() < trial[D - 1] || k == j) {
-          /* DE/rand/1/exp */
-          //           temp = pop_1[c][g_pot.opt_pot.idx[j]] + trial[D - 2] *
-          //           (pop_1[a][g_pot.opt_pot.idx[j]] -
-          //           pop_1[b][g_pot.opt_pot.idx[j]]);
-          /* DE/best/1/exp */
-          temp = best[g_pot.opt_pot.idx[j]] +
-                 trial[D - 2] * (pop_1[a][g_pot.opt_pot.idx[j]] -
-                                 pop_1[b][g_pot.opt_pot.idx[j]]);
+    for (int i = 0; i < NP; i += EVO_BATCH) {
+      int batch = MIN(EVO_BATCH, NP - i);
+
+      for (int n = 0; n < batch; n++) {
+        double* t = trial[n];
+
+        // generate random numbers
+        do
+          a = (int)floor(eqdist() * NP);
+        while (a == i + n);
+
+        do
+          b = (int)floor(eqdist() * NP);
+        while (b == i + n || b == a);
+
+        //       do
+        //         c = (int)floor(eqdist() * NP);
+        //       while (c == i + n || c == a || c == b);
+        //
+        //       do
+        //         d = (int)floor(eqdist() * NP);
+        //       while (d == i + n || d == a || d == b || d == c);
+        //
+        //       do
+        //         e = (int)floor(eqdist() * NP);
+        //       while (e == i + n || e == a || e == b || e == c || e == d);
+
+        int j = (int)floor(eqdist() * g_calc.ndim);
+
+        // self-adaptive parameters
+        if (eqdist() < TAU_1)
+          t[D - 2] = F_LOWER + eqdist() * F_UPPER;
+        else
+          t[D - 2] = pop_1[i + n][D - 2];
+
+        if (eqdist() < TAU_2)
+          t[D - 1] = eqdist();
+        else
+          t[D - 1] = pop_1[i + n][D - 1];
+
+        double temp = 0.0;
+
+        // create trail vectors with different methods
+        for (int k = 1; k <= g_calc.ndim; k++) {
+          if (eqdist() < t[D - 1] || k == j) {
+            /* DE/rand/1/exp */
+            //           temp = pop_1[c][g_pot.opt_pot.idx[j]] + t[D - 2] *
+            //           (pop_1[a][g_pot.opt_pot.idx[j]] -
+            //           pop_1[b][g_pot.opt_pot.idx[j]]);
+            /* DE/best/1/exp */
+            temp = best[g_pot.opt_pot.idx[j]] +
+                   t[D - 2] * (pop_1[a][g_pot.opt_pot.idx[j]] -
+                               pop_1[b][g_pot.opt_pot.idx[j]]);
 /* DE/rand/2/exp */
-//           temp = pop_1[e][j] + trial[D-2] * (pop_1[a][j] + pop_1[b][j] -
+//           temp = pop_1[e][j] + t[D-2] * (pop_1[a][j] + pop_1[b][j] -
 //           pop_1[c][j] -
 //           pop_1[d][j]);
 /* DE/best/2/exp */
-//           temp = best[j] + trial[D-2] * (pop_1[a][j] + pop_1[b][j] -
+//           temp = best[j] + t[D-2] * (pop_1[a][j] + pop_1[b][j] -
 //           pop_1[c][j] -
 //           pop_1[d][j]);
 /* DE/rand-to-best/1/exp */
-//           temp = pop_1[c][j] + (1 - trial[D-2]) * (best[j] - pop_1[c][j]) +
-//           trial[D-2]
+//           temp = pop_1[c][j] + (1 - t[D-2]) * (best[j] - pop_1[c][j]) +
+//           t[D-2]
 //           * (pop_1[a][j] - pop_1[b][j]);
 /* DE/rand-to-best/2/exp */
-//           temp = pop_1[e][j] + (1 - trial[D-2]) * (best[j] - pop_1[e][j]) +
-//           trial[D-2]
+//           temp = pop_1[e][j] + (1 - t[D-2]) * (best[j] - pop_1[e][j]) +
+//           t[D-2]
 //           * (pop_1[a][j] + pop_1[b][j] - pop_1[c][j] - pop_1[d][j]);
 #if defined(APOT) || defined(KIM)
-          double pmin = g_pot.apot_table.pmin[g_pot.apot_table.idxpot[j]]
-                                             [g_pot.apot_table.idxparam[j]];
-          double pmax = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[j]]
-                                             [g_pot.apot_table.idxparam[j]];
-
-          if (temp > pmax) {
-            trial[g_pot.opt_pot.idx[j]] = pmax;
-          } else if (temp < pmin) {
-            trial[g_pot.opt_pot.idx[j]] = pmin;
-          } else
-            trial[g_pot.opt_pot.idx[j]] = temp;
+            double pmin = g_pot.apot_table.pmin[g_pot.apot_table.idxpot[j]]
+                                               [g_pot.apot_table.idxparam[j]];
+            double pmax = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[j]]
+                                               [g_pot.apot_table.idxparam[j]];
+
+            if (temp > pmax) {
+              t[g_pot.opt_pot.idx[j]] = pmax;
+            } else if (temp < pmin) {
+              t[g_pot.opt_pot.idx[j]] = pmin;
+            } else
+              t[g_pot.opt_pot.idx[j]] = temp;
 #else
-          trial[g_pot.opt_pot.idx[j]] = temp;
+            t[g_pot.opt_pot.idx[j]] = temp;
 #endif  // APOT || KIM
-        } else {
-          trial[g_pot.opt_pot.idx[j]] = pop_1[i][g_pot.opt_pot.idx[j]];
+          } else {
+            t[g_pot.opt_pot.idx[j]] = pop_1[i + n][g_pot.opt_pot.idx[j]];
+          }
+
+          j = (j + 1) % g_calc.ndim;
         }
+      }
+
+      /* with a single evaluation group a trial predicted to lose
+         against the population member it challenges counts as
+         rejected right away; mini-batch estimates are not comparable
+         between subsets and stay out of the model */
+      if (batch == 1 && !g_force_batch.active &&
+          surrogate_screen(trial[0], cost[i], 0.0)) {
+        memcpy(pop_2[i], pop_1[i], D * sizeof(double));
 
-        j = (j + 1) % g_calc.ndim;
+        if (cost[i] > max_cost)
+          max_cost = cost[i];
+
+        continue;
       }
 
-      double force = calc_forces(trial, forces, 0);
+      // the whole batch is created from the same best vector and
+      // evaluated concurrently, one trial per evaluation group
+      evaluate_trial_batch(trial, trial_cost, batch, forces);
+
+      for (int n = 0; n < batch; n++) {
+        double force = trial_cost[n];
+
+        if (!g_force_batch.active)
+          surrogate_store(trial[n], force);
 
-      if (force < min_cost) {
-        memcpy(best, trial, D * sizeof(double));
+        trace_record(force, 0.0, force <= cost[i + n]);
 
-        if (g_files.tempfile && strlen(g_files.tempfile)) {
-          for (j = 0; j < g_calc.ndim; j++)
+        if (force < min_cost) {
+          memcpy(best, trial[n], D * sizeof(double));
+
+          if (g_files.tempfile && strlen(g_files.tempfile)) {
+            for (int j = 0; j < g_calc.ndim; j++)
 #if defined(APOT) || defined(KIM)
-            g_pot.apot_table.values[g_pot.apot_table.idxpot[j]]
-                                   [g_pot.apot_table.idxparam[j]] =
-                trial[g_pot.opt_pot.idx[j]];
+              g_pot.apot_table.values[g_pot.apot_table.idxpot[j]]
+                                     [g_pot.apot_table.idxparam[j]] =
+                  trial[n][g_pot.opt_pot.idx[j]];
 #else
-            xi[g_pot.opt_pot.idx[j]] = trial[g_pot.opt_pot.idx[j]];
+              xi[g_pot.opt_pot.idx[j]] = trial[n][g_pot.opt_pot.idx[j]];
 #endif  // APOT || KIM
-          write_pot_table_potfit(g_files.tempfile);
+            write_pot_table_potfit_async(g_files.tempfile);
+          }
+          min_cost = force;
         }
-        min_cost = force;
-      }
 
-      if (force <= cost[i]) {
-        memcpy(pop_2[i], trial, D * sizeof(double));
+        if (force <= cost[i + n]) {
+          memcpy(pop_2[i + n], trial[n], D * sizeof(double));
 
-        cost[i] = force;
+          cost[i + n] = force;
 
-        if (force > max_cost)
-          max_cost = force;
-      } else {
-        memcpy(pop_2[i], pop_1[i], D * sizeof(double));
+          if (force > max_cost)
+            max_cost = force;
+        } else {
+          memcpy(pop_2[i + n], pop_1[i + n], D * sizeof(double));
 
-        if (cost[i] > max_cost)
-          max_cost = cost[i];
+          if (cost[i + n] > max_cost)
+            max_cost = cost[i + n];
+        }
       }
     }
 
@@ -501,8 +666,45 @@ void run_differential_evolution(double* xi)
     }
 
     crit = max_cost - min_cost;
+
+    /* resample the mini-batch periodically to correct the drift of the
+       estimates and switch to full evaluations close to convergence;
+       the population costs are only comparable when computed on the
+       same subset, so they are redone whenever it changes */
+    if (g_force_batch.active &&
+        (count % MINIBATCH_PERIOD == 0 ||
+         crit < MINIBATCH_FULL_CRIT * g_param.evo_threshold)) {
+      if (crit < MINIBATCH_FULL_CRIT * g_param.evo_threshold)
+        force_batch_clear();
+      else
+        force_batch_select(g_param.eval_batch);
+
+      min_cost = 10e10;
+      max_cost = 0.0;
+
+      for (int i = 0; i < NP; i++) {
+        cost[i] = calc_forces(pop_1[i], forces, 0);
+
+        if (cost[i] < min_cost) {
+          min_cost = cost[i];
+          memcpy(best, pop_1[i], D * sizeof(double));
+        }
+        if (cost[i] > max_cost)
+          max_cost = cost[i];
+      }
+
+      crit = max_cost - min_cost;
+    }
   }
 
+  /* the flagfile break can leave a subset selected */
+  force_batch_clear();
+
+  /* powell polishes in full precision */
+  eval_float_set(0);
+
+  gather_forces_sum_only(0);
+
   printf("Finished differential evolution.\n");
   fflush(stdout);
 
@@ -27,6 +27,10 @@
  *
  ****************************************************************/
 
+#if defined(OPENMP)
+#include <omp.h>
+#endif  // OPENMP
+
 #include "potfit.h"
 
 #include "memory.h"
@@ -38,6 +42,102 @@ double write_energy_errors(double* force);
 double write_stress_errors(double* force);
 void write_eam_punishments(double* force);
 
+// growing buffer for formatted report lines
+//
+// The final report used to issue one fprintf call per force component,
+// which stalls the end of the run on large datasets. The lines are now
+// formatted into memory - by several threads for the force listing -
+// and handed to stdio in one block per buffer.
+
+typedef struct {
+  char* data;
+  size_t used;
+  size_t size;
+} error_buffer_t;
+
+static void error_buffer_printf(error_buffer_t* buffer, const char* format,
+                                ...)
+{
+  va_list ap;
+
+  for (;;) {
+    size_t space = buffer->size - buffer->used;
+
+    char* dest = (buffer->data == NULL) ? NULL : buffer->data + buffer->used;
+
+    va_start(ap, format);
+    int n = vsnprintf(dest, space, format, ap);
+    va_end(ap);
+
+    if (n < 0)
+      error(1, "Error formatting the error report\n");
+
+    if ((size_t)n < space) {
+      buffer->used += n;
+      return;
+    }
+
+    // plain realloc on purpose: this runs inside OpenMP regions where
+    // the registered Malloc/Realloc pair must not be used concurrently
+    if (buffer->size == 0)
+      buffer->size = 65536;
+    while (buffer->size - buffer->used <= (size_t)n)
+      buffer->size *= 2;
+    buffer->data = (char*)realloc(buffer->data, buffer->size);
+
+    if (buffer->data == NULL)
+      error(1, "Error allocating resources\n");
+  }
+}
+
+static void error_buffer_flush(error_buffer_t* buffer, FILE* outfile)
+{
+  if (buffer->used > 0)
+    fwrite(buffer->data, 1, buffer->used, outfile);
+
+  free(buffer->data);
+  memset(buffer, 0, sizeof(error_buffer_t));
+}
+
+/****************************************************************
+  dataset_error_sums
+    weighted force, energy and stress error sums restricted to the
+    configurations of one dataset file
+****************************************************************/
+
+static void dataset_error_sums(double* force, int n, double* sums)
+{
+  const int first = g_config.dataset_start[n];
+  const int last = g_config.dataset_start[n + 1];
+
+  const int atom_first = g_config.cnfstart[first];
+  const int atom_last =
+      (last < g_config.nconf) ? g_config.cnfstart[last] : g_config.natoms;
+
+  sums[0] = 0.0;
+  sums[1] = 0.0;
+  sums[2] = 0.0;
+
+  for (int i = 3 * atom_first; i < 3 * atom_last; i++) {
+#if defined(CONTRIB)
+    if (g_config.atoms[i / 3].contrib == 0)
+      continue;
+#endif  // CONTRIB
+    sums[0] +=
+        g_config.conf_weight[g_config.atoms[i / 3].conf] * dsquare(force[i]);
+  }
+
+  for (int i = first; i < last; i++)
+    sums[1] += g_config.conf_weight[i] * g_param.eweight *
+               dsquare(force[g_calc.energy_p + i]);
+
+#if defined(STRESS)
+  for (int i = 6 * first; i < 6 * last; i++)
+    sums[2] += g_config.conf_weight[i / 6] * g_param.sweight *
+               dsquare(force[g_calc.stress_p + i]);
+#endif  // STRESS
+}
+
 /****************************************************************
   write_errors
 ****************************************************************/
@@ -153,6 +253,27 @@ void write_errors(double* force, double tot)
       fprintf(outfile, "sum of stress-errors = %e\t\t( %.3f%% )\n", s_sum,
               s_sum / tot * 100);
 #endif  // STRESS
+    if (g_config.num_datasets > 1) {
+      fprintf(outfile, "error sums per dataset:\n");
+      for (int n = 0; n < g_config.num_datasets; n++) {
+        double sums[3];
+        dataset_error_sums(force, n, sums);
+#if !defined(STRESS)
+        fprintf(outfile,
+                "  %s (weight %g, configs %d-%d): %e (forces %e, energies %e)\n",
+                g_files.config_files[n], g_files.config_weights[n],
+                g_config.dataset_start[n], g_config.dataset_start[n + 1] - 1,
+                sums[0] + sums[1], sums[0], sums[1]);
+#else
+        fprintf(outfile,
+                "  %s (weight %g, configs %d-%d): %e (forces %e, energies %e, "
+                "stresses %e)\n",
+                g_files.config_files[n], g_files.config_weights[n],
+                g_config.dataset_start[n], g_config.dataset_start[n + 1] - 1,
+                sums[0] + sums[1] + sums[2], sums[0], sums[1], sums[2]);
+#endif  // !STRESS
+      }
+    }
     if ((tot - f_sum - e_sum - s_sum) > 0.01 && g_param.opt == 1) {
       fprintf(outfile,
               "\n --> Warning <--\nThis sum contains punishments! Please check "
@@ -189,6 +310,26 @@ void write_errors(double* force, double tot)
            s_sum / tot * 100);
 #endif  // STRESS
 
+  if (g_config.num_datasets > 1) {
+    printf("error sums per dataset:\n");
+    for (int n = 0; n < g_config.num_datasets; n++) {
+      double sums[3];
+      dataset_error_sums(force, n, sums);
+#if !defined(STRESS)
+      printf("  %s (weight %g, configs %d-%d): %e (forces %e, energies %e)\n",
+             g_files.config_files[n], g_files.config_weights[n],
+             g_config.dataset_start[n], g_config.dataset_start[n + 1] - 1,
+             sums[0] + sums[1], sums[0], sums[1]);
+#else
+      printf("  %s (weight %g, configs %d-%d): %e (forces %e, energies %e, "
+             "stresses %e)\n",
+             g_files.config_files[n], g_files.config_weights[n],
+             g_config.dataset_start[n], g_config.dataset_start[n + 1] - 1,
+             sums[0] + sums[1] + sums[2], sums[0], sums[1], sums[2]);
+#endif  // !STRESS
+    }
+  }
+
   if ((tot - f_sum - e_sum - s_sum) > 0.01 && g_param.opt == 1) {
     printf(
         "\n --> Warning <--\nThis sum contains punishments! Check your "
@@ -241,11 +382,12 @@ void write_local_electron_density()
 #endif  // !MEAM
 
   for (int i = 0; i < g_config.natoms; i++) {
+    int atom_idx = g_config.atom_orig_idx ? g_config.atom_orig_idx[i] : i;
 #if !defined(MEAM)
-    fprintf(outfile, "%d\t%d\t%f\n", i, g_config.atoms[i].type,
+    fprintf(outfile, "%d\t%d\t%f\n", atom_idx, g_config.atoms[i].type,
             g_config.atoms[i].rho);
 #else
-    fprintf(outfile, "%d\t%d\t%f\t%f\t%f\n", i, g_config.atoms[i].type,
+    fprintf(outfile, "%d\t%d\t%f\t%f\t%f\n", atom_idx, g_config.atoms[i].type,
             g_config.atoms[i].rho, g_config.atoms[i].rho_eam,
             g_config.atoms[i].rho - g_config.atoms[i].rho_eam);
 #endif  // !MEAM
@@ -268,6 +410,61 @@ void write_local_electron_density()
 #endif  // !MPI && !(EAM || ADP || MEAM)
 }
 
+/****************************************************************
+  write_force_lines
+    format the per-component force deviations with indices
+    [first, last) - each line only depends on its own index, so
+    disjoint ranges can be formatted concurrently
+****************************************************************/
+
+static void write_force_lines(error_buffer_t* buffer, double* force, int first,
+                              int last)
+{
+  const char component[3] = {'x', 'y', 'z'};
+  double sqr = 0.0;
+
+  for (int i = first; i < last; i++) {
+    // with Morton-ordered atoms report the position from the
+    // configuration file
+    int atom_idx =
+        g_config.atom_orig_idx ? g_config.atom_orig_idx[i / 3] : i / 3;
+#if defined(CONTRIB)
+    if (g_config.atoms[i / 3].contrib == 0)
+      sqr = 0.0;
+    else
+#endif  // CONTRIB
+      sqr =
+          g_config.conf_weight[g_config.atoms[i / 3].conf] * dsquare(force[i]);
+#if defined(FWEIGHT)
+    if (i > 2 && i % 3 == 0 &&
+        g_config.atoms[i / 3].conf != g_config.atoms[i / 3 - 1].conf)
+      error_buffer_printf(buffer, "\n\n");
+    if (i == 0)
+      error_buffer_printf(buffer,
+                          "#conf:atom\ttype\tdf^2\t\tf\t\tf0\t\tdf/f0\t\t|f|\n");
+    error_buffer_printf(buffer, "%3d:%6d:%c\t%4s\t%e\t%e\t%e\t%e\t%e\n",
+            g_config.atoms[i / 3].conf, atom_idx, component[i % 3],
+            g_config.elements[g_config.atoms[i / 3].type], sqr,
+            force[i] * (FORCE_EPS + g_config.atoms[i / 3].absforce) +
+                g_config.force_0[i],
+            g_config.force_0[i], force[i] / g_config.force_0[i],
+            g_config.atoms[i / 3].absforce);
+#else
+    if (i > 2 && i % 3 == 0 &&
+        g_config.atoms[i / 3].conf != g_config.atoms[i / 3 - 1].conf)
+      error_buffer_printf(buffer, "\n\n");
+    if (i == 0)
+      error_buffer_printf(buffer,
+                          "#conf:atom\ttype\tdf^2\t\tf\t\tf0\t\tdf/f0\n");
+    error_buffer_printf(buffer, "%3d:%6d:%c\t%4s\t%e\t%e\t%e\t%e\n",
+            g_config.atoms[i / 3].conf, atom_idx, component[i % 3],
+            g_config.elements[g_config.atoms[i / 3].type], sqr,
+            force[i] + g_config.force_0[i], g_config.force_0[i],
+            force[i] / g_config.force_0[i]);
+#endif  // FWEIGHT
+  }
+}
+
 /****************************************************************
   write_force_errors
 ****************************************************************/
@@ -276,7 +473,6 @@ double write_force_errors(double* force)
 {
   char file[255];
   FILE* outfile = NULL;
-  char component[3];
   double force_error = 0.0;
   double sqr = 0.0;
 
@@ -292,11 +488,11 @@ double write_force_errors(double* force)
     printf("Forces:\n");
   }
 
-  component[0] = 'x';
-  component[1] = 'y';
-  component[2] = 'z';
+  const int num_lines = 3 * g_config.natoms;
 
-  for (int i = 0; i < 3 * g_config.natoms; i++) {
+  // the error sum keeps its original accumulation order, only the
+  // expensive formatting of the listing is done in parallel
+  for (int i = 0; i < num_lines; i++) {
 #if defined(CONTRIB)
     if (g_config.atoms[i / 3].contrib == 0)
       sqr = 0.0;
@@ -305,32 +501,41 @@ double write_force_errors(double* force)
       sqr =
           g_config.conf_weight[g_config.atoms[i / 3].conf] * dsquare(force[i]);
     force_error += sqr;
-#if defined(FWEIGHT)
-    if (i > 2 && i % 3 == 0 &&
-        g_config.atoms[i / 3].conf != g_config.atoms[i / 3 - 1].conf)
-      fprintf(outfile, "\n\n");
-    if (i == 0)
-      fprintf(outfile, "#conf:atom\ttype\tdf^2\t\tf\t\tf0\t\tdf/f0\t\t|f|\n");
-    fprintf(outfile, "%3d:%6d:%c\t%4s\t%e\t%e\t%e\t%e\t%e\n",
-            g_config.atoms[i / 3].conf, i / 3, component[i % 3],
-            g_config.elements[g_config.atoms[i / 3].type], sqr,
-            force[i] * (FORCE_EPS + g_config.atoms[i / 3].absforce) +
-                g_config.force_0[i],
-            g_config.force_0[i], force[i] / g_config.force_0[i],
-            g_config.atoms[i / 3].absforce);
+  }
+
+#if defined(OPENMP)
+  {
+    const int num_threads = omp_get_max_threads();
+    error_buffer_t* buffers =
+        (error_buffer_t*)calloc(num_threads, sizeof(error_buffer_t));
+
+    if (buffers == NULL)
+      error(1, "Error allocating resources\n");
+
+#pragma omp parallel num_threads(num_threads)
+    {
+      const int id = omp_get_thread_num();
+      const int first = (int)((long)num_lines * id / num_threads);
+      const int last = (int)((long)num_lines * (id + 1) / num_threads);
+
+      write_force_lines(&buffers[id], force, first, last);
+    }
+
+    // concatenating the blocks in thread order restores the exact
+    // serial listing
+    for (int t = 0; t < num_threads; t++)
+      error_buffer_flush(&buffers[t], outfile);
+
+    free(buffers);
+  }
 #else
-    if (i > 2 && i % 3 == 0 &&
-        g_config.atoms[i / 3].conf != g_config.atoms[i / 3 - 1].conf)
-      fprintf(outfile, "\n\n");
-    if (i == 0)
-      fprintf(outfile, "#conf:atom\ttype\tdf^2\t\tf\t\tf0\t\tdf/f0\n");
-    fprintf(outfile, "%3d:%6d:%c\t%4s\t%e\t%e\t%e\t%e\n",
-            g_config.atoms[i / 3].conf, i / 3, component[i % 3],
-            g_config.elements[g_config.atoms[i / 3].type], sqr,
-            force[i] + g_config.force_0[i], g_config.force_0[i],
-            force[i] / g_config.force_0[i]);
-#endif  // FWEIGHT
+  {
+    error_buffer_t buffer = {NULL, 0, 0};
+
+    write_force_lines(&buffer, force, 0, num_lines);
+    error_buffer_flush(&buffer, outfile);
   }
+#endif  // OPENMP
 
   if (g_param.write_output_files) {
     printf("Force data written to \t\t\t%s\n", file);
@@ -377,21 +582,23 @@ double write_energy_errors(double* force)
     fprintf(outfile, "conf\tconf_w\t(w*de)^2\te\t\te0\t\tde/e0\n");
   }
 
+  error_buffer_t buffer = {NULL, 0, 0};
+
   for (int i = 0; i < g_config.nconf; i++) {
     sqr = g_config.conf_weight[i] * g_param.eweight *
           dsquare(force[g_calc.energy_p + i]);
     energy_error += sqr;
     if (g_param.write_output_files) {
-      fprintf(
-          outfile, "%3d\t%6.2f\t%10.6f\t%13.10f\t%13.10f\t%f\t%f\t%f\n", i,
+      error_buffer_printf(
+          &buffer, "%3d\t%6.2f\t%10.6f\t%13.10f\t%13.10f\t%f\t%f\t%f\n", i,
           g_config.conf_weight[i], sqr / g_config.conf_weight[i],
           force[g_calc.energy_p + i] + g_config.force_0[g_calc.energy_p + i],
           g_config.force_0[g_calc.energy_p + i],
           fabs(force[g_calc.energy_p + i]), force[g_calc.energy_p + i],
           force[g_calc.energy_p + i] / g_config.force_0[g_calc.energy_p + i]);
     } else {
-      fprintf(
-          outfile, "%d\t%.4f\t%f\t%f\t%f\t%f\n", i, g_config.conf_weight[i],
+      error_buffer_printf(
+          &buffer, "%d\t%.4f\t%f\t%f\t%f\t%f\n", i, g_config.conf_weight[i],
           sqr,
           force[g_calc.energy_p + i] + g_config.force_0[g_calc.energy_p + i],
           g_config.force_0[g_calc.energy_p + i],
@@ -399,6 +606,8 @@ double write_energy_errors(double* force)
     }
   }
 
+  error_buffer_flush(&buffer, outfile);
+
   if (g_param.write_output_files) {
     printf("Energy data written to \t\t\t%s\n", file);
     fclose(outfile);
@@ -451,16 +660,20 @@ double write_stress_errors(double* force)
 
   fprintf(outfile, "#\tconf_w\tw*ds^2\t\ts\t\ts0\t\tds/s0\n");
 
+  error_buffer_t buffer = {NULL, 0, 0};
+
   for (int i = 0; i < 6 * g_config.nconf; i++) {
     int p = i + g_calc.stress_p;
     sqr = g_config.conf_weight[i / 6] * g_param.sweight * dsquare(force[p]);
     stress_error += sqr;
-    fprintf(outfile, "%3d-%s\t%6.2f\t%14.8f\t%12.10f\t%12.10f\t%14.8f\n", i / 6,
-            component[i % 6], g_config.conf_weight[i / 6], sqr,
+    error_buffer_printf(&buffer, "%3d-%s\t%6.2f\t%14.8f\t%12.10f\t%12.10f\t%14.8f\n",
+            i / 6, component[i % 6], g_config.conf_weight[i / 6], sqr,
             force[p] + g_config.force_0[p], g_config.force_0[p],
             force[p] / g_config.force_0[p]);
   }
 
+  error_buffer_flush(&buffer, outfile);
+
   if (g_param.write_output_files) {
     printf("Stress data written to \t\t\t%s\n", file);
     fclose(outfile);
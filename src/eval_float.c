@@ -0,0 +1,294 @@
+/****************************************************************
+ *
+ * eval_float.c: single-precision force evaluations for the global search
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <float.h>
+
+#include "potfit.h"
+
+#include "eval_float.h"
+#include "force_cache.h"
+#include "memory.h"
+#include "utils.h"
+
+eval_float_t g_eval_float;
+
+/* the single-precision kernel is only wired into the pair force routine
+   and accumulates whole configurations locally */
+
+#if defined(PAIR) && !defined(COULOMB) && !defined(MPI) && !defined(KIM)
+#define EVAL_FLOAT_AVAILABLE
+#endif
+
+/****************************************************************
+ *
+ *  init_eval_float
+ *      mirror the static packed neighbor data as floats if
+ *      single-precision evaluations are requested
+ *
+ ****************************************************************/
+
+void init_eval_float(void)
+{
+#if defined(EVAL_FLOAT_AVAILABLE)
+  if (!g_param.eval_float)
+    return;
+
+  const neigh_soa_t* soa = &g_config.neigh_soa;
+  int num = soa->num_entries;
+  int len = g_pot.calc_pot.len;
+
+  g_eval_float.xi = (float*)Malloc(len * sizeof(float));
+  g_eval_float.d2tab = (float*)Malloc(len * sizeof(float));
+  g_eval_float.shift = (float*)Malloc(num * sizeof(float));
+  g_eval_float.step = (float*)Malloc(num * sizeof(float));
+  g_eval_float.r = (float*)Malloc(num * sizeof(float));
+  g_eval_float.dist_r_x = (float*)Malloc(num * sizeof(float));
+  g_eval_float.dist_r_y = (float*)Malloc(num * sizeof(float));
+  g_eval_float.dist_r_z = (float*)Malloc(num * sizeof(float));
+#if defined(STRESS)
+  g_eval_float.dist_x = (float*)Malloc(num * sizeof(float));
+  g_eval_float.dist_y = (float*)Malloc(num * sizeof(float));
+  g_eval_float.dist_z = (float*)Malloc(num * sizeof(float));
+#endif  // STRESS
+  g_eval_float.end = (float*)Malloc(g_pot.calc_pot.ncols * sizeof(float));
+
+  for (int i = 0; i < num; i++) {
+    g_eval_float.shift[i] = (float)soa->shift[0][i];
+    g_eval_float.step[i] = (float)soa->step[0][i];
+    /* the spline positions are only valid inside the cutoff; push the
+       entries beyond it out of reach so rounding the distance to float
+       can never pull one back in */
+    if (soa->r[i] < g_pot.calc_pot.end[soa->col[0][i]])
+      g_eval_float.r[i] = (float)soa->r[i];
+    else
+      g_eval_float.r[i] = FLT_MAX;
+    g_eval_float.dist_r_x[i] = (float)soa->dist_r_x[i];
+    g_eval_float.dist_r_y[i] = (float)soa->dist_r_y[i];
+    g_eval_float.dist_r_z[i] = (float)soa->dist_r_z[i];
+#if defined(STRESS)
+    g_eval_float.dist_x[i] = (float)soa->dist_x[i];
+    g_eval_float.dist_y[i] = (float)soa->dist_y[i];
+    g_eval_float.dist_z[i] = (float)soa->dist_z[i];
+#endif  // STRESS
+  }
+
+  for (int i = 0; i < g_pot.calc_pot.ncols; i++)
+    g_eval_float.end[i] = (float)g_pot.calc_pot.end[i];
+
+  g_eval_float.enabled = 1;
+#else
+  if (g_param.eval_float)
+    warning(
+        "Mixed precision is only available for serial pair binaries, "
+        "eval_float is ignored!\n");
+#endif  // EVAL_FLOAT_AVAILABLE
+}
+
+/****************************************************************
+ *
+ *  eval_float_set
+ *      switch the force kernel between single and double precision;
+ *      the optimizers call this at their phase boundaries
+ *
+ ****************************************************************/
+
+void eval_float_set(int active)
+{
+  if (!g_eval_float.enabled || g_eval_float.active == (active != 0))
+    return;
+
+  g_eval_float.active = (active != 0);
+
+  /* cached contributions of the other precision are not comparable */
+  g_force_cache.active = 0;
+}
+
+/****************************************************************
+ *
+ *  eval_float_prepare
+ *      refresh the float mirrors of the spline tables, called once
+ *      per evaluation after the second derivatives are updated
+ *
+ ****************************************************************/
+
+void eval_float_prepare(const double* xi)
+{
+  if (!g_eval_float.active)
+    return;
+
+  for (int i = 0; i < g_pot.calc_pot.len; i++) {
+    g_eval_float.xi[i] = (float)xi[i];
+    g_eval_float.d2tab[i] = (float)g_pot.calc_pot.d2tab[i];
+  }
+}
+
+#if defined(EVAL_FLOAT_AVAILABLE)
+
+/****************************************************************
+ *
+ *  splint_float_batch
+ *      single-precision version of splint_comb_dir_batch; plain
+ *      loops, the compiler vectorizes them at twice the width of
+ *      the double kernels
+ *
+ ****************************************************************/
+
+static void splint_float_batch(int n, const int* slot, const float* shift,
+                               const float* step, int do_grad, float* val,
+                               float* grad)
+{
+  const float* xi = g_eval_float.xi;
+  const float* d2 = g_eval_float.d2tab;
+
+  for (int i = 0; i < n; i++) {
+    int k = slot[i];
+    float b = shift[i];
+    float a = 1.0f - b;
+    float st = step[i];
+    float p1 = xi[k];
+    float p2 = xi[k + 1];
+    float d21 = d2[k];
+    float d22 = d2[k + 1];
+
+    val[i] = a * p1 + b * p2 +
+             ((a * a * a - a) * d21 + (b * b * b - b) * d22) * (st * st) / 6.0f;
+    if (do_grad)
+      grad[i] = (p2 - p1) / st +
+                ((3.0f * (b * b) - 1.0f) * d22 - (3.0f * (a * a) - 1.0f) * d21) *
+                    st / 6.0f;
+  }
+}
+
+#endif  // EVAL_FLOAT_AVAILABLE
+
+/****************************************************************
+ *
+ *  eval_float_pair_config
+ *      single-precision replacement for the force and energy loops
+ *      of one configuration in the pair kernel; the results are
+ *      converted back into the regular force vector, the weighting
+ *      and error summing stay in double precision
+ *
+ ****************************************************************/
+
+void eval_float_pair_config(int config_idx, int uf, int us, double* forces)
+{
+#if defined(EVAL_FLOAT_AVAILABLE)
+  const neigh_soa_t* soa = &g_config.neigh_soa;
+  const int cnfstart = g_config.cnfstart[config_idx];
+  const int inconf = g_config.inconf[config_idx];
+
+  float f[3 * inconf];
+  float energy = 0.0f;
+#if defined(STRESS)
+  float stress[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+#endif  // STRESS
+
+  // first loop: reset forces
+  if (uf) {
+    for (int k = 0; k < 3 * inconf; k++)
+      f[k] = -(float)g_config.force_0[3 * cnfstart + k];
+  } else {
+    memset(f, 0, 3 * inconf * sizeof(float));
+  }
+
+  // second loop: calculate pair forces and energies
+  for (int atom_idx = 0; atom_idx < inconf; atom_idx++) {
+    int first_n = soa->first[atom_idx + cnfstart];
+    int num_n = soa->first[atom_idx + cnfstart + 1] - first_n;
+
+    float phi_val[max(num_n, 1)];
+    float phi_grad[max(num_n, 1)];
+    splint_float_batch(num_n, soa->slot[0] + first_n,
+                       g_eval_float.shift + first_n,
+                       g_eval_float.step + first_n, uf, phi_val, phi_grad);
+
+    // loop over all neighbors
+    for (int n = first_n; n < first_n + num_n; n++) {
+      // In small cells, an atom might interact with itself
+      int self = (soa->nr[n] == atom_idx + cnfstart) ? 1 : 0;
+
+      // pair potential part
+      if (g_eval_float.r[n] < g_eval_float.end[soa->col[0][n]]) {
+        float val = phi_val[n - first_n];
+        float grad = uf ? phi_grad[n - first_n] : 0.0f;
+
+        // avoid double counting if atom is interacting with itself
+        if (self) {
+          val *= 0.5f;
+          grad *= 0.5f;
+        }
+
+        // add cohesive energy
+        energy += val;
+
+        // calculate forces
+        if (uf) {
+          float fx = g_eval_float.dist_r_x[n] * grad;
+          float fy = g_eval_float.dist_r_y[n] * grad;
+          float fz = g_eval_float.dist_r_z[n] * grad;
+          f[3 * atom_idx + 0] += fx;
+          f[3 * atom_idx + 1] += fy;
+          f[3 * atom_idx + 2] += fz;
+          // actio = reactio
+          int n_j = 3 * (soa->nr[n] - cnfstart);
+          f[n_j + 0] -= fx;
+          f[n_j + 1] -= fy;
+          f[n_j + 2] -= fz;
+#if defined(STRESS)
+          /* also calculate pair stresses */
+          if (us) {
+            stress[0] -= g_eval_float.dist_x[n] * fx;
+            stress[1] -= g_eval_float.dist_y[n] * fy;
+            stress[2] -= g_eval_float.dist_z[n] * fz;
+            stress[3] -= g_eval_float.dist_x[n] * fy;
+            stress[4] -= g_eval_float.dist_y[n] * fz;
+            stress[5] -= g_eval_float.dist_z[n] * fx;
+          }
+#endif  // STRESS
+        }
+      } // neighbors in range
+    }   // loop over all neighbors
+  } // second loop over atoms
+
+  // hand the results back to the regular force vector
+  for (int k = 0; k < 3 * inconf; k++)
+    forces[3 * cnfstart + k] = (double)f[k];
+
+  forces[g_calc.energy_p + config_idx] += (double)energy;
+
+#if defined(STRESS)
+  if (uf && us) {
+    int stress_idx = g_calc.stress_p + 6 * config_idx;
+    for (int i = 0; i < 6; i++)
+      forces[stress_idx + i] = (double)stress[i];
+  }
+#endif  // STRESS
+#endif  // EVAL_FLOAT_AVAILABLE
+}
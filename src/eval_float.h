@@ -0,0 +1,83 @@
+/****************************************************************
+ *
+ * eval_float.h: single-precision force evaluations for the global search
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef EVAL_FLOAT_H_INCLUDED
+#define EVAL_FLOAT_H_INCLUDED
+
+/****************************************************************
+ *
+ *  The stochastic optimizers only need a few significant digits of
+ *  the error sum to accept or reject a trial. With the eval_float
+ *  parameter set, the global search runs the pair kernel in single
+ *  precision: the spline coefficients derived from the trial
+ *  parameters and the static packed neighbor geometry are mirrored
+ *  as floats and the forces of a configuration are accumulated in a
+ *  float scratch buffer. That halves the memory traffic of the
+ *  bandwidth-bound inner loop and doubles the usable SIMD width.
+ *  The accumulated deviations are converted back to double before
+ *  the weighting, so the error sums of all trials stay comparable.
+ *  The powell and L-BFGS polishing stages always run in full
+ *  precision.
+ *
+ *  Like the force cache this is only wired into the pair force
+ *  routine and needs the complete force vector on a single process.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled; /* eval_float parameter is set and usable */
+  int active;  /* single-precision evaluations are currently selected */
+
+  /* float mirrors of the spline tables, refreshed every evaluation */
+  float* xi;
+  float* d2tab;
+
+  /* float mirrors of the static packed neighbor data */
+  float* shift;
+  float* step;
+  float* r;
+  float* dist_r_x;
+  float* dist_r_y;
+  float* dist_r_z;
+#if defined(STRESS)
+  float* dist_x;
+  float* dist_y;
+  float* dist_z;
+#endif  // STRESS
+  float* end; /* per-column potential cutoffs */
+} eval_float_t;
+
+extern eval_float_t g_eval_float;
+
+void init_eval_float(void);
+void eval_float_set(int active);
+void eval_float_prepare(const double* xi);
+void eval_float_pair_config(int config_idx, int uf, int us, double* forces);
+
+#endif  // EVAL_FLOAT_H_INCLUDED
@@ -0,0 +1,194 @@
+/****************************************************************
+ *
+ * eval_memo.c: memoization of repeated force evaluations
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "eval_float.h"
+#include "eval_memo.h"
+#include "force_abort.h"
+#include "force_batch.h"
+#include "memory.h"
+
+eval_memo_t g_eval_memo;
+
+/* the memo cache is only wired into the pair and EAM force routines
+   and needs the complete force vector on a single process */
+
+#if (defined(PAIR) || defined(EAM)) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM)
+#define EVAL_MEMO_AVAILABLE
+#endif
+
+// number of evaluations kept
+#define EVAL_MEMO_SIZE 16
+
+/****************************************************************
+ *
+ *  init_eval_memo
+ *      allocate the slot storage
+ *
+ ****************************************************************/
+
+void init_eval_memo(void)
+{
+#if defined(EVAL_MEMO_AVAILABLE)
+  if (g_calc.ndimtot == 0 || g_calc.mdim == 0)
+    return;
+
+  g_eval_memo.valid = (char*)Malloc(EVAL_MEMO_SIZE * sizeof(char));
+  g_eval_memo.hash = (uint64_t*)Malloc(EVAL_MEMO_SIZE * sizeof(uint64_t));
+  g_eval_memo.params = (double*)Malloc(EVAL_MEMO_SIZE * g_calc.ndimtot * sizeof(double));
+  g_eval_memo.forces = (double*)Malloc(EVAL_MEMO_SIZE * g_calc.mdim * sizeof(double));
+  g_eval_memo.error_sum = (double*)Malloc(EVAL_MEMO_SIZE * sizeof(double));
+
+  g_eval_memo.enabled = 1;
+#endif  // EVAL_MEMO_AVAILABLE
+}
+
+#if defined(EVAL_MEMO_AVAILABLE)
+
+/****************************************************************
+ *
+ *  eval_memo_hash
+ *      FNV-1a over the bytes of the parameter vector, only used
+ *      to reject mismatching slots quickly - a hit still compares
+ *      the full vector
+ *
+ ****************************************************************/
+
+static uint64_t eval_memo_hash(const double* params)
+{
+  const unsigned char* bytes = (const unsigned char*)params;
+  size_t len = g_calc.ndimtot * sizeof(double);
+  uint64_t hash = 14695981039346656037ull;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+
+  return hash;
+}
+
+/****************************************************************
+ *
+ *  eval_memo_usable
+ *      partial or single-precision estimates of the error sum are
+ *      not comparable with a full evaluation of the same vector
+ *
+ ****************************************************************/
+
+static int eval_memo_usable(void)
+{
+  if (!g_eval_memo.enabled)
+    return 0;
+  if (g_force_batch.active || g_force_abort.active)
+    return 0;
+  if (g_eval_float.active)
+    return 0;
+  return 1;
+}
+
+#endif  // EVAL_MEMO_AVAILABLE
+
+/****************************************************************
+ *
+ *  eval_memo_lookup
+ *      serve an exact repeat of a stored evaluation, returns 1
+ *      and fills the force vector and the error sum on a hit
+ *
+ ****************************************************************/
+
+int eval_memo_lookup(const double* params, double* forces, double* error_sum)
+{
+#if defined(EVAL_MEMO_AVAILABLE)
+  if (!eval_memo_usable())
+    return 0;
+
+  uint64_t hash = eval_memo_hash(params);
+
+  for (int i = 0; i < EVAL_MEMO_SIZE; i++) {
+    if (!g_eval_memo.valid[i] || g_eval_memo.hash[i] != hash)
+      continue;
+    if (memcmp(g_eval_memo.params + i * g_calc.ndimtot, params, g_calc.ndimtot * sizeof(double)) != 0)
+      continue;
+
+    memcpy(forces, g_eval_memo.forces + i * g_calc.mdim, g_calc.mdim * sizeof(double));
+    *error_sum = g_eval_memo.error_sum[i];
+
+    return 1;
+  }
+#endif  // EVAL_MEMO_AVAILABLE
+
+  return 0;
+}
+
+/****************************************************************
+ *
+ *  eval_memo_store
+ *      remember a completed evaluation, evicting round robin
+ *
+ ****************************************************************/
+
+void eval_memo_store(const double* params, const double* forces, double error_sum)
+{
+#if defined(EVAL_MEMO_AVAILABLE)
+  if (!eval_memo_usable())
+    return;
+
+  int slot = g_eval_memo.next;
+
+  g_eval_memo.next = (g_eval_memo.next + 1) % EVAL_MEMO_SIZE;
+
+  g_eval_memo.hash[slot] = eval_memo_hash(params);
+  memcpy(g_eval_memo.params + slot * g_calc.ndimtot, params, g_calc.ndimtot * sizeof(double));
+  memcpy(g_eval_memo.forces + slot * g_calc.mdim, forces, g_calc.mdim * sizeof(double));
+  g_eval_memo.error_sum[slot] = error_sum;
+  g_eval_memo.valid[slot] = 1;
+#endif  // EVAL_MEMO_AVAILABLE
+}
+
+/****************************************************************
+ *
+ *  eval_memo_invalidate
+ *      drop all stored evaluations, the same parameter vector no
+ *      longer describes the same potential (e.g. after regridding
+ *      a tabulated potential)
+ *
+ ****************************************************************/
+
+void eval_memo_invalidate(void)
+{
+#if defined(EVAL_MEMO_AVAILABLE)
+  if (!g_eval_memo.enabled)
+    return;
+
+  memset(g_eval_memo.valid, 0, EVAL_MEMO_SIZE * sizeof(char));
+#endif  // EVAL_MEMO_AVAILABLE
+}
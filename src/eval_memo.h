@@ -0,0 +1,77 @@
+/****************************************************************
+ *
+ * eval_memo.h: memoization of repeated force evaluations
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef EVAL_MEMO_H_INCLUDED
+#define EVAL_MEMO_H_INCLUDED
+
+#include <stdint.h>
+
+/****************************************************************
+ *
+ *  The optimizers re-submit identical parameter vectors surprisingly
+ *  often: powell_lsq re-evaluates the accepted point after a line
+ *  search, simann re-tests the best-so-far vector at restarts and
+ *  the final vector is evaluated again for reporting. A small cache
+ *  of the most recent evaluations serves such exact repeats without
+ *  touching a single configuration. The candidate slot is found via
+ *  a hash of the parameter vector, a repeat is only accepted when
+ *  the stored vector matches bit for bit, and both the error sum
+ *  and the full force vector are restored so the callers see no
+ *  difference to a real evaluation.
+ *
+ *  Estimates from mini-batch, aborted or single-precision
+ *  evaluations are not comparable with a full evaluation of the
+ *  same vector and bypass the cache. Regridding a tabulated
+ *  potential changes the meaning of the stored vectors, so the
+ *  cache is flushed alongside the spline cache.
+ *
+ *  Like the force cache this is only wired into the pair and EAM
+ *  force routines and needs the complete force vector on a single
+ *  process.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled;       /* cache storage has been set up */
+  int next;          /* round robin eviction slot */
+  char* valid;       /* per-slot occupancy flag */
+  uint64_t* hash;    /* per-slot hash of the stored vector */
+  double* params;    /* stored parameter vectors, ndimtot each */
+  double* forces;    /* stored force vectors, mdim each */
+  double* error_sum; /* stored error sums */
+} eval_memo_t;
+
+extern eval_memo_t g_eval_memo;
+
+void init_eval_memo(void);
+int eval_memo_lookup(const double* params, double* forces, double* error_sum);
+void eval_memo_store(const double* params, const double* forces, double error_sum);
+void eval_memo_invalidate(void);
+
+#endif  // EVAL_MEMO_H_INCLUDED
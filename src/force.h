@@ -31,9 +31,6 @@
 #define FORCE_H_INCLUDED
 
 double calc_forces(double* xi_opt, double* forces, int shutdown_flag);
-extern double (*g_splint)(pot_table_t*, double*, int, double);
-extern double (*g_splint_grad)(pot_table_t*, double*, int, double);
-extern double (*g_splint_comb)(pot_table_t*, double*, int, double, double*);
 
 // common force initialization (force_common.cc)
 void init_force_common(int is_worker);
@@ -43,8 +40,10 @@ void init_force(int is_worker);
 void set_force_vector_pointers();
 void gather_variable(double* var);
 void gather_forces(double* error_sum, double* forces);
+void gather_forces_sum_only(int enable);
 
 void update_splines(double* xi, int start_col, int num_col, int grad_flag);
+void invalidate_spline_cache();
 
 #if defined(STIWEB)
 void update_stiweb_pointers(double*);
@@ -0,0 +1,167 @@
+/****************************************************************
+ *
+ * force_abort.c: early abort of trial force evaluations
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "force_abort.h"
+#include "memory.h"
+
+force_abort_t g_force_abort;
+
+/* early aborts are only wired into the pair and EAM force routines,
+   need the complete error sum on a single process and cannot stop the
+   threaded configuration loop */
+
+#if (defined(PAIR) || defined(EAM)) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM) && !defined(OPENMP)
+#define FORCE_ABORT_AVAILABLE
+#endif
+
+/****************************************************************
+ *
+ *  init_force_abort
+ *      enable early aborts if requested
+ *
+ ****************************************************************/
+
+void init_force_abort(void)
+{
+#if defined(FORCE_ABORT_AVAILABLE)
+  if (!g_param.eval_abort || g_config.nconf < 2)
+    return;
+
+  g_force_abort.order = (int*)Malloc(g_config.nconf * sizeof(int));
+  g_force_abort.error_hist = (double*)Malloc(g_config.nconf * sizeof(double));
+
+  for (int i = 0; i < g_config.nconf; i++)
+    g_force_abort.order[i] = i;
+
+  g_force_abort.enabled = 1;
+#endif  // FORCE_ABORT_AVAILABLE
+}
+
+#if defined(FORCE_ABORT_AVAILABLE)
+
+/****************************************************************
+ *
+ *  compare_error_hist
+ *      qsort comparator: configurations with the larger last known
+ *      error contribution come first
+ *
+ ****************************************************************/
+
+static int compare_error_hist(const void* a, const void* b)
+{
+  double err_a = g_force_abort.error_hist[*(const int*)a];
+  double err_b = g_force_abort.error_hist[*(const int*)b];
+
+  if (err_a > err_b)
+    return -1;
+  if (err_a < err_b)
+    return 1;
+
+  return 0;
+}
+
+#endif  // FORCE_ABORT_AVAILABLE
+
+/****************************************************************
+ *
+ *  force_abort_arm
+ *      arm the cutoff for the next evaluation and sort the
+ *      configurations by their last known error contribution
+ *
+ ****************************************************************/
+
+void force_abort_arm(double cutoff)
+{
+#if defined(FORCE_ABORT_AVAILABLE)
+  if (!g_force_abort.enabled)
+    return;
+
+  qsort(g_force_abort.order, g_config.nconf, sizeof(int), compare_error_hist);
+
+  g_force_abort.cutoff = cutoff;
+  g_force_abort.active = 1;
+  g_force_abort.rejected = 0;
+#endif  // FORCE_ABORT_AVAILABLE
+}
+
+/****************************************************************
+ *
+ *  force_abort_disarm
+ *      subsequent evaluations run to completion again
+ *
+ ****************************************************************/
+
+void force_abort_disarm(void)
+{
+  g_force_abort.active = 0;
+  g_force_abort.rejected = 0;
+}
+
+/****************************************************************
+ *
+ *  force_abort_order
+ *      map a loop index to the configuration to process; identity
+ *      unless early aborts are enabled
+ *
+ ****************************************************************/
+
+int force_abort_order(int conf_i)
+{
+  if (!g_force_abort.enabled)
+    return conf_i;
+
+  return g_force_abort.order[conf_i];
+}
+
+/****************************************************************
+ *
+ *  force_abort_check
+ *      record the error contribution of a processed configuration
+ *      and test the running sum against an armed cutoff; returns 1
+ *      if the evaluation should be aborted
+ *
+ ****************************************************************/
+
+int force_abort_check(int config_idx, double error_part, double error_sum)
+{
+  if (!g_force_abort.enabled)
+    return 0;
+
+  g_force_abort.error_hist[config_idx] = error_part;
+
+  if (g_force_abort.active && error_sum > g_force_abort.cutoff) {
+    g_force_abort.rejected = 1;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,70 @@
+/****************************************************************
+ *
+ * force_abort.h: early abort of trial force evaluations header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef FORCE_ABORT_H_INCLUDED
+#define FORCE_ABORT_H_INCLUDED
+
+/****************************************************************
+ *
+ *  Simulated annealing only needs to know whether a trial beats a
+ *  threshold: a trial is accepted if F_new < F - T * ln(u) with u
+ *  drawn uniformly. Since the error sum grows monotonically while
+ *  the configurations are processed, the evaluation can stop as
+ *  soon as the partial sum crosses that threshold - the trial is
+ *  rejected no matter what the remaining configurations contribute.
+ *  With the eval_abort parameter set, simann draws u up front, arms
+ *  the cutoff and treats an aborted evaluation as a rejection.
+ *
+ *  To fail as fast as possible the configurations are visited in
+ *  order of their last known error contribution, largest first.
+ *
+ *  Like the force cache this is only available for serial runs; it
+ *  also conflicts with the threaded configuration loop, which cannot
+ *  stop early.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled;        /* eval_abort parameter is set and usable */
+  int active;         /* a cutoff is armed for the current evaluation */
+  int rejected;       /* the last armed evaluation was aborted */
+  double cutoff;      /* abort once the partial error sum exceeds this */
+  int* order;         /* configuration traversal order, worst first */
+  double* error_hist; /* last known error contribution per configuration */
+} force_abort_t;
+
+extern force_abort_t g_force_abort;
+
+void init_force_abort(void);
+void force_abort_arm(double cutoff);
+void force_abort_disarm(void);
+int force_abort_order(int conf_i);
+int force_abort_check(int config_idx, double error_part, double error_sum);
+
+#endif  // FORCE_ABORT_H_INCLUDED
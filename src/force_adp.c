@@ -41,6 +41,7 @@
 #endif
 #include "potential_input.h"
 #include "potential_output.h"
+#include "rescale.h"
 #include "splines.h"
 #include "utils.h"
 
@@ -149,18 +150,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // APOT && !MPI
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else
     // if flag==2 then the potential parameters have changed -> sync
@@ -188,10 +189,16 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     update_splines(xi, g_calc.paircol + 2 * g_param.ntypes, 2 * g_calc.paircol, 1);
 
     // loop over configurations
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial sums reduced at the end
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum, rho_sum)
+#endif  // OPENMP
     for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
 #endif  // STRESS
       // reset energies and stresses
       forces[g_calc.energy_p + config_idx] = 0.0;
@@ -203,6 +210,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       // set limiting constraints
       forces[g_calc.limit_p + config_idx] = -g_config.force_0[g_calc.limit_p + config_idx];
 
+#if defined(RESCALE) && !defined(MPI)
+      // fresh rho bounds for this configuration
+      rescale_track_start(config_idx);
+#endif  // RESCALE && !MPI
+
       /* first loop over atoms: reset forces, densities */
       for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
         int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
@@ -227,10 +239,37 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         atom->lambda.zx = 0.0;
       }
 
+      // packed neighbor data for the batched spline lookups
+      const neigh_soa_t* soa = &g_config.neigh_soa;
+
       // second loop: calculate pair forces, energies and atomic densities
       for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
         atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
+        int atom_local = atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
         int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+        int first_n = soa->first[atom_local];
+        int num_n = soa->first[atom_local + 1] - first_n;
+
+        // evaluate pair potential, transfer, dipole and quadrupole function
+        // for the whole neighbor list at once, fusing two columns per pass;
+        // entries beyond the respective cutoffs are discarded below
+        // the transfer gradient is kept for the force pass, which no longer
+        // has to walk the table again
+        double phi_tab[max(num_n, 1)];
+        double phi_grad_tab[max(num_n, 1)];
+        double rho_tab[max(num_n, 1)];
+        double u_tab[max(num_n, 1)];
+        double u_grad_tab[max(num_n, 1)];
+        double w_tab[max(num_n, 1)];
+        double w_grad_tab[max(num_n, 1)];
+        if (uf) {
+          splint_comb_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_tab, phi_grad_tab, soa->slot[1] + first_n, soa->shift[1] + first_n, soa->step[1] + first_n, rho_tab, soa->rho_grad + first_n);
+          splint_comb_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[2] + first_n, soa->shift[2] + first_n, soa->step[2] + first_n, u_tab, u_grad_tab, soa->slot[3] + first_n, soa->shift[3] + first_n, soa->step[3] + first_n, w_tab, w_grad_tab);
+        } else {
+          splint_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_tab, soa->slot[1] + first_n, soa->shift[1] + first_n, soa->step[1] + first_n, rho_tab);
+          splint_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[2] + first_n, soa->shift[2] + first_n, soa->step[2] + first_n, u_tab, soa->slot[3] + first_n, soa->shift[3] + first_n, soa->step[3] + first_n, w_tab);
+        }
+
         // loop over all neighbors
         for (int neigh_idx = 0; neigh_idx < atom->num_neigh; neigh_idx++) {
           neigh_t* neigh = atom->neigh + neigh_idx;
@@ -239,13 +278,8 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 
           // pair potential part
           if (neigh->r < g_pot.calc_pot.end[neigh->col[0]]) {
-            double phi_val = 0.0;
-            double phi_grad = 0.0;
-            // potential value and gradient are calculated in the same step
-            if (uf)
-              phi_val = splint_comb_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0], &phi_grad);
-            else
-              phi_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0]);
+            double phi_val = phi_tab[neigh_idx];
+            double phi_grad = uf ? phi_grad_tab[neigh_idx] : 0.0;
 
             // avoid double counting if atom is interacting with itself
             if (self) {
@@ -285,11 +319,8 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 
           // dipole distortion part
           if (neigh->r < g_pot.calc_pot.end[neigh->col[2]]) {
-            // potential value and grad are calculated in the same step
-            if (uf)
-              neigh->u_val = splint_comb_dir(&g_pot.calc_pot, xi, neigh->slot[2], neigh->shift[2], neigh->step[2], &neigh->u_grad);
-            else
-              neigh->u_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[2], neigh->shift[2], neigh->step[2]);
+            neigh->u_val = u_tab[neigh_idx];
+            neigh->u_grad = uf ? u_grad_tab[neigh_idx] : 0.0;
 
             // avoid double counting if atom is interacting with itself
             if (self) {
@@ -311,11 +342,8 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 
           // quadrupole distortion part
           if (neigh->r < g_pot.calc_pot.end[neigh->col[3]]) {
-            // potential value and grad are calculated in the same step
-            if (uf)
-              neigh->w_val = splint_comb_dir(&g_pot.calc_pot, xi, neigh->slot[3], neigh->shift[3], neigh->step[3], &neigh->w_grad);
-            else
-              neigh->w_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[3], neigh->shift[3], neigh->step[3]);
+            neigh->w_val = w_tab[neigh_idx];
+            neigh->w_grad = uf ? w_grad_tab[neigh_idx] : 0.0;
 
             // avoid double counting if atom is interacting with itself
             if (self) {
@@ -350,7 +378,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           if (atom->type == neigh->type) {
             // then transfer(a->b)==transfer(b->a)
             if (neigh->r < g_pot.calc_pot.end[neigh->col[1]]) {
-              double rho_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[1], neigh->shift[1], neigh->step[1]);
+              double rho_val = rho_tab[neigh_idx];
               atom->rho += rho_val;
               // avoid double counting if atom is interacting with itself
               if (!self)
@@ -359,17 +387,22 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           } else {
             // transfer(a->b)!=transfer(b->a)
             if (neigh->r < g_pot.calc_pot.end[neigh->col[1]]) {
-              atom->rho += splint_dir(&g_pot.calc_pot, xi, neigh->slot[1], neigh->shift[1], neigh->step[1]);
+              atom->rho += rho_tab[neigh_idx];
             }
             // cannot use slot/shift to access splines
             if (neigh->r < g_pot.calc_pot.end[g_calc.paircol + atom->type])
-              g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho += (*g_splint)(&g_pot.calc_pot, xi, g_calc.paircol + atom->type, neigh->r);
+              g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho += splint_fmt(&g_pot.calc_pot, xi, g_calc.paircol + atom->type, neigh->r);
           }
         } // loop over neighbors
 
         // column of F
         int col_F = g_calc.paircol + g_param.ntypes + atom->type;
 #if defined(RESCALE)
+#if !defined(MPI)
+        // record the unclamped density for the incremental rescale check
+        rescale_track_atom(config_idx, atom->type, atom->rho);
+#endif  // !MPI
+
         if (atom->rho > g_pot.calc_pot.end[col_F]) {
           // then punish target function -> bad potential
           forces[g_calc.limit_p + config_idx] += DUMMY_WEIGHT * 10.0 * dsquare(atom->rho - g_pot.calc_pot.end[col_F]);
@@ -398,18 +431,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #else // APOT
         if (atom->rho < g_pot.calc_pot.begin[col_F]) {
           // linear extrapolation left
-          double rho_val = g_splint_comb(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.begin[col_F], &atom->gradF);
+          double rho_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.begin[col_F], &atom->gradF);
           forces[g_calc.energy_p + config_idx] += rho_val + (atom->rho - g_pot.calc_pot.begin[col_F]) * atom->gradF;
         } else if (atom->rho > g_pot.calc_pot.end[col_F]) {
           // and right
-          double rho_val = g_splint_comb(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.end[col_F] - 0.5 * g_pot.calc_pot.step[col_F], &atom->gradF);
+          double rho_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.end[col_F] - 0.5 * g_pot.calc_pot.step[col_F], &atom->gradF);
           forces[g_calc.energy_p + config_idx] += rho_val + (atom->rho - g_pot.calc_pot.end[col_F]) * atom->gradF;
         } else { // and in-between
 #endif // APOT
-          forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+          forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
         }
 #else // RESCALE
-        forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+        forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
 #endif  // !RESCALE
 
         // sum up rho
@@ -437,7 +470,10 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       if (uf) {
         for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
           atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
+          int atom_local = atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
           int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+          int first_n = soa->first[atom_local];
+
           for (int neigh_idx = 0; neigh_idx < atom->num_neigh; neigh_idx++) {
             // loop over all neighbors
             neigh_t* neigh = atom->neigh + neigh_idx;
@@ -449,17 +485,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             // are we within reach?
             if ((neigh->r < g_pot.calc_pot.end[neigh->col[1]]) || (neigh->r < g_pot.calc_pot.end[col_F - g_param.ntypes]))
             {
+              // the transfer gradient was already computed by the fused
+              // lookup in the density loop
               double rho_grad = 0.0;
               if (neigh->r < g_pot.calc_pot.end[neigh->col[1]])
-                rho_grad = splint_grad_dir(&g_pot.calc_pot, xi, neigh->slot[1],
-                                        neigh->shift[1], neigh->step[1]);
+                rho_grad = soa->rho_grad[first_n + neigh_idx];
               double rho_grad_j = 0.0;
               // use actio = reactio
               if (atom->type == neigh->type)
                 rho_grad_j = rho_grad;
               else
                 if (neigh->r < g_pot.calc_pot.end[col_F - g_param.ntypes])
-                  rho_grad_j = g_splint_grad(&g_pot.calc_pot, xi, col_F - g_param.ntypes, neigh->r);
+                  rho_grad_j = splint_grad_fmt(&g_pot.calc_pot, xi, col_F - g_param.ntypes, neigh->r);
 
               // now we know everything - calculate forces
               double eam_force = (rho_grad * atom->gradF + rho_grad_j * g_config.conf_atoms[(neigh->nr) - g_mpi.firstatom] .gradF);
@@ -627,11 +664,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         // clear field
         forces[g_calc.dummy_p + g_param.ntypes + g] = 0.0; // Free end ...
         // NEW: Constraint on U': U'(1.0)=0.0;
-        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 1.0);
+        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 1.0);
 #else   // !RESCALE
         forces[g_calc.dummy_p + g_param.ntypes + g] = 0.0; // Free end ...
         // constraints on U`(n)
-        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 0.5 * (g_pot.calc_pot.begin[g_calc.paircol + g_param.ntypes + g] + g_pot.calc_pot.end[g_calc.paircol + g_param.ntypes + g])) -
+        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 0.5 * (g_pot.calc_pot.begin[g_calc.paircol + g_param.ntypes + g] + g_pot.calc_pot.end[g_calc.paircol + g_param.ntypes + g])) -
             g_config.force_0[g_calc.dummy_p + g];
 #endif  // !RESCALE
 
@@ -171,18 +171,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // APOT && !MPI
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (1 == flag)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else
     /* if flag==2 then the potential parameters have changed -> sync */
@@ -221,7 +221,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       for (h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
         uf = g_config.conf_uf[h - g_mpi.firstconf];
 #if defined(STRESS)
-        us = g_config.conf_us[h - g_mpi.firstconf];
+        us = (g_param.sweight != 0) ? g_config.conf_us[h - g_mpi.firstconf] : 0;
 #endif  // STRESS
         /* Reset energies */
         forces[g_calc.energy_p + h] = 0.0;
@@ -347,6 +347,23 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 
           /* Loop over every angle stored with neighbors */
 
+          /* Evaluate g and g' for all stored triples of this atom in
+             one batched spline call; the interpolation geometry was
+             packed once at startup since cos(theta) never changes.
+             The cos(theta) should always lie inside -1 ... 1
+             So compute the g and g' without checking bounds */
+          const neigh_soa_t* soa = &g_config.neigh_soa;
+          int atom_local = g_config.cnfstart[h] - g_mpi.firstatom + i;
+          int first_a = soa->ang_first[atom_local];
+          int num_a = soa->ang_first[atom_local + 1] - first_a;
+          double g_tab[max(num_a, 1)];
+          double dg_tab[max(num_a, 1)];
+
+          splint_comb_dir_batch(&g_pot.calc_pot, xi, num_a,
+                                soa->ang_slot + first_a,
+                                soa->ang_shift + first_a,
+                                soa->ang_step + first_a, g_tab, dg_tab);
+
           /* set angl pointer to angl_part of current atom */
           angle = atom->angle_part;
 
@@ -365,15 +382,12 @@ double calc_forces(double* xi_opt, double* forces, int flag)
                 /* check that k lies inside f_ik */
                 if (neigh_k->r < g_pot.calc_pot.end[neigh_k->col[1]]) {
 
-                  /* The cos(theta) should always lie inside -1 ... 1
-                     So store the g and g' without checking bounds */
-                  angle->g = splint_comb_dir(&g_pot.calc_pot, xi, angle->slot,
-                                             angle->shift, angle->step,
-					     &angle->dg);
+                  double g_val = g_tab[angle - atom->angle_part];
+                  double dg_val = dg_tab[angle - atom->angle_part];
 
                   /* Sum up angular contribution for atom i caused by j and k
                      f_ij * f_ik * m_ijk */
-                  angener_sum += neigh_j->f * neigh_k->f * angle->g;
+                  angener_sum += neigh_j->f * neigh_k->f * g_val;
 
                   if (uf) {
                     /* Force location for atom j */
@@ -382,9 +396,9 @@ double calc_forces(double* xi_opt, double* forces, int flag)
                     n_k = 3 * neigh_k->nr;
 
                     /* Some tmp variables to clean up force fn below */
-                    dV3j = angle->g * neigh_j->df * neigh_k->f;
-                    dV3k = angle->g * neigh_j->f * neigh_k->df;
-                    V3 = neigh_j->f * neigh_k->f * angle->dg;
+                    dV3j = g_val * neigh_j->df * neigh_k->f;
+                    dV3k = g_val * neigh_j->f * neigh_k->df;
+                    V3 = neigh_j->f * neigh_k->f * dg_val;
 
                     vlj = V3 * neigh_j->inv_r;
                     vlk = V3 * neigh_k->inv_r;
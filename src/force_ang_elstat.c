@@ -185,18 +185,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // APOT && !MPI
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (1 == flag)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else
     /* if flag==2 then the potential parameters have changed -> sync */
@@ -247,13 +247,20 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #if !defined(MPI)
     g_mpi.myconf = g_config.nconf;
 #endif  // !MPI
+
+    /* with variing kappa the cached tail tables are refreshed once
+       per evaluation - and only when the optimizer actually moved
+       kappa - instead of per neighbor */
+    if (!g_pot.apot_table.sw_kappa)
+      update_tails(dp_kappa);
+
     /* region containing loop over configurations */
     {
       /* Loop over configurations */
       for (h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
         uf = g_config.conf_uf[h - g_mpi.firstconf];
 #if defined(STRESS)
-        us = g_config.conf_us[h - g_mpi.firstconf];
+        us = (g_param.sweight != 0) ? g_config.conf_us[h - g_mpi.firstconf] : 0;
 #endif  // STRESS
         /* Reset energies */
         forces[g_calc.energy_p + h] = 0.0;
@@ -345,16 +352,6 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             }
 
             /* calculate monopole forces */
-            /* updating tail-functions - only necessary with variing kappa */
-            if (!g_pot.apot_table.sw_kappa)
-#if defined(DSF)
-            elstat_dsf(neigh_j->r, dp_kappa, &neigh_j->fnval_el,
-                            &neigh_j->grad_el, &neigh_j->ggrad_el);
-#else
-            elstat_shift(neigh_j->r, dp_kappa, &neigh_j->fnval_el,
-                           &neigh_j->grad_el, &neigh_j->ggrad_el);
-#endif // DSF
-
             if (neigh_j->r < g_config.dp_cut &&
                 (charge[type1] || charge[type2])) {
               fnval_tail = neigh_j->fnval_el;
@@ -0,0 +1,161 @@
+/****************************************************************
+ *
+ * force_batch.c: mini-batch evaluation of the error sum
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "force_batch.h"
+#include "force_cache.h"
+#include "memory.h"
+#include "random.h"
+
+force_batch_t g_force_batch;
+
+/* mini-batches are only wired into the pair and EAM force routines and
+   need all configurations on a single process */
+
+#if (defined(PAIR) || defined(EAM)) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM)
+#define FORCE_BATCH_AVAILABLE
+#endif
+
+/****************************************************************
+ *
+ *  init_force_batch
+ *      enable mini-batch evaluations if requested and remember the
+ *      unscaled configuration weights
+ *
+ ****************************************************************/
+
+void init_force_batch(void)
+{
+#if defined(FORCE_BATCH_AVAILABLE)
+  if (g_param.eval_batch <= 0.0 || g_param.eval_batch >= 1.0 ||
+      g_config.nconf < 2)
+    return;
+
+  g_force_batch.in_batch = (char*)Malloc(g_config.nconf * sizeof(char));
+  g_force_batch.full_weight = (double*)Malloc(g_config.nconf * sizeof(double));
+
+  memcpy(g_force_batch.full_weight, g_config.conf_weight,
+         g_config.nconf * sizeof(double));
+
+  g_force_batch.enabled = 1;
+#endif  // FORCE_BATCH_AVAILABLE
+}
+
+/****************************************************************
+ *
+ *  force_batch_select
+ *      draw a new subset of the configurations, each one with a
+ *      probability proportional to its weight and the requested
+ *      fraction; the weights of the drawn configurations are divided
+ *      by that probability so the error sum stays unbiased
+ *
+ ****************************************************************/
+
+void force_batch_select(double fraction)
+{
+  if (!g_force_batch.enabled)
+    return;
+
+  if (fraction >= 1.0) {
+    force_batch_clear();
+    return;
+  }
+
+  double total_weight = 0.0;
+
+  for (int i = 0; i < g_config.nconf; i++)
+    total_weight += g_force_batch.full_weight[i];
+
+  if (total_weight <= 0.0)
+    return;
+
+  int num_selected = 0;
+
+  // redraw if the subset came up empty, which can only happen for
+  // very small fractions
+  do {
+    for (int i = 0; i < g_config.nconf; i++) {
+      double p = fraction * g_config.nconf * g_force_batch.full_weight[i] /
+                 total_weight;
+
+      if (p > 1.0)
+        p = 1.0;
+
+      if (p > 0.0 && eqdist() < p) {
+        g_force_batch.in_batch[i] = 1;
+        g_config.conf_weight[i] = g_force_batch.full_weight[i] / p;
+        num_selected++;
+      } else {
+        g_force_batch.in_batch[i] = 0;
+        g_config.conf_weight[i] = 0.0;
+      }
+    }
+  } while (num_selected == 0);
+
+  g_force_batch.active = 1;
+
+  // the cached per-configuration error shares were computed with the
+  // previous weights
+  g_force_cache.active = 0;
+}
+
+/****************************************************************
+ *
+ *  force_batch_skip
+ *      returns 1 if the configuration is not part of the current
+ *      subset and can be skipped
+ *
+ ****************************************************************/
+
+int force_batch_skip(int config_idx)
+{
+  return g_force_batch.active && !g_force_batch.in_batch[config_idx];
+}
+
+/****************************************************************
+ *
+ *  force_batch_clear
+ *      restore the full configuration weights, subsequent
+ *      evaluations cover the whole dataset again
+ *
+ ****************************************************************/
+
+void force_batch_clear(void)
+{
+  if (!g_force_batch.active)
+    return;
+
+  memcpy(g_config.conf_weight, g_force_batch.full_weight,
+         g_config.nconf * sizeof(double));
+
+  g_force_batch.active = 0;
+  g_force_cache.active = 0;
+}
@@ -0,0 +1,65 @@
+/****************************************************************
+ *
+ * force_batch.h: mini-batch evaluation of the error sum
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef FORCE_BATCH_H_INCLUDED
+#define FORCE_BATCH_H_INCLUDED
+
+/****************************************************************
+ *
+ *  The stochastic optimizers only need a rough error estimate for
+ *  most of their trial evaluations, especially in the early, hot
+ *  phase. With the eval_batch parameter set, a trial is evaluated on
+ *  a random subset of the configurations: each configuration is
+ *  drawn with a probability proportional to its weight and its
+ *  contribution is divided by that probability, so the expectation
+ *  value of the error sum is unchanged. The optimizers regrow the
+ *  batch as they converge and insert periodic full evaluations to
+ *  correct the drift of the estimates.
+ *
+ *  Like the force cache this is only available for serial runs -
+ *  with MPI the configurations are scattered over the processes and
+ *  the subset would have to be kept consistent on all ranks.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled;         /* eval_batch parameter is set and usable */
+  int active;          /* a subset is currently selected */
+  char* in_batch;      /* per-configuration selection flag */
+  double* full_weight; /* unscaled conf_weight values */
+} force_batch_t;
+
+extern force_batch_t g_force_batch;
+
+void init_force_batch(void);
+void force_batch_select(double fraction);
+int force_batch_skip(int config_idx);
+void force_batch_clear(void);
+
+#endif  // FORCE_BATCH_H_INCLUDED
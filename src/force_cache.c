@@ -0,0 +1,260 @@
+/****************************************************************
+ *
+ * force_cache.c: Incremental force evaluation for the optimizers
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "force_abort.h"
+#include "force_batch.h"
+#include "force_cache.h"
+#include "memory.h"
+
+force_cache_t g_force_cache;
+
+/* the cache is only wired into the pair and EAM force routines and
+   needs the complete force vector on a single process */
+
+#if (defined(PAIR) || defined(EAM)) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM)
+#define FORCE_CACHE_AVAILABLE
+#endif
+
+/****************************************************************
+ *
+ *  init_force_cache
+ *      build the dependency maps: one from optimizable parameter
+ *      to the potential column it modifies and one from potential
+ *      column to the configurations sampling it
+ *
+ ****************************************************************/
+
+void init_force_cache(void)
+{
+#if defined(FORCE_CACHE_AVAILABLE)
+  if (g_config.nconf == 0 || g_calc.ndim == 0)
+    return;
+
+  // number of columns the usage map can describe, any parameter
+  // belonging to a later column (chemical potentials, global
+  // parameters, ...) invalidates all configurations
+#if defined(TBEAM)
+  int ncols = g_calc.paircol + 4 * g_param.ntypes;
+#elif defined(EAM)
+  int ncols = g_calc.paircol + 2 * g_param.ntypes;
+#else
+  int ncols = g_calc.paircol;
+#endif  // TBEAM
+
+  g_force_cache.ncols = ncols;
+  g_force_cache.dirty = (int*)Malloc(g_config.nconf * sizeof(int));
+  g_force_cache.param_col = (int*)Malloc(g_calc.ndim * sizeof(int));
+  g_force_cache.col_used = (char*)Malloc(g_config.nconf * ncols * sizeof(char));
+  g_force_cache.forces = (double*)Malloc(g_calc.mdim * sizeof(double));
+  g_force_cache.error_part = (double*)Malloc(g_config.nconf * sizeof(double));
+  g_force_cache.stale = (char*)Malloc(g_config.nconf * sizeof(char));
+#if defined(EAM)
+  g_force_cache.rho_part = (double*)Malloc(g_config.nconf * sizeof(double));
+#endif  // EAM
+#if defined(TBEAM)
+  g_force_cache.rho_s_part = (double*)Malloc(g_config.nconf * sizeof(double));
+#endif  // TBEAM
+  g_force_cache.ref_params = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+
+  // map each optimizable parameter to the column it modifies
+  for (int i = 0; i < g_calc.ndim; i++) {
+    int idx = g_pot.opt_pot.idx[i];
+
+    g_force_cache.param_col[i] = -1;
+
+    for (int col = 0; col < g_pot.opt_pot.ncols && col < ncols; col++) {
+      if (idx >= g_pot.opt_pot.first[col] && idx <= g_pot.opt_pot.last[col]) {
+        g_force_cache.param_col[i] = col;
+        break;
+      }
+    }
+  }
+
+  // record which columns each configuration actually samples
+  const neigh_soa_t* soa = &g_config.neigh_soa;
+
+  for (int i = 0; i < g_config.natoms; i++) {
+    char* used = g_force_cache.col_used + g_config.atoms[i].conf * ncols;
+
+    for (int n = soa->first[i]; n < soa->first[i + 1]; n++)
+      for (int s = 0; s < SLOTS; s++)
+        used[soa->col[s][n]] = 1;
+
+#if defined(EAM)
+    // transfer and embedding functions of all types present
+    used[g_calc.paircol + g_config.atoms[i].type] = 1;
+    used[g_calc.paircol + g_param.ntypes + g_config.atoms[i].type] = 1;
+#if defined(TBEAM)
+    used[g_calc.paircol + 2 * g_param.ntypes + g_config.atoms[i].type] = 1;
+    used[g_calc.paircol + 3 * g_param.ntypes + g_config.atoms[i].type] = 1;
+#endif  // TBEAM
+#endif  // EAM
+  }
+
+  g_force_cache.enabled = 1;
+#endif  // FORCE_CACHE_AVAILABLE
+}
+
+/****************************************************************
+ *
+ *  force_cache_prepare
+ *      compare the new parameter vector with the reference one and
+ *      flag all configurations affected by a changed parameter
+ *
+ ****************************************************************/
+
+void force_cache_prepare(const double* params)
+{
+  if (!g_force_cache.enabled)
+    return;
+
+  // no reference data yet - compute everything
+  if (!g_force_cache.active) {
+    for (int i = 0; i < g_config.nconf; i++)
+      g_force_cache.dirty[i] = 1;
+    return;
+  }
+
+  // blocks stored during partial evaluations (mini-batch or aborted
+  // trials) never became part of the reference - always recompute them
+  for (int i = 0; i < g_config.nconf; i++)
+    g_force_cache.dirty[i] = g_force_cache.stale[i] ? 1 : 0;
+
+  for (int i = 0; i < g_calc.ndim; i++) {
+    int idx = g_pot.opt_pot.idx[i];
+
+    if (params[idx] == g_force_cache.ref_params[idx])
+      continue;
+
+    int col = g_force_cache.param_col[i];
+
+    // unknown dependency - recompute everything
+    if (col < 0) {
+      for (int j = 0; j < g_config.nconf; j++)
+        g_force_cache.dirty[j] = 1;
+      return;
+    }
+
+    for (int j = 0; j < g_config.nconf; j++)
+      if (g_force_cache.col_used[j * g_force_cache.ncols + col])
+        g_force_cache.dirty[j] = 1;
+  }
+}
+
+/****************************************************************
+ *
+ *  force_cache_restore
+ *      copy the per-configuration blocks of the force vector and the
+ *      error sum share from the reference evaluation, returns 0 if
+ *      the configuration has to be recomputed
+ *
+ ****************************************************************/
+
+int force_cache_restore(int config_idx, double* forces, double* error_sum)
+{
+  if (!g_force_cache.active || g_force_cache.dirty[config_idx])
+    return 0;
+
+  const double* cache = g_force_cache.forces;
+  int n_i = 3 * g_config.cnfstart[config_idx];
+
+  memcpy(forces + n_i, cache + n_i, 3 * g_config.inconf[config_idx] * sizeof(double));
+  forces[g_calc.energy_p + config_idx] = cache[g_calc.energy_p + config_idx];
+#if defined(STRESS)
+  memcpy(forces + g_calc.stress_p + 6 * config_idx, cache + g_calc.stress_p + 6 * config_idx, 6 * sizeof(double));
+#endif  // STRESS
+#if defined(RESCALE)
+  forces[g_calc.limit_p + config_idx] = cache[g_calc.limit_p + config_idx];
+#endif  // RESCALE
+
+  *error_sum += g_force_cache.error_part[config_idx];
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  force_cache_store
+ *      refresh the cache entry of a recomputed configuration
+ *
+ ****************************************************************/
+
+void force_cache_store(int config_idx, const double* forces, double error_part)
+{
+  if (!g_force_cache.enabled)
+    return;
+
+  double* cache = g_force_cache.forces;
+  int n_i = 3 * g_config.cnfstart[config_idx];
+
+  memcpy(cache + n_i, forces + n_i, 3 * g_config.inconf[config_idx] * sizeof(double));
+  cache[g_calc.energy_p + config_idx] = forces[g_calc.energy_p + config_idx];
+#if defined(STRESS)
+  memcpy(cache + g_calc.stress_p + 6 * config_idx, forces + g_calc.stress_p + 6 * config_idx, 6 * sizeof(double));
+#endif  // STRESS
+#if defined(RESCALE)
+  cache[g_calc.limit_p + config_idx] = forces[g_calc.limit_p + config_idx];
+#endif  // RESCALE
+
+  g_force_cache.error_part[config_idx] = error_part;
+
+  // tentatively mark the block, the flag is cleared again when the
+  // evaluation it belongs to becomes the reference
+  g_force_cache.stale[config_idx] = 1;
+}
+
+/****************************************************************
+ *
+ *  force_cache_commit
+ *      remember the parameter vector the cached data belongs to
+ *
+ ****************************************************************/
+
+void force_cache_commit(const double* params)
+{
+  if (!g_force_cache.enabled)
+    return;
+
+  // while a mini-batch is selected the stored blocks only cover part
+  // of the configurations - stay invalid until full evaluations resume
+  if (g_force_batch.active)
+    return;
+
+  // an aborted evaluation skipped part of the configurations as well
+  if (g_force_abort.rejected)
+    return;
+
+  memcpy(g_force_cache.ref_params, params, g_calc.ndimtot * sizeof(double));
+  memset(g_force_cache.stale, 0, g_config.nconf * sizeof(char));
+
+  g_force_cache.active = 1;
+}
@@ -0,0 +1,79 @@
+/****************************************************************
+ *
+ * force_cache.h: potfit incremental force evaluation header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef FORCE_CACHE_H_INCLUDED
+#define FORCE_CACHE_H_INCLUDED
+
+/****************************************************************
+ *
+ *  The force cache enables incremental force evaluations for the
+ *  least squares optimizers, which perturb only very few parameters
+ *  per call (one at a time while building the gamma matrix in
+ *  powell_lsq, a small subset per simann step). Each optimizable
+ *  parameter is mapped to the potential column it modifies and each
+ *  configuration records the columns it actually samples. When a new
+ *  parameter vector arrives, only the configurations touching a
+ *  changed column are recomputed; the per-configuration blocks of
+ *  the force vector and the per-configuration share of the error sum
+ *  are restored from the previous evaluation for all others.
+ *
+ *  The cache is only available for serial runs - with MPI the force
+ *  vector is scattered over the processes and the bookkeeping would
+ *  have to be kept consistent on all ranks.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled; /* dependency map has been built */
+  int active;  /* reference evaluation is available */
+  int ncols;   /* number of columns covered by the usage map */
+  int* dirty;  /* per-configuration recompute flag */
+  int* param_col;     /* optimizable parameter -> column (-1 = unknown) */
+  char* col_used;     /* nconf x ncols column usage map */
+  double* forces;     /* force vector of the reference evaluation */
+  double* error_part; /* per-configuration share of the error sum */
+  char* stale;        /* block was stored without a matching commit */
+#if defined(EAM)
+  double* rho_part; /* per-configuration share of rho_sum */
+#endif              // EAM
+#if defined(TBEAM)
+  double* rho_s_part; /* per-configuration share of rho_s_sum */
+#endif                // TBEAM
+  double* ref_params; /* parameter vector of the reference evaluation */
+} force_cache_t;
+
+extern force_cache_t g_force_cache;
+
+void init_force_cache(void);
+void force_cache_prepare(const double* params);
+int force_cache_restore(int config_idx, double* forces, double* error_sum);
+void force_cache_store(int config_idx, const double* forces, double error_part);
+void force_cache_commit(const double* params);
+
+#endif  // FORCE_CACHE_H_INCLUDED
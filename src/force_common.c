@@ -31,12 +31,17 @@
 
 #include "force.h"
 #include "memory.h"
+#include "rescale.h"
 #include "splines.h"
+#include "timers.h"
 #include "utils.h"
 
-double (*g_splint)(pot_table_t*, double*, int, double);
-double (*g_splint_grad)(pot_table_t*, double*, int, double);
-double (*g_splint_comb)(pot_table_t*, double*, int, double, double*);
+// inputs of the last second derivative computation per spline column,
+// used by update_splines to skip columns that did not change
+static char* g_spline_col_valid = NULL;
+static double* g_spline_knots_prev = NULL;
+static double* g_spline_xcoord_prev = NULL;
+static double* g_spline_step_prev = NULL;
 
 /****************************************************************
   init_force_common
@@ -46,25 +51,19 @@ double (*g_splint_comb)(pot_table_t*, double*, int, double, double*);
 
 void init_force_common(int is_worker)
 {
-  // Select correct spline interpolation and other functions
-  switch (g_pot.format_type) {
-    case POTENTIAL_FORMAT_UNKNOWN:
-      error(1, "Unknown potential format detected! (%s:%d)\n", __FILE__,
-            __LINE__);
-    case POTENTIAL_FORMAT_ANALYTIC:
-    case POTENTIAL_FORMAT_TABULATED_EQ_DIST:
-      g_splint = splint_ed;
-      g_splint_comb = splint_comb_ed;
-      g_splint_grad = splint_grad_ed;
-      break;
-    case POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST:
-      g_splint = splint_ne;
-      g_splint_comb = splint_comb_ne;
-      g_splint_grad = splint_grad_ne;
-      break;
-    case POTENTIAL_FORMAT_KIM:
-      break;
-  }
+  // the spline interpolation variant matching the potential format is
+  // selected by the inlined splint_*_fmt functions (splines.h)
+  if (g_pot.format_type == POTENTIAL_FORMAT_UNKNOWN)
+    error(1, "Unknown potential format detected! (%s:%d)\n", __FILE__,
+          __LINE__);
+
+#if defined(RESCALE) && !defined(MPI) && \
+    (defined(EAM) || defined(ADP) || defined(MEAM))
+  // the rho bound tracker is written from inside the threaded config
+  // loops, so its storage is allocated up front
+  rescale_track_init();
+#endif  // RESCALE && !MPI && (EAM || ADP || MEAM)
+
   // for force-specific initializations please use the
   // init_force function local to the force_xxx.c file
 }
@@ -149,73 +148,143 @@ void gather_variable(double* var)
 #if defined(MPI)
   // Reduce variable
   double tmpvar = 0.0;
-  MPI_Reduce(&var, &tmpvar, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&var, &tmpvar, 1, MPI_DOUBLE, MPI_SUM, 0, g_mpi.comm);
   if (g_mpi.myid == 0)
     *var = tmpvar;
 #endif  // MPI
 }
 
+// The stochastic optimizers (simulated annealing, differential
+// evolution) consume only the scalar error sum, so during their
+// stages the full deviation vector does not have to leave the ranks
+// on every evaluation. The mode is owned by rank 0 and broadcast
+// with every gather, so all ranks of the group take the same branch;
+// anything that reads the gathered vector (powell, the final report)
+// runs with the mode switched off.
+static int g_gather_sum_only = 0;
+
+void gather_forces_sum_only(int enable)
+{
+  g_gather_sum_only = enable;
+}
+
 /****************************************************************
   gather_forces
     called after all parameters and potentials are read
     additional assignments and initializations can be made here
 ****************************************************************/
 
+#if defined(MPI)
+// The kernels zero the force entries of configurations that do not
+// use forces, so when no configuration uses them the whole block is
+// zero on every rank and does not have to be gathered. useforce is
+// broadcast in full, so all ranks take the same branch.
+static int gather_forces_in_use(void)
+{
+  static int in_use = -1;
+
+  if (in_use < 0) {
+    in_use = 0;
+    for (int i = 0; i < g_config.nconf; i++)
+      if (g_config.useforce[i])
+        in_use = 1;
+  }
+
+  return in_use;
+}
+#endif  // MPI
+
 void gather_forces(double* error_sum, double* forces)
 {
+  timer_start(TIMER_COMM);
+
 #if defined(MPI)
   double tmpsum = 0.0;
+  MPI_Request requests[5];
+  int num_requests = 0;
+  int sum_only = g_gather_sum_only;
+
+  MPI_Bcast(&sum_only, 1, MPI_INT, 0, g_mpi.comm);
 
-  MPI_Reduce(error_sum, &tmpsum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+  // all collectives are started at once and completed with a single wait,
+  // so ranks that finish their configurations early can already progress
+  // the reduction and gathers while other ranks are still computing
+  MPI_Ireduce(error_sum, &tmpsum, 1, MPI_DOUBLE, MPI_SUM, 0, g_mpi.comm,
+              &requests[num_requests++]);
 
   // gather forces, energies, stresses
-  if (g_mpi.myid == 0) {
+  if (sum_only) {
+    // the optimizer only looks at the error sum right now
+  } else if (g_mpi.myid == 0) {
     // root node already has data in place
-    // forces
-    MPI_Gatherv(MPI_IN_PLACE, g_mpi.myatoms, g_mpi.MPI_VECTOR, forces,
-                g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
-                MPI_COMM_WORLD);
+    // forces; like the stresses the block stays home when no
+    // configuration uses it
+    if (gather_forces_in_use())
+      MPI_Igatherv(MPI_IN_PLACE, g_mpi.myatoms, g_mpi.MPI_VECTOR, forces,
+                   g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
+                   g_mpi.comm, &requests[num_requests++]);
     // energies
-    MPI_Gatherv(MPI_IN_PLACE, g_mpi.myconf, MPI_DOUBLE,
-                forces + g_calc.energy_p, g_mpi.conf_len, g_mpi.conf_dist,
-                MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Igatherv(MPI_IN_PLACE, g_mpi.myconf, MPI_DOUBLE,
+                 forces + g_calc.energy_p, g_mpi.conf_len, g_mpi.conf_dist,
+                 MPI_DOUBLE, 0, g_mpi.comm, &requests[num_requests++]);
 #if defined(STRESS)
-    // stresses
-    MPI_Gatherv(MPI_IN_PLACE, g_mpi.myconf, g_mpi.MPI_STENS,
-                forces + g_calc.stress_p, g_mpi.conf_len, g_mpi.conf_dist,
-                g_mpi.MPI_STENS, 0, MPI_COMM_WORLD);
+    // stresses; with a zero stress weight the kernels skipped the
+    // virial and the block is all zeros everywhere, so it stays home
+    if (g_param.sweight != 0)
+      MPI_Igatherv(MPI_IN_PLACE, g_mpi.myconf, g_mpi.MPI_STENS,
+                   forces + g_calc.stress_p, g_mpi.conf_len, g_mpi.conf_dist,
+                   g_mpi.MPI_STENS, 0, g_mpi.comm, &requests[num_requests++]);
 #endif  // STRESS
 #if defined(RESCALE) && (defined(EAM) || defined(ADP) || defined(MEAM))
     // punishment constraints
-    MPI_Gatherv(MPI_IN_PLACE, g_mpi.myconf, MPI_DOUBLE, forces + g_calc.limit_p,
-                g_mpi.conf_len, g_mpi.conf_dist, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Igatherv(MPI_IN_PLACE, g_mpi.myconf, MPI_DOUBLE,
+                 forces + g_calc.limit_p, g_mpi.conf_len, g_mpi.conf_dist,
+                 MPI_DOUBLE, 0, g_mpi.comm, &requests[num_requests++]);
 #endif  // RESCALE && (EAM || ADP || MEAM)
   } else {
+    // what a process contributes can be less than what it computes:
+    // of the processes sharing a configuration only the first one
+    // sends, so the slices below come from the distribution tables
+    int my_atoms = g_mpi.atom_len[g_mpi.myid];
+    int my_first_atom = g_mpi.atom_dist[g_mpi.myid];
+    int my_confs = g_mpi.conf_len[g_mpi.myid];
+    int my_first_conf = g_mpi.conf_dist[g_mpi.myid];
+
     // forces
-    MPI_Gatherv(forces + g_mpi.firstatom * 3, g_mpi.myatoms, g_mpi.MPI_VECTOR,
-                forces, g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
-                MPI_COMM_WORLD);
+    if (gather_forces_in_use())
+      MPI_Igatherv(forces + my_first_atom * 3, my_atoms, g_mpi.MPI_VECTOR,
+                   forces, g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
+                   g_mpi.comm, &requests[num_requests++]);
     // energies
-    MPI_Gatherv(forces + g_calc.energy_p + g_mpi.firstconf, g_mpi.myconf,
-                MPI_DOUBLE, forces + g_calc.energy_p, g_mpi.conf_len,
-                g_mpi.conf_dist, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Igatherv(forces + g_calc.energy_p + my_first_conf, my_confs,
+                 MPI_DOUBLE, forces + g_calc.energy_p, g_mpi.conf_len,
+                 g_mpi.conf_dist, MPI_DOUBLE, 0, g_mpi.comm,
+                 &requests[num_requests++]);
 #if defined(STRESS)
     // stresses
-    MPI_Gatherv(forces + g_calc.stress_p + 6 * g_mpi.firstconf, g_mpi.myconf,
-                g_mpi.MPI_STENS, forces + g_calc.stress_p, g_mpi.conf_len,
-                g_mpi.conf_dist, g_mpi.MPI_STENS, 0, MPI_COMM_WORLD);
+    if (g_param.sweight != 0)
+      MPI_Igatherv(forces + g_calc.stress_p + 6 * my_first_conf, my_confs,
+                   g_mpi.MPI_STENS, forces + g_calc.stress_p, g_mpi.conf_len,
+                   g_mpi.conf_dist, g_mpi.MPI_STENS, 0, g_mpi.comm,
+                   &requests[num_requests++]);
 #endif  // STRESS
 #if defined(RESCALE) && (defined(EAM) || defined(ADP) || defined(MEAM))
     // punishment constraints
-    MPI_Gatherv(forces + g_calc.limit_p + g_mpi.firstconf, g_mpi.myconf,
-                MPI_DOUBLE, forces + g_calc.limit_p, g_mpi.conf_len,
-                g_mpi.conf_dist, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Igatherv(forces + g_calc.limit_p + my_first_conf, my_confs,
+                 MPI_DOUBLE, forces + g_calc.limit_p, g_mpi.conf_len,
+                 g_mpi.conf_dist, MPI_DOUBLE, 0, g_mpi.comm,
+                 &requests[num_requests++]);
 #endif  // RESCALE && (EAM || ADP || MEAM)
   }
 
+  MPI_Waitall(num_requests, requests, MPI_STATUSES_IGNORE);
+
   *error_sum = tmpsum;
 
 #endif  // MPI
+
+  timer_stop(TIMER_COMM);
+  timer_eval_done();
 }
 
 /****************************************************************
@@ -224,8 +293,31 @@ void gather_forces(double* error_sum, double* forces)
 
 void update_splines(double* xi, int start_col, int num_col, int grad_flag)
 {
+  timer_start(TIMER_SPLINES);
+
+  if (g_spline_col_valid == NULL) {
+    g_spline_col_valid = (char*)Malloc(g_pot.calc_pot.ncols * sizeof(char));
+    g_spline_knots_prev = (double*)Malloc(g_pot.calc_pot.len * sizeof(double));
+    g_spline_xcoord_prev = (double*)Malloc(g_pot.calc_pot.len * sizeof(double));
+    g_spline_step_prev = (double*)Malloc(g_pot.calc_pot.ncols * sizeof(double));
+  }
+
   for (int col = start_col; col < start_col + num_col; col++) {
     int first = g_pot.calc_pot.first[col];
+    int len = g_pot.calc_pot.last[col] - first + 1;
+
+    // the least squares optimizers perturb only very few parameters per
+    // call, recompute the second derivatives only for changed columns;
+    // the gradient slots and abscissas are part of the comparison so
+    // rescaled tables are picked up as well
+    if (g_spline_col_valid[col] &&
+        g_spline_step_prev[col] == g_pot.calc_pot.step[col] &&
+        memcmp(xi + first - 2, g_spline_knots_prev + first - 2,
+               (len + 2) * sizeof(double)) == 0 &&
+        memcmp(g_pot.calc_pot.xcoord + first, g_spline_xcoord_prev + first,
+               len * sizeof(double)) == 0)
+      continue;
+
     double grad_left = (grad_flag & 1) ? *(xi + first - 2) : 0.0;
     double grad_right = (grad_flag & 2) ? *(xi + first - 1) : 0.0;
     switch (g_pot.format_type) {
@@ -233,20 +325,155 @@ void update_splines(double* xi, int start_col, int num_col, int grad_flag)
         error(1, "Unknown potential format detected! (%s:%d)\n", __FILE__, __LINE__);
       case POTENTIAL_FORMAT_ANALYTIC:
       case POTENTIAL_FORMAT_TABULATED_EQ_DIST: {
-        spline_ed(g_pot.calc_pot.step[col], xi + first,
-                  g_pot.calc_pot.last[col] - first + 1,
+        spline_ed(g_pot.calc_pot.step[col], xi + first, len,
                   grad_left, grad_right, g_pot.calc_pot.d2tab + first);
         break;
       }
       case POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST: {
-        spline_ne(g_pot.calc_pot.xcoord + first, xi + first,
-                  g_pot.calc_pot.last[col] - first + 1,
+        spline_ne(g_pot.calc_pot.xcoord + first, xi + first, len,
                   grad_left, grad_right, g_pot.calc_pot.d2tab + first);
         break;
       }
       case POTENTIAL_FORMAT_KIM:
         warning("updates_splines() should not be called for KIM potentials!");
+        timer_stop(TIMER_SPLINES);
         return;
     }
+
+    memcpy(g_spline_knots_prev + first - 2, xi + first - 2,
+           (len + 2) * sizeof(double));
+    memcpy(g_spline_xcoord_prev + first, g_pot.calc_pot.xcoord + first,
+           len * sizeof(double));
+    g_spline_step_prev[col] = g_pot.calc_pot.step[col];
+    g_spline_col_valid[col] = 1;
   }
+
+  timer_stop(TIMER_SPLINES);
 }
+
+/****************************************************************
+  invalidate_spline_cache
+    must be called whenever the second derivatives are written
+    outside of update_splines (rescaled or restored tables)
+****************************************************************/
+
+void invalidate_spline_cache()
+{
+  if (g_spline_col_valid != NULL)
+    memset(g_spline_col_valid, 0, g_pot.calc_pot.ncols * sizeof(char));
+}
+
+#if defined(RESCALE) && !defined(MPI) && \
+    (defined(EAM) || defined(ADP) || defined(MEAM))
+
+/****************************************************************
+ *
+ *  running rho bounds for the incremental rescale check
+ *
+ *    rescale re-walks every neighbor list just to find the extrema of
+ *    the electron density before deciding whether the embedding domain
+ *    has to move. The force kernels see every density anyway, so they
+ *    record per-configuration extrema here and rescale can make that
+ *    decision without the full dataset pass. Configurations restored
+ *    from the force cache keep their last recorded bounds, which are
+ *    still valid because nothing relevant to them has changed.
+ *
+ ****************************************************************/
+
+static double* g_rescale_min = NULL;
+static double* g_rescale_max = NULL;
+static char* g_rescale_seen = NULL;
+
+/****************************************************************
+  rescale_track_init
+    allocate the tracker from init_force_common, before any force
+    kernel can record bounds from a threaded config loop
+****************************************************************/
+
+void rescale_track_init(void)
+{
+  if (g_rescale_min != NULL)
+    return;
+
+  g_rescale_min =
+      (double*)Malloc(g_config.nconf * g_param.ntypes * sizeof(double));
+  g_rescale_max =
+      (double*)Malloc(g_config.nconf * g_param.ntypes * sizeof(double));
+  g_rescale_seen = (char*)Malloc(g_config.nconf * sizeof(char));
+}
+
+/****************************************************************
+  rescale_track_start
+    reset the entries of one configuration before its densities are
+    summed
+****************************************************************/
+
+void rescale_track_start(int config_idx)
+{
+  for (int i = 0; i < g_param.ntypes; i++) {
+    g_rescale_min[config_idx * g_param.ntypes + i] = 1e100;
+    g_rescale_max[config_idx * g_param.ntypes + i] = -1e100;
+  }
+
+  g_rescale_seen[config_idx] = 1;
+}
+
+/****************************************************************
+  rescale_track_atom
+    record the density of one atom before it is clamped to the
+    embedding domain
+****************************************************************/
+
+void rescale_track_atom(int config_idx, int type, double rho)
+{
+  const int i = config_idx * g_param.ntypes + type;
+
+  if (rho < g_rescale_min[i])
+    g_rescale_min[i] = rho;
+  if (rho > g_rescale_max[i])
+    g_rescale_max[i] = rho;
+}
+
+/****************************************************************
+  rescale_track_bounds
+    reduce the per-configuration entries to per-type extrema, returns
+    0 while configurations without recorded bounds remain
+****************************************************************/
+
+int rescale_track_bounds(double* minrho, double* maxrho)
+{
+  if (g_rescale_min == NULL)
+    return 0;
+
+  for (int h = 0; h < g_config.nconf; h++)
+    if (!g_rescale_seen[h])
+      return 0;
+
+  for (int i = 0; i < g_param.ntypes; i++) {
+    minrho[i] = 1e100;
+    maxrho[i] = -1e100;
+  }
+
+  for (int h = 0; h < g_config.nconf; h++) {
+    for (int i = 0; i < g_param.ntypes; i++) {
+      minrho[i] = MIN(minrho[i], g_rescale_min[h * g_param.ntypes + i]);
+      maxrho[i] = MAX(maxrho[i], g_rescale_max[h * g_param.ntypes + i]);
+    }
+  }
+
+  return 1;
+}
+
+/****************************************************************
+  rescale_track_invalidate
+    drop all recorded bounds, the densities change when the transfer
+    functions are scaled
+****************************************************************/
+
+void rescale_track_invalidate(void)
+{
+  if (g_rescale_seen != NULL)
+    memset(g_rescale_seen, 0, g_config.nconf * sizeof(char));
+}
+
+#endif  // RESCALE && !MPI && (EAM || ADP || MEAM)
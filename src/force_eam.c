@@ -33,7 +33,13 @@
 
 #include "potfit.h"
 
+#include "conf_index.h"
+#include "config.h"
+#include "eval_memo.h"
 #include "force.h"
+#include "force_abort.h"
+#include "force_batch.h"
+#include "force_cache.h"
 #include "functions.h"
 #include "memory.h"
 #if defined(MPI)
@@ -41,6 +47,7 @@
 #endif
 #include "potential_input.h"
 #include "potential_output.h"
+#include "rescale.h"
 #include "splines.h"
 #include "utils.h"
 
@@ -149,19 +156,26 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     }
 #endif  // APOT && !MPI
 
+#if !defined(MPI)
+    // exact repeats of a recent parameter vector are served from the
+    // memo cache without touching a single configuration
+    if (eval_memo_lookup(xi_opt, forces, &error_sum))
+      return error_sum;
+#endif  // !MPI
+
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else   // APOT
     // if flag == 2 then the potential parameters have changed -> sync
@@ -192,12 +206,56 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     update_splines(xi, g_calc.paircol + 3 * g_param.ntypes, g_param.ntypes, 3);
 #endif  // TBEAM
 
+    // flag all configurations affected by a changed parameter
+    force_cache_prepare(xi_opt);
+
     // loop over configurations
-    for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial sums reduced at the end
+#if defined(OPENMP)
+#if defined(TBEAM)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum, rho_sum, rho_s_sum)
+#else
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum, rho_sum)
+#endif  // TBEAM
+#endif  // OPENMP
+    for (int conf_i = g_mpi.firstconf; conf_i < g_mpi.firstconf + g_mpi.myconf; conf_i++) {
+      // with an armed abort cutoff the configurations with the largest
+      // error contributions come first so hopeless trials fail fast
+      int config_idx = force_abort_order(conf_i);
+
+      // with file-backed neighbor data fetch the next block now
+      config_stream_prefetch(config_idx);
+
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
 #endif  // STRESS
+
+      // configurations outside of the current mini-batch keep their
+      // previous force vector entries, only the error sum matters for
+      // a trial evaluation
+      if (force_batch_skip(config_idx))
+        continue;
+
+      // reuse the cached contributions if nothing relevant has changed
+      if (force_cache_restore(config_idx, forces, &error_sum)) {
+        rho_sum += g_force_cache.rho_part[config_idx];
+#if defined(TBEAM)
+        rho_s_sum += g_force_cache.rho_s_part[config_idx];
+#endif  // TBEAM
+        continue;
+      }
+
+      double error_start = error_sum;
+      double rho_start = rho_sum;
+#if defined(TBEAM)
+      double rho_s_start = rho_s_sum;
+#endif  // TBEAM
+
+      // packed neighbor data keeps the inner loops contiguous in memory
+      const neigh_soa_t* soa = &g_config.neigh_soa;
       // reset energies and stresses
       forces[g_calc.energy_p + config_idx] = 0.0;
 #if defined(STRESS)
@@ -208,6 +266,10 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #if defined(RESCALE)
       // set limiting constraints
       forces[g_calc.limit_p + config_idx] = -g_config.force_0[g_calc.limit_p + config_idx];
+#if !defined(MPI)
+      // fresh rho bounds for this configuration
+      rescale_track_start(config_idx);
+#endif  // !MPI
 #endif  // RESCALE
 
       // first loop: reset forces and densities
@@ -230,91 +292,101 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       // second loop: calculate pair forces, energies and atomic densities
       for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
         atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
+        int atom_local = atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
         int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+        int first_n = soa->first[atom_local];
+        int num_n = soa->first[atom_local + 1] - first_n;
+
+        // evaluate pair potential and transfer function for the whole
+        // neighbor list at once in a single fused pass over both
+        // columns; entries beyond the cutoff are discarded below
+        // the transfer gradient is kept for the force pass, which no
+        // longer has to walk the table again
+        double phi_val[max(num_n, 1)];
+        double phi_grad[max(num_n, 1)];
+        double rho_val[max(num_n, 1)];
+        if (uf)
+          splint_comb_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_val, phi_grad, soa->slot[1] + first_n, soa->shift[1] + first_n, soa->step[1] + first_n, rho_val, soa->rho_grad + first_n);
+        else
+          splint_dir_batch2(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_val, soa->slot[1] + first_n, soa->shift[1] + first_n, soa->step[1] + first_n, rho_val);
+
         // loop over all neighbors
-        for (int neigh_idx = 0; neigh_idx < atom->num_neigh; neigh_idx++) {
-          neigh_t* neigh = atom->neigh + neigh_idx;
+        for (int n = first_n; n < first_n + num_n; n++) {
           // In small cells, an atom might interact with itself
-          int self = (neigh->nr == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
+          int self = (soa->nr[n] == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
 
           // pair potential part
-          if (neigh->r < g_pot.calc_pot.end[neigh->col[0]]) {
-            double phi_val = 0.0;
-            double phi_grad = 0.0;
-            // potential value and gradient are calculated in the same step
-            if (uf)
-              phi_val = splint_comb_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0], &phi_grad);
-            else
-              phi_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0]);
+          if (soa->r[n] < g_pot.calc_pot.end[soa->col[0][n]]) {
+            double val = phi_val[n - first_n];
+            double grad = uf ? phi_grad[n - first_n] : 0.0;
 
             // avoid double counting if atom is interacting with itself
             if (self) {
-              phi_val *= 0.5;
-              phi_grad *= 0.5;
+              val *= 0.5;
+              grad *= 0.5;
             }
 
             // add cohesive energy
-            forces[g_calc.energy_p + config_idx] += phi_val;
+            forces[g_calc.energy_p + config_idx] += val;
 
             // calculate forces
             if (uf) {
               vector tmp_force;
-              tmp_force.x = neigh->dist_r.x * phi_grad;
-              tmp_force.y = neigh->dist_r.y * phi_grad;
-              tmp_force.z = neigh->dist_r.z * phi_grad;
+              tmp_force.x = soa->dist_r_x[n] * grad;
+              tmp_force.y = soa->dist_r_y[n] * grad;
+              tmp_force.z = soa->dist_r_z[n] * grad;
               forces[n_i + 0] += tmp_force.x;
               forces[n_i + 1] += tmp_force.y;
               forces[n_i + 2] += tmp_force.z;
               // actio = reactio
-              forces[3 * neigh->nr + 0] -= tmp_force.x;
-              forces[3 * neigh->nr + 1] -= tmp_force.y;
-              forces[3 * neigh->nr + 2] -= tmp_force.z;
+              forces[3 * soa->nr[n] + 0] -= tmp_force.x;
+              forces[3 * soa->nr[n] + 1] -= tmp_force.y;
+              forces[3 * soa->nr[n] + 2] -= tmp_force.z;
 #if defined(STRESS)
               // also calculate pair stresses
               if (us) {
-                forces[stress_idx + 0] -= neigh->dist.x * tmp_force.x;
-                forces[stress_idx + 1] -= neigh->dist.y * tmp_force.y;
-                forces[stress_idx + 2] -= neigh->dist.z * tmp_force.z;
-                forces[stress_idx + 3] -= neigh->dist.x * tmp_force.y;
-                forces[stress_idx + 4] -= neigh->dist.y * tmp_force.z;
-                forces[stress_idx + 5] -= neigh->dist.z * tmp_force.x;
+                forces[stress_idx + 0] -= soa->dist_x[n] * tmp_force.x;
+                forces[stress_idx + 1] -= soa->dist_y[n] * tmp_force.y;
+                forces[stress_idx + 2] -= soa->dist_z[n] * tmp_force.z;
+                forces[stress_idx + 3] -= soa->dist_x[n] * tmp_force.y;
+                forces[stress_idx + 4] -= soa->dist_y[n] * tmp_force.z;
+                forces[stress_idx + 5] -= soa->dist_z[n] * tmp_force.x;
               }
 #endif // STRESS
             } // uf
           } // neighbor in range
 
           // calculate atomic densities
-          if (atom->type == neigh->type) {
+          if (atom->type == soa->type[n]) {
             // then transfer(a->b)==transfer(b->a)
-            if (neigh->r < g_pot.calc_pot.end[neigh->col[1]]) {
-              double rho_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[1], neigh->shift[1], neigh->step[1]);
-              atom->rho += rho_val;
+            if (soa->r[n] < g_pot.calc_pot.end[soa->col[1][n]]) {
+              atom->rho += rho_val[n - first_n];
               // avoid double counting if atom is interacting with itself
               if (!self)
-                g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho += rho_val;
+                g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom].rho += rho_val[n - first_n];
             }
 #if defined(TBEAM)
-            if (neigh->r < g_pot.calc_pot.end[neigh->col[2]]) {
-              double rho_s_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[2], neigh->shift[2], neigh->step[2]);
+            if (soa->r[n] < g_pot.calc_pot.end[soa->col[2][n]]) {
+              double rho_s_val = splint_dir(&g_pot.calc_pot, xi, soa->slot[2][n], soa->shift[2][n], soa->step[2][n]);
               atom->rho_s += rho_s_val;
               // avoid double counting if atom is interacting with itself
               if (!self)
-                g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho_s += rho_s_val;
+                g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom].rho_s += rho_s_val;
             }
 #endif  // TBEAM
           } else {
             // transfer(a->b)!=transfer(b->a)
-            if (neigh->r < g_pot.calc_pot.end[neigh->col[1]])
-              atom->rho += splint_dir(&g_pot.calc_pot, xi, neigh->slot[1], neigh->shift[1], neigh->step[1]);
-            // cannot use slot/shift to access splines
-            if (neigh->r < g_pot.calc_pot.end[g_calc.paircol + atom->type])
-              g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho +=
-                g_splint(&g_pot.calc_pot, xi, g_calc.paircol + atom->type, neigh->r);
+            if (soa->r[n] < g_pot.calc_pot.end[soa->col[1][n]])
+              atom->rho += rho_val[n - first_n];
+            // reverse direction via the precomputed slots
+            if (soa->r[n] < g_pot.calc_pot.end[g_calc.paircol + atom->type])
+              g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom].rho +=
+                splint_dir(&g_pot.calc_pot, xi, soa->slot_rev[n], soa->shift_rev[n], soa->step_rev[n]);
 #if defined(TBEAM)
-            if (neigh->r < g_pot.calc_pot.end[neigh->col[2]])
-              atom->rho_s += splint_dir(&g_pot.calc_pot, xi, neigh->slot[2], neigh->shift[2], neigh->step[2]);
-            if (neigh->r < g_pot.calc_pot .end[g_calc.paircol + 2 * g_param.ntypes + atom->type])
-              g_config.conf_atoms[neigh->nr - g_mpi.firstatom].rho_s += g_splint(&g_pot.calc_pot, xi, g_calc.paircol + 2 * g_param.ntypes + atom->type, neigh->r);
+            if (soa->r[n] < g_pot.calc_pot.end[soa->col[2][n]])
+              atom->rho_s += splint_dir(&g_pot.calc_pot, xi, soa->slot[2][n], soa->shift[2][n], soa->step[2][n]);
+            if (soa->r[n] < g_pot.calc_pot .end[g_calc.paircol + 2 * g_param.ntypes + atom->type])
+              g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom].rho_s += splint_dir(&g_pot.calc_pot, xi, soa->slot_rev_s[n], soa->shift_rev_s[n], soa->step_rev_s[n]);
 #endif  // TBEAM
           }
         } // loop over all neighbors
@@ -327,6 +399,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // TBEAM
 
 #if defined(RESCALE)
+#if !defined(MPI)
+        // record the unclamped density for the incremental rescale check
+        rescale_track_atom(config_idx, atom->type, atom->rho);
+#endif  // !MPI
+
         // we punish the potential for bad behavior:
         // if the density of one atom is smaller or greater than we have the
         // embedding function tabulated a punishment is added
@@ -366,24 +443,35 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           // calculate analytic value explicitly
           double temp_eng = 0.0;
           g_pot.apot_table.fvalue[col_F](atom->rho, xi_opt + g_pot.opt_pot.first[col_F], &temp_eng);
-          atom->gradF = apot_gradient(atom->rho, xi_opt + g_pot.opt_pot.first[col_F], g_pot.apot_table.fvalue[col_F]);
+          // the embedding gradient is only consumed by the force loop
+          if (uf)
+            atom->gradF = apot_gradient(atom->rho, xi_opt + g_pot.opt_pot.first[col_F], g_pot.apot_table.fvalue[col_F]);
           forces[g_calc.energy_p + config_idx] += temp_eng;
         } else {
 #else // APOT
         if (atom->rho < g_pot.calc_pot.begin[col_F]) {
           // linear extrapolation left
-          double rho_val = g_splint_comb(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.begin[col_F], &atom->gradF);
+          double rho_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.begin[col_F], &atom->gradF);
           forces[g_calc.energy_p + config_idx] += rho_val + (atom->rho - g_pot.calc_pot.begin[col_F]) * atom->gradF;
         } else if (atom->rho > g_pot.calc_pot.end[col_F]) {
           // and right
-          double rho_val = g_splint_comb(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.end[col_F] - 0.5 * g_pot.calc_pot.step[col_F], &atom->gradF);
+          double rho_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F, g_pot.calc_pot.end[col_F] - 0.5 * g_pot.calc_pot.step[col_F], &atom->gradF);
           forces[g_calc.energy_p + config_idx] += rho_val + (atom->rho - g_pot.calc_pot.end[col_F]) * atom->gradF;
         } else { // and in-between
 #endif // APOT
-          forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+          // without forces the embedding gradient is never read, the
+          // value-only lookup is enough (the extrapolation branches
+          // above need the gradient for the energy itself)
+          if (uf)
+            forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+          else
+            forces[g_calc.energy_p + config_idx] += splint_fmt(&g_pot.calc_pot, xi, col_F, atom->rho);
         }
 #else // RESCALE
-        forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+        if (uf)
+          forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
+        else
+          forces[g_calc.energy_p + config_idx] += splint_fmt(&g_pot.calc_pot, xi, col_F, atom->rho);
 #endif  // !RESCALE
 
         // sum up rho
@@ -396,24 +484,31 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           // calculate analytic value explicitly
           double temp_eng = 0.0;
           g_pot.apot_table.fvalue[col_F_s](atom->rho_s, xi_opt + g_pot.opt_pot.first[col_F_s], &temp_eng);
-          atom->gradF_s = apot_gradient(atom->rho_s, xi_opt + g_pot.opt_pot.first[col_F_s], g_pot.apot_table.fvalue[col_F_s]);
+          if (uf)
+            atom->gradF_s = apot_gradient(atom->rho_s, xi_opt + g_pot.opt_pot.first[col_F_s], g_pot.apot_table.fvalue[col_F_s]);
           forces[g_calc.energy_p + config_idx] += temp_eng;
         } else {
 #else // APOT
         if (atom->rho_s < g_pot.calc_pot.begin[col_F_s]) {
           // linear extrapolation left
-          double rho_s_val = g_splint_comb(&g_pot.calc_pot, xi, col_F_s, g_pot.calc_pot.begin[col_F_s], &atom->gradF_s);
+          double rho_s_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F_s, g_pot.calc_pot.begin[col_F_s], &atom->gradF_s);
           forces[g_calc.energy_p + config_idx] += rho_s_val + (atom->rho_s - g_pot.calc_pot.begin[col_F_s]) * atom->gradF_s;
         } else if (atom->rho_s > g_pot.calc_pot.end[col_F_s]) {
           // and right
-          double rho_s_val = g_splint_comb(&g_pot.calc_pot, xi, col_F_s, g_pot.calc_pot.end[col_F_s] - 0.5 * g_pot.calc_pot.step[col_F_s], &atom->gradF_s);
+          double rho_s_val = splint_comb_fmt(&g_pot.calc_pot, xi, col_F_s, g_pot.calc_pot.end[col_F_s] - 0.5 * g_pot.calc_pot.step[col_F_s], &atom->gradF_s);
           forces[g_calc.energy_p + config_idx] += rho_s_val + (atom->rho_s - g_pot.calc_pot.end[col_F_s]) * atom->gradF_s;
         } else {
 #endif // APOT
-          forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F_s, atom->rho_s, &atom->gradF_s);
+          if (uf)
+            forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F_s, atom->rho_s, &atom->gradF_s);
+          else
+            forces[g_calc.energy_p + config_idx] += splint_fmt(&g_pot.calc_pot, xi, col_F_s, atom->rho_s);
         }
 #else // RESCALE
-        forces[g_calc.energy_p + config_idx] += g_splint_comb(&g_pot.calc_pot, xi, col_F_s, atom->rho_s, &atom->gradF_s);
+        if (uf)
+          forces[g_calc.energy_p + config_idx] += splint_comb_fmt(&g_pot.calc_pot, xi, col_F_s, atom->rho_s, &atom->gradF_s);
+        else
+          forces[g_calc.energy_p + config_idx] += splint_fmt(&g_pot.calc_pot, xi, col_F_s, atom->rho_s);
 #endif // RESCALE
 
         // sum up rho_s
@@ -428,46 +523,51 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
           atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] -
                   g_mpi.firstatom;
+          int atom_local = atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
           int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+          int first_n = soa->first[atom_local];
+          int num_n = soa->first[atom_local + 1] - first_n;
+
           // loop over all neighbors
-          for (int neigh_idx = 0; neigh_idx < atom->num_neigh; neigh_idx++) {
-            neigh_t* neigh = atom->neigh + neigh_idx;
+          for (int n = first_n; n < first_n + num_n; n++) {
             // In small cells, an atom might interact with itself
-            int self = (neigh->nr == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
+            int self = (soa->nr[n] == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
             // column of F
             int col_F = g_calc.paircol + g_param.ntypes + atom->type;
 #if defined(TBEAM)
             int col_F_s = col_F + 2 * g_param.ntypes;
 #endif  // TBEAM
-            double r = neigh->r;
+            double r = soa->r[n];
             // are we within reach?
-            if ((r < g_pot.calc_pot.end[neigh->col[1]]) || (r < g_pot.calc_pot.end[col_F - g_param.ntypes])) {
+            if ((r < g_pot.calc_pot.end[soa->col[1][n]]) || (r < g_pot.calc_pot.end[col_F - g_param.ntypes])) {
+              // the transfer gradient was already computed by the fused
+              // lookup in the density loop
               double rho_grad = 0.0;
-              if (r < g_pot.calc_pot.end[neigh->col[1]])
-                rho_grad = splint_grad_dir(&g_pot.calc_pot, xi, neigh->slot[1], neigh->shift[1], neigh->step[1]);
+              if (r < g_pot.calc_pot.end[soa->col[1][n]])
+                rho_grad = soa->rho_grad[n];
               // use actio = reactio
               double rho_grad_j = 0.0;
-              if (atom->type == neigh->type)
+              if (atom->type == soa->type[n])
                 rho_grad_j = rho_grad;
               else if (r < g_pot.calc_pot.end[col_F - g_param.ntypes])
-                rho_grad_j =  g_splint_grad(&g_pot.calc_pot, xi, col_F - g_param.ntypes, r);
+                rho_grad_j = splint_grad_dir(&g_pot.calc_pot, xi, soa->slot_rev[n], soa->shift_rev[n], soa->step_rev[n]);
               // now we know everything - calculate forces
-              double eam_force = (rho_grad * atom->gradF + rho_grad_j * g_config.conf_atoms[(neigh->nr) - g_mpi.firstatom] .gradF);
+              double eam_force = (rho_grad * atom->gradF + rho_grad_j * g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom] .gradF);
 
 #if defined(TBEAM)
               // s-band contribution to force for TBEAM
-              if ((r < g_pot.calc_pot.end[neigh->col[2]]) || (r < g_pot.calc_pot.end[col_F_s - g_param.ntypes])) {
+              if ((r < g_pot.calc_pot.end[soa->col[2][n]]) || (r < g_pot.calc_pot.end[col_F_s - g_param.ntypes])) {
                 double rho_s_grad = 0.0;
-                if (r < g_pot.calc_pot.end[neigh->col[2]])
-                  rho_s_grad = splint_grad_dir(&g_pot.calc_pot, xi, neigh->slot[2], neigh->shift[2], neigh->step[2]);
+                if (r < g_pot.calc_pot.end[soa->col[2][n]])
+                  rho_s_grad = splint_grad_dir(&g_pot.calc_pot, xi, soa->slot[2][n], soa->shift[2][n], soa->step[2][n]);
                 // use actio = reactio
                 double rho_s_grad_j = 0.0;
-                if (atom->type == neigh->type)
+                if (atom->type == soa->type[n])
                   rho_s_grad_j = rho_s_grad;
                 else if (r < g_pot.calc_pot.end[col_F_s - g_param.ntypes])
-                  rho_s_grad_j = g_splint_grad(&g_pot.calc_pot, xi, col_F_s - g_param.ntypes, r);
+                  rho_s_grad_j = splint_grad_dir(&g_pot.calc_pot, xi, soa->slot_rev_s[n], soa->shift_rev_s[n], soa->step_rev_s[n]);
                 // now we know everything - calculate forces
-                eam_force += (rho_s_grad * atom->gradF_s + rho_s_grad_j * g_config.conf_atoms[(neigh->nr) - g_mpi.firstatom] .gradF_s);
+                eam_force += (rho_s_grad * atom->gradF_s + rho_s_grad_j * g_config.conf_atoms[soa->nr[n] - g_mpi.firstatom] .gradF_s);
               }
 #endif  // TBEAM
 
@@ -475,25 +575,25 @@ double calc_forces(double* xi_opt, double* forces, int flag)
               if (self)
                 eam_force *= 0.5;
               vector tmp_force;
-              tmp_force.x = neigh->dist_r.x * eam_force;
-              tmp_force.y = neigh->dist_r.y * eam_force;
-              tmp_force.z = neigh->dist_r.z * eam_force;
+              tmp_force.x = soa->dist_r_x[n] * eam_force;
+              tmp_force.y = soa->dist_r_y[n] * eam_force;
+              tmp_force.z = soa->dist_r_z[n] * eam_force;
               forces[n_i + 0] += tmp_force.x;
               forces[n_i + 1] += tmp_force.y;
               forces[n_i + 2] += tmp_force.z;
               // actio = reactio
-              forces[3 * neigh->nr + 0] -= tmp_force.x;
-              forces[3 * neigh->nr + 1] -= tmp_force.y;
-              forces[3 * neigh->nr + 2] -= tmp_force.z;
+              forces[3 * soa->nr[n] + 0] -= tmp_force.x;
+              forces[3 * soa->nr[n] + 1] -= tmp_force.y;
+              forces[3 * soa->nr[n] + 2] -= tmp_force.z;
 #if defined(STRESS)
               // and stresses
               if (us) {
-                forces[stress_idx + 0] -= neigh->dist.x * tmp_force.x;
-                forces[stress_idx + 1] -= neigh->dist.y * tmp_force.y;
-                forces[stress_idx + 2] -= neigh->dist.z * tmp_force.z;
-                forces[stress_idx + 3] -= neigh->dist.x * tmp_force.y;
-                forces[stress_idx + 4] -= neigh->dist.y * tmp_force.z;
-                forces[stress_idx + 5] -= neigh->dist.z * tmp_force.x;
+                forces[stress_idx + 0] -= soa->dist_x[n] * tmp_force.x;
+                forces[stress_idx + 1] -= soa->dist_y[n] * tmp_force.y;
+                forces[stress_idx + 2] -= soa->dist_z[n] * tmp_force.z;
+                forces[stress_idx + 3] -= soa->dist_x[n] * tmp_force.y;
+                forces[stress_idx + 4] -= soa->dist_y[n] * tmp_force.z;
+                forces[stress_idx + 5] -= soa->dist_z[n] * tmp_force.x;
               }
 #endif          // STRESS
             } // within reach
@@ -534,8 +634,30 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       // limiting constraints per configuration
       error_sum += g_config.conf_weight[config_idx] * dsquare(forces[g_calc.limit_p + config_idx]);
 #endif  // RESCALE
+
+      // refresh the cache entry of this configuration
+      force_cache_store(config_idx, forces, error_sum - error_start);
+      if (g_force_cache.enabled) {
+        g_force_cache.rho_part[config_idx] = rho_sum - rho_start;
+#if defined(TBEAM)
+        g_force_cache.rho_s_part[config_idx] = rho_s_sum - rho_s_start;
+#endif  // TBEAM
+      }
+
+      // fold the contribution into the importance index
+      conf_index_update(config_idx, error_sum - error_start);
+
+#if !defined(OPENMP)
+      // an armed abort cutoff rejects the trial as soon as the
+      // partial error sum exceeds it
+      if (force_abort_check(config_idx, error_sum - error_start, error_sum))
+        break;
+#endif  // !OPENMP
     } // loop over configurations
 
+    force_cache_commit(xi_opt);
+    conf_index_advance();
+
     // dummy constraints (global)
 #if defined(APOT)
     // add punishment for out of bounds (mostly for powell_lsq)
@@ -557,21 +679,21 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         // clear field
         forces[g_calc.dummy_p + g_param.ntypes + g] = 0.0; // Free end ...
         // NEW: Constraint on U': U'(1.0)=0.0;
-        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 1.0);
+        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 1.0);
 #if defined(TBEAM)
         // clear field
         forces[g_calc.dummy_p + 3 * g_param.ntypes + g] = 0.0; // Free end ...
         // NEW: Constraint on U': U'(1.0)=0.0;
-        forces[g_calc.dummy_p + 2 * g_param.ntypes + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + 3 * g_param.ntypes + g, 1.0);
+        forces[g_calc.dummy_p + 2 * g_param.ntypes + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + 3 * g_param.ntypes + g, 1.0);
 #endif  // TBEAM
 #else   // !RESCALE
         forces[g_calc.dummy_p + g_param.ntypes + g] = 0.0; // Free end ...
         // constraints on U`(n)
-        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 0.5 * (g_pot.calc_pot .begin[g_calc.paircol + g_param.ntypes + g] + g_pot.calc_pot .end[g_calc.paircol + g_param.ntypes + g])) - g_config.force_0[g_calc.dummy_p + g];
+        forces[g_calc.dummy_p + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + g_param.ntypes + g, 0.5 * (g_pot.calc_pot .begin[g_calc.paircol + g_param.ntypes + g] + g_pot.calc_pot .end[g_calc.paircol + g_param.ntypes + g])) - g_config.force_0[g_calc.dummy_p + g];
 #if defined(TBEAM)
         forces[g_calc.dummy_p + 3 * g_param.ntypes + g] = 0.0; // Free end ...
         // constraints on U`(n)
-        forces[g_calc.dummy_p + 2 * g_param.ntypes + g] = DUMMY_WEIGHT * g_splint_grad(&g_pot.calc_pot, xi, g_calc.paircol + 3 * g_param.ntypes + g, 0.5 * (g_pot.calc_pot .begin[g_calc.paircol + 3 * g_param.ntypes + g] + g_pot.calc_pot .end[g_calc.paircol + 3 * g_param.ntypes + g])) - g_config.force_0[g_calc.dummy_p + 2 * g_param.ntypes + g];
+        forces[g_calc.dummy_p + 2 * g_param.ntypes + g] = DUMMY_WEIGHT * splint_grad_fmt(&g_pot.calc_pot, xi, g_calc.paircol + 3 * g_param.ntypes + g, 0.5 * (g_pot.calc_pot .begin[g_calc.paircol + 3 * g_param.ntypes + g] + g_pot.calc_pot .end[g_calc.paircol + 3 * g_param.ntypes + g])) - g_config.force_0[g_calc.dummy_p + 2 * g_param.ntypes + g];
 #endif  // TBEAM
 #endif  // !RESCALE
 
@@ -585,10 +707,22 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       } // loop over types
 
 #if !defined(RESCALE)
+      // with a mini-batch selected only the evaluated atoms entered
+      // rho_sum
+      int eval_atoms = g_config.natoms;
+
+      if (g_force_batch.active) {
+        eval_atoms = 0;
+
+        for (int i = 0; i < g_config.nconf; i++)
+          if (g_force_batch.in_batch[i])
+            eval_atoms += g_config.inconf[i];
+      }
+
       // NEW: Constraint on n: <n>=1.0 ONE CONSTRAINT ONLY
       if (rho_sum > 0.0) {
         // Calculate averages
-        rho_sum /= (double)g_config.natoms;
+        rho_sum /= (double)eval_atoms;
         // ATTN: if there are invariant potentials, things might be problematic
         forces[g_calc.dummy_p + g_param.ntypes] = DUMMY_WEIGHT * (rho_sum - 1.0);
         error_sum += dsquare(forces[g_calc.dummy_p + g_param.ntypes]);
@@ -596,7 +730,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #if defined(TBEAM)
       if (rho_s_sum > 0.0) {
         // Calculate averages
-        rho_s_sum /= (double)g_config.natoms;
+        rho_s_sum /= (double)eval_atoms;
         // ATTN: if there are invariant potentials, things might be problematic
         forces[g_calc.dummy_p + 3 * g_param.ntypes] = DUMMY_WEIGHT * (rho_s_sum - 1.0);
         error_sum += dsquare(forces[g_calc.dummy_p + 3 * g_param.ntypes]);
@@ -617,8 +751,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         printf("\n--> Force is nan! <--\n\n");
 #endif  // DEBUG
         return 10e10;
-      } else
+      } else {
+        // remember this evaluation for exact repeats
+        eval_memo_store(xi_opt, forces, error_sum);
         return error_sum;
+      }
     }
   } // end of infinite loop
 
@@ -37,6 +37,9 @@
 #include "force.h"
 #include "functions.h"
 #include "memory.h"
+#if defined(MPI)
+#include "mpi_utils.h"
+#endif
 #include "potential_input.h"
 #include "potential_output.h"
 #include "splines.h"
@@ -159,18 +162,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // APOT && !MPI
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // !APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     if (g_pot.format_type == POTENTIAL_FORMAT_ANALYTIC)
       update_calc_table(xi_opt, xi, 0);
 #else   // APOT
@@ -248,6 +251,12 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     g_mpi.myconf = g_config.nconf;
 #endif  // MPI
 
+    /* with variing kappa the cached tail tables are refreshed once
+       per evaluation - and only when the optimizer actually moved
+       kappa - instead of per neighbor */
+    if (!apt->sw_kappa)
+      update_tails(dp_kappa);
+
     /* region containing loop over configurations,
        also OMP-parallelized region */
     {
@@ -269,7 +278,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       for (h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
         uf = g_config.conf_uf[h - g_mpi.firstconf];
 #if defined(STRESS)
-        us = g_config.conf_us[h - g_mpi.firstconf];
+        us = (g_param.sweight != 0) ? g_config.conf_us[h - g_mpi.firstconf] : 0;
 #endif  // STRESS
         /* reset energies and stresses */
         forces[g_calc.energy_p + h] = 0.0;
@@ -319,15 +328,6 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             type2 = neigh->type;
             col = neigh->col[0];
 
-            /* updating tail-functions - only necessary with variing kappa */
-            if (!apt->sw_kappa)
-#if defined(DSF)
-           elstat_dsf(neigh->r, dp_kappa, &neigh->fnval_el,
-                            &neigh->grad_el, &neigh->ggrad_el);
-#else
-           elstat_shift(neigh->r, dp_kappa, &neigh->fnval_el,
-                           &neigh->grad_el, &neigh->ggrad_el);
-#endif // DSF
             /* In small cells, an atom might interact with itself */
             self = (neigh->nr == i + g_config.cnfstart[h]) ? 1 : 0;
 
@@ -886,37 +886,37 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #if defined(MPI)
     /* reduce global sum */
     sum = 0.0;
-    MPI_Reduce(&tmpsum, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&tmpsum, &sum, 1, MPI_DOUBLE, MPI_SUM, 0, g_mpi.comm);
     /* gather forces, energies, stresses */
     if (g_mpi.myid == 0) { /* root node already has data in place */
       /* forces */
       MPI_Gatherv(MPI_IN_PLACE, g_mpi.myatoms, g_mpi.MPI_VECTOR, forces,
                   g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
-                  MPI_COMM_WORLD);
+                  g_mpi.comm);
       /* energies */
       MPI_Gatherv(MPI_IN_PLACE, g_mpi.myconf, MPI_DOUBLE,
                   forces + g_calc.energy_p, g_mpi.conf_len, g_mpi.conf_dist,
-                  MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                  MPI_DOUBLE, 0, g_mpi.comm);
 #if defined(STRESS)
       /* stresses */
       MPI_Gatherv(MPI_IN_PLACE, g_mpi.myconf, g_mpi.MPI_STENS,
                   forces + g_calc.stress_p, g_mpi.conf_len, g_mpi.conf_dist,
-                  g_mpi.MPI_STENS, 0, MPI_COMM_WORLD);
+                  g_mpi.MPI_STENS, 0, g_mpi.comm);
 #endif  // STRESS
     } else {
       /* forces */
       MPI_Gatherv(forces + g_mpi.firstatom * 3, g_mpi.myatoms, g_mpi.MPI_VECTOR,
                   forces, g_mpi.atom_len, g_mpi.atom_dist, g_mpi.MPI_VECTOR, 0,
-                  MPI_COMM_WORLD);
+                  g_mpi.comm);
       /* energies */
       MPI_Gatherv(forces + g_calc.energy_p + g_mpi.firstconf, g_mpi.myconf,
                   MPI_DOUBLE, forces + g_calc.energy_p, g_mpi.conf_len,
-                  g_mpi.conf_dist, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                  g_mpi.conf_dist, MPI_DOUBLE, 0, g_mpi.comm);
 #if defined(STRESS)
       /* stresses */
       MPI_Gatherv(forces + g_calc.stress_p + 6 * g_mpi.firstconf, g_mpi.myconf,
                   g_mpi.MPI_STENS, forces + g_calc.stress_p, g_mpi.conf_len,
-                  g_mpi.conf_dist, g_mpi.MPI_STENS, 0, MPI_COMM_WORLD);
+                  g_mpi.conf_dist, g_mpi.MPI_STENS, 0, g_mpi.comm);
 #endif  // STRESS
     }
 #else
@@ -0,0 +1,397 @@
+/****************************************************************
+ *
+ * force_jacobian.c: Analytic jacobian of the force vector for
+ *      analytic pair potentials
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "config.h"
+#include "force_jacobian.h"
+#include "functions.h"
+#include "memory.h"
+#include "splines.h"
+#include "utils.h"
+
+/* the jacobian is only wired into the pair force routine and needs
+   the complete force vector on a single process */
+
+#if defined(APOT) && defined(PAIR) && !defined(COULOMB) && !defined(MPI) && \
+    !defined(KIM)
+#define APOT_JACOBIAN_AVAILABLE
+#endif
+
+#if defined(APOT_JACOBIAN_AVAILABLE)
+
+// finite difference step for the punishment terms and for potential
+// functions without a registered parameter gradient, relative to the
+// allowed range of the parameter
+#define APOT_JAC_EPS 1.0e-6
+
+// derivative tables, one per optimizable parameter: the sampled
+// d(phi)/d(param) on the calc_pot grid and its spline coefficients
+static double** g_jac_dtab;
+static double** g_jac_d2tab;
+static int* g_jac_col_begin; // first free parameter of each column
+static int* g_jac_col_end;   // one past the last free parameter
+
+/****************************************************************
+  apot_cutoff_h_grad
+    derivative of the cutoff function with respect to the cutoff
+    parameter h
+****************************************************************/
+
+static double apot_cutoff_h_grad(const double r, const double r0,
+                                 const double h)
+{
+  if ((r - r0) >= 0)
+    return 0.0;
+
+  double val = (r - r0) / h;
+  val *= val;
+  val *= val;
+
+  return -4.0 * val / (h * (1.0 + val) * (1.0 + val));
+}
+
+/****************************************************************
+  jacobian_fd_step
+    finite difference step for the i-th free parameter
+****************************************************************/
+
+static double jacobian_fd_step(int i)
+{
+  double range =
+      g_pot.apot_table
+          .pmax[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]] -
+      g_pot.apot_table
+          .pmin[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
+
+  return APOT_JAC_EPS * (range > 0.0 ? range : 1.0);
+}
+
+/****************************************************************
+  jacobian_build_tables
+    sample d(phi)/d(param) on the calc_pot grid for all free
+    parameters and initialize the spline coefficients
+****************************************************************/
+
+static void jacobian_build_tables(double* xi_opt)
+{
+  if (g_jac_dtab == NULL) {
+    g_jac_dtab = mat_double(g_calc.ndim, APOT_STEPS);
+    g_jac_d2tab = mat_double(g_calc.ndim, APOT_STEPS);
+    g_jac_col_begin = (int*)Malloc(g_pot.apot_table.number * sizeof(int));
+    g_jac_col_end = (int*)Malloc(g_pot.apot_table.number * sizeof(int));
+  }
+
+  int max_par = 0;
+  for (int c = 0; c < g_pot.apot_table.number; c++)
+    max_par = MAX(max_par, g_pot.apot_table.n_par[c]);
+
+  double gtmp[max_par];
+  double ptmp[max_par];
+  double base[APOT_STEPS];
+
+  // the free parameters are ordered by potential column
+  int i0 = 0;
+
+  for (int c = 0; c < g_pot.apot_table.number; c++) {
+    g_jac_col_begin[c] = i0;
+
+    int i1 = i0;
+    while (i1 < g_calc.ndim && g_pot.apot_table.idxpot[i1] == c)
+      i1++;
+    g_jac_col_end[c] = i1;
+
+    if (i1 == i0)
+      continue;
+
+    double* pval = xi_opt + g_pot.opt_pot.first[c];
+    int n_par = g_pot.apot_table.n_par[c];
+    int smooth = g_pot.smooth_pot[c];
+    double h = smooth ? pval[n_par - 1] : 0.0;
+    int first = g_pot.calc_pot.first[c];
+
+    if (g_pot.apot_table.gvalue[c] != NULL) {
+      // closed form gradient; the cutoff function factors out and the
+      // cutoff parameter itself only sees the derivative of the cutoff
+      for (int j = 0; j < APOT_STEPS; j++) {
+        double r = g_pot.calc_pot.xcoord[first + j];
+        double cut = 1.0;
+        double dcut = 0.0;
+        double f = 0.0;
+
+        g_pot.apot_table.gvalue[c](r, pval, gtmp);
+
+        if (smooth) {
+          cut = apot_cutoff(r, g_pot.apot_table.end[c], h);
+          dcut = apot_cutoff_h_grad(r, g_pot.apot_table.end[c], h);
+          g_pot.apot_table.fvalue[c](r, pval, &f);
+        }
+
+        for (int i = i0; i < i1; i++) {
+          int k = g_pot.apot_table.idxparam[i];
+          g_jac_dtab[i][j] =
+              (smooth && k == n_par - 1) ? f * dcut : gtmp[k] * cut;
+        }
+      }
+    } else {
+      // no gradient registered, fall back to a finite difference on
+      // the sampled column - still no force evaluation involved
+      for (int j = 0; j < APOT_STEPS; j++) {
+        double r = g_pot.calc_pot.xcoord[first + j];
+        double f = 0.0;
+        g_pot.apot_table.fvalue[c](r, pval, &f);
+        base[j] = smooth ? f * apot_cutoff(r, g_pot.apot_table.end[c], h) : f;
+      }
+
+      for (int i = i0; i < i1; i++) {
+        int k = g_pot.apot_table.idxparam[i];
+        double step = jacobian_fd_step(i);
+
+        memcpy(ptmp, pval, n_par * sizeof(double));
+        ptmp[k] += step;
+
+        double hp = smooth ? ptmp[n_par - 1] : 0.0;
+
+        for (int j = 0; j < APOT_STEPS; j++) {
+          double r = g_pot.calc_pot.xcoord[first + j];
+          double f = 0.0;
+          g_pot.apot_table.fvalue[c](r, ptmp, &f);
+          if (smooth)
+            f *= apot_cutoff(r, g_pot.apot_table.end[c], hp);
+          g_jac_dtab[i][j] = (f - base[j]) / step;
+        }
+      }
+    }
+
+    // same boundary conditions as update_splines uses for the calc
+    // table: natural spline at rmin, zero gradient at the cutoff
+    for (int i = i0; i < i1; i++)
+      spline_ed(g_pot.calc_pot.step[c], g_jac_dtab[i], APOT_STEPS, 10e30, 0.0,
+                g_jac_d2tab[i]);
+
+    i0 = i1;
+  }
+}
+
+#endif  // APOT_JACOBIAN_AVAILABLE
+
+/****************************************************************
+  apot_jacobian_available
+    check whether the jacobian can be computed for the current setup
+****************************************************************/
+
+int apot_jacobian_available(void)
+{
+#if defined(APOT_JACOBIAN_AVAILABLE)
+  if (g_pot.format_type != POTENTIAL_FORMAT_ANALYTIC)
+    return 0;
+
+  // global parameters modify several columns at once and the chemical
+  // potentials enter the energies directly, both would need extra
+  // bookkeeping here
+  if (g_pot.have_globals || g_param.enable_cp)
+    return 0;
+
+  // all free parameters have to belong to a pair potential column
+  for (int i = 0; i < g_calc.ndim; i++)
+    if (g_pot.apot_table.idxpot[i] >= g_calc.paircol)
+      return 0;
+
+  return 1;
+#else
+  return 0;
+#endif  // APOT_JACOBIAN_AVAILABLE
+}
+
+/****************************************************************
+  apot_jacobian
+    fill gamma[j][i] with d(forces[j])/d(parameter i) using one
+    pass of the pair force kernel over the derivative tables
+****************************************************************/
+
+void apot_jacobian(double* xi_opt, double** gamma)
+{
+#if defined(APOT_JACOBIAN_AVAILABLE)
+  jacobian_build_tables(xi_opt);
+
+  for (int j = 0; j < g_calc.mdim; j++)
+    memset(gamma[j], 0, g_calc.ndim * sizeof(double));
+
+  const neigh_soa_t* soa = &g_config.neigh_soa;
+
+  // loop over configurations, same traversal as calc_forces
+  for (int config_idx = 0; config_idx < g_config.nconf; config_idx++) {
+    // with file-backed neighbor data fetch the next block now
+    config_stream_prefetch(config_idx);
+
+    int uf = g_config.conf_uf[config_idx];
+#if defined(STRESS)
+    int us =
+        (g_param.sweight != 0) ? g_config.conf_us[config_idx] : 0;
+    int stress_idx = g_calc.stress_p + 6 * config_idx;
+#endif  // STRESS
+
+    for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
+      int atom_local = atom_idx + g_config.cnfstart[config_idx];
+      int n_i = 3 * atom_local;
+      int first_n = soa->first[atom_local];
+      int num_n = soa->first[atom_local + 1] - first_n;
+
+      for (int n = first_n; n < first_n + num_n; n++) {
+        int col = soa->col[0][n];
+
+        if (soa->r[n] >= g_pot.calc_pot.end[col])
+          continue;
+
+        // In small cells, an atom might interact with itself
+        int self = (soa->nr[n] == atom_local) ? 1 : 0;
+
+        int k = soa->slot[0][n] - g_pot.calc_pot.first[col];
+        double b = soa->shift[0][n];
+        double step = soa->step[0][n];
+        double a = 1.0 - b;
+
+        // spline interpolation weights, see splint_comb_dir
+        double wa = (a * a * a - a) * (step * step) / 6.0;
+        double wb = (b * b * b - b) * (step * step) / 6.0;
+        double ga = (3 * (a * a) - 1) * step / 6.0;
+        double gb = (3 * (b * b) - 1) * step / 6.0;
+
+        int n_j = 3 * soa->nr[n];
+
+        for (int i = g_jac_col_begin[col]; i < g_jac_col_end[col]; i++) {
+          double p1 = g_jac_dtab[i][k];
+          double p2 = g_jac_dtab[i][k + 1];
+          double d21 = g_jac_d2tab[i][k];
+          double d22 = g_jac_d2tab[i][k + 1];
+
+          double val = a * p1 + b * p2 + wa * d21 + wb * d22;
+
+          // avoid double counting if atom is interacting with itself
+          if (self)
+            val *= 0.5;
+
+          gamma[g_calc.energy_p + config_idx][i] += val;
+
+          if (uf) {
+            double grad = (p2 - p1) / step + gb * d22 - ga * d21;
+
+            if (self)
+              grad *= 0.5;
+
+            double tmp_x = soa->dist_r_x[n] * grad;
+            double tmp_y = soa->dist_r_y[n] * grad;
+            double tmp_z = soa->dist_r_z[n] * grad;
+
+            gamma[n_i + 0][i] += tmp_x;
+            gamma[n_i + 1][i] += tmp_y;
+            gamma[n_i + 2][i] += tmp_z;
+            // actio = reactio
+            gamma[n_j + 0][i] -= tmp_x;
+            gamma[n_j + 1][i] -= tmp_y;
+            gamma[n_j + 2][i] -= tmp_z;
+#if defined(STRESS)
+            if (us) {
+              gamma[stress_idx + 0][i] -= soa->dist_x[n] * tmp_x;
+              gamma[stress_idx + 1][i] -= soa->dist_y[n] * tmp_y;
+              gamma[stress_idx + 2][i] -= soa->dist_z[n] * tmp_z;
+              gamma[stress_idx + 3][i] -= soa->dist_x[n] * tmp_y;
+              gamma[stress_idx + 4][i] -= soa->dist_y[n] * tmp_z;
+              gamma[stress_idx + 5][i] -= soa->dist_z[n] * tmp_x;
+            }
+#endif  // STRESS
+          }
+        }
+      } // loop over neighbors
+    }   // loop over atoms
+
+#if defined(FWEIGHT)
+    // apply the same weights calc_forces applies to the force vector
+    if (uf) {
+      for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
+        atom_t* atom =
+            g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx];
+        double weight = FORCE_EPS + atom->absforce;
+        int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+
+        for (int i = 0; i < g_calc.ndim; i++) {
+          gamma[n_i + 0][i] /= weight;
+          gamma[n_i + 1][i] /= weight;
+          gamma[n_i + 2][i] /= weight;
+        }
+      }
+    }
+#endif  // FWEIGHT
+
+    // energy per atom
+    for (int i = 0; i < g_calc.ndim; i++)
+      gamma[g_calc.energy_p + config_idx][i] /=
+          (double)g_config.inconf[config_idx];
+
+#if defined(STRESS)
+    if (uf && us) {
+      for (int j = 0; j < 6; j++)
+        for (int i = 0; i < g_calc.ndim; i++)
+          gamma[stress_idx + j][i] /= g_config.conf_vol[config_idx];
+    }
+#endif  // STRESS
+  } // loop over configurations
+
+  // the punishment terms are cheap direct functions of the parameters,
+  // a finite difference on them involves no force evaluation
+  static double* punish_base;
+  static double* punish_pert;
+
+  if (punish_base == NULL) {
+    punish_base = (double*)Malloc(g_calc.mdim * sizeof(double));
+    punish_pert = (double*)Malloc(g_calc.mdim * sizeof(double));
+  }
+
+  int punish_len = g_calc.mdim - g_calc.punish_par_p;
+
+  memset(punish_base + g_calc.punish_par_p, 0, punish_len * sizeof(double));
+  apot_punish(xi_opt, punish_base);
+
+  for (int i = 0; i < g_calc.ndim; i++) {
+    double step = jacobian_fd_step(i);
+    double store = xi_opt[g_pot.opt_pot.idx[i]];
+
+    xi_opt[g_pot.opt_pot.idx[i]] += step;
+
+    memset(punish_pert + g_calc.punish_par_p, 0, punish_len * sizeof(double));
+    apot_punish(xi_opt, punish_pert);
+
+    xi_opt[g_pot.opt_pot.idx[i]] = store;
+
+    for (int j = g_calc.punish_par_p; j < g_calc.mdim; j++)
+      gamma[j][i] = (punish_pert[j] - punish_base[j]) / step;
+  }
+#endif  // APOT_JACOBIAN_AVAILABLE
+}
@@ -0,0 +1,57 @@
+/****************************************************************
+ *
+ * force_jacobian.h: potfit analytic force jacobian header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef FORCE_JACOBIAN_H_INCLUDED
+#define FORCE_JACOBIAN_H_INCLUDED
+
+/****************************************************************
+ *
+ *  For analytic pair potentials the force vector depends on the
+ *  parameters only through the tabulated potential columns, and the
+ *  spline interpolation is linear in the table values. The derivative
+ *  of the force vector with respect to one parameter is therefore a
+ *  single pass of the pair force kernel over the derivative table
+ *  d(phi)/d(param), sampled on the same grid. One such pass per
+ *  parameter replaces the ndim full force evaluations powell_lsq
+ *  needs to build its gamma matrix by finite differences.
+ *
+ *  The derivative tables come from the closed form parameter
+ *  gradients registered in functions.c; potentials without one fall
+ *  back to a finite difference on the sampled column, which is still
+ *  far cheaper than a full force call.
+ *
+ ****************************************************************/
+
+// check whether the jacobian can be computed for the current setup
+int apot_jacobian_available(void);
+
+// fill gamma[j][i] with d(forces[j])/d(parameter i)
+void apot_jacobian(double* xi_opt, double** gamma);
+
+#endif  // FORCE_JACOBIAN_H_INCLUDED
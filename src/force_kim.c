@@ -54,9 +54,10 @@ void update_kim_model(double *xi_opt)
 {
   int res = 0;
 
-  // set new parameters
+  // push only parameters which changed since the last evaluation
 
   int pos = 0;
+  int num_changed = 0;
 
   for (int i = 0; i < g_kim.nparams; ++i) {
     for (int j = 0; j < g_kim.params[i].extent; ++j) {
@@ -67,11 +68,19 @@ void update_kim_model(double *xi_opt)
         res = KIM_Model_SetParameterDouble(g_kim.model, i, j, xi_opt[pos]);
         if (res)
           error(1, "Error updating KIM model parameter (%d. %d): %d\n", i, j, res);
+        g_kim.params[i].values[j].d = xi_opt[pos];
+        ++num_changed;
       }
       ++pos;
     }
   }
 
+  // with no changed parameter the model state from the previous
+  // evaluation is still valid and the refresh can be skipped entirely
+
+  if (num_changed == 0)
+    return;
+
   // refresh the model - should recalculate internal data structures if necessary
 
   res = KIM_Model_ClearThenRefresh(g_kim.model);
@@ -175,31 +184,28 @@ double calc_forces(double *xi_opt, double *forces, int flag)
 
     // loop over configurations
     for (int h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
-      double kim_energy = 0.0;
-      int ret = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[h], KIM_COMPUTE_ARGUMENT_NAME_partialEnergy, &kim_energy);
-      if (ret)
-        error(1, "Error setting energy pointer\n");
+      // deferred from startup: bind the compute-argument object for this
+      // configuration the first time this rank evaluates it
+      if (!g_kim.arguments || !g_kim.arguments[h])
+        init_kim_compute_arguments(h);
 
       double* kim_forces = g_kim.helpers[h].forces;
       int uf = g_config.conf_uf[h - g_mpi.firstconf];
-      // forces pointer has already been set when setting up the compute argument
+      // energy, forces and virial pointers have already been set when
+      // setting up the compute argument
 
 #if defined(STRESS)
-      double virial[6] = {0};
-      int us = g_config.conf_us[h - g_mpi.firstconf];
-      if (us) {
-        int ret = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[h], KIM_COMPUTE_ARGUMENT_NAME_partialVirial, virial);
-        if (ret)
-          error(1, "Error setting virial pointer\n");
-      }
+      int us = (g_param.sweight != 0) ? g_config.conf_us[h - g_mpi.firstconf] : 0;
 #endif // STRESS
 
       // Calculate forces from KIM (general forces, including forces, virial and energy)
 
-      ret = KIM_Model_Compute(g_kim.model, g_kim.arguments[h]);
+      int ret = KIM_Model_Compute(g_kim.model, g_kim.arguments[h]);
       if (ret)
         error(1, "Error calling KIM_Model_Compute\n");
 
+      double kim_energy = g_kim.helpers[h].energy;
+
       // forces contributation
       double weight = sqrt(g_config.conf_weight[h]);
 
@@ -258,7 +264,7 @@ double calc_forces(double *xi_opt, double *forces, int flag)
       if (uf && us) {
         weight = sqrt(g_config.conf_weight[h] * g_param.sweight);
         for (int i = 0; i < 6; i++) {
-          forces[stresses_offset + i]  = weight * virial[i];
+          forces[stresses_offset + i]  = weight * g_kim.helpers[h].virial[i];
           forces[stresses_offset + i] /= g_config.conf_vol[h - g_mpi.firstconf];
           forces[stresses_offset + i] -= weight*g_config.force_0[stresses_offset + i];
           error_sum += dsquare(forces[stresses_offset + i]);
@@ -44,6 +44,7 @@
 #endif
 #include "potential_input.h"
 #include "potential_output.h"
+#include "rescale.h"
 #include "splines.h"
 #include "utils.h"
 
@@ -115,7 +116,7 @@ void init_force(int is_worker)
 
 double calc_forces(double* xi_opt, double* forces, int flag)
 {
-  int first, col, i = flag;
+  int i = flag;
   double* xi = NULL;
 
   /* Some useful temp variables */
@@ -185,18 +186,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // APOT && !MPI
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (1 == flag)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else
     /* if flag==2 then the potential parameters have changed -> sync */
@@ -211,22 +212,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
        where paircol is number of pair potential columns
        and g_param.ntypes is number of rho columns
        and g_param.ntypes is number of F columns */
-    for (col = 0; col < 2 * g_calc.paircol + 3 * g_param.ntypes; col++) {
-      /* Pointer to first entry */
-      first = g_pot.calc_pot.first[col];
-
-      /* Initialize 2nd derivatives
-         step = width of spline knots (known as h)
-         xi+first = array with spline values
-         g_pot.calc_pot.last[col1] - first + 1 = num of spline pts
-         *(xi + first - 2) = value of endpoint gradient (default: 1e30)
-         *(xi + first - 1) = value of other endpoint gradient
-         (default: phi=0.0, rho=0.0, F=1e30)
-         g_pot.calc_pot.d2tab + first = array to hold 2nd deriv */
-      spline_ed(g_pot.calc_pot.step[col], xi + first,
-                g_pot.calc_pot.last[col] - first + 1, *(xi + first - 2),
-                *(xi + first - 1), g_pot.calc_pot.d2tab + first);
-    }
+    update_splines(xi, 0, 2 * g_calc.paircol + 3 * g_param.ntypes, 3);
 
 #if !defined(MPI)
     g_mpi.myconf = g_config.nconf;
@@ -238,7 +224,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       for (h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
         uf = g_config.conf_uf[h - g_mpi.firstconf];
 #if defined(STRESS)
-        us = g_config.conf_us[h - g_mpi.firstconf];
+        us = (g_param.sweight != 0) ? g_config.conf_us[h - g_mpi.firstconf] : 0;
 #endif  // STRESS
         /* Reset energies */
         forces[g_calc.energy_p + h] = 0.0;
@@ -252,6 +238,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         /* Set limiting constraints */
         forces[g_calc.limit_p + h] = -g_config.force_0[g_calc.limit_p + h];
 
+#if defined(RESCALE) && !defined(MPI)
+        /* Fresh rho bounds for this configuration */
+        rescale_track_start(h);
+#endif  // RESCALE && !MPI
+
         /* FIRST LOOP: Reset forces and densities for each atom */
         for (i = 0; i < g_config.inconf[h]; i++) {
           /* Skip every 3 spots in force array starting from position of first
@@ -397,6 +388,30 @@ double calc_forces(double* xi_opt, double* forces, int flag)
              N(N-1)/2 possible combinations
              Used in computing angular part g_ijk */
 
+          /* Evaluate g and g' for all triples of this atom in one
+             batched spline call; the interpolation geometry was packed
+             once at startup since cos(theta) never changes.
+             The cos(theta) should always lie inside -1 ... 1
+             So store the g and g' without checking bounds */
+          {
+            const neigh_soa_t* soa = &g_config.neigh_soa;
+            int atom_local = g_config.cnfstart[h] - g_mpi.firstatom + i;
+            int first_a = soa->ang_first[atom_local];
+            int num_a = soa->ang_first[atom_local + 1] - first_a;
+            double g_tab[max(num_a, 1)];
+            double dg_tab[max(num_a, 1)];
+
+            splint_comb_dir_batch(&g_pot.calc_pot, xi, num_a,
+                                  soa->ang_slot + first_a,
+                                  soa->ang_shift + first_a,
+                                  soa->ang_step + first_a, g_tab, dg_tab);
+
+            for (j = 0; j < num_a; j++) {
+              atom->angle_part[j].g = g_tab[j];
+              atom->angle_part[j].dg = dg_tab[j];
+            }
+          }
+
           /* set angl pointer to angl_part of current atom */
           angle = atom->angle_part;
 
@@ -408,11 +423,6 @@ double calc_forces(double* xi_opt, double* forces, int flag)
               /* Get pointer to neighbor kk */
               neigh_k = atom->neigh + k;
 
-              /* The cos(theta) should always lie inside -1 ... 1
-                 So store the g and g' without checking bounds */
-              angle->g = splint_comb_dir(&g_pot.calc_pot, xi, angle->slot,
-                                         angle->shift, angle->step, &angle->dg);
-
               /* Sum up rho piece for atom i caused by j and k
                  f_ij * f_ik * m_ijk */
               atom->rho += neigh_j->f * neigh_k->f * angle->g;
@@ -426,6 +436,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           col_F = g_calc.paircol + g_param.ntypes + atom->type;
 
 #if defined(RESCALE)
+#if !defined(MPI)
+          /* Record the unclamped density for the incremental rescale check */
+          rescale_track_atom(h, atom->type, atom->rho);
+#endif  // !MPI
+
           /* Compute energy, gradient for embedding function F
              Check if rho lies short of inner cutoff of F(rho) */
           if (atom->rho < g_pot.calc_pot.begin[col_F]) {
@@ -450,7 +465,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
           }
           /* Compute energy piece from F, and store the gradient for later use
            */
-          forces[g_calc.energy_p + h] += (*g_splint_comb)(
+          forces[g_calc.energy_p + h] += splint_comb_fmt(
               &g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
 
 #else
@@ -469,7 +484,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             /* Linear extrapolate values to left to get F_i(rho)
                This gets value and grad of initial spline point */
             rho_val =
-                (*g_splint_comb)(&g_pot.calc_pot, xi, col_F,
+                splint_comb_fmt(&g_pot.calc_pot, xi, col_F,
                                  g_pot.calc_pot.begin[col_F], &atom->gradF);
 
             /* Sum this to the total energy for this configuration
@@ -491,7 +506,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #else
             /* Get value and grad at 1/2 the width from the final spline point
              */
-            rho_val = (*g_splint_comb)(
+            rho_val = splint_comb_fmt(
                 &g_pot.calc_pot, xi, col_F,
                 g_pot.calc_pot.end[col_F] - 0.5 * g_pot.calc_pot.step[col_F],
                 &atom->gradF);
@@ -513,7 +528,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             } else
 #endif
               /* Get energy value from within spline and store the grad */
-              forces[g_calc.energy_p + h] += (*g_splint_comb)(
+              forces[g_calc.energy_p + h] += splint_comb_fmt(
                   &g_pot.calc_pot, xi, col_F, atom->rho, &atom->gradF);
           }
 #endif  // RESCALE
@@ -723,7 +738,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     /* Reduce the rho_sum into root node */
     double rho_sum_temp = 0.0;
     MPI_Reduce(&rho_sum, &rho_sum_temp, 1, MPI_DOUBLE, MPI_SUM, 0,
-               MPI_COMM_WORLD);
+               g_mpi.comm);
     if (g_mpi.myid == 0)
       rho_sum = rho_sum_temp;
 #endif  // MPI
@@ -34,10 +34,17 @@
 #include "potfit.h"
 
 #include "chempot.h"
+#include "conf_index.h"
+#include "config.h"
+#include "eval_float.h"
+#include "eval_memo.h"
 #if defined(MPI)
 #include "mpi_utils.h"
 #endif
 #include "force.h"
+#include "force_abort.h"
+#include "force_batch.h"
+#include "force_cache.h"
 #include "functions.h"
 #include "potential_input.h"
 #include "splines.h"
@@ -139,19 +146,26 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     }
 #endif  // APOT && !MPI
 
+#if !defined(MPI)
+    // exact repeats of a recent parameter vector are served from the
+    // memo cache without touching a single configuration
+    if (eval_memo_lookup(xi_opt, forces, &error_sum))
+      return error_sum;
+#endif  // !MPI
+
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 #if !defined(APOT)
     // exchange potential and flag value
-    MPI_Bcast(xi, g_pot.calc_pot.len, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi, g_pot.calc_pot.len);
 #endif  // !APOT
 
 #if defined(APOT)
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
     update_calc_table(xi_opt, xi, 0);
 #else   // APOT
     // if flag == 2 then the potential parameters have changed -> sync
@@ -166,12 +180,63 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     //   [0, ...,  paircol - 1]
     update_splines(xi, 0, g_calc.paircol, 1);
 
+    // flag all configurations affected by a changed parameter
+    force_cache_prepare(xi_opt);
+
+    // refresh the float spline mirrors when the search runs in
+    // single precision
+    eval_float_prepare(xi);
+
+#if defined(APOT)
+    // refill the chemical potential cache before the threaded loop
+    if (g_param.enable_cp)
+      chemical_potential_cache_prepare(g_param.ntypes, xi_opt + g_pot.cp_start);
+#endif  // APOT
+
     // loop over configurations
-    for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial error sums reduced at the end
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum) \
+    if (g_mpi.conf_size == 1)
+#endif  // OPENMP
+    for (int conf_i = g_mpi.firstconf; conf_i < g_mpi.firstconf + g_mpi.myconf; conf_i++) {
+      // with an armed abort cutoff the configurations with the largest
+      // error contributions come first so hopeless trials fail fast
+      int config_idx = force_abort_order(conf_i);
+
+      // with file-backed neighbor data fetch the next block now
+      config_stream_prefetch(config_idx);
+
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
 #endif  // STRESS
+
+      // atom slice of this process when the configuration is shared
+      int atom_first = 0;
+      int atom_count = g_config.inconf[config_idx];
+
+#if defined(MPI)
+      if (g_mpi.conf_size > 1) {
+        atom_first = g_mpi.conf_atom_first;
+        atom_count = g_mpi.conf_atom_count;
+      }
+#endif  // MPI
+
+      // configurations outside of the current mini-batch keep their
+      // previous force vector entries, only the error sum matters for
+      // a trial evaluation
+      if (force_batch_skip(config_idx))
+        continue;
+
+      // reuse the cached contributions if nothing relevant has changed
+      if (force_cache_restore(config_idx, forces, &error_sum))
+        continue;
+
+      double error_start = error_sum;
+
       // reset energies and stresses
       forces[g_calc.energy_p + config_idx] = 0.0;
 #if defined(STRESS)
@@ -180,83 +245,133 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // STRESS
 
 #if defined(APOT)
-      if (g_param.enable_cp)
-        forces[g_calc.energy_p + config_idx] += chemical_potential(
-            g_param.ntypes, g_config.na_type[config_idx], xi_opt + g_pot.cp_start);
+      if (g_param.enable_cp && g_mpi.conf_rank == 0)
+        forces[g_calc.energy_p + config_idx] +=
+            chemical_potential_cached(config_idx);
 #endif  // APOT
 
-      // first loop: reset forces
-      for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
-        int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
-        if (uf) {
-          forces[n_i + 0] = -g_config.force_0[n_i + 0];
-          forces[n_i + 1] = -g_config.force_0[n_i + 1];
-          forces[n_i + 2] = -g_config.force_0[n_i + 2];
-        } else {
-          memset(forces + n_i, 0, 3 * sizeof(double));
+      // the float kernel replaces the force and energy loops during the
+      // single-precision search phases
+      if (g_eval_float.active) {
+#if defined(STRESS)
+        eval_float_pair_config(config_idx, uf, us, forces);
+#else
+        eval_float_pair_config(config_idx, uf, 0, forces);
+#endif  // STRESS
+      } else {
+        // first loop: reset forces
+        // with a shared configuration each process subtracts the
+        // reference forces only for its own slice, so the reduced sum
+        // contains them exactly once
+        for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
+          int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+          if (uf && atom_idx >= atom_first && atom_idx < atom_first + atom_count) {
+            forces[n_i + 0] = -g_config.force_0[n_i + 0];
+            forces[n_i + 1] = -g_config.force_0[n_i + 1];
+            forces[n_i + 2] = -g_config.force_0[n_i + 2];
+          } else {
+            memset(forces + n_i, 0, 3 * sizeof(double));
+          }
         }
+
+        // second loop: calculate pair forces and energies
+        // the packed neighbor layout keeps the inner loop contiguous in memory
+        const neigh_soa_t* soa = &g_config.neigh_soa;
+        for (int atom_idx = atom_first; atom_idx < atom_first + atom_count; atom_idx++) {
+          int atom_local = atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
+          int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
+          int first_n = soa->first[atom_local];
+          int num_n = soa->first[atom_local + 1] - first_n;
+
+          // evaluate the pair potential for the whole neighbor list at once
+          // entries beyond the potential cutoff are discarded below
+          double phi_val[max(num_n, 1)];
+          double phi_grad[max(num_n, 1)];
+          if (uf)
+            splint_comb_dir_batch(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_val, phi_grad);
+          else
+            splint_dir_batch(&g_pot.calc_pot, xi, num_n, soa->slot[0] + first_n, soa->shift[0] + first_n, soa->step[0] + first_n, phi_val);
+
+          // loop over all neighbors
+          for (int n = first_n; n < first_n + num_n; n++) {
+            // In small cells, an atom might interact with itself
+            int self = (soa->nr[n] == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
+
+            // pair potential part
+            if (soa->r[n] < g_pot.calc_pot.end[soa->col[0][n]]) {
+              double val = phi_val[n - first_n];
+              double grad = uf ? phi_grad[n - first_n] : 0.0;
+
+              // avoid double counting if atom is interacting with itself
+              if (self) {
+                val *= 0.5;
+                grad *= 0.5;
+              }
+
+              // add cohesive energy
+              forces[g_calc.energy_p + config_idx] += val;
+
+              // calculate forces
+              if (uf) {
+                vector tmp_force;
+                tmp_force.x = soa->dist_r_x[n] * grad;
+                tmp_force.y = soa->dist_r_y[n] * grad;
+                tmp_force.z = soa->dist_r_z[n] * grad;
+                forces[n_i + 0] += tmp_force.x;
+                forces[n_i + 1] += tmp_force.y;
+                forces[n_i + 2] += tmp_force.z;
+                // actio = reactio
+                int n_j = 3 * soa->nr[n];
+                forces[n_j + 0] -= tmp_force.x;
+                forces[n_j + 1] -= tmp_force.y;
+                forces[n_j + 2] -= tmp_force.z;
+  #if defined(STRESS)
+                /* also calculate pair stresses */
+                if (us) {
+                  forces[stress_idx + 0] -= soa->dist_x[n] * tmp_force.x;
+                  forces[stress_idx + 1] -= soa->dist_y[n] * tmp_force.y;
+                  forces[stress_idx + 2] -= soa->dist_z[n] * tmp_force.z;
+                  forces[stress_idx + 3] -= soa->dist_x[n] * tmp_force.y;
+                  forces[stress_idx + 4] -= soa->dist_y[n] * tmp_force.z;
+                  forces[stress_idx + 5] -= soa->dist_z[n] * tmp_force.x;
+                }
+  #endif  // STRESS
+              }
+            } // neighbors in range
+          }   // loop over all neighbors
+        } // second loop over atoms
       }
 
-      // second loop: calculate pair forces and energies
-      for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
-        atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
-        int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
-        // loop over all neighbors
-        for (int neigh_idx = 0; neigh_idx < atom->num_neigh; neigh_idx++) {
-          neigh_t* neigh = atom->neigh + neigh_idx;
-          // In small cells, an atom might interact with itself
-          int self = (neigh->nr == atom_idx + g_config.cnfstart[config_idx]) ? 1 : 0;
-
-          // pair potential part
-          if (neigh->r < g_pot.calc_pot.end[neigh->col[0]]) {
-            double phi_val = 0.0;
-            double phi_grad = 0.0;
-            // potential value and gradient are calculated in the same step
-            if (uf)
-              phi_val = splint_comb_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0], &phi_grad);
-            else
-              phi_val = splint_dir(&g_pot.calc_pot, xi, neigh->slot[0], neigh->shift[0], neigh->step[0]);
-
-            // avoid double counting if atom is interacting with itself
-            if (self) {
-              phi_val *= 0.5;
-              phi_grad *= 0.5;
-            }
-
-            // add cohesive energy
-            forces[g_calc.energy_p + config_idx] += phi_val;
-
-            // calculate forces
-            if (uf) {
-              vector tmp_force;
-              tmp_force.x = neigh->dist_r.x * phi_grad;
-              tmp_force.y = neigh->dist_r.y * phi_grad;
-              tmp_force.z = neigh->dist_r.z * phi_grad;
-              forces[n_i + 0] += tmp_force.x;
-              forces[n_i + 1] += tmp_force.y;
-              forces[n_i + 2] += tmp_force.z;
-              // actio = reactio
-              int n_j = 3 * neigh->nr;
-              forces[n_j + 0] -= tmp_force.x;
-              forces[n_j + 1] -= tmp_force.y;
-              forces[n_j + 2] -= tmp_force.z;
+#if defined(MPI)
+      // combine the partial sums of the processes sharing this
+      // configuration, only the first one carries on with the error sum
+      if (g_mpi.conf_size > 1) {
+        int n_c = 3 * g_config.cnfstart[config_idx];
+        if (g_mpi.conf_rank == 0) {
+          MPI_Reduce(MPI_IN_PLACE, forces + n_c, 3 * g_config.inconf[config_idx], MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
+          MPI_Reduce(MPI_IN_PLACE, forces + g_calc.energy_p + config_idx, 1, MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
 #if defined(STRESS)
-              /* also calculate pair stresses */
-              if (us) {
-                forces[stress_idx + 0] -= neigh->dist.x * tmp_force.x;
-                forces[stress_idx + 1] -= neigh->dist.y * tmp_force.y;
-                forces[stress_idx + 2] -= neigh->dist.z * tmp_force.z;
-                forces[stress_idx + 3] -= neigh->dist.x * tmp_force.y;
-                forces[stress_idx + 4] -= neigh->dist.y * tmp_force.z;
-                forces[stress_idx + 5] -= neigh->dist.z * tmp_force.x;
-              }
+          MPI_Reduce(MPI_IN_PLACE, forces + stress_idx, 6, MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
 #endif  // STRESS
-            }
-          } // neighbors in range
-        }   // loop over all neighbors
+        } else {
+          MPI_Reduce(forces + n_c, NULL, 3 * g_config.inconf[config_idx], MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
+          MPI_Reduce(forces + g_calc.energy_p + config_idx, NULL, 1, MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
+#if defined(STRESS)
+          MPI_Reduce(forces + stress_idx, NULL, 6, MPI_DOUBLE, MPI_SUM, 0, g_mpi.conf_comm);
+#endif  // STRESS
+          continue;
+        }
+      }
+#endif  // MPI
 
-        // calculate contribution of forces right away
-        if (uf) {
+      // third loop: weigh the force deviations and sum up the errors,
+      // possible only after all neighbor contributions have arrived
+      if (uf) {
+        for (int atom_idx = 0; atom_idx < g_config.inconf[config_idx]; atom_idx++) {
+#if defined(FWEIGHT) || defined(CONTRIB)
+          atom_t* atom = g_config.conf_atoms + atom_idx + g_config.cnfstart[config_idx] - g_mpi.firstatom;
+#endif  // FWEIGHT || CONTRIB
+          int n_i = 3 * (g_config.cnfstart[config_idx] + atom_idx);
 #if defined(FWEIGHT)
           // weigh by absolute value of force
           forces[n_i + 0] /= FORCE_EPS + atom->absforce;
@@ -270,7 +385,7 @@ double calc_forces(double* xi_opt, double* forces, int flag)
 #endif  // CONTRIB
             error_sum += g_config.conf_weight[config_idx] * (dsquare(forces[n_i + 0]) + dsquare(forces[n_i + 1]) + dsquare(forces[n_i + 2]));
         }
-      } // second loop over atoms
+      }
 
       // energy contributions
       forces[g_calc.energy_p + config_idx] /= (double)g_config.inconf[config_idx];
@@ -288,8 +403,23 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       }
 #endif  // STRESS
 
+      // refresh the cache entry of this configuration
+      force_cache_store(config_idx, forces, error_sum - error_start);
+
+      // fold the contribution into the importance index
+      conf_index_update(config_idx, error_sum - error_start);
+
+#if !defined(OPENMP)
+      // an armed abort cutoff rejects the trial as soon as the
+      // partial error sum exceeds it
+      if (force_abort_check(config_idx, error_sum - error_start, error_sum))
+        break;
+#endif  // !OPENMP
     } // loop over configurations
 
+    force_cache_commit(xi_opt);
+    conf_index_advance();
+
     // dummy constraints (global)
 #if defined(APOT)
     // add punishment for out of bounds (mostly for powell_lsq)
@@ -308,8 +438,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         printf("\n--> Force is nan! <--\n\n");
 #endif  // DEBUG
         return 10e10;
-      } else
+      } else {
+        // remember this evaluation for exact repeats
+        eval_memo_store(xi_opt, forces, error_sum);
         return error_sum;
+      }
     }
   } // end of infinite loop
 
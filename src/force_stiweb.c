@@ -37,6 +37,9 @@
 #include "force.h"
 #include "functions.h"
 #include "memory.h"
+#if defined(MPI)
+#include "mpi_utils.h"
+#endif
 #include "potential_input.h"
 #include "potential_output.h"
 #include "splines.h"
@@ -117,14 +120,14 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     double error_sum = 0.0;
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
 
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
 #else
     apot_check_params(xi_opt);
 #endif  // MPI
@@ -132,12 +135,18 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     update_stiweb_pointers(xi_opt);
 
     // loop over configurations
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial error sums reduced at the end
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum)
+#endif  // OPENMP
     for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
       // reset energies and stresses
       forces[g_calc.energy_p + config_idx] = 0.0;
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
       int stress_idx = g_calc.stress_p + 6 * config_idx;
       memset(forces + stress_idx, 0, 6 * sizeof(double));
 #endif  // STRESS
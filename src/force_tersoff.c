@@ -36,11 +36,18 @@
 #include "force.h"
 #include "functions.h"
 #include "memory.h"
+#if defined(MPI)
+#include "mpi_utils.h"
+#endif
 #include "potential_input.h"
 #include "potential_output.h"
 #include "splines.h"
 #include "utils.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif  // __AVX2__
+
 /****************************************************************
  *
  *  init_forces
@@ -117,14 +124,14 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     double error_sum = 0.0;
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
 
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
 #else
     apot_check_params(xi_opt);
 #endif  // MPI
@@ -132,6 +139,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     update_tersoff_pointers(xi_opt);
 
     // loop over configurations
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial error sums reduced at the end
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum)
+#endif  // OPENMP
     for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
 
@@ -139,7 +151,8 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       forces[g_calc.energy_p + config_idx] = 0.0;
 
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
       int stress_idx = g_calc.stress_p + 6 * config_idx;
       memset(forces + stress_idx, 0, 6 * sizeof(double));
 #endif  // STRESS
@@ -223,71 +236,175 @@ double calc_forces(double* xi_opt, double* forces, int flag)
         } // loop over neighbors
 
         // calculate threebody part
-        for (int neigh_j_idx = 0; neigh_j_idx < atom->num_neigh; neigh_j_idx++) {
+        //
+        // the (j,k) pair loop below used to pick single neigh_t fields out
+        // of the AoS records for every pair; instead gather the per-neighbor
+        // inputs into packed per-atom arrays once, evaluate the pairwise
+        // cos-theta/zeta terms in a flat pass over those arrays (four pairs
+        // at a time with AVX2) and accumulate the guarded sums in the
+        // original inner loop order, so the results stay bit-identical
+        int nn = atom->num_neigh;
+
+        if (nn == 0)
+          continue;
+
+        double k_cos[nn], k_f[nn], k_om[nn], k_df_r[nn], k_r[nn], k_r2[nn];
+        double k_dx[nn], k_dy[nn], k_dz[nn];
+        double k_zeta[nn], k_dzeta_x[nn], k_dzeta_y[nn], k_dzeta_z[nn];
+        double k_dzj_x[nn], k_dzj_y[nn], k_dzj_z[nn];
+        int k_in[nn];
+
+        for (int k = 0; k < nn; k++) {
+          neigh_t* neigh_k = atom->neigh + k;
+          int col_k = neigh_k->col[0];
+          k_f[k] = neigh_k->f;
+          k_om[k] = ters->omega[col_k][0];
+          k_df_r[k] = neigh_k->df / neigh_k->r;
+          k_r[k] = neigh_k->r;
+          k_r2[k] = neigh_k->r * neigh_k->r;
+          k_dx[k] = neigh_k->dist.x;
+          k_dy[k] = neigh_k->dist.y;
+          k_dz[k] = neigh_k->dist.z;
+          k_in[k] = (neigh_k->r < ters->S[col_k][0]);
+        }
+
+        for (int neigh_j_idx = 0; neigh_j_idx < nn; neigh_j_idx++) {
           neigh_t* neigh_j = atom->neigh + neigh_j_idx;
           int col_j = neigh_j->col[0];
           // check if we are within the cutoff range
           if (neigh_j->r < ters->S[col_j][0]) {
-            int ijk = neigh_j->ijk_start;
             int n_j = 3 * neigh_j->nr;
 
             // skip neighbor if coefficient is zero
             if (ters->B[col_j][0] == 0.0)
               continue;
 
-            // reset variables for each neighbor
-            double zeta = 0.0;
-            vector dzeta_i = {0.0, 0.0, 0.0};
-            vector dzeta_j = {0.0, 0.0, 0.0};
+            // angle cosines for this neighbor, packed in inner loop order
+            // (the angle table skips the j == k entry)
+            {
+              int ijk = neigh_j->ijk_start;
+              for (int k = 0; k < nn; k++) {
+                if (k == neigh_j_idx) {
+                  k_cos[k] = 0.0;
+                  continue;
+                }
+                k_cos[k] = atom->angle_part[ijk++].cos;
+              }
+            }
 
-            // inner loop over neighbors
-            for (int neigh_k_idx = 0; neigh_k_idx < atom->num_neigh; neigh_k_idx++) {
-              if (neigh_k_idx == neigh_j_idx)
-                continue;
-              neigh_t* neigh_k = atom->neigh + neigh_k_idx;
-              int col_k = neigh_k->col[0];
-              angle_t* angle = atom->angle_part + ijk++;
-              if (neigh_k->r < ters->S[col_k][0]) {
-                double tmp_jk = 1.0 / (neigh_j->r * neigh_k->r);
+            double r_j = neigh_j->r;
+            double r_j2 = neigh_j->r * neigh_j->r;
+            double h_j = ters->h[col_j][0];
+            double c2_j = ters->c2[col_j];
+            double d2_j = ters->d2[col_j];
+            double g_0 = 1.0 + ters->c2[col_j] / ters->d2[col_j];
+            double dist_j_x = neigh_j->dist.x;
+            double dist_j_y = neigh_j->dist.y;
+            double dist_j_z = neigh_j->dist.z;
+
+            // pairwise pass: cutoff and j == k entries are computed as well
+            // (they are finite) and filtered out during accumulation below
+            int k0 = 0;
+
+#if defined(__AVX2__)
+            {
+              const __m256d one = _mm256_set1_pd(1.0);
+              const __m256d v_rj = _mm256_set1_pd(r_j);
+              const __m256d v_rj2 = _mm256_set1_pd(r_j2);
+              const __m256d v_h = _mm256_set1_pd(h_j);
+              const __m256d v_c2 = _mm256_set1_pd(c2_j);
+              const __m256d v_2c2 = _mm256_set1_pd(2.0 * c2_j);
+              const __m256d v_d2 = _mm256_set1_pd(d2_j);
+              const __m256d v_g0 = _mm256_set1_pd(g_0);
+              const __m256d v_jx = _mm256_set1_pd(dist_j_x);
+              const __m256d v_jy = _mm256_set1_pd(dist_j_y);
+              const __m256d v_jz = _mm256_set1_pd(dist_j_z);
+
+              for (; k0 + 4 <= nn; k0 += 4) {
+                __m256d cos_k = _mm256_loadu_pd(k_cos + k0);
+                __m256d f_k = _mm256_loadu_pd(k_f + k0);
+                __m256d om_k = _mm256_loadu_pd(k_om + k0);
+                __m256d dx = _mm256_loadu_pd(k_dx + k0);
+                __m256d dy = _mm256_loadu_pd(k_dy + k0);
+                __m256d dz = _mm256_loadu_pd(k_dz + k0);
+                __m256d tmp_jk = _mm256_div_pd(one, _mm256_mul_pd(v_rj, _mm256_loadu_pd(k_r + k0)));
+                __m256d tmp_1 = _mm256_sub_pd(v_h, cos_k);
+                __m256d tmp_2 = _mm256_div_pd(one, _mm256_add_pd(v_d2, _mm256_mul_pd(tmp_1, tmp_1)));
+                __m256d g_theta = _mm256_sub_pd(v_g0, _mm256_mul_pd(v_c2, tmp_2));
+                _mm256_storeu_pd(k_zeta + k0, _mm256_mul_pd(_mm256_mul_pd(f_k, om_k), g_theta));
+                __m256d tmp_j2 = _mm256_div_pd(cos_k, v_rj2);
+                __m256d tmp_k2 = _mm256_div_pd(cos_k, _mm256_loadu_pd(k_r2 + k0));
+                __m256d tmp_3 = _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(v_2c2, tmp_1), tmp_2), tmp_2), f_k), om_k);
+                __m256d tmp_grad = _mm256_mul_pd(_mm256_mul_pd(_mm256_loadu_pd(k_df_r + k0), g_theta), om_k);
+                __m256d dcos_j = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, dx), _mm256_mul_pd(tmp_j2, v_jx));
+                __m256d dcos_k = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, v_jx), _mm256_mul_pd(tmp_k2, dx));
+                _mm256_storeu_pd(k_dzeta_x + k0, _mm256_sub_pd(_mm256_mul_pd(tmp_grad, dx), _mm256_mul_pd(tmp_3, dcos_k)));
+                _mm256_storeu_pd(k_dzj_x + k0, _mm256_mul_pd(tmp_3, dcos_j));
+                dcos_j = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, dy), _mm256_mul_pd(tmp_j2, v_jy));
+                dcos_k = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, v_jy), _mm256_mul_pd(tmp_k2, dy));
+                _mm256_storeu_pd(k_dzeta_y + k0, _mm256_sub_pd(_mm256_mul_pd(tmp_grad, dy), _mm256_mul_pd(tmp_3, dcos_k)));
+                _mm256_storeu_pd(k_dzj_y + k0, _mm256_mul_pd(tmp_3, dcos_j));
+                dcos_j = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, dz), _mm256_mul_pd(tmp_j2, v_jz));
+                dcos_k = _mm256_sub_pd(_mm256_mul_pd(tmp_jk, v_jz), _mm256_mul_pd(tmp_k2, dz));
+                _mm256_storeu_pd(k_dzeta_z + k0, _mm256_sub_pd(_mm256_mul_pd(tmp_grad, dz), _mm256_mul_pd(tmp_3, dcos_k)));
+                _mm256_storeu_pd(k_dzj_z + k0, _mm256_mul_pd(tmp_3, dcos_j));
+              }
+            }
+#endif  // __AVX2__
 
-                double tmp_1 = ters->h[col_j][0] - angle->cos;
-                double tmp_2 = 1.0 / (ters->d2[col_j] + tmp_1 * tmp_1);
-                double g_theta = 1.0 + ters->c2[col_j] / ters->d2[col_j] -
-                          ters->c2[col_j] * tmp_2;
+            for (int k = k0; k < nn; k++) {
+              double tmp_jk = 1.0 / (r_j * k_r[k]);
+              double tmp_1 = h_j - k_cos[k];
+              double tmp_2 = 1.0 / (d2_j + tmp_1 * tmp_1);
+              double g_theta = g_0 - c2_j * tmp_2;
 
-                // zeta
-                zeta += neigh_k->f * ters->omega[col_k][0] * g_theta;
+              k_zeta[k] = k_f[k] * k_om[k] * g_theta;
 
-                double tmp_j2 = angle->cos / (neigh_j->r * neigh_j->r);
-                double tmp_k2 = angle->cos / (neigh_k->r * neigh_k->r);
+              double tmp_j2 = k_cos[k] / r_j2;
+              double tmp_k2 = k_cos[k] / k_r2[k];
 
-                vector dcos_j;
-                dcos_j.x = tmp_jk * neigh_k->dist.x - tmp_j2 * neigh_j->dist.x;
-                dcos_j.y = tmp_jk * neigh_k->dist.y - tmp_j2 * neigh_j->dist.y;
-                dcos_j.z = tmp_jk * neigh_k->dist.z - tmp_j2 * neigh_j->dist.z;
+              vector dcos_j;
+              dcos_j.x = tmp_jk * k_dx[k] - tmp_j2 * dist_j_x;
+              dcos_j.y = tmp_jk * k_dy[k] - tmp_j2 * dist_j_y;
+              dcos_j.z = tmp_jk * k_dz[k] - tmp_j2 * dist_j_z;
 
-                vector dcos_k;
-                dcos_k.x = tmp_jk * neigh_j->dist.x - tmp_k2 * neigh_k->dist.x;
-                dcos_k.y = tmp_jk * neigh_j->dist.y - tmp_k2 * neigh_k->dist.y;
-                dcos_k.z = tmp_jk * neigh_j->dist.z - tmp_k2 * neigh_k->dist.z;
+              vector dcos_k;
+              dcos_k.x = tmp_jk * dist_j_x - tmp_k2 * k_dx[k];
+              dcos_k.y = tmp_jk * dist_j_y - tmp_k2 * k_dy[k];
+              dcos_k.z = tmp_jk * dist_j_z - tmp_k2 * k_dz[k];
 
-                double tmp_3 = 2.0 * ters->c2[col_j] * tmp_1 * tmp_2 * tmp_2 * neigh_k->f * ters->omega[col_k][0];
+              double tmp_3 = 2.0 * c2_j * tmp_1 * tmp_2 * tmp_2 * k_f[k] * k_om[k];
 
-                double tmp_grad = neigh_k->df / neigh_k->r * g_theta * ters->omega[col_k][0];
+              double tmp_grad = k_df_r[k] * g_theta * k_om[k];
 
-                neigh_k->dzeta.x = tmp_grad * neigh_k->dist.x - tmp_3 * dcos_k.x;
-                neigh_k->dzeta.y = tmp_grad * neigh_k->dist.y - tmp_3 * dcos_k.y;
-                neigh_k->dzeta.z = tmp_grad * neigh_k->dist.z - tmp_3 * dcos_k.z;
+              k_dzeta_x[k] = tmp_grad * k_dx[k] - tmp_3 * dcos_k.x;
+              k_dzeta_y[k] = tmp_grad * k_dy[k] - tmp_3 * dcos_k.y;
+              k_dzeta_z[k] = tmp_grad * k_dz[k] - tmp_3 * dcos_k.z;
 
-                dzeta_i.x -= neigh_k->dzeta.x;
-                dzeta_i.y -= neigh_k->dzeta.y;
-                dzeta_i.z -= neigh_k->dzeta.z;
+              k_dzj_x[k] = tmp_3 * dcos_j.x;
+              k_dzj_y[k] = tmp_3 * dcos_j.y;
+              k_dzj_z[k] = tmp_3 * dcos_j.z;
+            }
 
-                dzeta_j.x -= tmp_3 * dcos_j.x;
-                dzeta_j.y -= tmp_3 * dcos_j.y;
-                dzeta_j.z -= tmp_3 * dcos_j.z;
-              }
-            } // neigh_k_idx
+            // reset variables for each neighbor
+            double zeta = 0.0;
+            vector dzeta_i = {0.0, 0.0, 0.0};
+            vector dzeta_j = {0.0, 0.0, 0.0};
+
+            // zeta, accumulated in the original inner loop order
+            for (int k = 0; k < nn; k++) {
+              if (k == neigh_j_idx || !k_in[k])
+                continue;
+              zeta += k_zeta[k];
+
+              dzeta_i.x -= k_dzeta_x[k];
+              dzeta_i.y -= k_dzeta_y[k];
+              dzeta_i.z -= k_dzeta_z[k];
+
+              dzeta_j.x -= k_dzj_x[k];
+              dzeta_j.y -= k_dzj_y[k];
+              dzeta_j.z -= k_dzj_z[k];
+            }
 
             double phi_a = 0.5 * ters->B[col_j][0] * exp(-ters->mu[col_j][0] * neigh_j->r);
 
@@ -314,31 +431,27 @@ double calc_forces(double* xi_opt, double* forces, int flag)
             force_j.y = -tmp_6 * neigh_j->dist.y + tmp_5 * dzeta_j.y;
             force_j.z = -tmp_6 * neigh_j->dist.z + tmp_5 * dzeta_j.z;
 
-            for (int neigh_k_idx = 0; neigh_k_idx < atom->num_neigh; neigh_k_idx++) {
-              if (neigh_k_idx != neigh_j_idx) {
-                neigh_t* neigh_k = atom->neigh + neigh_k_idx;
-                int col_k = neigh_k->col[0];
-                if (neigh_k->r < ters->S[col_k][0]) {
-                  int n_k = 3 * neigh_k->nr;
-                  // update force on particle k
-                  forces[n_k + 0] += tmp_5 * neigh_k->dzeta.x;
-                  forces[n_k + 1] += tmp_5 * neigh_k->dzeta.y;
-                  forces[n_k + 2] += tmp_5 * neigh_k->dzeta.z;
+            for (int k = 0; k < nn; k++) {
+              if (k != neigh_j_idx && k_in[k]) {
+                int n_k = 3 * atom->neigh[k].nr;
+                // update force on particle k
+                forces[n_k + 0] += tmp_5 * k_dzeta_x[k];
+                forces[n_k + 1] += tmp_5 * k_dzeta_y[k];
+                forces[n_k + 2] += tmp_5 * k_dzeta_z[k];
 
 #if defined(STRESS)
-                  if (us) {
-                    // Distribute stress among atoms
-                    forces[stress_idx + 0] += neigh_k->dist.x * tmp_5 * neigh_k->dzeta.x;
-                    forces[stress_idx + 1] += neigh_k->dist.y * tmp_5 * neigh_k->dzeta.y;
-                    forces[stress_idx + 2] += neigh_k->dist.z * tmp_5 * neigh_k->dzeta.z;
-                    forces[stress_idx + 3] += 0.5 * tmp_5 * (neigh_k->dist.x * neigh_k->dzeta.y + neigh_k->dist.y * neigh_k->dzeta.x);
-                    forces[stress_idx + 4] += 0.5 * tmp_5 * (neigh_k->dist.y * neigh_k->dzeta.z + neigh_k->dist.z * neigh_k->dzeta.y);
-                    forces[stress_idx + 5] += 0.5 * tmp_5 * (neigh_k->dist.z * neigh_k->dzeta.x + neigh_k->dist.x * neigh_k->dzeta.z);
-                  }
-#endif  // STRESS
+                if (us) {
+                  // Distribute stress among atoms
+                  forces[stress_idx + 0] += k_dx[k] * tmp_5 * k_dzeta_x[k];
+                  forces[stress_idx + 1] += k_dy[k] * tmp_5 * k_dzeta_y[k];
+                  forces[stress_idx + 2] += k_dz[k] * tmp_5 * k_dzeta_z[k];
+                  forces[stress_idx + 3] += 0.5 * tmp_5 * (k_dx[k] * k_dzeta_y[k] + k_dy[k] * k_dzeta_x[k]);
+                  forces[stress_idx + 4] += 0.5 * tmp_5 * (k_dy[k] * k_dzeta_z[k] + k_dz[k] * k_dzeta_y[k]);
+                  forces[stress_idx + 5] += 0.5 * tmp_5 * (k_dz[k] * k_dzeta_x[k] + k_dx[k] * k_dzeta_z[k]);
                 }
-              } // neigh_k_idx != neigh_j_idx
-            }   // neigh_k_idx loop
+#endif  // STRESS
+              } // k != neigh_j_idx
+            }   // inner neighbor loop
 
             // update force on particle j
             forces[n_j + 0] += force_j.x;
@@ -449,14 +562,14 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     double error_sum = 0.0;
 
 #if defined(MPI)
-    MPI_Bcast(&flag, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&flag, 1, MPI_INT, 0, g_mpi.comm);
 
     if (flag == 1)
       break; // Exception: flag 1 means clean up
 
     if (g_mpi.myid == 0)
       apot_check_params(xi_opt);
-    MPI_Bcast(xi_opt, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    broadcast_hierarchical(xi_opt, g_calc.ndimtot);
 #else
     apot_check_params(xi_opt);
 #endif  // MPI
@@ -464,6 +577,11 @@ double calc_forces(double* xi_opt, double* forces, int flag)
     update_tersoff_pointers(xi_opt);
 
     // loop over configurations
+    // all configurations are independent of each other, so the loop can be
+    // threaded with per-thread partial error sums reduced at the end
+#if defined(OPENMP)
+#pragma omp parallel for schedule(dynamic) reduction(+ : error_sum)
+#endif  // OPENMP
     for (int config_idx = g_mpi.firstconf; config_idx < g_mpi.firstconf + g_mpi.myconf; config_idx++) {
       int uf = g_config.conf_uf[config_idx - g_mpi.firstconf];
 
@@ -471,7 +589,8 @@ double calc_forces(double* xi_opt, double* forces, int flag)
       forces[g_calc.energy_p + config_idx] = 0.0;
 
 #if defined(STRESS)
-      int us = g_config.conf_us[config_idx - g_mpi.firstconf];
+      int us =
+          (g_param.sweight != 0) ? g_config.conf_us[config_idx - g_mpi.firstconf] : 0;
       int stress_idx = g_calc.stress_p + 6 * config_idx;
       memset(forces + stress_idx, 0, 6 * sizeof(double));
 #endif  // STRESS
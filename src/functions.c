@@ -33,6 +33,10 @@
 #include "memory.h"
 #include "utils.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif  // __AVX2__
+
 // eopp = 0
 // universal = 1
 #define NUM_PUNISH_FUNCTIONS 2
@@ -46,8 +50,19 @@ struct {
   char** name;             // identifier of the potential
   int* num_params;         // number of parameters
   fvalue_pointer* fvalue;  // function pointer
+  bvalue_pointer* bvalue;  // batched function pointer (optional)
+  gvalue_pointer* gvalue;  // parameter gradient pointer (optional)
   int num_functions;       // number of analytic function prototypes
   int** punish_index;      // array to index which functions may be punished
+  // packed tables for the per-evaluation parameter checks
+  int* wrap_index;         // parameter slots that are 2 pi periodic
+  int num_wrap;
+#if defined(TERSOFF)
+  int* swap_index;         // first slot of the (S, R) cutoff pairs
+  int num_swap;
+#endif  // TERSOFF
+  double* bounds_min;      // packed lower bounds of the free parameters
+  double* bounds_max;      // packed upper bounds of the free parameters
 } function_table;
 
 /****************************************************************
@@ -62,6 +77,19 @@ void initialize_analytic_potentials(void)
 #include "functions.itm"
 
 #undef FUNCTION
+
+  // batched variants evaluating a whole column of sampling points per
+  // call - functions without one fall back to the scalar loop
+  add_batched_potential("lj", &lj_value_batch);
+  add_batched_potential("morse", &morse_value_batch);
+  add_batched_potential("eopp", &eopp_value_batch);
+
+  // closed form parameter gradients, used to assemble the jacobian
+  // of the force vector without finite differences
+  add_gradient_potential("lj", &lj_value_grad);
+  add_gradient_potential("morse", &morse_value_grad);
+  add_gradient_potential("eopp", &eopp_value_grad);
+
   function_table.punish_index =
       (int**)Malloc(NUM_PUNISH_FUNCTIONS * sizeof(int*));
   for (int i = 0; i < NUM_PUNISH_FUNCTIONS; ++i)
@@ -91,15 +119,55 @@ void add_potential(const char* name, int npar, fvalue_pointer function)
       (int*)Realloc(function_table.num_params, (k + 1) * sizeof(int));
   function_table.fvalue = (fvalue_pointer*)Realloc(
       function_table.fvalue, (k + 1) * sizeof(fvalue_pointer));
+  function_table.bvalue = (bvalue_pointer*)Realloc(
+      function_table.bvalue, (k + 1) * sizeof(bvalue_pointer));
+  function_table.gvalue = (gvalue_pointer*)Realloc(
+      function_table.gvalue, (k + 1) * sizeof(gvalue_pointer));
 
   // assign values
   sprintf(function_table.name[k], "%s", name);
   function_table.num_params[k] = npar;
   function_table.fvalue[k] = function;
+  function_table.bvalue[k] = NULL;
+  function_table.gvalue[k] = NULL;
 
   function_table.num_functions++;
 }
 
+/****************************************************************
+  add_batched_potential
+    attach a batched variant to an already registered potential
+****************************************************************/
+
+void add_batched_potential(const char* name, bvalue_pointer function)
+{
+  for (int i = 0; i < function_table.num_functions; i++) {
+    if (strcmp(function_table.name[i], name) == 0) {
+      function_table.bvalue[i] = function;
+      return;
+    }
+  }
+
+  error(1, "There is no potential with the name \"%s\".\n", name);
+}
+
+/****************************************************************
+  add_gradient_potential
+    attach a parameter gradient to an already registered potential
+****************************************************************/
+
+void add_gradient_potential(const char* name, gvalue_pointer function)
+{
+  for (int i = 0; i < function_table.num_functions; i++) {
+    if (strcmp(function_table.name[i], name) == 0) {
+      function_table.gvalue[i] = function;
+      return;
+    }
+  }
+
+  error(1, "There is no potential with the name \"%s\".\n", name);
+}
+
 /****************************************************************
   apot_get_num_parameters
     return the number of parameters for a specific analytic potential
@@ -126,6 +194,8 @@ int apot_assign_function_pointers(apot_table_t* apt)
     for (int j = 0; j < function_table.num_functions; j++) {
       if (strcmp(apt->names[i], function_table.name[j]) == 0) {
         apt->fvalue[i] = function_table.fvalue[j];
+        apt->bvalue[i] = function_table.bvalue[j];
+        apt->gvalue[i] = function_table.gvalue[j];
         apot_assign_punish_functions(apt->names[i], i);
         break;
       }
@@ -258,58 +328,85 @@ void check_correct_apot_functions(void)
 }
 
 /****************************************************************
-  check analytic parameters for special conditions
+  apot_init_checks
+    precompute the packed tables for the per-evaluation parameter
+    checks
+
+    apot_check_params and apot_punish run ahead of every single force
+    evaluation, so the name lookups and the two-level bound indirection
+    are resolved once here instead of on every call.
 ****************************************************************/
 
-int apot_check_params(double* params)
+void apot_init_checks(void)
 {
+  apot_table_t* apt = &g_pot.apot_table;
+
+  function_table.wrap_index = (int*)Malloc(apt->number * sizeof(int));
+  function_table.num_wrap = 0;
+#if defined(TERSOFF)
+  function_table.swap_index = (int*)Malloc(apt->number * sizeof(int));
+  function_table.num_swap = 0;
+#endif  // TERSOFF
+
   int j = 2;
-  int k = 0;
 
-  for (int i = 0; i < g_pot.apot_table.number; i++) {
+  for (int i = 0; i < apt->number; i++) {
     // last parameter of eopp potential is 2 pi periodic
-    if (strcmp(g_pot.apot_table.names[i], "eopp") == 0) {
-      k = j + 5;
-      if (params[k] > 2 * M_PI)
-        do {
-          params[k] -= 2 * M_PI;
-        } while (params[k] > 2 * M_PI);
-      if (params[k] < 0)
-        do {
-          params[k] += 2 * M_PI;
-        } while (params[k] < 0);
-    }
+    if (strcmp(apt->names[i], "eopp") == 0)
+      function_table.wrap_index[function_table.num_wrap++] = j + 5;
 
     // the third parameter of csw2 potential is 2 pi periodic
-    if (strcmp(g_pot.apot_table.names[i], "csw2") == 0) {
-      k = j + 2;
-      if (params[k] > 2 * M_PI)
-        do {
-          params[k] -= 2 * M_PI;
-        } while (params[k] > 2 * M_PI);
-      if (params[k] < 0)
-        do {
-          params[k] += 2 * M_PI;
-        } while (params[k] < 0);
-    }
+    if (strcmp(apt->names[i], "csw2") == 0)
+      function_table.wrap_index[function_table.num_wrap++] = j + 2;
 
 #if defined(TERSOFF)
     // the parameter S has to be greater than the parameter R
-    // switch them if this is not the case
-    if (strcmp(g_pot.apot_table.names[i], "tersoff_pot") == 0) {
-      k = j + 9;
-      if (params[k] < params[k + 1]) {
-        double temp = params[k];
-        params[k] = params[k + 1];
-        params[k + 1] = temp;
-      }
-    }
+    if (strcmp(apt->names[i], "tersoff_pot") == 0)
+      function_table.swap_index[function_table.num_swap++] = j + 9;
 #endif  // TERSOFF
 
     // jump to next potential
-    j += 2 + apot_get_num_parameters(g_pot.apot_table.names[i]) +
-         g_pot.smooth_pot[i];
+    j += 2 + apot_get_num_parameters(apt->names[i]) + g_pot.smooth_pot[i];
+  }
+
+  // flatten the pmin/pmax indirection into arrays aligned with the
+  // free parameter vector
+  function_table.bounds_min = (double*)Malloc(g_calc.ndim * sizeof(double));
+  function_table.bounds_max = (double*)Malloc(g_calc.ndim * sizeof(double));
+
+  for (int i = 0; i < g_calc.ndim; i++) {
+    function_table.bounds_min[i] = apt->pmin[apt->idxpot[i]][apt->idxparam[i]];
+    function_table.bounds_max[i] = apt->pmax[apt->idxpot[i]][apt->idxparam[i]];
+  }
+}
+
+/****************************************************************
+  check analytic parameters for special conditions
+****************************************************************/
+
+int apot_check_params(double* params)
+{
+  // wrap the 2 pi periodic parameters back into [0, 2 pi]
+  for (int i = 0; i < function_table.num_wrap; i++) {
+    int k = function_table.wrap_index[i];
+    while (params[k] > 2 * M_PI)
+      params[k] -= 2 * M_PI;
+    while (params[k] < 0)
+      params[k] += 2 * M_PI;
+  }
+
+#if defined(TERSOFF)
+  // the parameter S has to be greater than the parameter R
+  // switch them if this is not the case
+  for (int i = 0; i < function_table.num_swap; i++) {
+    int k = function_table.swap_index[i];
+    if (params[k] < params[k + 1]) {
+      double temp = params[k];
+      params[k] = params[k + 1];
+      params[k + 1] = temp;
+    }
   }
+#endif  // TERSOFF
 
   return 0;
 }
@@ -357,21 +454,45 @@ double apot_punish(double* params, double* forces)
 {
   double tmpsum = 0.0;
 
-  // loop over individual parameters
-  for (int i = 0; i < g_calc.ndim; i++) {
-    double min =
-        g_pot.apot_table
-            .pmin[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
-    double max =
-        g_pot.apot_table
-            .pmax[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
-    // punishment for out of bounds
-    if (params[g_pot.opt_pot.idx[i]] < min) {
-      double x = params[g_pot.opt_pot.idx[i]] - min;
+  const double* pmin = function_table.bounds_min;
+  const double* pmax = function_table.bounds_max;
+
+  // punishment for out of bounds, four bounds per compare with AVX2
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d weight = _mm256_set1_pd(APOT_PUNISH);
+
+  for (; i + 4 <= g_calc.ndim; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(g_pot.opt_pot.idx + i));
+    __m256d p = _mm256_i32gather_pd(params, k, 8);
+    // clamped excess over the bounds, zero for parameters in range
+    __m256d lo = _mm256_min_pd(_mm256_sub_pd(p, _mm256_loadu_pd(pmin + i)), zero);
+    __m256d hi = _mm256_max_pd(_mm256_sub_pd(p, _mm256_loadu_pd(pmax + i)), zero);
+    __m256d x = _mm256_add_pd(lo, hi);
+    __m256d y = _mm256_mul_pd(_mm256_mul_pd(weight, x), x);
+    // only the out of bounds entries of the force vector are written
+    __m256d mask = _mm256_cmp_pd(x, zero, _CMP_NEQ_OQ);
+    _mm256_maskstore_pd(forces + g_calc.punish_par_p + i,
+                        _mm256_castpd_si256(mask), y);
+
+    double y4[4];
+    _mm256_storeu_pd(y4, y);
+    // summed one by one to keep the scalar accumulation order
+    for (int m = 0; m < 4; m++)
+      tmpsum += y4[m];
+  }
+#endif  // __AVX2__
+
+  for (; i < g_calc.ndim; i++) {
+    double p = params[g_pot.opt_pot.idx[i]];
+    if (p < pmin[i]) {
+      double x = p - pmin[i];
       tmpsum += APOT_PUNISH * x * x;
       forces[g_calc.punish_par_p + i] = APOT_PUNISH * x * x;
-    } else if (params[g_pot.opt_pot.idx[i]] > max) {
-      double x = params[g_pot.opt_pot.idx[i]] - max;
+    } else if (p > pmax[i]) {
+      double x = p - pmax[i];
       tmpsum += APOT_PUNISH * x * x;
       forces[g_calc.punish_par_p + i] = APOT_PUNISH * x * x;
     }
@@ -511,6 +632,43 @@ void init_tails(double dp_kappa)
   }
 }
 
+/****************************************************************
+  update_tails
+    refresh the cached Coulomb tail entries of the local neighbor
+    lists; the tails depend on kappa only, so the whole sweep is
+    skipped while the optimizer leaves kappa untouched (most steps
+    of the one-parameter-at-a-time least squares minimizers)
+****************************************************************/
+
+void update_tails(double dp_kappa)
+{
+  static double dp_kappa_prev = 0.0;
+  static int have_tails = 0;
+
+  if (have_tails && dp_kappa == dp_kappa_prev)
+    return;
+
+  for (int h = g_mpi.firstconf; h < g_mpi.firstconf + g_mpi.myconf; h++) {
+    for (int i = 0; i < g_config.inconf[h]; i++) {
+      atom_t* atom =
+          g_config.conf_atoms + i + g_config.cnfstart[h] - g_mpi.firstatom;
+      for (int j = 0; j < atom->num_neigh; j++) {
+        neigh_t* neigh = atom->neigh + j;
+#if defined(DSF)
+        elstat_dsf(neigh->r, dp_kappa, &neigh->fnval_el, &neigh->grad_el,
+                   &neigh->ggrad_el);
+#else
+        elstat_shift(neigh->r, dp_kappa, &neigh->fnval_el, &neigh->grad_el,
+                     &neigh->ggrad_el);
+#endif  // DSF
+      }
+    }
+  }
+
+  dp_kappa_prev = dp_kappa;
+  have_tails = 1;
+}
+
 #endif  // COULOMB
 
 #if defined(DIPOLE)
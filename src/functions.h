@@ -43,13 +43,29 @@
 
 #undef FUNCTION
 
+// batched variants evaluating a whole column of sampling points per call
+void lj_value_batch(const int n, const double* r, const double* params,
+                    double* fvalue);
+void morse_value_batch(const int n, const double* r, const double* params,
+                       double* fvalue);
+void eopp_value_batch(const int n, const double* r, const double* params,
+                      double* fvalue);
+
+// closed form gradients with respect to the potential parameters
+void lj_value_grad(const double r, const double* params, double* gvalue);
+void morse_value_grad(const double r, const double* params, double* gvalue);
+void eopp_value_grad(const double r, const double* params, double* gvalue);
+
 // functions for analytic potential initialization
 void initialize_analytic_potentials(void);
 void add_potential(const char* name, int npar, fvalue_pointer function);
+void add_batched_potential(const char* name, bvalue_pointer function);
+void add_gradient_potential(const char* name, gvalue_pointer function);
 int apot_get_num_parameters(const char* potential_name);
 int apot_assign_function_pointers(apot_table_t* apot_table);
 void apot_assign_punish_functions(char const* name, int index);
 void check_correct_apot_functions(void);
+void apot_init_checks(void);
 
 // functions for analytic potential evaluation
 int apot_check_params(double* params);
@@ -69,6 +85,7 @@ void elstat_shift(double, double, double*, double*, double*);
 void elstat_dsf(double, double, double*, double*, double*);
 #endif
 void init_tails(double);
+void update_tails(double);
 #endif  // COULOMB
 #if defined(DIPOLE)
 double shortrange_value(double, double, double, double);
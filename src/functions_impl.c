@@ -50,6 +50,26 @@ void lj_value(const double r, const double* p, double* f)
   *f = 4.0 * p[0] * x * (x - 1.0);
 }
 
+void lj_value_batch(const int n, const double* r, const double* p, double* f)
+{
+  const double sig2 = p[1] * p[1];
+
+  for (int i = 0; i < n; i++) {
+    double x = sig2 / (r[i] * r[i]);
+    x = x * x * x;
+    f[i] = 4.0 * p[0] * x * (x - 1.0);
+  }
+}
+
+void lj_value_grad(const double r, const double* p, double* g)
+{
+  double x = (p[1] * p[1]) / (r * r);
+  x = x * x * x;
+
+  g[0] = 4.0 * x * (x - 1.0);
+  g[1] = 24.0 * p[0] * x * (2.0 * x - 1.0) / p[1];
+}
+
 /****************************************************************
   empirical oscillating pair potential (eopp)
     http://arxiv.org/abs/0802.2926v2
@@ -66,6 +86,38 @@ void eopp_value(const double r, const double* p, double* f)
   *f = p[0] / power[0] + (p[2] / power[1]) * cos(p[4] * r + p[5]);
 }
 
+void eopp_value_batch(const int n, const double* r, const double* p, double* f)
+{
+  for (int i = 0; i < n; i++) {
+    double x[2] = {r[i], r[i]};
+    double y[2] = {p[1], p[3]};
+    double power[2] = {0, 0};
+
+    power_m(2, power, x, y);
+
+    f[i] = p[0] / power[0] + (p[2] / power[1]) * cos(p[4] * r[i] + p[5]);
+  }
+}
+
+void eopp_value_grad(const double r, const double* p, double* g)
+{
+  double x[2] = {r, r};
+  double y[2] = {p[1], p[3]};
+  double power[2] = {0, 0};
+
+  power_m(2, power, x, y);
+
+  double cosine = cos(p[4] * r + p[5]);
+  double sine = sin(p[4] * r + p[5]);
+
+  g[0] = 1.0 / power[0];
+  g[1] = -p[0] * log(r) / power[0];
+  g[2] = cosine / power[1];
+  g[3] = -p[2] * log(r) * cosine / power[1];
+  g[4] = -p[2] * r * sine / power[1];
+  g[5] = -p[2] * sine / power[1];
+}
+
 /****************************************************************
   morse potential
     http://dx.doi.org/doi:10.1103/PhysRev.34.57
@@ -76,6 +128,23 @@ void morse_value(const double r, const double* p, double* f)
   *f = p[0] * (exp(-2.0 * p[1] * (r - p[2])) - 2.0 * exp(-p[1] * (r - p[2])));
 }
 
+void morse_value_batch(const int n, const double* r, const double* p, double* f)
+{
+  for (int i = 0; i < n; i++)
+    f[i] = p[0] * (exp(-2.0 * p[1] * (r[i] - p[2])) -
+                   2.0 * exp(-p[1] * (r[i] - p[2])));
+}
+
+void morse_value_grad(const double r, const double* p, double* g)
+{
+  double x = exp(-p[1] * (r - p[2]));
+  double x2 = x * x;
+
+  g[0] = x2 - 2.0 * x;
+  g[1] = 2.0 * p[0] * (r - p[2]) * (x - x2);
+  g[2] = 2.0 * p[0] * p[1] * (x2 - x);
+}
+
 /****************************************************************
   morse-stretch potential (without derivative!)
     http://dx.doi.org/doi:10.1063/1.1513312
@@ -108,7 +108,8 @@ void init_kim_model()
   if (g_kim.nparams < 1)
     error(1, "Selected KIM model \"%s\" does not support any parameters for optimization!\n", g_kim.model_name);
 
-  printf("\nKIM model \"%s\" supports %d species and %d parameters.\n\n", g_kim.model_name, g_kim.nspecies, g_kim.nparams);
+  if (g_mpi.myid == 0)
+    printf("\nKIM model \"%s\" supports %d species and %d parameters.\n\n", g_kim.model_name, g_kim.nspecies, g_kim.nparams);
 
   g_kim.params = (kim_parameter_t*)Malloc(g_kim.nparams * sizeof(kim_parameter_t));
 
@@ -133,7 +134,7 @@ void init_kim_model()
     check_KIM_model_support
 *******************************************************************************/
 
-void check_KIM_model_support()
+void check_KIM_model_support(KIM_ComputeArguments* arguments)
 {
   int res = 0;
 
@@ -180,7 +181,7 @@ void check_KIM_model_support()
     res = KIM_COMPUTE_ARGUMENT_NAME_GetComputeArgumentName(i, &computeArgumentName);
     if (res)
       error(1, "Error getting argument name %d", i);
-    res = KIM_ComputeArguments_GetArgumentSupportStatus(g_kim.arguments[0], computeArgumentName, &supportStatus);
+    res = KIM_ComputeArguments_GetArgumentSupportStatus(arguments, computeArgumentName, &supportStatus);
     if (res)
       error(1, "Error getting argument supportStatus %d", i);
 
@@ -220,95 +221,163 @@ void check_KIM_model_support()
 
 void initialize_KIM()
 {
-  printf("\nInitializing KIM interface ...\n");
+  if (g_mpi.myid == 0)
+    printf("\nInitializing KIM interface ...\n");
 
+#if defined(MPI)
+  // the worker processes have not read the parameter file and need the
+  // model name from the root process of their evaluation group
+  int len = (g_mpi.myid == 0) ? (int)strlen(g_kim.model_name) + 1 : 0;
+
+  MPI_Bcast(&len, 1, MPI_INT, 0, g_mpi.comm);
+
+  char* model_name = (char*)Malloc(len);
+
+  if (g_mpi.myid == 0)
+    memcpy(model_name, g_kim.model_name, len);
+
+  MPI_Bcast(model_name, len, MPI_CHAR, 0, g_mpi.comm);
+
+  if (g_mpi.myid != 0)
+    g_kim.model_name = model_name;
+
+  // A KIM model object lives in process memory and cannot be shared
+  // between ranks, but the expensive part of creating one is locating the
+  // driver and reading its parameter files from the (typically shared)
+  // filesystem. The first rank of each node therefore creates its model
+  // alone; the remaining ranks follow once the files sit in the warm page
+  // cache, instead of all ranks stampeding the filesystem at startup.
+  if (g_mpi.node_comm != MPI_COMM_NULL) {
+    if (g_kim.model == NULL && g_mpi.node_rank == 0)
+      init_kim_model();
+    MPI_Barrier(g_mpi.node_comm);
+  }
+
+  if (g_kim.model == NULL)
+    init_kim_model();
+#endif  // MPI
+
+  // the per-configuration compute-argument objects are created on demand
+  // by init_kim_compute_arguments at the first force calculation
+
+  if (g_mpi.myid == 0)
+    printf("Initializing KIM interface ... done\n");
+}
+
+/*******************************************************************************
+    init_kim_compute_arguments
+*******************************************************************************/
+
+void init_kim_compute_arguments(int config)
+{
   int res = 0;
 
-  // Allocate memory for KIM compute arguments
-  g_kim.arguments = (KIM_ComputeArguments**)Malloc(g_config.nconf * sizeof(KIM_ComputeArguments*));
-  g_kim.helpers = (potfit_compute_helper_t*)Malloc(g_config.nconf * sizeof(potfit_compute_helper_t));
+  // Creating a compute-argument object for every configuration up front
+  // makes job startup grow with the size of the dataset. Instead each rank
+  // creates them here on first use - and only for the configurations it
+  // actually evaluates.
 
-  // TODO check for MPI compatibility
-  for (int i = 0; i < g_config.nconf; i++) {
-    res = KIM_Model_ComputeArgumentsCreate(g_kim.model, &g_kim.arguments[i]);
-    if (res)
-      error(1, "Error calling KIM_Model_ComputeArgumentsCreate: %d\n", res);
+  if (!g_kim.arguments) {
+    g_kim.arguments = (KIM_ComputeArguments**)Malloc(g_config.nconf * sizeof(KIM_ComputeArguments*));
+    g_kim.helpers = (potfit_compute_helper_t*)Malloc(g_config.nconf * sizeof(potfit_compute_helper_t));
+  }
 
-    if (i == 0)
-      check_KIM_model_support();
+  if (g_kim.arguments[config])
+    return;
 
-    // check arguments
-    int numberOfComputeCallbackNames;
-    KIM_ComputeCallbackName computeCallbackName;
-    KIM_SupportStatus supportStatus;
+  res = KIM_Model_ComputeArgumentsCreate(g_kim.model, &g_kim.arguments[config]);
+  if (res)
+    error(1, "Error calling KIM_Model_ComputeArgumentsCreate: %d\n", res);
 
-    // check call backs
-    KIM_COMPUTE_CALLBACK_NAME_GetNumberOfComputeCallbackNames(&numberOfComputeCallbackNames);
-    for (int j = 0; j < numberOfComputeCallbackNames; ++j) {
-      res = KIM_COMPUTE_CALLBACK_NAME_GetComputeCallbackName(j, &computeCallbackName);
-      if (res)
-        error(1, "Error getting ComputeCallbackName %d: %d\n", j, res);
+  // the argument support is a property of the model, checking it for the
+  // first compute-argument object of this rank is enough
+  if (!g_kim.species_map)
+    check_KIM_model_support(g_kim.arguments[config]);
 
-      res = KIM_ComputeArguments_GetCallbackSupportStatus(g_kim.arguments[i], computeCallbackName, &supportStatus);
+  // check arguments
+  int numberOfComputeCallbackNames;
+  KIM_ComputeCallbackName computeCallbackName;
+  KIM_SupportStatus supportStatus;
+
+  // check call backs
+  KIM_COMPUTE_CALLBACK_NAME_GetNumberOfComputeCallbackNames(&numberOfComputeCallbackNames);
+  for (int j = 0; j < numberOfComputeCallbackNames; ++j) {
+    res = KIM_COMPUTE_CALLBACK_NAME_GetComputeCallbackName(j, &computeCallbackName);
+    if (res)
+      error(1, "Error getting ComputeCallbackName %d: %d\n", j, res);
+
+    res = KIM_ComputeArguments_GetCallbackSupportStatus(g_kim.arguments[config], computeCallbackName, &supportStatus);
+    if (res)
+      error(1, "Error getting CallbackSupportStatus for callback %d: %d\n", j + 1, res);
+
+    if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_GetNeighborList)) {
+      res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[config], KIM_COMPUTE_CALLBACK_NAME_GetNeighborList, KIM_LANGUAGE_NAME_c, (KIM_Function*)get_neigh, &g_kim.helpers[config]);
       if (res)
-        error(1, "Error getting CallbackSupportStatus for callback %d: %d\n", j + 1, res);
+        error(1, "Error setting GetNeighborList callback function: %d\n", res);
+      continue;
+    }
 
-      if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_GetNeighborList)) {
-        res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[i], KIM_COMPUTE_CALLBACK_NAME_GetNeighborList, KIM_LANGUAGE_NAME_c, (KIM_Function*)get_neigh, &g_kim.helpers[i]);
+    if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_ProcessDEDrTerm)) {
+      if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required) || KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_optional)) {
+        res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[config], KIM_COMPUTE_CALLBACK_NAME_ProcessDEDrTerm, KIM_LANGUAGE_NAME_c, (KIM_Function*)process_DEDr, NULL);
         if (res)
-          error(1, "Error setting GetNeighborList callback function: %d\n", res);
-        continue;
+          error(1, "Error setting ProcessDEDrTerm callback function: %d\n", res);
       }
+      continue;
+    }
 
-      if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_ProcessDEDrTerm)) {
-        if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required) || KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_optional)) {
-          res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[i], KIM_COMPUTE_CALLBACK_NAME_ProcessDEDrTerm, KIM_LANGUAGE_NAME_c, (KIM_Function*)process_DEDr, NULL);
-          if (res)
-            error(1, "Error setting ProcessDEDrTerm callback function: %d\n", res);
-        }
-        continue;
+    if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_ProcessD2EDr2Term)) {
+      if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required) || KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_optional)) {
+        res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[config], KIM_COMPUTE_CALLBACK_NAME_ProcessD2EDr2Term, KIM_LANGUAGE_NAME_c, (KIM_Function*)process_D2EDr2, NULL);
+        if (res)
+          error(1, "Error setting ProcessD2EDr2Term callback function: %d\n", res);
       }
+      continue;
+    }
 
-      if (KIM_ComputeCallbackName_Equal(computeCallbackName, KIM_COMPUTE_CALLBACK_NAME_ProcessD2EDr2Term)) {
-        if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required) || KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_optional)) {
-          res = KIM_ComputeArguments_SetCallbackPointer(g_kim.arguments[i], KIM_COMPUTE_CALLBACK_NAME_ProcessD2EDr2Term, KIM_LANGUAGE_NAME_c, (KIM_Function*)process_D2EDr2, NULL);
-          if (res)
-            error(1, "Error setting ProcessD2EDr2Term callback function: %d\n", res);
-        }
-        continue;
-      }
+    // cannot handle any other "required" call backs
+    if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required))
+      error(1, "KIM model requires the following unsupported callback: %s\n", KIM_ComputeCallbackName_ToString(computeCallbackName));
+  }
 
-      // cannot handle any other "required" call backs
-      if (KIM_SupportStatus_Equal(supportStatus, KIM_SUPPORT_STATUS_required))
-        error(1, "KIM model requires the following unsupported callback: %s\n", KIM_ComputeCallbackName_ToString(computeCallbackName));
-    }
+  res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_numberOfParticles, g_config.number_of_particles + config);
+  if (res)
+    error(1, "Error setting numberOfParticles");
 
-    res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[i], KIM_COMPUTE_ARGUMENT_NAME_numberOfParticles, g_config.number_of_particles + i);
-    if (res)
-      error(1, "Error setting numberOfParticles");
+  res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_particleSpeciesCodes, g_config.species_codes[config]);
+  if (res)
+    error(1, "Error setting particleSpeciesCodes");
 
-    res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[i], KIM_COMPUTE_ARGUMENT_NAME_particleSpeciesCodes, g_config.species_codes[i]);
-    if (res)
-      error(1, "Error setting particleSpeciesCodes");
+  res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_particleContributing, g_config.particle_contributing[config]);
+  if (res)
+    error(1, "Error setting particleContributing");
 
-    res = KIM_ComputeArguments_SetArgumentPointerInteger(g_kim.arguments[i], KIM_COMPUTE_ARGUMENT_NAME_particleContributing, g_config.particle_contributing[i]);
-    if (res)
-      error(1, "Error setting particleContributing");
+  res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_coordinates, g_config.coordinates[config]);
+  if (res)
+    error(1, "Error setting coordinates");
 
-    res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[i], KIM_COMPUTE_ARGUMENT_NAME_coordinates, g_config.coordinates[i]);
-    if (res)
-      error(1, "Error setting coordinates");
+  g_kim.helpers[config].config = config;
 
-    g_kim.helpers[i].config = i;
+  g_kim.helpers[config].forces = (double*)Malloc(3 * g_config.number_of_particles[config] * sizeof(double));
 
-    g_kim.helpers[i].forces = (double*)Malloc(3 * g_config.number_of_particles[i] * sizeof(double));
+  res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_partialForces, g_kim.helpers[config].forces);
+  if (res)
+    error(1, "Error setting forces!\n");
+
+  // the energy and virial locations never change, so register them
+  // here instead of on every evaluation
+
+  res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_partialEnergy, &g_kim.helpers[config].energy);
+  if (res)
+    error(1, "Error setting energy pointer\n");
 
-    res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[i], KIM_COMPUTE_ARGUMENT_NAME_partialForces, g_kim.helpers[i].forces);
+#if defined(STRESS)
+  if (g_config.usestress[config]) {
+    res = KIM_ComputeArguments_SetArgumentPointerDouble(g_kim.arguments[config], KIM_COMPUTE_ARGUMENT_NAME_partialVirial, g_kim.helpers[config].virial);
     if (res)
-      error(1, "Error setting forces!\n");
+      error(1, "Error setting virial pointer\n");
   }
-
-  printf("Initializing KIM interface ... done\n");
+#endif  // STRESS
 }
 
 /******************************************************************************
@@ -45,6 +45,9 @@ void init_kim_model();
 void initialize_KIM();
 void shutdown_KIM();
 
+// called from force_kim.c on the first evaluation of a configuration
+void init_kim_compute_arguments(int config);
+
 #endif // KIM
 
 #endif // KIM_H_INCLUDED
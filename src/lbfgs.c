@@ -0,0 +1,417 @@
+/****************************************************************
+ *
+ * lbfgs.c: Limited-memory BFGS minimization, an alternative to
+ *          the powell algorithm for high-dimensional fits
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+/****************************************************************
+ *
+ *  Minimizes U=sum_{i=1..M}(f_i(xi)-F_i)^2 like run_powell_lsq,
+ *  but with the two-loop L-BFGS recursion instead of the dense
+ *  gamma and lineqsys matrices. Only a handful of ndim-length
+ *  history vectors are kept, so the memory footprint stays linear
+ *  in the number of free parameters.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "bracket.h"
+#include "force.h"
+#include "memory.h"
+#include "optimize.h"
+#include "potential_input.h"
+#include "potential_output.h"
+#include "utils.h"
+
+#define EPS 0.001
+#define PRECISION 1.E-7
+#define VERY_SMALL 1.E-12
+
+// number of stored (step, gradient difference) pairs
+#define LBFGS_HISTORY 10
+// maximum number of iterations
+#define LBFGS_ITMAX 2000
+
+void lbfgs_gradient(double* xi, double* force_xi, double fxi, double* grad,
+                    double* force);
+double lbfgs_gradient_component(double* xi, int i, double h, double* force_xi,
+                                double fxi, double* force);
+double lbfgs_scale(int i);
+
+/****************************************************************
+ *
+ * run_lbfgs
+ *
+ ****************************************************************/
+
+void run_lbfgs(double* xi)
+{
+  int len = 0;    /* number of stored history pairs */
+  int next = 0;   /* ring buffer position for the next pair */
+  int fresh = 1;  /* direction is plain steepest descent */
+  double F1 = 0.0;
+  double F2 = 0.0;
+  double df = 0.0;
+  double xi1 = 0.0;
+  double xi2 = 0.0;
+
+  /* step and gradient difference history */
+  double** s = mat_double(LBFGS_HISTORY, g_calc.ndim);
+  double** y = mat_double(LBFGS_HISTORY, g_calc.ndim);
+  double* rho = (double*)Malloc(LBFGS_HISTORY * sizeof(double));
+  double* alpha = (double*)Malloc(LBFGS_HISTORY * sizeof(double));
+
+  /* current and previous gradient */
+  double* grad = (double*)Malloc(g_calc.ndim * sizeof(double));
+  double* grad_old = (double*)Malloc(g_calc.ndim * sizeof(double));
+
+  /* search direction in the full parameter vector */
+  double* delta = (double*)Malloc(g_calc.ndimtot * sizeof(double)); /* ==0 */
+
+  /* calculated forces */
+  double* forces_1 = (double*)Malloc(g_calc.mdim * sizeof(double));
+  double* forces_2 = (double*)Malloc(g_calc.mdim * sizeof(double));
+
+  F1 = calc_forces(xi, forces_1, 0);
+
+  if (F1 < VERY_SMALL) {
+    printf("Error already too small to optimize, aborting ...\n");
+    return;
+  }
+
+  memcpy(forces_2, forces_1, g_calc.mdim * sizeof(double));
+
+#if defined(APOT) || defined(KIM)
+  printf("loops\t\terror_sum\tforce calculations\n");
+  printf("%5d\t%17.6f\t%6d\n", 0, F1, g_calc.fcalls);
+#else
+  printf("%d %f %f %f %f %f %f %d\n", 0, F1, xi[0], xi[1], xi[2], xi[3], xi[4],
+         g_calc.fcalls);
+#endif  // APOT
+  fflush(stdout);
+
+  lbfgs_gradient(xi, forces_1, F1, grad, forces_2);
+
+  for (int iter = 1; iter <= LBFGS_ITMAX; iter++) {
+    /* (a) two-loop recursion: delta = -H . grad */
+    memcpy(grad_old, grad, g_calc.ndim * sizeof(double));
+
+    for (int k = len - 1; k >= 0; k--) {
+      int idx = (next + k) % LBFGS_HISTORY;
+      alpha[idx] = 0.0;
+      for (int i = 0; i < g_calc.ndim; i++)
+        alpha[idx] += s[idx][i] * grad[i];
+      alpha[idx] *= rho[idx];
+      for (int i = 0; i < g_calc.ndim; i++)
+        grad[i] -= alpha[idx] * y[idx][i];
+    }
+
+    /* initial Hessian guess gamma_k * Id from the latest pair */
+    if (len > 0) {
+      int idx = (next + len - 1) % LBFGS_HISTORY;
+      double sy = 0.0;
+      double yy = 0.0;
+      for (int i = 0; i < g_calc.ndim; i++) {
+        sy += s[idx][i] * y[idx][i];
+        yy += y[idx][i] * y[idx][i];
+      }
+      for (int i = 0; i < g_calc.ndim; i++)
+        grad[i] *= sy / yy;
+      fresh = 0;
+    } else
+      fresh = 1;
+
+    for (int k = 0; k < len; k++) {
+      int idx = (next + k) % LBFGS_HISTORY;
+      double beta = 0.0;
+      for (int i = 0; i < g_calc.ndim; i++)
+        beta += y[idx][i] * grad[i];
+      beta *= rho[idx];
+      for (int i = 0; i < g_calc.ndim; i++)
+        grad[i] += (alpha[idx] - beta) * s[idx][i];
+    }
+
+#if defined(APOT) || defined(KIM)
+    /* project out components that push an active bound further out,
+       their finite differences only see the punishment wall */
+    for (int i = 0; i < g_calc.ndim; i++) {
+      if (xi[g_pot.opt_pot.idx[i]] <= g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]] && grad[i] > 0.0)
+        grad[i] = 0.0;
+      if (xi[g_pot.opt_pot.idx[i]] >= g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]] && grad[i] < 0.0)
+        grad[i] = 0.0;
+    }
+#endif  // APOT || KIM
+
+    /* (b) descending direction in the full parameter vector */
+    double descent = 0.0;
+
+    for (int i = 0; i < g_calc.ndim; i++) {
+      delta[g_pot.opt_pot.idx[i]] = -grad[i] * lbfgs_scale(i);
+      descent -= grad[i] * grad_old[i];
+    }
+
+    if (descent >= 0.0 && fresh == 0) {
+      /* not a descent direction, drop the history and restart with
+         steepest descent */
+      len = 0;
+      next = 0;
+      for (int i = 0; i < g_calc.ndim; i++)
+        delta[g_pot.opt_pot.idx[i]] = -grad_old[i] * lbfgs_scale(i);
+      fresh = 1;
+    }
+
+#if defined(APOT) || defined(KIM)
+    /* respect the parameter bounds */
+    for (int i = 0; i < g_calc.ndim; i++) {
+      if ((xi[g_pot.opt_pot.idx[i]] + delta[g_pot.opt_pot.idx[i]]) < g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]]) {
+        delta[g_pot.opt_pot.idx[i]] = g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]] - xi[g_pot.opt_pot.idx[i]];
+      }
+      if ((xi[g_pot.opt_pot.idx[i]] + delta[g_pot.opt_pot.idx[i]]) > g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]]) {
+        delta[g_pot.opt_pot.idx[i]] = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]] [g_pot.apot_table.idxparam[i]] - xi[g_pot.opt_pot.idx[i]];
+      }
+    }
+#endif  // APOT || KIM
+
+    F2 = F1; /* shift F */
+
+    /* (c) minimize F(xi) along delta, xi and delta are updated */
+    F1 = linmin(xi, delta, F1, &xi1, &xi2, forces_1, forces_2);
+
+    df = F2 - F1;
+
+    if (df <= 0.0) {
+      if (fresh) {
+        /* no improvement even along the steepest descent, give up */
+        F1 = F2;
+        break;
+      }
+      /* bad quasi-Newton direction, forget the history and retry */
+      len = 0;
+      next = 0;
+      memcpy(grad, grad_old, g_calc.ndim * sizeof(double));
+      continue;
+    }
+
+    /* (d) new gradient and history update */
+    lbfgs_gradient(xi, forces_1, F1, grad, forces_2);
+
+    {
+      int idx = (next + len) % LBFGS_HISTORY;
+      double sy = 0.0;
+
+      for (int i = 0; i < g_calc.ndim; i++) {
+        s[idx][i] = delta[g_pot.opt_pot.idx[i]] / lbfgs_scale(i);
+        y[idx][i] = grad[i] - grad_old[i];
+        sy += s[idx][i] * y[idx][i];
+      }
+
+      /* only keep pairs that preserve positive curvature */
+      if (sy > VERY_SMALL) {
+        rho[idx] = 1.0 / sy;
+        if (len < LBFGS_HISTORY)
+          len++;
+        else
+          next = (next + 1) % LBFGS_HISTORY;
+      }
+    }
+
+#if defined(APOT) || defined(KIM)
+    printf("%5d\t%17.6f\t%6d\n", iter, F1, g_calc.fcalls);
+#else
+    printf("%d %f %f %f %f %f %f %d\n", iter, F1, xi[0], xi[1], xi[2], xi[3],
+           xi[4], g_calc.fcalls);
+#endif  // APOT
+    fflush(stdout);
+
+    /* End fit if break flagfile exists */
+    if (g_files.flagfile && strlen(g_files.flagfile)) {
+      FILE* ff = fopen(g_files.flagfile, "r");
+      if (ff != NULL) {
+        printf(
+            "Fit terminated prematurely in presence of break flagfile "
+            "\"%s\"!\n",
+            g_files.flagfile);
+        fclose(ff);
+        remove(g_files.flagfile);
+        break;
+      }
+    }
+
+    /* write temp file  */
+    if (g_files.tempfile && strlen(g_files.tempfile)) {
+#if defined(APOT)
+      update_apot_table(xi);
+#elif defined(KIM)
+      update_kim_table(xi);
+#endif  // APOT
+      write_pot_table_potfit_async(g_files.tempfile);
+    }
+
+    /* End fit if the improvement got smaller than d_eps */
+    if (df < PRECISION || df < g_calc.d_eps)
+      break;
+  }
+
+  if (df < PRECISION && df > 0.0)
+    printf("Precision reached: %10g\n", df);
+  else if (df <= 0.0)
+    printf("Could not find any further improvements, aborting!\n");
+  else if (df < g_calc.d_eps)
+    printf("Last improvement was smaller than d_eps (%f), aborting!\n",
+           g_calc.d_eps);
+  else
+    printf("Precision not reached!\n");
+
+#if defined(APOT)
+  update_apot_table(xi);
+#elif defined(KIM)
+  update_kim_table(xi);
+#endif  // APOT
+}
+
+/****************************************************************
+ *
+ * lbfgs_gradient: numerical gradient of the error sum with respect
+ *            to the range-scaled parameters, one force calculation
+ *            per parameter. The perturbations are farmed out to the
+ *            line search helper groups when they are available.
+ *
+ ****************************************************************/
+
+void lbfgs_gradient(double* xi, double* force_xi, double fxi, double* grad,
+                    double* force)
+{
+#if defined(MPI) && !defined(EVO)
+  static double* xi_pert;
+  int num_helpers = g_mpi.num_groups - 1;
+
+  if (num_helpers > 0) {
+    if (xi_pert == NULL)
+      xi_pert = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+
+    for (int base = 0; base < g_calc.ndim; base += num_helpers + 1) {
+      int extra = MIN(num_helpers, g_calc.ndim - base - 1);
+
+      for (int k = 0; k < extra; k++) {
+        int i = base + 1 + k;
+        memcpy(xi_pert, xi, g_calc.ndimtot * sizeof(double));
+        xi_pert[g_pot.opt_pot.idx[i]] += EPS * lbfgs_scale(i);
+        MPI_Send(xi_pert, g_calc.ndimtot, MPI_DOUBLE,
+                 g_mpi.group_leaders[k + 1], LINMIN_TAG_EVAL, MPI_COMM_WORLD);
+      }
+
+      /* own component, evaluated while the helpers work */
+      grad[base] =
+          lbfgs_gradient_component(xi, base, EPS * lbfgs_scale(base), force_xi,
+                                   fxi, force);
+
+      for (int k = 0; k < extra; k++) {
+        int i = base + 1 + k;
+        double cost = 0.0;
+        MPI_Recv(&cost, 1, MPI_DOUBLE, g_mpi.group_leaders[k + 1],
+                 LINMIN_TAG_EVAL, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(force, g_calc.mdim, MPI_DOUBLE, g_mpi.group_leaders[k + 1],
+                 LINMIN_TAG_EVAL, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+
+        if (cost > 2.0 * fxi) {
+          /* perturbation hit a steep wall, redo with a smaller step */
+          grad[i] = lbfgs_gradient_component(
+              xi, i, 0.1 * EPS * lbfgs_scale(i), force_xi, fxi, force);
+        } else {
+          grad[i] = 0.0;
+          for (int j = 0; j < g_calc.mdim; j++)
+            grad[i] += force_xi[j] * (force[j] - force_xi[j]);
+          grad[i] *= 2.0 / EPS;
+        }
+      }
+    }
+
+    return;
+  }
+#endif  // MPI && !EVO
+
+  for (int i = 0; i < g_calc.ndim; i++)
+    grad[i] = lbfgs_gradient_component(xi, i, EPS * lbfgs_scale(i), force_xi,
+                                       fxi, force);
+}
+
+/****************************************************************
+ *
+ * lbfgs_gradient_component: one gradient component from the
+ *            residual differences 2 sum_j f_j (f_j' - f_j) / h,
+ *            which avoids the positive bias the forward difference
+ *            of the squared sum carries. The step h is reduced when
+ *            the perturbation runs into a steep wall of the error
+ *            landscape, where the finite difference would be
+ *            meaningless.
+ *
+ ****************************************************************/
+
+double lbfgs_gradient_component(double* xi, int i, double h, double* force_xi,
+                                double fxi, double* force)
+{
+  double store = xi[g_pot.opt_pot.idx[i]];
+  double grad = 0.0;
+
+  for (int k = 0; k < 8; k++) {
+    xi[g_pot.opt_pot.idx[i]] = store + h;
+
+    double fp = calc_forces(xi, force, 0);
+
+    xi[g_pot.opt_pot.idx[i]] = store;
+
+    if (fp <= 2.0 * fxi || k == 7) {
+      for (int j = 0; j < g_calc.mdim; j++)
+        grad += force_xi[j] * (force[j] - force_xi[j]);
+      grad *= 2.0 * lbfgs_scale(i) / h;
+      break;
+    }
+
+    h *= 0.1;
+  }
+
+  return grad;
+}
+
+/****************************************************************
+ *
+ * lbfgs_scale: width of the allowed range of the i-th free
+ *            parameter, used to scale the finite differences
+ *
+ ****************************************************************/
+
+double lbfgs_scale(int i)
+{
+#if defined(APOT) || defined(KIM)
+  return g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]] -
+    g_pot.apot_table .pmin[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
+#else
+  (void)i;
+  return 1.0;
+#endif  // APOT
+}
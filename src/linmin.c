@@ -38,6 +38,7 @@
 #include "bracket.h"
 #include "force.h"
 #include "memory.h"
+#include "uq.h"
 #include "utils.h"
 
 #define TOL 1.0e-1
@@ -91,3 +92,59 @@ double linmin(double xi[], double del[], double fxi1, double* x1, double* x2,
 }
 
 #undef TOL
+
+#if defined(MPI) && !defined(EVO)
+
+/****************************************************************
+ *
+ *  evaluation loop of the line search helpers (the replica group
+ *  leaders after their annealing chains have finished): receive
+ *  candidate points from the root process, evaluate them with the
+ *  own group and return the cost and the force vector
+ *
+ ****************************************************************/
+
+void run_linmin_helper(double* forces)
+{
+  double* vecu = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+  MPI_Status status;
+
+  while (1) {
+    MPI_Recv(vecu, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_ANY_TAG, MPI_COMM_WORLD,
+             &status);
+
+    if (status.MPI_TAG == LINMIN_TAG_STOP)
+      break;
+
+    double cost = calc_forces(vecu, forces, 0);
+
+    MPI_Send(&cost, 1, MPI_DOUBLE, 0, LINMIN_TAG_EVAL, MPI_COMM_WORLD);
+    MPI_Send(forces, g_calc.mdim, MPI_DOUBLE, 0, LINMIN_TAG_EVAL,
+             MPI_COMM_WORLD);
+  }
+
+#if defined(UQ)
+  // the workers are still needed, this leader runs its own MC chain
+  run_uq_walker();
+#endif  // UQ
+
+  // go wake up the workers of this group
+  calc_forces(NULL, NULL, 1);
+}
+
+/****************************************************************
+ *
+ *  release the line search helpers when the root process is done
+ *
+ ****************************************************************/
+
+void stop_linmin_helpers()
+{
+  double dummy = 0.0;
+
+  for (int i = 1; i < g_mpi.num_groups; i++)
+    MPI_Send(&dummy, 1, MPI_DOUBLE, g_mpi.group_leaders[i], LINMIN_TAG_STOP,
+             MPI_COMM_WORLD);
+}
+
+#endif  // MPI && !EVO
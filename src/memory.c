@@ -27,6 +27,15 @@
  *
  *****************************************************************/
 
+// MAP_ANONYMOUS and madvise are not visible under plain -std=c99
+#define _DEFAULT_SOURCE
+
+#include <sys/mman.h>
+
+#if defined(OPENMP)
+#include <unistd.h>
+#endif  // OPENMP
+
 #include "potfit.h"
 
 #include "memory.h"
@@ -58,6 +67,33 @@ typedef struct {
 
 static potfit_memory g_memory;
 
+// slab state for Malloc_slab, the chunks themselves are ordinary
+// registered allocations and are released by free_allocated_memory
+
+#define SLAB_CHUNK_SIZE (4 * 1024 * 1024)
+#define SLAB_ALIGNMENT 16
+
+typedef struct {
+  char* current;
+  size_t bytes_left;
+  void** chunks;
+  int num_chunks;
+} potfit_slab;
+
+static potfit_slab g_slab;
+
+// mappings made by Malloc_huge, released with munmap instead of free
+
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+typedef struct {
+  void** blocks;
+  size_t* sizes;
+  int num_blocks;
+} potfit_huge;
+
+static potfit_huge g_huge;
+
 /****************************************************************
  *
  *  Malloc:
@@ -96,6 +132,205 @@ void* Malloc(size_t size)
   return p;
 }
 
+/****************************************************************
+ *
+ *  Malloc_first_touch:
+ *    allocate memory like Malloc, but zero it from the OpenMP team
+ *
+ *    Linux places a page on the NUMA node of the thread that first
+ *    writes to it. The packed per-neighbor arrays are traversed by
+ *    all threads of the force loop, so zeroing them from a static
+ *    parallel loop spreads their pages over the memory controllers
+ *    instead of leaving everything on the node of the main thread.
+ *    Without OpenMP this is plain Malloc.
+ *
+ ****************************************************************/
+
+void* Malloc_first_touch(size_t size)
+{
+#if defined(OPENMP)
+  if (size == 0)
+    error(1, "Allocating memory with size 0!\n");
+
+  void* p = malloc(size);
+
+  if (p == NULL)
+    error(1, "Error allocating resources\n");
+
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const long num_pages = (long)((size + page - 1) / page);
+
+#pragma omp parallel for schedule(static)
+  for (long i = 0; i < num_pages; i++) {
+    size_t offset = (size_t)i * page;
+    size_t length = size - offset;
+
+    if (length > page)
+      length = page;
+
+    memset((char*)p + offset, 0, length);
+  }
+
+  g_memory.pointers = (void**)realloc(
+      g_memory.pointers, sizeof(void*) * (g_memory.num_pointers + 1));
+
+  if (g_memory.pointers == NULL)
+    error(1, "Error allocating resources\n");
+
+  g_memory.pointers[g_memory.num_pointers] = p;
+  g_memory.num_pointers++;
+
+  return p;
+#else
+  return Malloc(size);
+#endif  // OPENMP
+}
+
+/****************************************************************
+ *
+ *  Malloc_huge:
+ *    allocate a large long-lived block backed by 2M huge pages
+ *
+ *    The packed neighbor arrays and the force vector of a large fit
+ *    span gigabytes and are walked on every evaluation, so mapping
+ *    them with 4K pages burns dTLB entries in the force kernels.
+ *    With the huge_pages parameter set, blocks of at least one huge
+ *    page are placed in their own anonymous mapping, preferably on
+ *    pre-reserved huge pages and otherwise with a transparent huge
+ *    page hint. Every fallback ends at Malloc_first_touch, so the
+ *    mode degrades gracefully on machines without huge pages. Huge
+ *    blocks cannot be passed to Realloc or freed individually, they
+ *    are unmapped by free_allocated_memory.
+ *
+ ****************************************************************/
+
+void* Malloc_huge(size_t size)
+{
+  // small blocks and disabled mode take the regular path
+  if (!g_param.huge_pages || size < HUGE_PAGE_SIZE)
+    return Malloc_first_touch(size);
+
+  const size_t map_size =
+      (size + HUGE_PAGE_SIZE - 1) & ~((size_t)HUGE_PAGE_SIZE - 1);
+
+  // pre-reserved huge pages first, then transparent ones
+  void* p = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+  if (p == MAP_FAILED) {
+    p = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED)
+      return Malloc_first_touch(size);
+
+    madvise(p, map_size, MADV_HUGEPAGE);
+  }
+
+  g_huge.blocks = (void**)realloc(g_huge.blocks,
+                                  sizeof(void*) * (g_huge.num_blocks + 1));
+  g_huge.sizes = (size_t*)realloc(g_huge.sizes,
+                                  sizeof(size_t) * (g_huge.num_blocks + 1));
+
+  if (g_huge.blocks == NULL || g_huge.sizes == NULL)
+    error(1, "Error allocating resources\n");
+
+  g_huge.blocks[g_huge.num_blocks] = p;
+  g_huge.sizes[g_huge.num_blocks] = map_size;
+  g_huge.num_blocks++;
+
+#if defined(OPENMP)
+  // anonymous mappings are already zeroed, but the first write places
+  // a page - touching from the team spreads the huge pages over the
+  // NUMA domains like in Malloc_first_touch
+  const long num_pages = (long)(map_size / HUGE_PAGE_SIZE);
+
+#pragma omp parallel for schedule(static)
+  for (long i = 0; i < num_pages; i++)
+    memset((char*)p + (size_t)i * HUGE_PAGE_SIZE, 0, HUGE_PAGE_SIZE);
+#endif  // OPENMP
+
+  return p;
+}
+
+/****************************************************************
+ *
+ *  Malloc_slab:
+ *    carve a small allocation out of a large chunk
+ *
+ *    intended for the many fixed-size tables with identical lifetime
+ *    (one neighbor table per atom), which would otherwise fragment
+ *    the heap, scatter the force-loop traversal over random pages
+ *    and fill the freeing array with millions of entries - slab
+ *    memory cannot be passed to Realloc or freed individually
+ *
+ ****************************************************************/
+
+void* Malloc_slab(size_t size)
+{
+  if (size == 0) {
+#if defined(ENABLE_ASAN)
+    // trigger asan on purpose
+    int* p = NULL;
+    *p = 1;
+#else
+    error(1, "Allocating memory with size 0!\n");
+#endif
+  }
+
+  // keep every returned pointer suitably aligned
+  size = (size + SLAB_ALIGNMENT - 1) & ~((size_t)SLAB_ALIGNMENT - 1);
+
+  if (size > g_slab.bytes_left) {
+    size_t chunk_size = (size > SLAB_CHUNK_SIZE) ? size : SLAB_CHUNK_SIZE;
+    g_slab.current = (char*)Malloc(chunk_size);
+    g_slab.bytes_left = chunk_size;
+
+    g_slab.chunks = (void**)realloc(g_slab.chunks,
+                                    sizeof(void*) * (g_slab.num_chunks + 1));
+
+    if (g_slab.chunks == NULL)
+      error(1, "Error allocating resources\n");
+
+    g_slab.chunks[g_slab.num_chunks] = g_slab.current;
+    g_slab.num_chunks++;
+  }
+
+  void* p = g_slab.current;
+
+  g_slab.current += size;
+  g_slab.bytes_left -= size;
+
+  return p;
+}
+
+/****************************************************************
+ *
+ *  Free_slab_memory:
+ *    release all slab chunks at once
+ *
+ *    only valid when no allocation made with Malloc_slab is used
+ *    anymore - every pointer into the slab dangles afterwards
+ *
+ ****************************************************************/
+
+void Free_slab_memory()
+{
+  for (int i = 0; i < g_slab.num_chunks; i++) {
+    for (int j = 0; j < g_memory.num_pointers; j++)
+      if (g_memory.pointers[j] == g_slab.chunks[i])
+        g_memory.pointers[j] = NULL;
+    free(g_slab.chunks[i]);
+  }
+
+  free(g_slab.chunks);
+
+  g_slab.current = NULL;
+  g_slab.bytes_left = 0;
+  g_slab.chunks = NULL;
+  g_slab.num_chunks = 0;
+}
+
 /****************************************************************
  *
  *  Realloc:
@@ -155,7 +390,22 @@ void initialize_global_variables()
   g_mpi.firstconf = 0;
   g_mpi.myatoms = 0;
   g_mpi.myconf = 0;
+  g_mpi.conf_size = 1;
+  g_mpi.conf_rank = 0;
+  g_mpi.conf_atom_first = 0;
+  g_mpi.conf_atom_count = 0;
 #if defined(MPI)
+  g_mpi.comm = MPI_COMM_WORLD;
+  g_mpi.leader_comm = MPI_COMM_NULL;
+  g_mpi.conf_comm = MPI_COMM_NULL;
+  g_mpi.node_comm = MPI_COMM_NULL;
+  g_mpi.internode_comm = MPI_COMM_NULL;
+  g_mpi.node_rank = 0;
+  g_mpi.world_id = 0;
+  g_mpi.world_cpus = 1;
+  g_mpi.num_groups = 1;
+  g_mpi.group = 0;
+  g_mpi.group_leaders = NULL;
   g_mpi.atom_dist = NULL;
   g_mpi.atom_len = NULL;
   g_mpi.conf_dist = NULL;
@@ -163,12 +413,16 @@ void initialize_global_variables()
 #endif  // MPI
 
   memset(&g_param, 0, sizeof(g_param));
+  g_param.config_cache = 1;
   g_param.imdpotsteps = 500;
   g_param.lammpspotsteps = 500;
   g_param.sweight = -1.0;
   g_param.global_cell_scale = 1.0;
 #if defined(EVO)
   g_param.evo_threshold = 1.0e-6;
+  g_param.evo_groups = 1;
+#else
+  g_param.anneal_replicas = 1;
 #endif  // EVO
 
   g_pot.interaction_name = NULL;
@@ -194,6 +448,15 @@ void initialize_global_variables()
   g_memory.pointers = NULL;
   g_memory.num_pointers = 0;
 
+  g_slab.current = NULL;
+  g_slab.bytes_left = 0;
+  g_slab.chunks = NULL;
+  g_slab.num_chunks = 0;
+
+  g_huge.blocks = NULL;
+  g_huge.sizes = NULL;
+  g_huge.num_blocks = 0;
+
 #if defined(PAIR)
   #if !defined(ANG)
     init_interaction_name("PAIR");
@@ -255,6 +518,13 @@ void free_allocated_memory()
     free(g_memory.pointers[i]);
 
   free(g_memory.pointers);
+  free(g_slab.chunks);
+
+  for (int i = 0; i < g_huge.num_blocks; i++)
+    munmap(g_huge.blocks[i], g_huge.sizes[i]);
+
+  free(g_huge.blocks);
+  free(g_huge.sizes);
 }
 
 /****************************************************************
@@ -31,8 +31,13 @@
 #define MEMORY_H_INCLUDED
 
 void* Malloc(size_t size);
+void* Malloc_first_touch(size_t size);
+void* Malloc_huge(size_t size);
+void* Malloc_slab(size_t size);
 void* Realloc(void* pvoid, size_t size);
 
+void Free_slab_memory();
+
 void initialize_global_variables();
 void free_allocated_memory();
 
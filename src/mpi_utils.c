@@ -49,10 +49,16 @@ int create_custom_datatypes();
 int broadcast_basic_data();
 int broadcast_calcpot_table();
 int broadcast_apot_table();
+int broadcast_shared(double** data, int count);
+int setup_evaluation_groups();
+int setup_hierarchical_bcast();
 int broadcast_configurations();
-int broadcast_atoms();
-int broadcast_neighbors();
-int broadcast_angles();
+int broadcast_partitions();
+
+// shared-memory windows holding read-only data, freed at shutdown
+#define MAX_SHARED_WINDOWS 4
+static MPI_Win g_shared_windows[MAX_SHARED_WINDOWS];
+static int g_num_shared_windows = 0;
 #endif  // MPI
 
 /****************************************************************
@@ -83,6 +89,11 @@ int initialize_mpi(int* argc, char*** argv)
     printf("Error getting MPI communicator rank! (Error: %d)\n", rval);
     return POTFIT_ERROR;
   }
+
+  // until the evaluation groups are set up the world is one big group
+  g_mpi.comm = MPI_COMM_WORLD;
+  g_mpi.world_id = g_mpi.myid;
+  g_mpi.world_cpus = g_mpi.num_cpus;
 #endif  // MPI
 
   if (g_mpi.myid == 0) {
@@ -107,6 +118,11 @@ void shutdown_mpi(void)
   if (g_mpi.init_done == 0) {
     int abort = -1;
     MPI_Bcast(&abort, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  } else {
+    // freeing a window is collective, so only do it after a complete
+    // setup where all processes hold the same windows
+    for (int i = 0; i < g_num_shared_windows; i++)
+      MPI_Win_free(&g_shared_windows[i]);
   }
   MPI_Finalize(); /* Shutdown */
 #endif            // MPI
@@ -135,12 +151,12 @@ int broadcast_params_mpi()
   CHECK_RETURN(broadcast_basic_data());
   CHECK_RETURN(broadcast_calcpot_table());
   CHECK_RETURN(broadcast_apot_table());
+  CHECK_RETURN(setup_evaluation_groups());
+  CHECK_RETURN(setup_hierarchical_bcast());
   CHECK_RETURN(broadcast_configurations());
-  CHECK_RETURN(broadcast_atoms());
-  CHECK_RETURN(broadcast_neighbors());
-  CHECK_RETURN(broadcast_angles());
+  CHECK_RETURN(broadcast_partitions());
 
-  if (g_mpi.myid == 0) {
+  if (g_mpi.world_id == 0) {
     printf("done\n");
     fflush(stdout);
   }
@@ -172,21 +188,21 @@ void potsync()
   /* Memory is allocated - just bcast that changed potential... */
   /* bcast begin/end/step/invstep of embedding energy  */
   MPI_Bcast(g_pot.calc_pot.begin + firstcol, g_param.ntypes, MPI_DOUBLE, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
   MPI_Bcast(g_pot.calc_pot.end + firstcol, g_param.ntypes, MPI_DOUBLE, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
   MPI_Bcast(g_pot.calc_pot.step + firstcol, g_param.ntypes, MPI_DOUBLE, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
   MPI_Bcast(g_pot.calc_pot.invstep + firstcol, g_param.ntypes, MPI_DOUBLE, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
   MPI_Bcast(g_pot.calc_pot.first + firstcol, g_param.ntypes, MPI_INT, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
 
   /* bcast table values of transfer fn. and embedding energy */
   int firstval = g_pot.calc_pot.first[g_calc.paircol];
   int nvals = g_pot.calc_pot.len - firstval;
   MPI_Bcast(g_pot.calc_pot.table + firstval, nvals, MPI_DOUBLE, 0,
-            MPI_COMM_WORLD);
+            g_mpi.comm);
 #endif  // MPI
 }
 
@@ -310,6 +326,13 @@ int create_custom_datatypes()
 
   CHECK_RETURN(MPI_Type_create_struct(size_a, data_len, data_size, data_type,
                                       &g_mpi.MPI_NEIGH));
+
+  // resize to the true record size, so the type can stride over whole
+  // arrays of records in the packed transfers
+  MPI_Datatype neigh_struct = g_mpi.MPI_NEIGH;
+  CHECK_RETURN(MPI_Type_create_resized(neigh_struct, 0, sizeof(neigh_t),
+                                       &g_mpi.MPI_NEIGH));
+  CHECK_RETURN(MPI_Type_free(&neigh_struct));
   CHECK_RETURN(MPI_Type_commit(&g_mpi.MPI_NEIGH));
 
 #if defined(THREEBODY)
@@ -360,6 +383,11 @@ int create_custom_datatypes()
 
   CHECK_RETURN(MPI_Type_create_struct(size_a, data_len, data_size, data_type,
                                       &g_mpi.MPI_ANGL));
+
+  MPI_Datatype angle_struct = g_mpi.MPI_ANGL;
+  CHECK_RETURN(MPI_Type_create_resized(angle_struct, 0, sizeof(angle_t),
+                                       &g_mpi.MPI_ANGL));
+  CHECK_RETURN(MPI_Type_free(&angle_struct));
   CHECK_RETURN(MPI_Type_commit(&g_mpi.MPI_ANGL));
 #endif  // THREEBODY
 
@@ -455,11 +483,79 @@ int create_custom_datatypes()
 
   CHECK_RETURN(MPI_Type_create_struct(size_a, data_len, data_size, data_type,
                                       &g_mpi.MPI_ATOM));
+
+  MPI_Datatype atom_struct = g_mpi.MPI_ATOM;
+  CHECK_RETURN(MPI_Type_create_resized(atom_struct, 0, sizeof(atom_t),
+                                       &g_mpi.MPI_ATOM));
+  CHECK_RETURN(MPI_Type_free(&atom_struct));
   CHECK_RETURN(MPI_Type_commit(&g_mpi.MPI_ATOM));
 
   return MPI_SUCCESS;
 }
 
+/****************************************************************
+    broadcast_shared
+      distribute a read-only double array into one MPI-3
+      shared-memory window per node, so that all processes of a
+      node read the same copy instead of each holding its own
+****************************************************************/
+
+int broadcast_shared(double** data, int count)
+{
+  if (g_num_shared_windows == MAX_SHARED_WINDOWS)
+    error(1, "Too many shared-memory windows!\n");
+
+  MPI_Comm node_comm = MPI_COMM_NULL;
+
+  CHECK_RETURN(MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED,
+                                   g_mpi.world_id, MPI_INFO_NULL, &node_comm));
+
+  int node_rank = 0;
+
+  CHECK_RETURN(MPI_Comm_rank(node_comm, &node_rank));
+
+  MPI_Win* win = &g_shared_windows[g_num_shared_windows++];
+  MPI_Aint bytes = (node_rank == 0) ? (MPI_Aint)count * sizeof(double) : 0;
+  double* base = NULL;
+
+  CHECK_RETURN(MPI_Win_allocate_shared(bytes, sizeof(double), MPI_INFO_NULL,
+                                       node_comm, &base, win));
+
+  if (node_rank != 0) {
+    MPI_Aint query_bytes = 0;
+    int query_disp = 0;
+    CHECK_RETURN(
+        MPI_Win_shared_query(*win, 0, &query_bytes, &query_disp, &base));
+  }
+
+  // the node leaders receive the data directly into their windows,
+  // the lowest world rank on each node leads, so the reading process
+  // is the root of the leader communicator
+  MPI_Comm leader_comm = MPI_COMM_NULL;
+
+  CHECK_RETURN(MPI_Comm_split(MPI_COMM_WORLD,
+                              node_rank == 0 ? 0 : MPI_UNDEFINED,
+                              g_mpi.world_id, &leader_comm));
+
+  CHECK_RETURN(MPI_Win_fence(0, *win));
+
+  if (node_rank == 0) {
+    if (g_mpi.world_id == 0)
+      memcpy(base, *data, count * sizeof(double));
+    CHECK_RETURN(MPI_Bcast(base, count, MPI_DOUBLE, 0, leader_comm));
+  }
+
+  CHECK_RETURN(MPI_Win_fence(0, *win));
+
+  if (leader_comm != MPI_COMM_NULL)
+    CHECK_RETURN(MPI_Comm_free(&leader_comm));
+  CHECK_RETURN(MPI_Comm_free(&node_comm));
+
+  *data = base;
+
+  return MPI_SUCCESS;
+}
+
 /****************************************************************
     broadcast_basic_data
 ****************************************************************/
@@ -473,20 +569,58 @@ int broadcast_basic_data()
   CHECK_RETURN(MPI_Bcast(&g_config.nconf, 1, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_calc.paircol, 1, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_param.opt, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  // the final timer report is a collective over all ranks
+  CHECK_RETURN(MPI_Bcast(&g_param.phase_timers, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  // every process backs its packed neighbor data with its own scratch file
+  CHECK_RETURN(
+      MPI_Bcast(&g_param.config_stream, 1, MPI_INT, 0, MPI_COMM_WORLD));
+#if defined(EVO)
+  CHECK_RETURN(MPI_Bcast(&g_param.evo_groups, 1, MPI_INT, 0, MPI_COMM_WORLD));
+#else
+  CHECK_RETURN(
+      MPI_Bcast(&g_param.anneal_replicas, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  // replica chains derive their own seeds from the global one
+  CHECK_RETURN(MPI_Bcast(&g_param.rng_seed, 1, MPI_INT, 0, MPI_COMM_WORLD));
+
+  // the replica chains also need the annealing temperature setting
+  int temp_len = 0;
+  if (g_mpi.myid == 0 && g_param.anneal_temp)
+    temp_len = strlen(g_param.anneal_temp) + 1;
+  CHECK_RETURN(MPI_Bcast(&temp_len, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  if (temp_len > 0) {
+    if (g_mpi.myid > 0)
+      g_param.anneal_temp = (char*)Malloc(temp_len * sizeof(char));
+    CHECK_RETURN(MPI_Bcast((char*)g_param.anneal_temp, temp_len, MPI_CHAR, 0,
+                           MPI_COMM_WORLD));
+  }
+#endif  // EVO
+
+#if defined(UQ)
+  // the MC walkers on the group leaders sample their own chains
+#if defined(EVO)
+  CHECK_RETURN(MPI_Bcast(&g_param.rng_seed, 1, MPI_INT, 0, MPI_COMM_WORLD));
+#endif  // EVO
+  CHECK_RETURN(MPI_Bcast(&g_param.acc_moves, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(
+      MPI_Bcast(&g_param.acc_rescaling, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(&g_param.uq_temp, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(
+      MPI_Bcast(&g_param.hess_pert, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+#endif  // UQ
 
   // allocate and broadcast config metadata
   if (g_mpi.myid > 0) {
     g_config.inconf = (int*)Malloc(g_config.nconf * sizeof(int));
     g_config.cnfstart = (int*)Malloc(g_config.nconf * sizeof(int));
-    g_config.force_0 = (double*)Malloc(g_calc.mdim * sizeof(double));
     g_config.conf_weight = (double*)Malloc(g_config.nconf * sizeof(double));
   }
   CHECK_RETURN(
       MPI_Bcast(g_config.inconf, g_config.nconf, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(
       MPI_Bcast(g_config.cnfstart, g_config.nconf, MPI_INT, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(
-      MPI_Bcast(g_config.force_0, g_calc.mdim, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+  // the reference data is the largest read-only array and is only
+  // ever read during fitting, one copy per node is enough
+  CHECK_RETURN(broadcast_shared(&g_config.force_0, g_calc.mdim));
   CHECK_RETURN(MPI_Bcast(g_config.conf_weight, g_config.nconf, MPI_DOUBLE, 0,
                          MPI_COMM_WORLD));
 
@@ -563,6 +697,10 @@ int broadcast_apot_table()
 #if defined(APOT)
   CHECK_RETURN(MPI_Bcast(&g_param.enable_cp, 1, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_pot.opt_pot.len, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(
+      MPI_Bcast(&g_pot.opt_pot.idxlen, 1, MPI_INT, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(&g_param.apot_punish_value, 1, MPI_DOUBLE, 0,
+                         MPI_COMM_WORLD));
   CHECK_RETURN(
       MPI_Bcast(&g_pot.apot_table.number, 1, MPI_INT, 0, MPI_COMM_WORLD));
 #if defined(COULOMB)
@@ -592,7 +730,10 @@ int broadcast_apot_table()
     g_pot.apot_table.end =
         (double*)Malloc(g_pot.apot_table.number * sizeof(double));
     g_pot.apot_table.idxpot =
-        (int*)Malloc(g_pot.apot_table.number * sizeof(int));
+        (int*)Malloc(g_pot.opt_pot.len * sizeof(int));
+    g_pot.apot_table.idxparam =
+        (int*)Malloc(g_pot.opt_pot.len * sizeof(int));
+    g_pot.opt_pot.idx = (int*)Malloc(g_pot.opt_pot.len * sizeof(int));
 #if defined(COULOMB)
     g_pot.apot_table.ratio = (double*)Malloc(g_param.ntypes * sizeof(double));
 #endif  // COULOMB
@@ -605,6 +746,10 @@ int broadcast_apot_table()
     g_pot.apot_table.names = (char**)Malloc(g_pot.apot_table.number * sizeof(char*));
     g_pot.apot_table.fvalue = (fvalue_pointer*)Malloc(g_pot.apot_table.number *
                                                       sizeof(fvalue_pointer));
+    g_pot.apot_table.bvalue = (bvalue_pointer*)Malloc(g_pot.apot_table.number *
+                                                      sizeof(bvalue_pointer));
+    g_pot.apot_table.gvalue = (gvalue_pointer*)Malloc(g_pot.apot_table.number *
+                                                      sizeof(gvalue_pointer));
     g_pot.opt_pot.table = (double*)Malloc(g_pot.opt_pot.len * sizeof(double));
     g_pot.opt_pot.first = (int*)Malloc(g_pot.apot_table.number * sizeof(int));
   }
@@ -642,8 +787,12 @@ int broadcast_apot_table()
                          MPI_DOUBLE, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(g_pot.apot_table.begin, g_pot.apot_table.number,
                          MPI_DOUBLE, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(MPI_Bcast(g_pot.apot_table.idxpot, g_pot.apot_table.number,
+  CHECK_RETURN(MPI_Bcast(g_pot.apot_table.idxpot, g_pot.opt_pot.idxlen,
                          MPI_INT, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(g_pot.apot_table.idxparam, g_pot.opt_pot.idxlen,
+                         MPI_INT, 0, MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(g_pot.opt_pot.idx, g_pot.opt_pot.idxlen, MPI_INT, 0,
+                         MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_pot.cp_start, 1, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_pot.have_globals, 1, MPI_INT, 0, MPI_COMM_WORLD));
   CHECK_RETURN(MPI_Bcast(&g_pot.global_idx, 1, MPI_INT, 0, MPI_COMM_WORLD));
@@ -680,174 +829,559 @@ int broadcast_apot_table()
         CHECK_RETURN(MPI_Bcast(g_pot.apot_table.global_idx[i][j], 2, MPI_INT, 0,
                                MPI_COMM_WORLD));
   }
+
+  // The evaluation group leaders run the root part of calc_forces and
+  // need the bounds of all optimizable parameters for apot_punish.
+  // Only the entries addressed via idxpot/idxparam are rebuilt here.
+  if (g_pot.opt_pot.idxlen > 0) {
+    int idxlen = g_pot.opt_pot.idxlen;
+
+    if (g_mpi.myid > 0) {
+      int nrows = 0;
+
+      for (int i = 0; i < idxlen; i++)
+        nrows = MAX(nrows, g_pot.apot_table.idxpot[i] + 1);
+
+      g_pot.apot_table.pmin = (double**)Malloc(nrows * sizeof(double*));
+      g_pot.apot_table.pmax = (double**)Malloc(nrows * sizeof(double*));
+
+      for (int i = 0; i < nrows; i++) {
+        int ncols = 0;
+
+        for (int j = 0; j < idxlen; j++)
+          if (g_pot.apot_table.idxpot[j] == i)
+            ncols = MAX(ncols, g_pot.apot_table.idxparam[j] + 1);
+
+        if (ncols > 0) {
+          g_pot.apot_table.pmin[i] = (double*)Malloc(ncols * sizeof(double));
+          g_pot.apot_table.pmax[i] = (double*)Malloc(ncols * sizeof(double));
+        }
+      }
+    }
+
+    double* bounds = (double*)Malloc(2 * idxlen * sizeof(double));
+
+    if (g_mpi.myid == 0) {
+      for (int i = 0; i < idxlen; i++) {
+        bounds[2 * i] = g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]]
+                                             [g_pot.apot_table.idxparam[i]];
+        bounds[2 * i + 1] = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]]
+                                                 [g_pot.apot_table.idxparam[i]];
+      }
+    }
+
+    CHECK_RETURN(
+        MPI_Bcast(bounds, 2 * idxlen, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+
+    if (g_mpi.myid > 0) {
+      for (int i = 0; i < idxlen; i++) {
+        g_pot.apot_table.pmin[g_pot.apot_table.idxpot[i]]
+                             [g_pot.apot_table.idxparam[i]] = bounds[2 * i];
+        g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]]
+                             [g_pot.apot_table.idxparam[i]] =
+            bounds[2 * i + 1];
+      }
+    }
+  }
 #endif  // APOT
 
   return MPI_SUCCESS;
 }
 
+/****************************************************************
+    setup_evaluation_groups
+****************************************************************/
+
+int setup_evaluation_groups()
+{
+#if defined(EVO)
+  const char* group_param = "evo_groups";
+  int num_groups = g_param.evo_groups;
+#else
+  const char* group_param = "anneal_replicas";
+  int num_groups = g_param.anneal_replicas;
+#endif  // EVO
+
+  if (num_groups > g_mpi.world_cpus) {
+    error(0, "%s cannot exceed the number of MPI processes!\n", group_param);
+    error(0, "You requested %d groups with %d processes\n", num_groups,
+          g_mpi.world_cpus);
+    return POTFIT_ERROR;
+  }
+
+#if !defined(EVO) && !defined(APOT)
+  // the replica chains run on the group leaders, which only have the
+  // analytic potential tables available
+  if (num_groups > 1) {
+    error(0, "anneal_replicas > 1 requires analytic potentials!\n");
+    return POTFIT_ERROR;
+  }
+#endif  // !EVO && !APOT
+
+  g_mpi.num_groups = num_groups;
+
+  if (g_mpi.num_groups == 1)
+    return MPI_SUCCESS;
+
+  // contiguous ranges of world ranks form the groups, the lowest rank
+  // of each group acts as its leader
+  g_mpi.group = g_mpi.world_id * g_mpi.num_groups / g_mpi.world_cpus;
+
+  CHECK_RETURN(MPI_Comm_split(MPI_COMM_WORLD, g_mpi.group, g_mpi.world_id,
+                              &g_mpi.comm));
+  CHECK_RETURN(MPI_Comm_size(g_mpi.comm, &g_mpi.num_cpus));
+  CHECK_RETURN(MPI_Comm_rank(g_mpi.comm, &g_mpi.myid));
+
+  g_mpi.group_leaders = (int*)Malloc(g_mpi.num_groups * sizeof(int));
+  for (int i = 0; i < g_mpi.num_groups; i++)
+    g_mpi.group_leaders[i] =
+        (i * g_mpi.world_cpus + g_mpi.num_groups - 1) / g_mpi.num_groups;
+
+  // the leaders get their own communicator, its rank order matches the
+  // group indices
+  CHECK_RETURN(MPI_Comm_split(MPI_COMM_WORLD,
+                              g_mpi.myid == 0 ? 0 : MPI_UNDEFINED,
+                              g_mpi.world_id, &g_mpi.leader_comm));
+
+  if (g_mpi.world_id == 0)
+    printf("\nSplitting %d processes into %d evaluation groups.\n",
+           g_mpi.world_cpus, g_mpi.num_groups);
+
+  return MPI_SUCCESS;
+}
+
+/****************************************************************
+    setup_hierarchical_bcast
+
+    The parameter vector is broadcast to the whole evaluation group
+    before every force calculation, and at scale the latency of a
+    flat broadcast crossing the network for every process becomes
+    visible in each line search step. Splitting the group by shared
+    memory lets one message per node cross the network, the fan-out
+    to the remaining processes of a node then happens locally.
+****************************************************************/
+
+int setup_hierarchical_bcast()
+{
+  MPI_Comm node_comm = MPI_COMM_NULL;
+
+  CHECK_RETURN(MPI_Comm_split_type(g_mpi.comm, MPI_COMM_TYPE_SHARED,
+                                   g_mpi.myid, MPI_INFO_NULL, &node_comm));
+
+  int node_size = 0;
+  int node_rank = 0;
+
+  CHECK_RETURN(MPI_Comm_size(node_comm, &node_size));
+  CHECK_RETURN(MPI_Comm_rank(node_comm, &node_rank));
+
+  // a single node needs no second level, keep the flat broadcast
+  if (node_size == g_mpi.num_cpus) {
+    CHECK_RETURN(MPI_Comm_free(&node_comm));
+    return MPI_SUCCESS;
+  }
+
+  g_mpi.node_comm = node_comm;
+  g_mpi.node_rank = node_rank;
+
+  // the lowest rank of each node relays the data across the network,
+  // the group leader is the lowest rank of its node and thus the root
+  // of both stages
+  CHECK_RETURN(MPI_Comm_split(g_mpi.comm, node_rank == 0 ? 0 : MPI_UNDEFINED,
+                              g_mpi.myid, &g_mpi.internode_comm));
+
+  return MPI_SUCCESS;
+}
+
+/****************************************************************
+    broadcast_hierarchical
+      broadcast doubles from the group leader in two stages: one
+      message to each node first, shared-memory fan-out second
+****************************************************************/
+
+int broadcast_hierarchical(double* buffer, int count)
+{
+  if (g_mpi.node_comm == MPI_COMM_NULL)
+    return MPI_Bcast(buffer, count, MPI_DOUBLE, 0, g_mpi.comm);
+
+  if (g_mpi.node_rank == 0)
+    CHECK_RETURN(
+        MPI_Bcast(buffer, count, MPI_DOUBLE, 0, g_mpi.internode_comm));
+
+  return MPI_Bcast(buffer, count, MPI_DOUBLE, 0, g_mpi.node_comm);
+}
+
 /****************************************************************
     broadcast_configurations
 ****************************************************************/
 
 int broadcast_configurations()
 {
-  if (g_mpi.num_cpus == 1) {
+  if (g_mpi.world_cpus == 1) {
     error(0, "Running potfit with a single MPI process is not supported!\n");
     error(0, "This creates a hugh overhead and slows down the process significantly!\n");
     return POTFIT_ERROR;
   }
 
-  if (g_mpi.num_cpus > g_config.nconf) {
+#if !defined(PAIR)
+  // splitting the atom loop of a configuration between several processes
+  // needs per-configuration partial sums, which only the pair force
+  // routine supports - all other interactions require one process per
+  // configuration
+  // the check has to give the same result on all processes, so the
+  // largest evaluation group decides
+  int max_group_cpus = g_mpi.num_cpus;
+
+  if (g_mpi.num_groups > 1) {
+    for (int i = 0; i < g_mpi.num_groups; i++) {
+      int next = (i == g_mpi.num_groups - 1) ? g_mpi.world_cpus
+                                             : g_mpi.group_leaders[i + 1];
+      max_group_cpus = MAX(max_group_cpus, next - g_mpi.group_leaders[i]);
+    }
+  }
+
+  if (max_group_cpus > g_config.nconf) {
     error(0, "Running potfit with more MPI processes than configurations is not supported!\n");
-    error(0, "You provided %d configurations and requested %d processes\n", g_config.nconf, g_mpi.num_cpus);
+    error(0, "You provided %d configurations and requested %d processes%s\n",
+          g_config.nconf, max_group_cpus,
+          g_mpi.num_groups > 1 ? " per evaluation group" : "");
     return POTFIT_ERROR;
   }
+#endif  // !PAIR
+
+  // Each node gets a contiguous block of configurations with roughly
+  // the same estimated evaluation cost. The cost of a configuration is
+  // dominated by its neighbor count, so datasets mixing small bulk
+  // cells with large slabs are split very unevenly by a plain
+  // configuration count and some processes would idle at the gather
+  // after every evaluation.
+
+  double* cost = (double*)Malloc(g_config.nconf * sizeof(double));
+
+  if (g_mpi.world_id == 0) {
+    for (int i = 0; i < g_config.nconf; i++) {
+      cost[i] = g_config.inconf[i];
+      for (int j = 0; j < g_config.inconf[i]; j++)
+        cost[i] += g_config.atoms[g_config.cnfstart[i] + j].num_neigh;
+    }
+  }
 
-  // Each node: nconf/num_cpus configurations.
-  // Last nconf%num_cpus nodes: 1 additional config
+  CHECK_RETURN(
+      MPI_Bcast(cost, g_config.nconf, MPI_DOUBLE, 0, MPI_COMM_WORLD));
 
-  if (g_mpi.myid == 0) {
-    int each = (g_config.nconf / g_mpi.num_cpus);
-    int odd = (g_config.nconf % g_mpi.num_cpus) - g_mpi.num_cpus;
+  double total_cost = 0.0;
+
+  for (int i = 0; i < g_config.nconf; i++)
+    total_cost += cost[i];
+
+  // every process computes the distribution for its own evaluation
+  // group, the cost array is identical everywhere so the groups agree
+  // on the result without further communication
+
+  g_mpi.atom_len = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
+  g_mpi.atom_dist = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
+  g_mpi.conf_len = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
+  g_mpi.conf_dist = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
+
+  if (g_mpi.num_cpus <= g_config.nconf) {
+    int conf = 0;
+    double assigned = 0.0;
+
+    for (int i = 0; i < g_mpi.num_cpus; i++) {
+      g_mpi.conf_dist[i] = conf;
+
+      if (i == g_mpi.num_cpus - 1) {
+        // the last process takes all remaining configurations
+        conf = g_config.nconf;
+        break;
+      }
+
+      double target = (total_cost - assigned) / (g_mpi.num_cpus - i);
+      double block = 0.0;
+
+      // grow the block while adding the next configuration brings it
+      // closer to the target cost, but leave one configuration for
+      // each of the remaining processes
+      while (conf < g_config.nconf - (g_mpi.num_cpus - i - 1) &&
+             (block == 0.0 || target - block > 0.5 * cost[conf])) {
+        block += cost[conf];
+        conf++;
+      }
+
+      assigned += block;
+    }
 
-    g_mpi.atom_len = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
-    g_mpi.atom_dist = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
-    g_mpi.conf_len = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
-    g_mpi.conf_dist = (int*)Malloc(g_mpi.num_cpus * sizeof(int));
-    for (int i = 0; i < g_mpi.num_cpus; i++)
-      g_mpi.conf_dist[i] = i * each + (((i + odd) > 0) ? (i + odd) : 0);
     for (int i = 0; i < g_mpi.num_cpus - 1; i++)
       g_mpi.conf_len[i] = g_mpi.conf_dist[i + 1] - g_mpi.conf_dist[i];
     g_mpi.conf_len[g_mpi.num_cpus - 1] =
         g_config.nconf - g_mpi.conf_dist[g_mpi.num_cpus - 1];
     for (int i = 0; i < g_mpi.num_cpus; i++)
-      g_mpi.atom_dist[i] =
-          g_config.cnfstart[i * each + (((i + odd) > 0) ? (i + odd) : 0)];
+      g_mpi.atom_dist[i] = g_config.cnfstart[g_mpi.conf_dist[i]];
     for (int i = 0; i < g_mpi.num_cpus - 1; i++)
       g_mpi.atom_len[i] = g_mpi.atom_dist[i + 1] - g_mpi.atom_dist[i];
     g_mpi.atom_len[g_mpi.num_cpus - 1] =
         g_config.natoms - g_mpi.atom_dist[g_mpi.num_cpus - 1];
-  }
 
-  CHECK_RETURN(MPI_Scatter(g_mpi.atom_len, 1, MPI_INT, &g_mpi.myatoms, 1,
-                           MPI_INT, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(MPI_Scatter(g_mpi.atom_dist, 1, MPI_INT, &g_mpi.firstatom, 1,
-                           MPI_INT, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(MPI_Scatter(g_mpi.conf_len, 1, MPI_INT, &g_mpi.myconf, 1,
-                           MPI_INT, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(MPI_Scatter(g_mpi.conf_dist, 1, MPI_INT, &g_mpi.firstconf, 1,
-                           MPI_INT, 0, MPI_COMM_WORLD));
+    g_mpi.myatoms = g_mpi.atom_len[g_mpi.myid];
+    g_mpi.firstatom = g_mpi.atom_dist[g_mpi.myid];
+    g_mpi.myconf = g_mpi.conf_len[g_mpi.myid];
+    g_mpi.firstconf = g_mpi.conf_dist[g_mpi.myid];
+  } else {
+    // more processes than configurations: the surplus processes join
+    // a team that shares a configuration and splits its atom loop,
+    // the most expensive configurations get the largest teams
+    int* team_size = (int*)Malloc(g_config.nconf * sizeof(int));
+
+    for (int i = 0; i < g_config.nconf; i++)
+      team_size[i] = 1;
+
+    for (int extra = g_config.nconf; extra < g_mpi.num_cpus; extra++) {
+      int best = 0;
+      for (int i = 1; i < g_config.nconf; i++)
+        if (cost[i] / (team_size[i] + 1) > cost[best] / (team_size[best] + 1))
+          best = i;
+      team_size[best]++;
+    }
 
-  g_config.conf_vol = (double*)Malloc(g_mpi.myconf * sizeof(double));
-  g_config.conf_uf = (int*)Malloc(g_mpi.myconf * sizeof(int));
+    // only the first process of each team contributes its
+    // configuration to the gathers after every evaluation
+    int rank = 0;
+    for (int i = 0; i < g_config.nconf; i++) {
+      for (int j = 0; j < team_size[i]; j++, rank++) {
+        g_mpi.conf_dist[rank] = i;
+        g_mpi.conf_len[rank] = (j == 0) ? 1 : 0;
+        g_mpi.atom_dist[rank] = g_config.cnfstart[i];
+        g_mpi.atom_len[rank] = (j == 0) ? g_config.inconf[i] : 0;
+        if (rank == g_mpi.myid) {
+          g_mpi.conf_size = team_size[i];
+          g_mpi.conf_rank = j;
+        }
+      }
+    }
 
-  CHECK_RETURN(MPI_Scatterv(g_config.volume, g_mpi.conf_len, g_mpi.conf_dist,
-                            MPI_DOUBLE, g_config.conf_vol, g_mpi.myconf,
-                            MPI_DOUBLE, 0, MPI_COMM_WORLD));
-  CHECK_RETURN(MPI_Scatterv(g_config.useforce, g_mpi.conf_len, g_mpi.conf_dist,
-                            MPI_INT, g_config.conf_uf, g_mpi.myconf, MPI_INT, 0,
-                            MPI_COMM_WORLD));
+    // every team member holds the complete configuration, but only
+    // computes its own slice of the atom loop
+    g_mpi.myconf = 1;
+    g_mpi.firstconf = g_mpi.conf_dist[g_mpi.myid];
+    g_mpi.myatoms = g_config.inconf[g_mpi.firstconf];
+    g_mpi.firstatom = g_config.cnfstart[g_mpi.firstconf];
+    g_mpi.conf_atom_first =
+        (g_mpi.myatoms * g_mpi.conf_rank) / g_mpi.conf_size;
+    g_mpi.conf_atom_count =
+        (g_mpi.myatoms * (g_mpi.conf_rank + 1)) / g_mpi.conf_size -
+        g_mpi.conf_atom_first;
+
+    if (g_mpi.world_id == 0)
+      printf("\nSharing %d configurations between %d processes.\n",
+             g_config.nconf, g_mpi.num_cpus);
+  }
 
+  // processes sharing a configuration combine their partial sums on a
+  // dedicated communicator, all other processes get a private one
+  CHECK_RETURN(MPI_Comm_split(
+      g_mpi.comm,
+      g_mpi.conf_size > 1 ? g_mpi.firstconf : g_config.nconf + g_mpi.myid,
+      g_mpi.myid, &g_mpi.conf_comm));
+
+  // distribute the per-configuration data, every process cuts out its
+  // own slice of the full arrays
+  if (g_mpi.world_id > 0) {
+    g_config.volume = (double*)Malloc(g_config.nconf * sizeof(double));
+    g_config.useforce = (int*)Malloc(g_config.nconf * sizeof(int));
 #if defined(STRESS)
-  g_config.conf_us = (int*)Malloc(g_mpi.myconf * sizeof(double));
+    g_config.usestress = (int*)Malloc(g_config.nconf * sizeof(int));
+#endif  // STRESS
+  }
 
-  CHECK_RETURN(MPI_Scatterv(g_config.usestress, g_mpi.conf_len, g_mpi.conf_dist,
-                            MPI_INT, g_config.conf_us, g_mpi.myconf, MPI_INT, 0,
-                            MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(g_config.volume, g_config.nconf, MPI_DOUBLE, 0,
+                         MPI_COMM_WORLD));
+  CHECK_RETURN(MPI_Bcast(g_config.useforce, g_config.nconf, MPI_INT, 0,
+                         MPI_COMM_WORLD));
+#if defined(STRESS)
+  CHECK_RETURN(MPI_Bcast(g_config.usestress, g_config.nconf, MPI_INT, 0,
+                         MPI_COMM_WORLD));
+#endif  // STRESS
+
+  // the slices are read-only for the whole run, a view into the full
+  // arrays replaces the former per-process copies
+  g_config.conf_vol = g_config.volume + g_mpi.firstconf;
+  g_config.conf_uf = g_config.useforce + g_mpi.firstconf;
+#if defined(STRESS)
+  g_config.conf_us = g_config.usestress + g_mpi.firstconf;
 #endif  // STRESS
 
   return MPI_SUCCESS;
 }
 
 /****************************************************************
-    scatter atom table
+    broadcast_partitions
+      scatter the atom, neighbor and angle tables
+
+    The former per-atom and per-record broadcasts amounted to
+    hundreds of thousands of latency-bound messages at scale. The
+    root now packs each process' whole partition into one contiguous
+    block and ships all blocks with a single scatter per table.
+    Processes sharing a configuration receive identical blocks, the
+    root simply packs those more than once.
 ****************************************************************/
 
-int broadcast_atoms()
+int broadcast_partitions()
 {
-  atom_t atom;
+  // every process announces its atom range to the root
+  int range[2] = {g_mpi.firstatom, g_mpi.myatoms};
+  int* ranges = NULL;
+  int* counts = NULL;
+  int* displs = NULL;
+
+  if (g_mpi.world_id == 0) {
+    ranges = (int*)Malloc(2 * g_mpi.world_cpus * sizeof(int));
+    counts = (int*)Malloc(g_mpi.world_cpus * sizeof(int));
+    displs = (int*)Malloc(g_mpi.world_cpus * sizeof(int));
+  }
 
-  g_config.conf_atoms = (atom_t*)Malloc(g_mpi.myatoms * sizeof(atom_t));
+  CHECK_RETURN(
+      MPI_Gather(range, 2, MPI_INT, ranges, 2, MPI_INT, 0, MPI_COMM_WORLD));
 
-  for (int i = 0; i < g_config.natoms; i++) {
-    if (g_mpi.myid == 0)
-      atom = g_config.atoms[i];
-    CHECK_RETURN(MPI_Bcast(&atom, 1, g_mpi.MPI_ATOM, 0, MPI_COMM_WORLD));
-    if (i >= g_mpi.firstatom && i < (g_mpi.firstatom + g_mpi.myatoms))
-      g_config.conf_atoms[i - g_mpi.firstatom] = atom;
-  }
+  // atom records
+  //
+  // The root already owns the full tables, its partition is a view into
+  // them and nothing is copied: MPI_IN_PLACE leaves the root out of the
+  // scatters and its segment is dropped from the pack buffers. The
+  // records also keep their valid neighbor and angle pointers that way.
 
-  return MPI_SUCCESS;
-}
+  atom_t* atom_pack = NULL;
 
-/****************************************************************
-    scatter dynamic neighbor table
-****************************************************************/
+  if (g_mpi.world_id == 0) {
+    g_config.conf_atoms = g_config.atoms + g_mpi.firstatom;
 
-int broadcast_neighbors()
-{
-  int num_neighs = 0;
-  neigh_t neigh;
-  atom_t* atom = NULL;
-
-  memset(&neigh, 0, sizeof(neigh));
-
-  for (int i = 0; i < g_config.natoms; ++i) {
-    atom = g_config.conf_atoms + i - g_mpi.firstatom;
-    if (g_mpi.myid == 0)
-      num_neighs = g_config.atoms[i].num_neigh;
-    CHECK_RETURN(MPI_Bcast(&num_neighs, 1, MPI_INT, 0, MPI_COMM_WORLD));
-    if (num_neighs > 0 && i >= g_mpi.firstatom &&
-        i < (g_mpi.firstatom + g_mpi.myatoms)) {
-      atom->neigh = (neigh_t*)Malloc(num_neighs * sizeof(neigh_t));
-      for (int j = 0; j < num_neighs; ++j)
-        memset(atom->neigh + j, 0, sizeof(neigh_t));
+    int total = 0;
+    for (int r = 0; r < g_mpi.world_cpus; r++) {
+      counts[r] = (r == 0) ? 0 : ranges[2 * r + 1];
+      displs[r] = total;
+      total += counts[r];
+    }
+    // the pack buffers are transient and can be large, the registered
+    // allocator would keep them resident until shutdown
+    atom_pack = (atom_t*)malloc(total * sizeof(atom_t));
+    if (atom_pack == NULL && total > 0)
+      error(1, "Error allocating resources\n");
+    for (int r = 1; r < g_mpi.world_cpus; r++)
+      memcpy(atom_pack + displs[r], g_config.atoms + ranges[2 * r],
+             counts[r] * sizeof(atom_t));
+  } else
+    g_config.conf_atoms = (atom_t*)Malloc(g_mpi.myatoms * sizeof(atom_t));
+
+  CHECK_RETURN(MPI_Scatterv(
+      atom_pack, counts, displs, g_mpi.MPI_ATOM,
+      g_mpi.world_id == 0 ? MPI_IN_PLACE : g_config.conf_atoms, g_mpi.myatoms,
+      g_mpi.MPI_ATOM, 0, MPI_COMM_WORLD));
+
+  if (g_mpi.world_id == 0)
+    free(atom_pack);
+
+  // neighbor records, one contiguous slab per process
+
+  int num_neigh = 0;
+
+  if (g_mpi.world_id > 0)
+    for (int i = 0; i < g_mpi.myatoms; i++)
+      num_neigh += g_config.conf_atoms[i].num_neigh;
+
+  neigh_t* neigh_slab =
+      num_neigh ? (neigh_t*)Malloc_slab(num_neigh * sizeof(neigh_t)) : NULL;
+  neigh_t* neigh_pack = NULL;
+
+  if (g_mpi.world_id == 0) {
+    int total = 0;
+    for (int r = 0; r < g_mpi.world_cpus; r++) {
+      counts[r] = 0;
+      if (r > 0)
+        for (int i = 0; i < ranges[2 * r + 1]; i++)
+          counts[r] += g_config.atoms[ranges[2 * r] + i].num_neigh;
+      displs[r] = total;
+      total += counts[r];
     }
-    for (int j = 0; j < num_neighs; ++j) {
-      if (g_mpi.myid == 0)
-        neigh = g_config.atoms[i].neigh[j];
-      CHECK_RETURN(MPI_Bcast(&neigh, 1, g_mpi.MPI_NEIGH, 0, MPI_COMM_WORLD));
-      if (i >= g_mpi.firstatom && i < (g_mpi.firstatom + g_mpi.myatoms))
-        atom->neigh[j] = neigh;
+    neigh_pack = (neigh_t*)malloc(total * sizeof(neigh_t));
+    if (neigh_pack == NULL && total > 0)
+      error(1, "Error allocating resources\n");
+    for (int r = 1; r < g_mpi.world_cpus; r++) {
+      neigh_t* pos = neigh_pack + displs[r];
+      for (int i = 0; i < ranges[2 * r + 1]; i++) {
+        const atom_t* atom = g_config.atoms + ranges[2 * r] + i;
+        if (atom->num_neigh)
+          memcpy(pos, atom->neigh, atom->num_neigh * sizeof(neigh_t));
+        pos += atom->num_neigh;
+      }
     }
   }
 
-  return MPI_SUCCESS;
-}
+  CHECK_RETURN(MPI_Scatterv(neigh_pack, counts, displs, g_mpi.MPI_NEIGH,
+                            g_mpi.world_id == 0 ? MPI_IN_PLACE : neigh_slab,
+                            num_neigh, g_mpi.MPI_NEIGH, 0, MPI_COMM_WORLD));
 
-/***************************************************************************
-    scatter dynamic angle table
-**************************************************************************/
+  if (g_mpi.world_id == 0)
+    free(neigh_pack);
+
+  if (g_mpi.world_id > 0) {
+    num_neigh = 0;
+
+    for (int i = 0; i < g_mpi.myatoms; i++) {
+      g_config.conf_atoms[i].neigh =
+          g_config.conf_atoms[i].num_neigh ? neigh_slab + num_neigh : NULL;
+      num_neigh += g_config.conf_atoms[i].num_neigh;
+    }
+  }
 
-int broadcast_angles()
-{
 #if defined(THREEBODY)
-  int num_angles = 0;
-  angle_t angle;
-  atom_t* atom = NULL;
+  // angle records, one contiguous slab per process
 
-  memset(&angle, 0, sizeof(angle));
+  int num_angles = 0;
 
-  for (int i = 0; i < g_config.natoms; ++i) {
-    atom = g_config.conf_atoms + i - g_mpi.firstatom;
-    if (g_mpi.myid == 0)
-      num_angles = g_config.atoms[i].num_angles;
-    CHECK_RETURN(MPI_Bcast(&num_angles, 1, MPI_INT, 0, MPI_COMM_WORLD));
-#if defined(ANG)
-    if (num_angles == 0)
-	    continue;
-#endif // ANG
-    if (i >= g_mpi.firstatom && i < (g_mpi.firstatom + g_mpi.myatoms)) {
-      atom->angle_part = (angle_t*)Malloc(num_angles * sizeof(angle_t));
-      for (int j = 0; j < num_angles; ++j)
-        memset(atom->angle_part + j, 0, sizeof(angle_t));
+  if (g_mpi.world_id > 0)
+    for (int i = 0; i < g_mpi.myatoms; i++)
+      num_angles += g_config.conf_atoms[i].num_angles;
+
+  angle_t* angle_slab =
+      num_angles ? (angle_t*)Malloc(num_angles * sizeof(angle_t)) : NULL;
+  angle_t* angle_pack = NULL;
+
+  if (g_mpi.world_id == 0) {
+    int total = 0;
+    for (int r = 0; r < g_mpi.world_cpus; r++) {
+      counts[r] = 0;
+      if (r > 0)
+        for (int i = 0; i < ranges[2 * r + 1]; i++)
+          counts[r] += g_config.atoms[ranges[2 * r] + i].num_angles;
+      displs[r] = total;
+      total += counts[r];
+    }
+    angle_pack = (angle_t*)malloc(total * sizeof(angle_t));
+    if (angle_pack == NULL && total > 0)
+      error(1, "Error allocating resources\n");
+    for (int r = 1; r < g_mpi.world_cpus; r++) {
+      angle_t* pos = angle_pack + displs[r];
+      for (int i = 0; i < ranges[2 * r + 1]; i++) {
+        const atom_t* atom = g_config.atoms + ranges[2 * r] + i;
+        if (atom->num_angles)
+          memcpy(pos, atom->angle_part, atom->num_angles * sizeof(angle_t));
+        pos += atom->num_angles;
+      }
     }
-    for (int j = 0; j < num_angles; ++j) {
-      if (g_mpi.myid == 0)
-        angle = g_config.atoms[i].angle_part[j];
-      CHECK_RETURN(MPI_Bcast(&angle, 1, g_mpi.MPI_ANGL, 0, MPI_COMM_WORLD));
-      if (i >= g_mpi.firstatom && i < (g_mpi.firstatom + g_mpi.myatoms))
-        atom->angle_part[j] = angle;
+  }
+
+  CHECK_RETURN(MPI_Scatterv(angle_pack, counts, displs, g_mpi.MPI_ANGL,
+                            g_mpi.world_id == 0 ? MPI_IN_PLACE : angle_slab,
+                            num_angles, g_mpi.MPI_ANGL, 0, MPI_COMM_WORLD));
+
+  if (g_mpi.world_id == 0)
+    free(angle_pack);
+
+  if (g_mpi.world_id > 0) {
+    num_angles = 0;
+
+    for (int i = 0; i < g_mpi.myatoms; i++) {
+      g_config.conf_atoms[i].angle_part =
+          g_config.conf_atoms[i].num_angles ? angle_slab + num_angles : NULL;
+      num_angles += g_config.conf_atoms[i].num_angles;
     }
   }
 #endif  // THREEBODY
@@ -33,6 +33,7 @@
 int initialize_mpi(int* argc, char*** argv);
 void shutdown_mpi();
 int broadcast_params_mpi();
+int broadcast_hierarchical(double* buffer, int count);
 void potsync();
 
 #endif  // MPI_UTILS_H_INCLUDED
@@ -29,12 +29,18 @@
 
 #include "potfit.h"
 
+#include "checkpoint.h"
 #include "optimize.h"
+#include "timers.h"
 
 // individual optimization algorithms
 void run_simulated_annealing(double* const xi);
 void run_differential_evolution(double* const xi);
+#if defined(EVO)
+void run_cmaes(double* xi);
+#endif  // EVO
 void run_powell_lsq(double* const xi);
+void run_lbfgs(double* const xi);
 
 void run_optimization()
 {
@@ -46,12 +52,29 @@ void run_optimization()
 #if !defined(EVO)
   run_simulated_annealing(xi);
 #else
-  run_differential_evolution(xi);
+  if (g_param.cmaes_sigma > 0.0)
+    run_cmaes(xi);
+  else
+    run_differential_evolution(xi);
 #endif  // !EVO
 
-  printf("\nStarting powell minimization ...\n");
+  if (g_param.lbfgs) {
+    printf("\nStarting L-BFGS minimization ...\n");
 
-  run_powell_lsq(xi);
+    run_lbfgs(xi);
 
-  printf("\nFinished powell minimization, calculating errors ...\n");
+    printf("\nFinished L-BFGS minimization, calculating errors ...\n");
+  } else {
+    printf("\nStarting powell minimization ...\n");
+
+    run_powell_lsq(xi);
+
+    printf("\nFinished powell minimization, calculating errors ...\n");
+  }
+
+  /* a leftover checkpoint would hijack the next fresh run */
+  checkpoint_remove();
+
+  // where did the optimization time go on this rank?
+  timer_report();
 }
@@ -124,6 +124,10 @@ void read_parameter_file(char const* param_file)
       get_param_string("plotfile", &g_files.plotfile, line, param_file);
       g_param.plot = 1;
     }
+    // write the IMD data blocks as raw doubles instead of text
+    else if (strcasecmp(token, "imd_binary") == 0) {
+      get_param_int("imd_binary", &g_param.imd_binary, line, param_file, 0, 1);
+    }
     // number of steps in IMD potential
     else if (strcasecmp(token, "imdpotsteps") == 0) {
       get_param_int("imdpotsteps", &g_param.imdpotsteps, line, param_file, 1,
@@ -135,13 +139,85 @@ void read_parameter_file(char const* param_file)
                        DBL_MAX);
     }
     // file with atom configuration
+    //   config <file> [weight]
+    // may be given several times, each file is loaded as one dataset and
+    // the optional weight scales the conf_weight of all its configurations
     else if (strcasecmp(token, "config") == 0) {
-      get_param_string("config", &g_files.config, line, param_file);
+      const char* config_file = NULL;
+      double weight = 1.0;
+
+      get_param_string("config", &config_file, line, param_file);
+
+      char* str = strtok(NULL, " \t\r\n");
+
+      if (str != NULL) {
+        char* endptr = NULL;
+        weight = strtod(str, &endptr);
+        if (endptr == str || *endptr != '\0')
+          error(1, "Illegal value in parameter file %s (line %d): the dataset weight is not a double!\n",
+                param_file, line);
+        if (weight < 0.0)
+          error(1, "Illegal value in parameter file %s (line %d): the dataset weight is negative!\n",
+                param_file, line);
+      }
+
+      int n = g_files.num_config_files++;
+
+      g_files.config_files = (const char**)Realloc(
+          (void*)g_files.config_files, (n + 1) * sizeof(char*));
+      g_files.config_weights = (double*)Realloc(g_files.config_weights,
+                                                (n + 1) * sizeof(double));
+      g_files.config_files[n] = config_file;
+      g_files.config_weights[n] = weight;
+
+      if (g_files.config == NULL)
+        g_files.config = config_file;
+    }
+    // sort the atoms of each configuration along a Morton curve ?
+    else if (strcasecmp(token, "atom_order") == 0) {
+      get_param_int("atom_order", &g_param.atom_order, line, param_file, 0, 1);
+    }
+    // benchmark the force kernel with n evaluations instead of fitting
+    else if (strcasecmp(token, "bench_evals") == 0) {
+      get_param_int("bench_evals", &g_param.bench_evals, line, param_file, 0,
+                    INT_MAX);
+    }
+    // use binary sidecar cache for the config file ?
+    else if (strcasecmp(token, "config_cache") == 0) {
+      get_param_int("config_cache", &g_param.config_cache, line, param_file, 0,
+                    1);
+    }
+    // stream the packed neighbor data from disk instead of holding it resident ?
+    else if (strcasecmp(token, "config_stream") == 0) {
+      get_param_int("config_stream", &g_param.config_stream, line, param_file,
+                    0, 1);
+    }
+    // use binary sidecar containers for tabulated potential files ?
+    else if (strcasecmp(token, "pot_cache") == 0) {
+      get_param_int("pot_cache", &g_param.pot_cache, line, param_file, 0, 1);
+    }
+    // back large long-lived blocks with 2M huge pages ?
+    else if (strcasecmp(token, "huge_pages") == 0) {
+      get_param_int("huge_pages", &g_param.huge_pages, line, param_file, 0, 1);
     }
     // Optimization flag
     else if (strcasecmp(token, "opt") == 0) {
       get_param_int("opt", &g_param.opt, line, param_file, 0, 1);
     }
+    // use L-BFGS instead of powell for the final minimization stage
+    else if (strcasecmp(token, "lbfgs") == 0) {
+      get_param_int("lbfgs", &g_param.lbfgs, line, param_file, 0, 1);
+    }
+    // calibrate the evaluation geometry before the optimization ?
+    else if (strcasecmp(token, "tune_geometry") == 0) {
+      get_param_int("tune_geometry", &g_param.tune_geometry, line, param_file,
+                    0, 1);
+    }
+    // print a per-phase timing breakdown after the optimization ?
+    else if (strcasecmp(token, "phase_timers") == 0) {
+      get_param_int("phase_timers", &g_param.phase_timers, line, param_file, 0,
+                    1);
+    }
     // break flagfile
     else if (strcasecmp(token, "flagfile") == 0) {
       get_param_string("flagfile", &g_files.flagfile, line, param_file);
@@ -155,10 +231,28 @@ void read_parameter_file(char const* param_file)
       get_param_string("plotpointfile", &g_files.plotpointfile, line,
                        param_file);
     }
+    // binary optimizer checkpoint for restarting interrupted fits
+    else if (strcasecmp(token, "checkpoint_file") == 0) {
+      get_param_string("checkpoint_file", &g_files.checkpointfile, line,
+                       param_file);
+    }
     // temporary potential file
     else if (strcasecmp(token, "tempfile") == 0) {
       get_param_string("tempfile", &g_files.tempfile, line, param_file);
     }
+    // binary optimizer telemetry ring file
+    else if (strcasecmp(token, "tracefile") == 0) {
+      get_param_string("tracefile", &g_files.tracefile, line, param_file);
+    }
+    // binary per-configuration importance index file
+    else if (strcasecmp(token, "conf_index_file") == 0) {
+      get_param_string("conf_index_file", &g_files.confindexfile, line,
+                       param_file);
+    }
+    // unix socket of the persistent evaluation server
+    else if (strcasecmp(token, "server_socket") == 0) {
+      get_param_string("server_socket", &g_files.socketfile, line, param_file);
+    }
     // seed for RNG
     else if (strcasecmp(token, "seed") == 0) {
       get_param_int("seed", &g_param.rng_seed, line, param_file, INT_MIN,
@@ -169,6 +263,23 @@ void read_parameter_file(char const* param_file)
       get_param_double("eng_weight", &g_param.eweight, line, param_file, 0,
                        DBL_MAX);
     }
+    // configuration fraction for mini-batch trial evaluations
+    else if (strcasecmp(token, "eval_batch") == 0) {
+      get_param_double("eval_batch", &g_param.eval_batch, line, param_file, 0,
+                       1);
+    }
+    // early abort of hopeless trial evaluations
+    else if (strcasecmp(token, "eval_abort") == 0) {
+      get_param_int("eval_abort", &g_param.eval_abort, line, param_file, 0, 1);
+    }
+    // single-precision force evaluations during the global search
+    else if (strcasecmp(token, "eval_float") == 0) {
+      get_param_int("eval_float", &g_param.eval_float, line, param_file, 0, 1);
+    }
+    // surrogate pre-screening of trial vectors
+    else if (strcasecmp(token, "surrogate") == 0) {
+      get_param_int("surrogate", &g_param.surrogate, line, param_file, 0, 1);
+    }
     // error margin delta epsilon
     else if (strcasecmp(token, "d_eps") == 0) {
       get_param_double("d_eps", &g_calc.d_eps, line, param_file, 0, DBL_MAX);
@@ -178,6 +289,11 @@ void read_parameter_file(char const* param_file)
       get_param_int("write_lammps", &g_param.write_lammps, line, param_file, 0,
                     1);
     }
+    // write intermediate potentials asynchronously
+    else if (strcasecmp(token, "write_async") == 0) {
+      get_param_int("write_async", &g_param.write_async, line, param_file, 0,
+                    1);
+    }
     // number of steps in LAMMPS potential
     else if (strcasecmp(token, "lammpspotsteps") == 0) {
       get_param_int("lammpspotsteps", &g_param.lammpspotsteps, line, param_file, 1,
@@ -241,11 +357,26 @@ void read_parameter_file(char const* param_file)
       get_param_double("evo_threshold", &g_param.evo_threshold, line,
                        param_file, 0, DBL_MAX);
     }
+    // number of concurrent trial evaluation groups
+    else if (strcasecmp(token, "evo_groups") == 0) {
+      get_param_int("evo_groups", &g_param.evo_groups, line, param_file, 1,
+                    INT_MAX);
+    }
+    // initial step size for CMA-ES (0 = use differential evolution)
+    else if (strcasecmp(token, "cmaes_sigma") == 0) {
+      get_param_double("cmaes_sigma", &g_param.cmaes_sigma, line, param_file,
+                       0, DBL_MAX);
+    }
 #else
     // starting temperature for annealing
     else if (strcasecmp(token, "anneal_temp") == 0) {
       get_param_string("anneal_temp", &g_param.anneal_temp, line, param_file);
     }
+    // number of replica-exchange annealing chains
+    else if (strcasecmp(token, "anneal_replicas") == 0) {
+      get_param_int("anneal_replicas", &g_param.anneal_replicas, line,
+                    param_file, 1, INT_MAX);
+    }
 #endif  // EVO
 
 #if defined(BINDIST)
@@ -478,7 +609,28 @@ void check_parameters_complete(char const* paramfile)
       ((char*)g_param.anneal_temp)[0] = '0';
       ((char*)g_param.anneal_temp)[1] = '\0';
     }
+#if !defined(MPI)
+    if (g_param.anneal_replicas > 1) {
+      warning("anneal_replicas is ignored without MPI support!\n");
+      g_param.anneal_replicas = 1;
+    }
+#endif  // !MPI
+#endif  // EVO
+
+  // the benchmark drives a single evaluation group from the root process
+  if (g_param.bench_evals > 0) {
+#if defined(EVO)
+    if (g_param.evo_groups > 1) {
+      warning("evo_groups is ignored while benchmarking!\n");
+      g_param.evo_groups = 1;
+    }
+#else
+    if (g_param.anneal_replicas > 1) {
+      warning("anneal_replicas is ignored while benchmarking!\n");
+      g_param.anneal_replicas = 1;
+    }
 #endif  // EVO
+  }
 
 #if defined(BINDIST)
   if (g_files.bindistfile == NULL)
@@ -0,0 +1,310 @@
+/****************************************************************
+ *
+ * potential_bin.c: binary containers for tabulated potential files
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "potfit.h"
+
+#include "potential_bin.h"
+
+#define POT_BIN_MAGIC 0x62706670
+#define POT_BIN_VERSION 1
+
+// header of the binary potential container, followed by the begin, end
+// and nvals arrays of the info block and the values block as raw
+// doubles in text file order
+typedef struct {
+  int magic;
+  int version;
+  int format_type;
+  int num_pots;
+  int have_gradient;
+  long long num_values;
+  long long pot_mtime;
+  long long pot_size;
+} pot_bin_header_t;
+
+// state of the currently mapped container
+static struct {
+  char* map;
+  size_t map_size;
+  const double* values;
+  long long num_values;
+  long long pos;
+} g_pot_bin;
+
+/****************************************************************
+  potential_bin_size
+    number of doubles in the values block of a table with the given
+    info block
+****************************************************************/
+
+static long long potential_bin_size(POTENTIAL_FORMAT format, int num_pots,
+                                    int have_gradient, const int* nvals)
+{
+  long long num_values = 0;
+
+  for (int i = 0; i < num_pots; i++) {
+    // two gradient values per function, only read with a #G header
+    if (have_gradient)
+      num_values += 2;
+    // non-equidistant tables interleave the sampling points
+    if (format == POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST)
+      num_values += 2 * (long long)nvals[i];
+    else
+      num_values += (long long)nvals[i];
+  }
+
+  return num_values;
+}
+
+/****************************************************************
+  potential_bin_open
+    map the sidecar container of a potential file, returns 1 if it
+    matches the text file and its parsed info block
+
+    The container is rejected whenever the text file changed or the
+    info block disagrees, the caller then falls back to fscanf.
+****************************************************************/
+
+int potential_bin_open(const char* filename, const potential_state* pstate,
+                       const int* nvals)
+{
+  char cachename[255];
+  struct stat pot_stat;
+  struct stat cache_stat;
+  pot_bin_header_t header;
+
+  if (!g_param.pot_cache)
+    return 0;
+
+  if (stat(filename, &pot_stat) != 0)
+    return 0;
+
+  sprintf(cachename, "%s.cache", filename);
+
+  int fd = open(cachename, O_RDONLY);
+
+  if (fd < 0)
+    return 0;
+
+  if (fstat(fd, &cache_stat) != 0 ||
+      (size_t)cache_stat.st_size < sizeof(header)) {
+    close(fd);
+    return 0;
+  }
+
+  char* map = (char*)mmap(NULL, cache_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (map == MAP_FAILED)
+    return 0;
+
+  memcpy(&header, map, sizeof(header));
+
+  long long num_values = potential_bin_size(
+      g_pot.format_type, pstate->num_pots, pstate->have_gradient, nvals);
+
+  if (header.magic != POT_BIN_MAGIC || header.version != POT_BIN_VERSION ||
+      header.format_type != (int)g_pot.format_type ||
+      header.num_pots != pstate->num_pots ||
+      header.have_gradient != pstate->have_gradient ||
+      header.num_values != num_values ||
+      header.pot_mtime != (long long)pot_stat.st_mtime ||
+      header.pot_size != (long long)pot_stat.st_size ||
+      (size_t)cache_stat.st_size !=
+          sizeof(header) + (2 * header.num_pots + num_values) * sizeof(double) +
+              header.num_pots * sizeof(int)) {
+    munmap(map, cache_stat.st_size);
+    return 0;
+  }
+
+  // the info block stored in the container has to match the parsed one
+  char* pos = map + sizeof(header);
+
+  const double* begin = (const double*)pos;
+  pos += header.num_pots * sizeof(double);
+  const double* end = (const double*)pos;
+  pos += header.num_pots * sizeof(double);
+  const int* bin_nvals = (const int*)pos;
+  pos += header.num_pots * sizeof(int);
+
+  for (int i = 0; i < pstate->num_pots; i++) {
+    if (bin_nvals[i] != nvals[i] ||
+        // format 4 determines begin and end from the sampling points
+        (g_pot.format_type == POTENTIAL_FORMAT_TABULATED_EQ_DIST &&
+         (begin[i] != g_pot.opt_pot.begin[i] ||
+          end[i] != g_pot.opt_pot.end[i]))) {
+      munmap(map, cache_stat.st_size);
+      return 0;
+    }
+  }
+
+  g_pot_bin.map = map;
+  g_pot_bin.map_size = cache_stat.st_size;
+  g_pot_bin.values = (const double*)pos;
+  g_pot_bin.num_values = num_values;
+  g_pot_bin.pos = 0;
+
+  printf(" - Serving the values block from the binary container %s\n",
+         cachename);
+
+  return 1;
+}
+
+/****************************************************************
+  potential_bin_read1 / potential_bin_read2
+    read one or two values from the mapped container, falling back
+    to the text file when no container is active
+****************************************************************/
+
+int potential_bin_read1(FILE* pfile, double* a)
+{
+  if (g_pot_bin.map != NULL) {
+    if (g_pot_bin.pos + 1 > g_pot_bin.num_values)
+      return 0;
+    *a = g_pot_bin.values[g_pot_bin.pos++];
+    return 1;
+  }
+
+  return fscanf(pfile, "%lf\n", a);
+}
+
+int potential_bin_read2(FILE* pfile, double* a, double* b)
+{
+  if (g_pot_bin.map != NULL) {
+    if (g_pot_bin.pos + 2 > g_pot_bin.num_values)
+      return 0;
+    *a = g_pot_bin.values[g_pot_bin.pos++];
+    *b = g_pot_bin.values[g_pot_bin.pos++];
+    return 2;
+  }
+
+  return fscanf(pfile, "%lf %lf\n", a, b);
+}
+
+/****************************************************************
+  potential_bin_done
+    unmap the container after the values block has been read
+****************************************************************/
+
+void potential_bin_done(void)
+{
+  if (g_pot_bin.map == NULL)
+    return;
+
+  munmap(g_pot_bin.map, g_pot_bin.map_size);
+
+  memset(&g_pot_bin, 0, sizeof(g_pot_bin));
+}
+
+/****************************************************************
+  potential_bin_write
+    store the values block of a freshly written tabulated potential
+    file in a binary sidecar container next to it
+****************************************************************/
+
+void potential_bin_write(const char* filename, POTENTIAL_FORMAT format)
+{
+  char cachename[255];
+  struct stat pot_stat;
+  pot_bin_header_t header;
+  pot_table_t* pt = &g_pot.opt_pot;
+
+  if (!g_param.pot_cache)
+    return;
+
+  if (stat(filename, &pot_stat) != 0) {
+    warning("Could not stat %s, not writing a potential container\n", filename);
+    return;
+  }
+
+  int nvals[pt->ncols];
+
+  for (int i = 0; i < pt->ncols; i++)
+    nvals[i] = pt->last[i] - pt->first[i] + 1;
+
+  memset(&header, 0, sizeof(header));
+
+  header.magic = POT_BIN_MAGIC;
+  header.version = POT_BIN_VERSION;
+  header.format_type = (int)format;
+  header.num_pots = pt->ncols;
+  // the table writers always include the gradient line
+  header.have_gradient = 1;
+  header.num_values = potential_bin_size(format, pt->ncols, 1, nvals);
+  header.pot_mtime = (long long)pot_stat.st_mtime;
+  header.pot_size = (long long)pot_stat.st_size;
+
+  sprintf(cachename, "%s.cache", filename);
+
+  FILE* cache_file = fopen(cachename, "wb");
+
+  if (cache_file == NULL) {
+    warning("Could not open potential container %s for writing\n", cachename);
+    return;
+  }
+
+  int ok = (fwrite(&header, sizeof(header), 1, cache_file) == 1);
+
+  ok = ok && (fwrite(pt->begin, sizeof(double), pt->ncols, cache_file) ==
+              (size_t)pt->ncols);
+  ok = ok && (fwrite(pt->end, sizeof(double), pt->ncols, cache_file) ==
+              (size_t)pt->ncols);
+  ok = ok && (fwrite(nvals, sizeof(int), pt->ncols, cache_file) ==
+              (size_t)pt->ncols);
+
+  // the values block in text file order: gradients, then the function
+  // values, with the sampling points interleaved for format 4
+  for (int i = 0; i < pt->ncols && ok; i++) {
+    ok = ok && (fwrite(pt->table + pt->first[i] - 2, sizeof(double), 2,
+                       cache_file) == 2);
+    if (format == POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST) {
+      for (int j = pt->first[i]; j <= pt->last[i] && ok; j++) {
+        ok = ok && (fwrite(pt->xcoord + j, sizeof(double), 1, cache_file) == 1);
+        ok = ok && (fwrite(pt->table + j, sizeof(double), 1, cache_file) == 1);
+      }
+    } else {
+      ok = ok && (fwrite(pt->table + pt->first[i], sizeof(double), nvals[i],
+                         cache_file) == (size_t)nvals[i]);
+    }
+  }
+
+  if (fclose(cache_file) != 0)
+    ok = 0;
+
+  if (!ok) {
+    warning("Could not write potential container %s\n", cachename);
+    remove(cachename);
+  }
+}
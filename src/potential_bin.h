@@ -0,0 +1,70 @@
+/****************************************************************
+ *
+ * potential_bin.h: binary containers for tabulated potential files
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef POTENTIAL_BIN_H_INCLUDED
+#define POTENTIAL_BIN_H_INCLUDED
+
+#include <stdio.h>
+
+#include "potential_input.h"
+
+/****************************************************************
+ *
+ *  Fine-grid tabulated potentials run to hundreds of thousands of
+ *  sampling points, and parsing them with scanf at startup (or
+ *  formatting them for the intermediate writes) is dominated by
+ *  number conversion. With the pot_cache parameter set, every
+ *  tabulated potential file gets a binary sidecar container next to
+ *  it, <file>.cache, holding the values block as raw doubles in file
+ *  order. The format 3 and 4 readers map the container and serve the
+ *  values from it instead of calling fscanf; all header parsing and
+ *  index bookkeeping still runs on the text file, which remains the
+ *  authoritative copy. Like the configuration cache the container is
+ *  rejected whenever the text file changed, the reader then falls
+ *  back to regular parsing.
+ *
+ ****************************************************************/
+
+// map the sidecar container of a potential file after its info block
+// has been parsed, returns 1 if the values can be served from it
+int potential_bin_open(const char* filename, const potential_state* pstate,
+                       const int* nvals);
+
+// read values from the mapped container, or from the text file when
+// no container is active; fscanf-style return values
+int potential_bin_read1(FILE* pfile, double* a);
+int potential_bin_read2(FILE* pfile, double* a, double* b);
+
+// unmap the container after the values block has been read
+void potential_bin_done(void);
+
+// write the sidecar container next to a freshly written table
+void potential_bin_write(const char* filename, POTENTIAL_FORMAT format);
+
+#endif  // POTENTIAL_BIN_H_INCLUDED
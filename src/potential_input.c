@@ -34,6 +34,7 @@
 #include "kim.h"
 #include "memory.h"
 #include "potential_input.h"
+#include "timers.h"
 #include "utils.h"
 
 void read_pot_line_F(char const* pbuf, potential_state* pstate);
@@ -416,6 +417,8 @@ void allocate_memory_for_potentials(potential_state* pstate)
   apt->end = (double*)Malloc(size * sizeof(double));
   apt->param_name = (const char***)Malloc(size * sizeof(char**));
   apt->fvalue = (fvalue_pointer*)Malloc(size * sizeof(fvalue_pointer));
+  apt->bvalue = (bvalue_pointer*)Malloc(size * sizeof(bvalue_pointer));
+  apt->gvalue = (gvalue_pointer*)Malloc(size * sizeof(gvalue_pointer));
 
 #if !defined(COULOMB)
 
@@ -626,6 +629,8 @@ void update_calc_table(double* xi_opt, double* xi_calc, int do_all)
   double* val = xi_opt;
   double* list = g_pot.calc_list + 2;
 
+  timer_start(TIMER_POT_UPDATE);
+
   // copy global parameters to the right positions
   if (g_pot.have_globals) {
     for (int i = 0; i < g_pot.apot_table.globals; i++) {
@@ -661,11 +666,21 @@ void update_calc_table(double* xi_opt, double* xi_calc, int do_all)
     }
 
     if (do_all || (change && !g_pot.invar_pot[i])) {
+      int first = i * APOT_STEPS + (i + 1) * 2;
+
+      // evaluate the whole column at once if a batched variant exists
+      if (g_pot.apot_table.bvalue[i] != NULL)
+        g_pot.apot_table.bvalue[i](APOT_STEPS, g_pot.calc_pot.xcoord + first,
+                                   val, xi_calc + first);
+
       for (int j = 0; j < APOT_STEPS; j++) {
         double f = 0;
-        int k = i * APOT_STEPS + (i + 1) * 2 + j;
+        int k = first + j;
 
-        g_pot.apot_table.fvalue[i](g_pot.calc_pot.xcoord[k], val, &f);
+        if (g_pot.apot_table.bvalue[i] != NULL)
+          f = *(xi_calc + k);
+        else
+          g_pot.apot_table.fvalue[i](g_pot.calc_pot.xcoord[k], val, &f);
 
         *(xi_calc + k) = g_pot.smooth_pot[i]
                              ? f * apot_cutoff(g_pot.calc_pot.xcoord[k],
@@ -691,6 +706,8 @@ void update_calc_table(double* xi_opt, double* xi_calc, int do_all)
     val += g_pot.apot_table.n_par[i];
     list += g_pot.apot_table.n_par[i] + 2;
   }
+
+  timer_stop(TIMER_POT_UPDATE);
 }
 
 #endif  // APOT
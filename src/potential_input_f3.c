@@ -30,6 +30,7 @@
 #include "potfit.h"
 
 #include "memory.h"
+#include "potential_bin.h"
 #include "potential_input.h"
 #include "utils.h"
 
@@ -96,6 +97,9 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   pt->d2tab = (double*)Malloc(pt->len * sizeof(double));
   pt->idx = (int*)Malloc(pt->len * sizeof(int));
 
+  /* a matching binary container replaces the scanf parse below */
+  potential_bin_open(potential_filename, pstate, nvals);
+
   /* input loop */
   double* val = pt->table;
   int k = 0;
@@ -104,7 +108,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   /* read pair potentials */
   for (int i = 0; i < g_calc.paircol; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no pair gradient pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -122,7 +126,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no pair values, pot %d line %d)\n",
 	      pstate->filename, i,j);
       else
@@ -139,7 +143,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   /* read EAM transfer function rho(r) */
   for (int i = g_calc.paircol; i < g_calc.paircol + g_param.ntypes; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no rho grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -157,7 +161,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no rho values pot %d line %d)\n",
 	      pstate->filename,i,j);
       else
@@ -183,7 +187,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
     }
 #endif
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no F grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -201,7 +205,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no F values, pot %d line %d)\n",
 	      pstate->filename,i,j);
       else
@@ -219,7 +223,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   for (int i = g_calc.paircol + 2 * g_param.ntypes;
        i < g_calc.paircol + 3 * g_param.ntypes; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no s-band rho grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -237,7 +241,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no s-band rho values, pot %d line %d)\n",
 	      pstate->filename,i,j);
       else
@@ -254,7 +258,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   for (int i = g_calc.paircol + 3 * g_param.ntypes;
        i < g_calc.paircol + 4 * g_param.ntypes; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no s-band F grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -272,7 +276,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no s-band F values, pot %d line %d)\n",
 	      pstate->filename, i, j);
       else
@@ -292,7 +296,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   for (int i = g_calc.paircol + 2 * g_param.ntypes;
        i < 2 * (g_calc.paircol + g_param.ntypes); i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no ADP-d grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -310,7 +314,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no ADP-d values, pot %d line %d)\n",
 	      pstate->filename,i,j);
       else
@@ -327,7 +331,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   for (int i = 2 * (g_calc.paircol + g_param.ntypes);
        i < 3 * g_calc.paircol + 2 * g_param.ntypes; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no ADP-q grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -345,7 +349,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf\n", val))
+      if (1 > potential_bin_read1(pfile, val))
         error(1, "Premature end of potential file %s\n(no ADP-q values, pot %d line %d)\n",
 	      pstate->filename, i, j);
       else
@@ -365,7 +369,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
        i < 2 * g_calc.paircol + 2 * g_param.ntypes; i++) {
     /* read gradient */
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no MEAM 2nd pair grad, pot %d)\n",
 	      pstate->filename,i);
       ;
@@ -383,7 +387,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
     else
       l++;
     for (int j = 0; j < nvals[i]; j++) { /* read values */
-      if (1 > fscanf(pfile, "%lf\n", val)) {
+      if (1 > potential_bin_read1(pfile, val)) {
         error(1, "Premature end of potential file %s\n(no MEAM 2nd pair values, pot %d line %d)\n",
 	      pstate->filename,i,j);
         ;
@@ -410,7 +414,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
        i < 2 * g_calc.paircol + 3 * g_param.ntypes; i++) {
     /* read gradient */
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no MEAM angle gradient, pot %d)\n",
 	      pstate->filename);
       ;
@@ -428,7 +432,7 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
     else
       l++;
     for (int j = 0; j < nvals[i]; j++) { /* read values */
-      if (1 > fscanf(pfile, "%lf\n", val)) {
+      if (1 > potential_bin_read1(pfile, val)) {
         error(1, "Premature end of potential file %s\n(no MEAM angle values, pot %d line %d)\n",
 	      pstate->filename,i,j);
         ;
@@ -443,6 +447,8 @@ void read_pot_table3(char const* potential_filename, FILE* pfile,
   }
 #endif  // MEAM
 
+  potential_bin_done();
+
   pt->idxlen = k;
   init_calc_table3();
 
@@ -30,6 +30,7 @@
 #include "potfit.h"
 
 #include "memory.h"
+#include "potential_bin.h"
 #include "potential_input.h"
 #include "utils.h"
 
@@ -92,6 +93,9 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   pt->d2tab = (double*)Malloc(pt->len * sizeof(double));
   pt->idx = (int*)Malloc(pt->len * sizeof(int));
 
+  /* a matching binary container replaces the scanf parse below */
+  potential_bin_open(potential_filename, pstate, nvals);
+
   /* input loop */
   double* val = pt->table;
   double* ord = pt->xcoord;
@@ -101,7 +105,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   /* read pair potentials */
   for (int i = 0; i < g_calc.paircol; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no pair gradient pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -120,7 +124,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (2 > fscanf(pfile, "%lf %lf\n", ord, val))
+      if (2 > potential_bin_read2(pfile, ord, val))
         error(1, "Premature end of potential file %s (no pair values, pot %d line %d)\n",
 	      pstate->filename, i,j);
       else {
@@ -155,7 +159,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   /* read EAM transfer function rho(r) */
   for (int i = g_calc.paircol; i < g_calc.paircol + den_count; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no rho grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -174,7 +178,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (2 > fscanf(pfile, "%lf %lf\n", ord, val))
+      if (2 > potential_bin_read2(pfile, ord, val))
         error(1, "Premature end of potential file %s\n(no rho values pot %d line %d)\n",
 	      pstate->filename,i,j);
       else {
@@ -199,7 +203,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   for (int i = g_calc.paircol + den_count;
        i < g_calc.paircol + den_count + emb_count; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no F grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -218,7 +222,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf %lf\n", ord, val))
+      if (1 > potential_bin_read2(pfile, ord, val))
         error(1, "Premature end of potential file %s\n(no F values, pot %d line %d)\n",
 	      pstate->filename,i,j);
       else {
@@ -252,7 +256,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   for (int i = g_calc.paircol + 2 * g_param.ntypes;
        i < 2 * (g_calc.paircol + g_param.ntypes); i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no ADP-d grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -271,7 +275,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (2 > fscanf(pfile, "%lf %lf\n", ord, val))
+      if (2 > potential_bin_read2(pfile, ord, val))
         error(1, "Premature end of potential file %s\n(no ADP-d values, pot %d line %d)\n",
 	      pstate->filename,i,j);
       else {
@@ -296,7 +300,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   for (int i = 2 * (g_calc.paircol + g_param.ntypes);
        i < 3 * g_calc.paircol + 2 * g_param.ntypes; i++) {
     if (pstate->have_gradient) {
-      if (2 > fscanf(pfile, "%lf %lf\n", val, val + 1))
+      if (2 > potential_bin_read2(pfile, val, val + 1))
         error(1, "Premature end of potential file %s\n(no ADP-q grad, pot %d)\n",
 	      pstate->filename,i);
     } else {
@@ -315,7 +319,7 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
       l++;
     /* read values */
     for (int j = 0; j < nvals[i]; j++) {
-      if (1 > fscanf(pfile, "%lf %lf\n", ord, val))
+      if (1 > potential_bin_read2(pfile, ord, val))
         error(1, "Premature end of potential file %s\n(no ADP-q values, pot %d line %d)\n",
 	      pstate->filename, i, j);
       else {
@@ -337,6 +341,8 @@ void read_pot_table4(char const* potential_filename, FILE* pfile,
   }
 #endif  // ADP
 
+  potential_bin_done();
+
   pt->idxlen = k;
   init_calc_table4();
 
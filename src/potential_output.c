@@ -27,10 +27,14 @@
  *
  ****************************************************************/
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include "potfit.h"
 
 #include "functions.h"
 #include "memory.h"
+#include "potential_bin.h"
 #include "potential_output.h"
 #include "splines.h"
 
@@ -67,6 +71,49 @@ void write_pot_table_potfit(char const* filename)
   }
 }
 
+/****************************************************************
+ *
+ * write intermediate potential asynchronously
+ *
+ * With write_async enabled the write runs in a forked child, which
+ * sees a copy-on-write snapshot of the potential tables while the
+ * optimizer continues; a stalling filesystem no longer delays the
+ * next evaluation. If the previous writer is still busy the snapshot
+ * is skipped, a newer one follows shortly anyway.
+ *
+ ****************************************************************/
+
+void write_pot_table_potfit_async(char const* filename)
+{
+  static pid_t writer_pid = 0;
+
+  if (!g_param.write_async) {
+    write_pot_table_potfit(filename);
+    return;
+  }
+
+  if (writer_pid > 0) {
+    if (waitpid(writer_pid, NULL, WNOHANG) == 0)
+      return;
+    writer_pid = 0;
+  }
+
+  // pending stdio buffers would be flushed twice after the fork
+  fflush(NULL);
+
+  pid_t pid = fork();
+
+  if (pid == 0) {
+    write_pot_table_potfit(filename);
+    _exit(EXIT_SUCCESS);
+  }
+
+  if (pid > 0)
+    writer_pid = pid;
+  else
+    write_pot_table_potfit(filename); /* fork failed, write synchronously */
+}
+
 /****************************************************************
  *
  *  write potential table (format 0)
@@ -372,6 +419,9 @@ void write_pot_table3(char const* filename)
 
   if (plot_flag)
     fclose(pfile_plot);
+
+  /* refresh the binary container so a restart skips the text parse */
+  potential_bin_write(filename, POTENTIAL_FORMAT_TABULATED_EQ_DIST);
 }
 
 /****************************************************************
@@ -479,6 +529,9 @@ void write_pot_table4(char const* filename)
 
   if (plot_flag)
     fclose(pfile_plot);
+
+  /* refresh the binary container so a restart skips the text parse */
+  potential_bin_write(filename, POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST);
 }
 
 /****************************************************************
@@ -31,6 +31,7 @@
 #define POTENTIAL_OUTPUT_H_INCLUDED
 
 void write_pot_table_potfit(char const* filename);
+void write_pot_table_potfit_async(char const* filename);
 void write_pot_table_imd(char const* prefix);
 void write_pot_table_lammps();
 
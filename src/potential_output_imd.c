@@ -38,6 +38,73 @@
 
 #define NPLOT 1000
 
+#if !(defined(STIWEB) || defined(TERSOFF))
+
+/****************************************************************
+ *
+ *  imd_write_header / imd_flush_block / imd_write_r2_block
+ *
+ *  Helpers for the sampled IMD tables. The sampling loops are
+ *  independent per grid point and run in parallel with OpenMP.
+ *  With imd_binary enabled a data block is flushed as raw doubles,
+ *  marked by #B instead of #E in the header, which shrinks the
+ *  files to a third and avoids the text formatting cost.
+ *
+ ****************************************************************/
+
+static void imd_write_header(FILE* outfile, int cols)
+{
+  fprintf(outfile, "#F 2 %d\n%s\n", cols, g_param.imd_binary ? "#B" : "#E");
+}
+
+static void imd_flush_block(FILE* outfile, double const* samples, int n)
+{
+  if (g_param.imd_binary) {
+    if (fwrite(samples, sizeof(double), n, outfile) != (size_t)n)
+      error(1, "Could not write IMD data block\n");
+  } else {
+    for (int k = 0; k < n; k++)
+      fprintf(outfile, "%.16e\n", samples[k]);
+    fprintf(outfile, "\n");
+  }
+}
+
+/* one data block sampled over r^2, closed by the trailing zero */
+
+static void imd_write_r2_block(FILE* outfile, int col1, double r2begin,
+                               double r2step, int linear)
+{
+  double* samples = (double*)Malloc((g_param.imdpotsteps + 1) * sizeof(double));
+
+#if defined(OPENMP)
+#pragma omp parallel for
+#endif  // OPENMP
+  for (int k = 0; k < g_param.imdpotsteps; k++) {
+    double r = sqrt(r2begin + k * r2step);
+#if defined(APOT)
+    double temp = 0.0;
+    (*g_pot.apot_table.fvalue[col1])(r, g_pot.apot_table.values[col1], &temp);
+    samples[k] =
+        g_pot.smooth_pot[col1]
+            ? temp * apot_cutoff(
+                         r, g_pot.apot_table.end[col1],
+                         g_pot.apot_table
+                             .values[col1][g_pot.apot_table.n_par[col1] - 1])
+            : temp;
+#else
+    samples[k] =
+        linear ? splint_ne_lin(&g_pot.opt_pot, g_pot.opt_pot.table, col1, r)
+               : splint_ne(&g_pot.opt_pot, g_pot.opt_pot.table, col1, r);
+#endif  // APOT
+  }
+
+  samples[g_param.imdpotsteps] = 0.0;
+
+  imd_flush_block(outfile, samples, g_param.imdpotsteps + 1);
+}
+
+#endif  // !(STIWEB || TERSOFF)
+
 /****************************************************************
  *
  *  write potential table for IMD (format 2)
@@ -188,7 +255,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes * g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes * g_param.ntypes);
 
   /* write info block */
   int m = 0;
@@ -225,33 +292,11 @@ void write_pot_table_imd(char const* prefix)
       int col1 =
           i < j ? i * g_param.ntypes + j - m : j * g_param.ntypes + i - m2;
       int col2 = i * g_param.ntypes + j;
-      double r2 = r2begin[col2];
-      for (int k = 0; k < g_param.imdpotsteps; k++) {
-#if defined(APOT)
-        double temp = 0;
-        g_pot.apot_table.fvalue[col1](sqrt(r2), g_pot.apot_table.values[col1],
-                                      &temp);
-        temp =
-            g_pot.smooth_pot[col1]
-                ? temp *
-                      apot_cutoff(
-                          sqrt(r2), g_pot.apot_table.end[col1],
-                          g_pot.apot_table
-                              .values[col1][g_pot.apot_table.n_par[col1] - 1])
-                : temp;
-        fprintf(outfile, "%.16e\n", temp);
-#else
 #if defined(MEAM)
-        fprintf(outfile, "%.16e\n",
-                splint_ne_lin(pt, pt->table, col1, sqrt(r2)));
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 1);
 #else
-        fprintf(outfile, "%.16e\n", splint_ne(pt, pt->table, col1, sqrt(r2)));
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 0);
 #endif  // MEAM
-#endif  // APOT
-        r2 += r2step[col2];
-      }
-      fprintf(outfile, "%.16e\n", 0.0);
-      fprintf(outfile, "\n");
     }
   }
   fclose(outfile);
@@ -265,7 +310,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes * g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes * g_param.ntypes);
 
   /* write info block */
   for (int i = 0; i < g_param.ntypes; i++) {
@@ -292,29 +337,7 @@ void write_pot_table_imd(char const* prefix)
     for (int j = 0; j < g_param.ntypes; j++) {
       int col1 = (g_param.ntypes * (g_param.ntypes + 1)) / 2 + j;
       int col2 = i * g_param.ntypes + j;
-      double r2 = r2begin[col2];
-      for (int k = 0; k < g_param.imdpotsteps; k++) {
-#if defined(APOT)
-        double temp = 0.0;
-        (*g_pot.apot_table.fvalue[col1])(sqrt(r2),
-                                         g_pot.apot_table.values[col1], &temp);
-        temp =
-            g_pot.smooth_pot[col1]
-                ? temp *
-                      apot_cutoff(
-                          sqrt(r2), g_pot.apot_table.end[col1],
-                          g_pot.apot_table
-                              .values[col1][g_pot.apot_table.n_par[col1] - 1])
-                : temp;
-        fprintf(outfile, "%.16e\n", temp);
-#else
-        fprintf(outfile, "%.16e\n",
-                splint_ne_lin(pt, pt->table, col1, sqrt(r2)));
-#endif
-        r2 += r2step[col2];
-      }
-      fprintf(outfile, "%.16e\n", 0.0);
-      fprintf(outfile, "\n");
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 1);
     }
   }
   fclose(outfile);
@@ -327,7 +350,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes);
 
   /* write info block */
   for (int i = 0; i < g_param.ntypes; i++) {
@@ -348,28 +371,28 @@ void write_pot_table_imd(char const* prefix)
 
   /* write data */
   for (int i = 0; i < g_param.ntypes; i++) {
-    double r2 = r2begin[i];
     int col1 = (g_param.ntypes * (g_param.ntypes + 3)) / 2 + i;
-    double root = (pt->begin[col1] > 0.0)
-                      ? pt->table[pt->first[col1]] / sqrt(pt->begin[col1])
-                      : 0.0;
-    root += (pt->end[col1] < 0.0)
-                ? pt->table[pt->last[col1]] / sqrt(-pt->end[col1])
-                : 0.0;
-    double temp = 0.0;
+    double* samples =
+        (double*)Malloc((g_param.imdpotsteps + 1) * sizeof(double));
+
+#if defined(OPENMP)
+#pragma omp parallel for
+#endif  // OPENMP
     for (int k = 0; k <= g_param.imdpotsteps; k++) {
+      double r2 = r2begin[i] + k * r2step[i];
 #if defined(APOT)
+      double temp = 0.0;
       (*g_pot.apot_table.fvalue[col1])(r2, g_pot.apot_table.values[col1],
                                        &temp);
 #else
-      temp = splint_ne_lin(pt, pt->table, col1, r2);
+      double temp = splint_ne_lin(pt, pt->table, col1, r2);
       double temp2 = r2 - pt->end[col1];
       temp += (temp2 > 0.0) ? 5e2 * (temp2 * temp2 * temp2) : 0.0;
 #endif  // APOT
-      fprintf(outfile, "%.16e\n", temp);
-      r2 += r2step[i];
+      samples[k] = temp;
     }
-    fprintf(outfile, "\n");
+
+    imd_flush_block(outfile, samples, g_param.imdpotsteps + 1);
   }
   fclose(outfile);
   printf("IMD embedding function written to \t%s\n", filename);
@@ -383,7 +406,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes * g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes * g_param.ntypes);
 
   /* write info block */
   m = 0;
@@ -422,28 +445,7 @@ void write_pot_table_imd(char const* prefix)
           i < j ? i * g_param.ntypes + j - m : j * g_param.ntypes + i - m2;
       col1 += g_calc.paircol + 2 * g_param.ntypes;
       int col2 = i * g_param.ntypes + j;
-      double r2 = r2begin[col2];
-      for (int k = 0; k < g_param.imdpotsteps; k++) {
-#if defined(APOT)
-        double temp = 0.0;
-        (*g_pot.apot_table.fvalue[col1])(sqrt(r2),
-                                         g_pot.apot_table.values[col1], &temp);
-        temp =
-            g_pot.smooth_pot[col1]
-                ? temp *
-                      apot_cutoff(
-                          sqrt(r2), g_pot.apot_table.end[col1],
-                          g_pot.apot_table
-                              .values[col1][g_pot.apot_table.n_par[col1] - 1])
-                : temp;
-        fprintf(outfile, "%.16e\n", temp);
-#else
-        fprintf(outfile, "%.16e\n", splint_ne(pt, pt->table, col1, sqrt(r2)));
-#endif  // APOT
-        r2 += r2step[col2];
-      }
-      fprintf(outfile, "%.16e\n", 0.0);
-      fprintf(outfile, "\n");
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 0);
     }
   }
   fclose(outfile);
@@ -456,7 +458,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes * g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes * g_param.ntypes);
 
   /* write info block */
   m = 0;
@@ -495,28 +497,7 @@ void write_pot_table_imd(char const* prefix)
           i < j ? i * g_param.ntypes + j - m : j * g_param.ntypes + i - m2;
       col1 += 2 * g_calc.paircol + 2 * g_param.ntypes;
       int col2 = i * g_param.ntypes + j;
-      double r2 = r2begin[col2];
-      for (int k = 0; k < g_param.imdpotsteps; k++) {
-#if defined(APOT)
-        double temp = 0.0;
-        (*g_pot.apot_table.fvalue[col1])(sqrt(r2),
-                                         g_pot.apot_table.values[col1], &temp);
-        temp =
-            g_pot.smooth_pot[col1]
-                ? temp *
-                      apot_cutoff(
-                          sqrt(r2), g_pot.apot_table.end[col1],
-                          g_pot.apot_table
-                              .values[col1][g_pot.apot_table.n_par[col1] - 1])
-                : temp;
-        fprintf(outfile, "%.16e\n", temp);
-#else
-        fprintf(outfile, "%.16e\n", splint_ne(pt, pt->table, col1, sqrt(r2)));
-#endif  // APOT
-        r2 += r2step[col2];
-      }
-      fprintf(outfile, "%.16e\n", 0.0);
-      fprintf(outfile, "\n");
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 0);
     }
   }
   fclose(outfile);
@@ -531,7 +512,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes * g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes * g_param.ntypes);
 
   /* write info block */
   m = 0;
@@ -568,29 +549,7 @@ void write_pot_table_imd(char const* prefix)
       int col1 = (g_param.ntypes * (g_param.ntypes + 5)) / 2;
       col1 += i < j ? i * g_param.ntypes + j - m : j * g_param.ntypes + i - m2;
       int col2 = i * g_param.ntypes + j;
-      double r2 = r2begin[col2];
-      for (int k = 0; k < g_param.imdpotsteps; k++) {
-#if defined(APOT)
-        double temp = 0.0;
-        (*g_pot.apot_table.fvalue[col1])(sqrt(r2),
-                                         g_pot.apot_table.values[col1], &temp);
-        temp =
-            g_pot.smooth_pot[col1]
-                ? temp *
-                      apot_cutoff(
-                          sqrt(r2), g_pot.apot_table.end[col1],
-                          g_pot.apot_table
-                              .values[col1][g_pot.apot_table.n_par[col1] - 1])
-                : temp;
-        fprintf(outfile, "%.16e\n", temp);
-#else
-        fprintf(outfile, "%.16e\n",
-                splint_ne_lin(pt, pt->table, col1, sqrt(r2)));
-#endif  // APOT
-        r2 += r2step[col2];
-      }
-      fprintf(outfile, "%.16e\n", 0.0);
-      fprintf(outfile, "\n");
+      imd_write_r2_block(outfile, col1, r2begin[col2], r2step[col2], 1);
     }
   }
 
@@ -604,7 +563,7 @@ void write_pot_table_imd(char const* prefix)
     error(1, "Could not open file %s\n", filename);
 
   /* write header */
-  fprintf(outfile, "#F 2 %d\n#E\n", g_param.ntypes);
+  imd_write_header(outfile, g_param.ntypes);
 
   /* write info block */
   for (int i = 0; i < g_param.ntypes; i++) {
@@ -619,13 +578,18 @@ void write_pot_table_imd(char const* prefix)
 
   /* write data */
   for (int i = 0; i < g_param.ntypes; i++) {
-    double r2 = r2begin[i];
     int col1 = (g_param.ntypes * (g_param.ntypes + 3)) + i;
-    for (int k = 0; k <= g_param.imdpotsteps; k++) {
-      fprintf(outfile, "%.16e\n", splint_ne(&g_pot.calc_pot, pt->table, col1, r2));
-      r2 += r2step[i];
-    }
-    fprintf(outfile, "\n");
+    double* samples =
+        (double*)Malloc((g_param.imdpotsteps + 1) * sizeof(double));
+
+#if defined(OPENMP)
+#pragma omp parallel for
+#endif  // OPENMP
+    for (int k = 0; k <= g_param.imdpotsteps; k++)
+      samples[k] = splint_ne(&g_pot.calc_pot, pt->table, col1,
+                             r2begin[i] + k * r2step[i]);
+
+    imd_flush_block(outfile, samples, g_param.imdpotsteps + 1);
   }
   fclose(outfile);
   printf("IMD MEAM g potential data written to\t%s\n", filename);
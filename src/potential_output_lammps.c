@@ -32,6 +32,7 @@
 #include "elements.h"
 #include "force.h"
 #include "functions.h"
+#include "memory.h"
 #include "potential_output.h"
 #include "splines.h"
 #include "utils.h"
@@ -284,13 +285,21 @@ void write_lammps_table_pair()
 
       // write pot data here
 #if defined(APOT)
-      double r = g_param.plotmin == 0 ? g_pot.calc_pot.begin[idx] : g_param.plotmin;
+      double r0 = g_param.plotmin == 0 ? g_pot.calc_pot.begin[idx] : g_param.plotmin;
 #else
-      double r = g_pot.calc_pot.begin[idx];
+      double r0 = g_pot.calc_pot.begin[idx];
 #endif
-      double dr = (g_pot.calc_pot.end[idx] - r) / (g_param.lammpspotsteps - 1);
+      double dr = (g_pot.calc_pot.end[idx] - r0) / (g_param.lammpspotsteps - 1);
 
-      for (int k = 0; k < g_param.lammpspotsteps; ++k, r += dr) {
+      double* fvals = (double*)Malloc(g_param.lammpspotsteps * sizeof(double));
+      double* grads = (double*)Malloc(g_param.lammpspotsteps * sizeof(double));
+
+      // all grid points are independent, sample them in parallel
+#if defined(OPENMP)
+#pragma omp parallel for
+#endif  // OPENMP
+      for (int k = 0; k < g_param.lammpspotsteps; ++k) {
+        double r = r0 + k * dr;
         double fval = 0.0;
         double grad = 0.0;
 
@@ -315,9 +324,19 @@ void write_lammps_table_pair()
         // make sure we don't acidentally read from the next potential
         if (k == (g_param.lammpspotsteps - 1))
           r -= 0.000001;
-        fval = g_splint_comb(&g_pot.calc_pot, g_pot.calc_pot.table, idx, r, &grad);
+        fval = splint_comb_fmt(&g_pot.calc_pot, g_pot.calc_pot.table, idx, r, &grad);
 #endif  // APOT
-        fprintf(outfile, "%d %f %.16e %.16e\n", k + 1, r, fval, grad);
+        fvals[k] = fval;
+        grads[k] = grad;
+      }
+
+      for (int k = 0; k < g_param.lammpspotsteps; ++k) {
+        double r = r0 + k * dr;
+#if !defined(APOT)
+        if (k == (g_param.lammpspotsteps - 1))
+          r -= 0.000001;
+#endif  // !APOT
+        fprintf(outfile, "%d %f %.16e %.16e\n", k + 1, r, fvals[k], grads[k]);
       }
       fprintf(outfile, "\n");
     }
@@ -370,6 +389,42 @@ int is_lammps_suited()
   return 1;
 }
 
+/****************************************************************
+ *
+ *  lammps_sample_column
+ *
+ *  Sample one potential column on an equidistant grid; the grid
+ *  points are independent and evaluated in parallel with OpenMP.
+ *  shift_index marks the grid point that is nudged below the
+ *  cutoff so the spline does not read from the next potential.
+ *
+ ****************************************************************/
+
+static void lammps_sample_column(int col, double r0, double dr, int steps,
+                                 int shift_index, double shift,
+                                 double* samples)
+{
+#if defined(OPENMP)
+#pragma omp parallel for
+#endif  // OPENMP
+  for (int j = 0; j < steps; j++) {
+    double r = r0 + j * dr;
+#if defined(APOT)
+    double temp = 0.0;
+    (*g_pot.apot_table.fvalue[col])(r, g_pot.apot_table.values[col], &temp);
+    if (r == 0.0 && (isnan(temp) || isinf(temp)))
+      g_pot.apot_table.fvalue[col](r + 0.001, g_pot.apot_table.values[col], &temp);
+    if (g_pot.smooth_pot[col])
+      temp *= apot_cutoff(r, g_pot.apot_table.end[col], g_pot.apot_table.values[col][g_pot.apot_table.n_par[col] - 1]);
+    samples[j] = temp;
+#else
+    if (j == shift_index)
+      r -= shift;
+    samples[j] = splint_fmt(&g_pot.calc_pot, g_pot.calc_pot.table, col, r);
+#endif  // APOT
+  }
+}
+
 void write_lammps_table_eam_adp()
 {
   if (!is_lammps_suited())
@@ -408,9 +463,7 @@ void write_lammps_table_eam_adp()
 
   // calculate the dr parameter
 
-#if defined(APOT)
-  double temp = 0.0f;
-#endif // APOT
+  double* samples = (double*)Malloc(g_param.lammpspotsteps * sizeof(double));
   const double rbegin = 0.0f;
   const double dr = g_pot.opt_pot.end[0] / (g_param.lammpspotsteps - 1);
   int steps = g_param.lammpspotsteps;
@@ -439,22 +492,10 @@ void write_lammps_table_eam_adp()
     }
 #endif // APOT
 
-    for (int j = 0; j < steps; j++) {
-#if defined(APOT)
-      (*g_pot.apot_table.fvalue[k])(r, g_pot.apot_table.values[k], &temp);
-      if (r == 0.0 && (isnan(temp) || isinf(temp)))
-        g_pot.apot_table.fvalue[k](r + 0.001, g_pot.apot_table.values[k], &temp);
-      if (g_pot.smooth_pot[k])
-        temp *= apot_cutoff(r, g_pot.apot_table.end[k], g_pot.apot_table.values[k][g_pot.apot_table.n_par[k] - 1]);
-      fprintf(outfile, "%.16e\n", temp);
-#else
-      // make sure we don't acidentally read from the next potential
-      if (j == (steps - 1))
-        r -= 0.00001;
-      fprintf(outfile, "%.16e\n", g_splint(&g_pot.calc_pot, g_pot.calc_pot.table, k, r));
-#endif  // APOT
-      r += drho;
-    }
+    lammps_sample_column(k, r, drho, steps, steps - 1, 0.00001, samples);
+
+    for (int j = 0; j < steps; j++)
+      fprintf(outfile, "%.16e\n", samples[j]);
 
     r = rbegin;
     k = g_calc.paircol + i;
@@ -469,22 +510,10 @@ void write_lammps_table_eam_adp()
 #endif // !APOT
 
     // transfer function rho(r)
-    for (int j = 0; j < steps; j++) {
-#if defined(APOT)
-      (*g_pot.apot_table.fvalue[k])(r, g_pot.apot_table.values[k], &temp);
-      if (r == 0.0 && (isnan(temp) || isinf(temp)))
-        g_pot.apot_table.fvalue[k](r + 0.001, g_pot.apot_table.values[k], &temp);
-      if (g_pot.smooth_pot[k])
-        temp *= apot_cutoff(r, g_pot.apot_table.end[k], g_pot.apot_table.values[k][g_pot.apot_table.n_par[k] - 1]);
-      fprintf(outfile, "%.16e\n", temp);
-#else
-      // make sure we don't acidentally read from the next potential
-      if (j == (steps - 1))
-        r -= 0.000001;
-      fprintf(outfile, "%.16e\n", g_splint(&g_pot.calc_pot, g_pot.calc_pot.table, k, r));
-#endif  // APOT
-      r += dr;
-    }
+    lammps_sample_column(k, r, dr, steps, steps - 1, 0.000001, samples);
+
+    for (int j = 0; j < steps; j++)
+      fprintf(outfile, "%.16e\n", samples[j]);
   }
 
   /* pair potentials */
@@ -504,21 +533,16 @@ void write_lammps_table_eam_adp()
       }
 #endif // !APOT
 
+      lammps_sample_column(k, r, dr, steps, steps - 1, 0.000001, samples);
+
       for (int l = 0; l < steps; l++) {
-#if defined(APOT)
-        (*g_pot.apot_table.fvalue[k])(r, g_pot.apot_table.values[k], &temp);
-        if (r == 0.0 && (isnan(temp) || isinf(temp)))
-          g_pot.apot_table.fvalue[k](r + 0.001, g_pot.apot_table.values[k], &temp);
-        if (g_pot.smooth_pot[k])
-          temp *= apot_cutoff(r, g_pot.apot_table.end[k], g_pot.apot_table.values[k][g_pot.apot_table.n_par[k] - 1]);
-        fprintf(outfile, "%.16e\n", r * temp);
-#else
+        double rr = r + l * dr;
+#if !defined(APOT)
         // make sure we don't acidentally read from the next potential
         if (l == (steps - 1))
-          r -= 0.000001;
-        fprintf(outfile, "%.16e\n", r * g_splint(&g_pot.calc_pot, g_pot.calc_pot.table, k, r));
-#endif  // APOT
-        r += dr;
+          rr -= 0.000001;
+#endif  // !APOT
+        fprintf(outfile, "%.16e\n", rr * samples[l]);
       }
     }
   }
@@ -542,22 +566,15 @@ void write_lammps_table_eam_adp()
       }
 #endif // !APOT
 
+      lammps_sample_column(k, r, dr, steps, g_param.lammpspotsteps - 1,
+                           0.000001, samples);
+
       for (int l = 0; l < steps; l++) {
 #if defined(APOT)
-        temp = 0.0;
-        (*g_pot.apot_table.fvalue[k])(r, g_pot.apot_table.values[k], &temp);
-        if (r == 0.0 && (isnan(temp) || isinf(temp)))
-          g_pot.apot_table.fvalue[k](r + 0.001, g_pot.apot_table.values[k], &temp);
-        if (g_pot.smooth_pot[k])
-          temp *= apot_cutoff(r, g_pot.apot_table.end[k], g_pot.apot_table.values[k][g_pot.apot_table.n_par[k] - 1]);
-        fprintf(outfile, "%.16e\n", r * temp);
+        fprintf(outfile, "%.16e\n", (r + l * dr) * samples[l]);
 #else
-        // make sure we don't acidentally read from the next potential
-        if (l == (g_param.lammpspotsteps - 1))
-          r -= 0.000001;
-        fprintf(outfile, "%e\n", g_splint(&g_pot.calc_pot, g_pot.calc_pot.table, k, r));
+        fprintf(outfile, "%e\n", samples[l]);
 #endif // APOT
-        r += dr;
       }
     }
   /* quadrupole distortion */
@@ -578,22 +595,15 @@ void write_lammps_table_eam_adp()
       }
 #endif // !APOT
 
+      lammps_sample_column(k, r, dr, steps, g_param.lammpspotsteps - 1,
+                           0.000001, samples);
+
       for (int l = 0; l < steps; l++) {
 #if defined(APOT)
-        temp = 0.0;
-        (*g_pot.apot_table.fvalue[k])(r, g_pot.apot_table.values[k], &temp);
-        if (r == 0.0 && (isnan(temp) || isinf(temp)))
-          g_pot.apot_table.fvalue[k](r + 0.001, g_pot.apot_table.values[k], &temp);
-        if (g_pot.smooth_pot[k])
-          temp *= apot_cutoff(r, g_pot.apot_table.end[k], g_pot.apot_table.values[k][g_pot.apot_table.n_par[k] - 1]);
-        fprintf(outfile, "%.16e\n", r * temp);
+        fprintf(outfile, "%.16e\n", (r + l * dr) * samples[l]);
 #else
-        // make sure we don't acidentally read from the next potential
-        if (l == (g_param.lammpspotsteps - 1))
-          r -= 0.000001;
-        fprintf(outfile, "%e\n", g_splint(&g_pot.calc_pot, g_pot.calc_pot.table, k, r));
+        fprintf(outfile, "%e\n", samples[l]);
 #endif // APOT
-        r += dr;
       }
     }
 #endif  // ADP
@@ -31,9 +31,16 @@
 
 #include "potfit.h"
 
+#include "bench.h"
+#include "conf_index.h"
 #include "config.h"
 #include "errors.h"
+#include "eval_float.h"
+#include "eval_memo.h"
 #include "force.h"
+#include "force_abort.h"
+#include "force_batch.h"
+#include "force_cache.h"
 #include "functions.h"
 #include "kim.h"
 #include "memory.h"
@@ -43,6 +50,11 @@
 #include "potential_input.h"
 #include "potential_output.h"
 #include "random.h"
+#include "server.h"
+#include "surrogate.h"
+#include "timers.h"
+#include "trace.h"
+#include "tune.h"
 #include "utils.h"
 #include "uq.h"
 
@@ -51,6 +63,19 @@
 void read_input_files(int argc, char** argv);
 void start_mpi_worker(double* force);
 
+#if defined(MPI)
+#if defined(EVO)
+// evaluation group leaders, implemented in diff_evo.c
+void run_evo_group_leader(double* forces);
+void stop_evo_group_leaders();
+#else
+// annealing replica chains, implemented in simann.c
+void run_anneal_replica();
+// line search helpers, implemented in linmin.c
+void stop_linmin_helpers();
+#endif  // EVO
+#endif  // MPI
+
 // potfit global variables
 
 potfit_calculation g_calc;
@@ -80,10 +105,6 @@ int main(int argc, char** argv)
 
   g_mpi.init_done = 1;
 
-#if defined(KIM)
-  initialize_KIM();
-#endif // KIM
-
   switch (broadcast_params_mpi()) {
     case POTFIT_ERROR_MPI_CLEAN_EXIT:
       shutdown_mpi();
@@ -93,33 +114,90 @@ int main(int argc, char** argv)
       return EXIT_FAILURE;
   }
 
+#if defined(KIM)
+  // needs the shared-memory communicators set up during the broadcast
+  initialize_KIM();
+#endif // KIM
+
+#if !defined(KIM)
+  // repack the distributed neighbor tables for the force kernels
+  build_neighbor_soa();
+#endif  // !KIM
+
   g_calc.ndim = g_pot.opt_pot.idxlen;
   g_calc.ndimtot = g_pot.opt_pot.len;
 
   // main force vector, all forces, energies, stresses, etc. will be stored here
-  g_calc.force = (double*)Malloc(g_calc.mdim * sizeof(double));
+  g_calc.force = (double*)Malloc_huge(g_calc.mdim * sizeof(double));
 
   // starting positions for the force vector
   set_force_vector_pointers();
 
+  // dependency maps for incremental force evaluations
+  init_force_cache();
+
+  // mini-batch evaluations for the stochastic optimizers
+  init_force_batch();
+
+  // early abort of hopeless trial evaluations
+  init_force_abort();
+
+  // float mirrors for the single-precision search phases
+  init_eval_float();
+
+  // memoization of repeated parameter vectors
+  init_eval_memo();
+
+  // surrogate pre-screening of trial vectors
+  init_surrogate();
+
+  // per-rank phase timers around the force evaluation hot path
+  init_timers();
+
+  // binary telemetry trace of the optimizers
+  init_trace();
+
+  // per-configuration importance index for screening and reordering
+  init_conf_index();
+
 #if defined(APOT)
 #if defined(MPI)
   MPI_Bcast(g_pot.opt_pot.table, g_calc.ndimtot, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 #endif  // MPI
 #if !defined(KIM)
   update_calc_table(g_pot.opt_pot.table, g_pot.calc_pot.table, 1);
+  // packed tables for the per-evaluation parameter checks
+  apot_init_checks();
 #endif  // !KIM
 #endif  // APOT
 
   if (g_mpi.myid > 0) {
     start_mpi_worker(g_calc.force);
+#if defined(MPI)
+  } else if (g_mpi.world_id > 0) {
+    // group-local root of another evaluation group
+#if defined(EVO)
+    run_evo_group_leader(g_calc.force);
+#else
+    run_anneal_replica();
+#endif  // EVO
+#endif  // MPI
   } else {
     time_t start_time;
     time_t end_time;
 
     time(&start_time);
 
-    if (g_param.opt && g_calc.ndim > 0) {
+    if (g_param.tune_geometry)
+      run_geometry_tuning();
+
+    if (g_files.socketfile != NULL) {
+      // keep all state resident and serve evaluation requests instead
+      // of running a single optimization
+      run_evaluation_server();
+    } else if (g_param.bench_evals > 0) {
+      run_benchmark();
+    } else if (g_param.opt && g_calc.ndim > 0) {
       run_optimization();
     } else if (g_calc.ndim == 0) {
       printf(
@@ -189,6 +267,15 @@ int main(int argc, char** argv)
     }
     printf("\n");
 
+#if defined(MPI)
+    // release the other group leaders first, they run their own MC walkers
+#if defined(EVO)
+    stop_evo_group_leaders();
+#else
+    stop_linmin_helpers();
+#endif // EVO
+#endif // MPI
+
     ensemble_generation(tot);
 #endif //UQ
 
@@ -203,6 +290,14 @@ int main(int argc, char** argv)
     }
 
 #if defined(MPI)
+#if !defined(UQ)
+    // with UQ the other group leaders have been released already
+#if defined(EVO)
+    stop_evo_group_leaders();
+#else
+    stop_linmin_helpers();
+#endif // EVO
+#endif // !UQ
     calc_forces(NULL, NULL, 1); // go wake up other threads
 #endif // MPI
   } // myid == 0
@@ -224,7 +319,7 @@ void read_input_files(int argc, char** argv)
     init_kim_model();
 #endif
     read_pot_table(g_files.startpot);
-    read_config(g_files.config);
+    read_config();
 
     printf("Global energy weight: %f\n", g_param.eweight);
 #if defined(STRESS)
@@ -266,6 +361,13 @@ void exit_potfit()
 {
   // do some cleanups before exiting
 
+  shutdown_trace();
+  shutdown_conf_index();
+
+  // all processes have left their evaluation loops here, print the
+  // phase breakdown over the ranks before MPI goes away
+  timer_report_final();
+
 #if defined(MPI)
   // kill MPI
   shutdown_mpi();
@@ -301,6 +403,13 @@ void error(int done, const char* msg, ...)
 #if defined(MPI)
     if (g_mpi.init_done == 1) {
       /* go wake up other threads */
+#if defined(EVO)
+      if (g_mpi.world_id == 0)
+        stop_evo_group_leaders();
+#else
+      if (g_mpi.world_id == 0)
+        stop_linmin_helpers();
+#endif  // EVO
       calc_forces(NULL, NULL, 1);
       shutdown_mpi();
     }
@@ -50,7 +50,9 @@
 #endif  // MKL
 
 #include "bracket.h"
+#include "checkpoint.h"
 #include "force.h"
+#include "force_jacobian.h"
 #include "memory.h"
 #include "optimize.h"
 #include "potential_input.h"
@@ -67,10 +69,52 @@
 int gamma_init(double**, double**, double*, double*);
 int gamma_update(double**, double, double, double*, double*, double*, int, int,
                  int, double);
+double gamma_scale(int);
+int gamma_column(double**, double**, int, double*, double*, double);
+int gamma_normalize(double**, double**, int);
 void lineqsys_init(double**, double**, double*, double*, int, int);
 void lineqsys_update(double**, double**, double*, double*, int, int, int);
 double normalize_vector(double*, int);
 
+/* sparse view of the gamma columns
+ *
+ * A spline knot only influences the force components of the configs
+ * with neighbors in its radial range, so most entries of a
+ * finite-difference gamma column are exactly zero. The row indices of
+ * the nonzero entries are recorded when a column is normalized and
+ * the gamma^t.gamma assembly only walks those rows - skipping exact
+ * zeros does not change the sums bitwise. A column touched by
+ * gamma_update mixes in the full force vector and falls back to the
+ * dense range (num_rows = -1). */
+
+static int** g_gamma_rows = NULL; /* row index list per column */
+static int* g_gamma_num_rows = NULL;
+static int* g_gamma_all_rows = NULL; /* 0..mdim-1, for dense columns */
+
+static void gamma_scan_column(double** gamma, int i)
+{
+  int count = 0;
+
+  for (int j = 0; j < g_calc.mdim; j++)
+    if (gamma[j][i] != 0.0)
+      count++;
+
+  /* a list denser than half the rows is not worth the indirection */
+  if (2 * count > g_calc.mdim) {
+    g_gamma_num_rows[i] = -1;
+    return;
+  }
+
+  g_gamma_rows[i] = (int*)Realloc(g_gamma_rows[i], count * sizeof(int));
+  g_gamma_num_rows[i] = count;
+
+  count = 0;
+
+  for (int j = 0; j < g_calc.mdim; j++)
+    if (gamma[j][i] != 0.0)
+      g_gamma_rows[i][count++] = j;
+}
+
 /****************************************************************
  *
  * run_powell_lsq
@@ -93,39 +137,81 @@ void run_powell_lsq(double* xi)
   double ferror = 0.0;
   double berror = 0.0; // forward/backward error estimates
 
+  /* The workspace is sized by ndim and mdim, which are fixed for the
+     lifetime of a run, while the alternating anneal/powell cycles
+     re-enter this function many times: allocate everything on the
+     first invocation and reuse it afterwards, like gamma_init already
+     does for its buffers. Every matrix is rebuilt from xi before use,
+     so no state leaks between invocations. */
+
   /* Direction vectors */
-  double** d = mat_double(g_calc.ndim, g_calc.ndim);
+  static double** d = NULL;
 
   /* Matrix of derivatives */
-  double** gamma = mat_double(g_calc.mdim, g_calc.ndim);
+  static double** gamma = NULL;
 
   /* Lin.Eq.Sys. Matrix */
-  double** lineqsys = mat_double(g_calc.ndim, g_calc.ndim);
+  static double** lineqsys = NULL;
 
   /* LU decomp. of the lineqsys */
-  double** les_inverse = mat_double(g_calc.ndim, g_calc.ndim);
+  static double** les_inverse = NULL;
 
   /* Keeps track of LU pivoting */
-  int* perm_indx = (int*)Malloc(g_calc.ndim * sizeof(int));
+  static int* perm_indx = NULL;
 
   /* Normalized vector delta */
-  double* delta_norm = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+  static double* delta_norm = NULL;
 
   /* calculated forces */
-  double* forces_1 = (double*)Malloc(g_calc.mdim * sizeof(double));
-  double* forces_2 = (double*)Malloc(g_calc.mdim * sizeof(double));
+  static double* forces_1 = NULL;
+  static double* forces_2 = NULL;
 
   /* Vectors needed in Powell's algorithm */
-  double* p = (double*)Malloc(g_calc.ndim * sizeof(double));
-  double* q = (double*)Malloc(g_calc.ndim * sizeof(double));
+  static double* p = NULL;
+  static double* q = NULL;
 
-  /* Vector pointing into correct dir'n */
-  double* delta = (double*)Malloc(g_calc.ndimtot * sizeof(double)); /* ==0 */
+  /* Vector pointing into correct dir'n; the components of the
+     non-optimized parameters stay 0 forever, the others are
+     recomputed in every inner step */
+  static double* delta = NULL;
 
   int worksize = 64 * g_calc.ndim;
+
   // work array to be used by dsysvx
-  double* work = (double*)Malloc(worksize * sizeof(double));
-  int* iwork = (int*)Malloc(g_calc.ndim * sizeof(int));
+  static double* work = NULL;
+  static int* iwork = NULL;
+
+  if (d == NULL) {
+    d = mat_double(g_calc.ndim, g_calc.ndim);
+    gamma = mat_double(g_calc.mdim, g_calc.ndim);
+    lineqsys = mat_double(g_calc.ndim, g_calc.ndim);
+    les_inverse = mat_double(g_calc.ndim, g_calc.ndim);
+    perm_indx = (int*)Malloc(g_calc.ndim * sizeof(int));
+    delta_norm = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+    forces_1 = (double*)Malloc(g_calc.mdim * sizeof(double));
+    forces_2 = (double*)Malloc(g_calc.mdim * sizeof(double));
+    p = (double*)Malloc(g_calc.ndim * sizeof(double));
+    q = (double*)Malloc(g_calc.ndim * sizeof(double));
+    delta = (double*)Malloc(g_calc.ndimtot * sizeof(double)); /* ==0 */
+    work = (double*)Malloc(worksize * sizeof(double));
+    iwork = (int*)Malloc(g_calc.ndim * sizeof(int));
+
+    g_gamma_rows = (int**)Malloc(g_calc.ndim * sizeof(int*));
+    g_gamma_num_rows = (int*)Malloc(g_calc.ndim * sizeof(int));
+    g_gamma_all_rows = (int*)Malloc(g_calc.mdim * sizeof(int));
+
+    for (int i = 0; i < g_calc.ndim; i++)
+      g_gamma_num_rows[i] = -1;
+
+    for (int j = 0; j < g_calc.mdim; j++)
+      g_gamma_all_rows[j] = j;
+  }
+
+  /* resume an interrupted run from the latest checkpointed iterate;
+     gamma and the direction vectors are rebuilt from xi anyway, so the
+     parameter vector and the rng state are the whole algorithm state */
+  if (checkpoint_read_powell(xi))
+    printf("Resuming powell minimization from checkpoint\n");
 
   /* calculate the first force */
   F1 = calc_forces(xi, forces_1, 0);
@@ -352,9 +438,11 @@ void run_powell_lsq(double* xi)
 #elif defined(KIM)
       update_kim_table(xi);
 #endif  // APOT
-      write_pot_table_potfit(g_files.tempfile);
+      write_pot_table_potfit_async(g_files.tempfile);
     }
 
+    checkpoint_write_powell(xi);
+
     /*End fit if whole series didn't improve F */
   } while (((F3 - F1 > PRECISION / 10.0) || (F3 - F1 < 0)) &&
            (F3 - F1 > g_calc.d_eps));
@@ -390,8 +478,13 @@ void run_powell_lsq(double* xi)
 int gamma_init(double** gamma, double** d, double* xi, double* force_xi)
 {
   static double* force;
+#if defined(MPI) && !defined(EVO)
+  static double* xi_pert;
+  static double** helper_force;
+  int num_helpers = g_mpi.num_groups - 1;
+#endif  // MPI && !EVO
 
-  double sum, temp, scale, store; /* Auxiliary var: Sum */
+  double store; /* original value of the perturbed parameter */
 
   /* Set direction vectors to coordinate directions d_ij=KroneckerDelta_ij */
   for (int i = 0; i < g_calc.ndim; i++)
@@ -402,40 +495,145 @@ int gamma_init(double** gamma, double** d, double* xi, double* force_xi)
   if (force == NULL)
     force = (double*)Malloc(g_calc.mdim * sizeof(double));
 
+#if defined(APOT)
+  /* analytic jacobian: one pass of the force kernel over the
+     parameter derivative tables instead of ndim force calls */
+  if (apot_jacobian_available()) {
+    apot_jacobian(xi, gamma);
+
+    for (int i = 0; i < g_calc.ndim; i++)
+      if (gamma_normalize(gamma, d, i))
+        return i + 1; /* singular matrix, abort */
+
+    return 0;
+  }
+#endif  // APOT
+
+#if defined(MPI) && !defined(EVO)
+  if (num_helpers > 0) {
+    if (xi_pert == NULL) {
+      xi_pert = (double*)Malloc(g_calc.ndimtot * sizeof(double));
+      helper_force = mat_double(num_helpers, g_calc.mdim);
+    }
+
+    /* the perturbations are independent, evaluate num_helpers + 1 of
+       them concurrently: one with the own group, the others on the
+       line search helper groups */
+    for (int base = 0; base < g_calc.ndim; base += num_helpers + 1) {
+      int extra = MIN(num_helpers, g_calc.ndim - base - 1);
+
+      for (int k = 0; k < extra; k++) {
+        int i = base + 1 + k;
+        memcpy(xi_pert, xi, g_calc.ndimtot * sizeof(double));
+        xi_pert[g_pot.opt_pot.idx[i]] += EPS * gamma_scale(i);
+        MPI_Send(xi_pert, g_calc.ndimtot, MPI_DOUBLE,
+                 g_mpi.group_leaders[k + 1], LINMIN_TAG_EVAL, MPI_COMM_WORLD);
+      }
+
+      /* own column, evaluated while the helpers work */
+      store = xi[g_pot.opt_pot.idx[base]];
+      xi[g_pot.opt_pot.idx[base]] += EPS * gamma_scale(base);
+      calc_forces(xi, force, 0);
+      xi[g_pot.opt_pot.idx[base]] = store;
+
+      for (int k = 0; k < extra; k++) {
+        double cost = 0.0;
+        MPI_Recv(&cost, 1, MPI_DOUBLE, g_mpi.group_leaders[k + 1],
+                 LINMIN_TAG_EVAL, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+        MPI_Recv(helper_force[k], g_calc.mdim, MPI_DOUBLE,
+                 g_mpi.group_leaders[k + 1], LINMIN_TAG_EVAL, MPI_COMM_WORLD,
+                 MPI_STATUS_IGNORE);
+      }
+
+      if (gamma_column(gamma, d, base, force, force_xi, gamma_scale(base)))
+        return base + 1; /* singular matrix, abort */
+
+      for (int k = 0; k < extra; k++)
+        if (gamma_column(gamma, d, base + 1 + k, helper_force[k], force_xi,
+                         gamma_scale(base + 1 + k)))
+          return base + 2 + k; /* singular matrix, abort */
+    }
+
+    return 0;
+  }
+#endif  // MPI && !EVO
+
   /*initialize gamma */
   for (int i = 0; i < g_calc.ndim; i++) {
     store = xi[g_pot.opt_pot.idx[i]];
+    xi[g_pot.opt_pot.idx[i]] += EPS * gamma_scale(i); /*increase xi[idx[i]]... */
+
+    calc_forces(xi, force, 0);
+
+    xi[g_pot.opt_pot.idx[i]] = store; /*...and reset [idx[i]] again */
+
+    if (gamma_column(gamma, d, i, force, force_xi, gamma_scale(i)))
+      return i + 1; /* singular matrix, abort */
+  }
+  return 0;
+}
+
+/****************************************************************
+ *
+ * gamma_scale: width of the allowed range of the i-th free
+ *            parameter, used to scale the finite differences
+ *
+ ****************************************************************/
+
+double gamma_scale(int i)
+{
 #if defined(APOT) || defined(KIM)
-    scale = g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]] -
-      g_pot.apot_table .pmin[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
-    xi[g_pot.opt_pot.idx[i]] += (EPS * scale);
+  return g_pot.apot_table.pmax[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]] -
+    g_pot.apot_table .pmin[g_pot.apot_table.idxpot[i]][g_pot.apot_table.idxparam[i]];
 #else
-    scale = 1.0;
-    xi[g_pot.opt_pot.idx[i]] += EPS; /*increase xi[idx[i]]... */
+  (void)i;
+  return 1.0;
 #endif  // APOT
+}
 
-    sum = 0.0;
+/****************************************************************
+ *
+ * gamma_column: fill column i of gamma with the numerical
+ *            derivatives from a perturbed force vector and
+ *            normalize it; returns 1 if the column vanishes
+ *
+ ****************************************************************/
 
-    calc_forces(xi, force, 0);
+int gamma_column(double** gamma, double** d, int i, double* force,
+                 double* force_xi, double scale)
+{
+  for (int j = 0; j < g_calc.mdim; j++)
+    gamma[j][i] = (force[j] - force_xi[j]) / (EPS * scale);
 
-    for (int j = 0; j < g_calc.mdim; j++) {
-      temp = (force[j] - force_xi[j]) / (EPS * scale);
-      gamma[j][i] = temp;
-      sum += dsquare(temp);
-    }
+  return gamma_normalize(gamma, d, i);
+}
+
+/****************************************************************
+ *
+ * gamma_normalize: scale column i of gamma so that
+ *            sum_j(gamma^2)=1 and rescale d accordingly;
+ *            returns 1 if the column vanishes
+ *
+ ****************************************************************/
+
+int gamma_normalize(double** gamma, double** d, int i)
+{
+  double sum = 0.0;
 
-    temp = sqrt(sum);
+  for (int j = 0; j < g_calc.mdim; j++)
+    sum += dsquare(gamma[j][i]);
 
-    xi[g_pot.opt_pot.idx[i]] = store; /*...and reset [idx[i]] again */
+  double temp = sqrt(sum);
+
+  if (temp > VERY_SMALL) {
+    for (int j = 0; j < g_calc.mdim; j++)
+      gamma[j][i] /= temp; /*normalize gamma */
+    d[i][i] /= temp;       /* rescale d */
+  } else
+    return 1; /* singular matrix, abort */
+
+  gamma_scan_column(gamma, i);
 
-    /* scale gamma so that sum_j(gamma^2)=1                      */
-    if (temp > VERY_SMALL) {
-      for (int j = 0; j < g_calc.mdim; j++)
-        gamma[j][i] /= temp; /*normalize gamma */
-      d[i][i] /= temp;       /* rescale d */
-    } else
-      return i + 1; /* singular matrix, abort */
-  }
   return 0;
 }
 
@@ -478,6 +676,10 @@ int gamma_update(double** gamma, double a, double b, double* fa, double* fb,
   } else
     return 1; /* Matrix will be singular: Restart! */
 
+  /* the secant correction mixed the full force vector into this
+     column, its sparsity pattern is gone */
+  g_gamma_num_rows[j] = -1;
+
   return 0;
 }
 
@@ -493,20 +695,37 @@ void lineqsys_init(double** gamma, double** lineqsys, double* deltaforce,
 {
   /* calculating vector p (lineqsys . q == P in LinEqSys) */
   for (int i = 0; i < n; i++) {
+    const int* rows = (g_gamma_num_rows[i] < 0) ? g_gamma_all_rows : g_gamma_rows[i];
+    const int num = (g_gamma_num_rows[i] < 0) ? m : g_gamma_num_rows[i];
+
     p[i] = 0.0;
-    for (int j = 0; j < m; j++) {
+    for (int r = 0; r < num; r++) {
+      const int j = rows[r];
       p[i] -= gamma[j][i] * deltaforce[j];
     }
   }
 
-  /* calculating the linear equation system matrix gamma^t.gamma */
+  /* calculating the linear equation system matrix gamma^t.gamma; every
+     product walks the nonzero rows of the sparser column involved */
   for (int i = 0; i < n; i++) {
+    const int* rows_i = (g_gamma_num_rows[i] < 0) ? g_gamma_all_rows : g_gamma_rows[i];
+    const int num_i = (g_gamma_num_rows[i] < 0) ? m : g_gamma_num_rows[i];
+
     lineqsys[i][i] = 0;
-    for (int j = 0; j < m; j++)
-      lineqsys[i][i] += dsquare(gamma[j][i]);
+    for (int r = 0; r < num_i; r++)
+      lineqsys[i][i] += dsquare(gamma[rows_i[r]][i]);
     for (int k = i + 1; k < n; k++) {
+      const int* rows = rows_i;
+      int num = num_i;
+
+      if (g_gamma_num_rows[k] >= 0 && g_gamma_num_rows[k] < num) {
+        rows = g_gamma_rows[k];
+        num = g_gamma_num_rows[k];
+      }
+
       lineqsys[i][k] = 0.0;
-      for (int j = 0; j < m; j++) {
+      for (int r = 0; r < num; r++) {
+        const int j = rows[r];
         lineqsys[i][k] += gamma[j][i] * gamma[j][k];
       }
       lineqsys[k][i] = lineqsys[i][k];
@@ -524,12 +743,18 @@ void lineqsys_init(double** gamma, double** lineqsys, double* deltaforce,
 void lineqsys_update(double** gamma, double** lineqsys, double* force_xi,
                      double* p, int i, int n, int m)
 {
+  /* column i has just been replaced by gamma_update and is dense, but
+     the untouched columns k keep their sparsity pattern */
   for (int k = 0; k < n; k++) {
+    const int* rows = (g_gamma_num_rows[k] < 0) ? g_gamma_all_rows : g_gamma_rows[k];
+    const int num = (g_gamma_num_rows[k] < 0) ? m : g_gamma_num_rows[k];
+
     p[k] = 0.0;
 
     lineqsys[i][k] = 0.0;
 
-    for (int j = 0; j < m; j++) {
+    for (int r = 0; r < num; r++) {
+      const int j = rows[r];
       p[k] -= gamma[j][k] * force_xi[j];
       lineqsys[i][k] += gamma[j][i] * gamma[j][k];
     }
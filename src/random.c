@@ -34,6 +34,19 @@
 
 dsfmt_t g_dsfmt;
 
+// cached second variate of the Box Muller transformation
+static int g_normdist_have = 0;
+static double g_normdist_nd2 = 0.0;
+
+// block-refill buffer: dSFMT fills whole arrays much faster than it
+// generates scalars, so eqdist serves from this buffer and refills it
+// in one call when it runs empty
+// must be a multiple of two and at least dsfmt_get_min_array_size()
+#define RNG_BUFFER_SIZE 4096
+
+static double g_rng_buffer[RNG_BUFFER_SIZE];
+static int g_rng_buffer_pos = RNG_BUFFER_SIZE;
+
 /****************************************************************
  *
  *  eqdist
@@ -42,7 +55,15 @@ dsfmt_t g_dsfmt;
  *
  ****************************************************************/
 
-double eqdist() { return dsfmt_genrand_close_open(&g_dsfmt); }
+double eqdist()
+{
+  if (g_rng_buffer_pos == RNG_BUFFER_SIZE) {
+    dsfmt_fill_array_close_open(&g_dsfmt, g_rng_buffer, RNG_BUFFER_SIZE);
+    g_rng_buffer_pos = 0;
+  }
+
+  return g_rng_buffer[g_rng_buffer_pos++];
+}
 
 /****************************************************************
  *
@@ -63,6 +84,9 @@ void init_rng(int seed)
 
   dsfmt_init_by_array(&g_dsfmt, array, ARRAY_SIZE);
 
+  // discard a previously buffered block, it belongs to the old state
+  g_rng_buffer_pos = RNG_BUFFER_SIZE;
+
   for (int i = 0; i < 10e5; i++)
     eqdist();
 
@@ -80,13 +104,11 @@ void init_rng(int seed)
 
 double normdist()
 {
-  static int have_number = 0;
-  static double nd2 = 0.0;
   double x1 = 0.0;
   double x2 = 0.0;
   double sqr = 0.0;
 
-  if (!have_number) {
+  if (!g_normdist_have) {
     do {
       x1 = 2.0 * eqdist() - 1.0;
       x2 = 2.0 * eqdist() - 1.0;
@@ -94,11 +116,53 @@ double normdist()
     } while (sqr >= 1.0 || sqr == 0);
     // Box Muller Transformation
     double cnst = sqrt(-2.0 * log(sqr) / sqr);
-    nd2 = x2 * cnst;
-    have_number = 1;
+    g_normdist_nd2 = x2 * cnst;
+    g_normdist_have = 1;
     return x1 * cnst;
   } else {
-    have_number = 0;
-    return nd2;
+    g_normdist_have = 0;
+    return g_normdist_nd2;
   }
 }
+
+/****************************************************************
+ *
+ *  rng state serialization, used by the optimizer checkpoints;
+ *  the cached normdist variate is part of the state, otherwise a
+ *  resumed run would not reproduce the interrupted sequence
+ *
+ ****************************************************************/
+
+int rng_write_state(FILE* file)
+{
+  if (fwrite(&g_dsfmt, sizeof(dsfmt_t), 1, file) != 1)
+    return -1;
+  if (fwrite(&g_normdist_have, sizeof(int), 1, file) != 1)
+    return -1;
+  if (fwrite(&g_normdist_nd2, sizeof(double), 1, file) != 1)
+    return -1;
+  if (fwrite(&g_rng_buffer_pos, sizeof(int), 1, file) != 1)
+    return -1;
+  if (fwrite(g_rng_buffer, sizeof(double), RNG_BUFFER_SIZE, file) != RNG_BUFFER_SIZE)
+    return -1;
+
+  return 0;
+}
+
+int rng_read_state(FILE* file)
+{
+  if (fread(&g_dsfmt, sizeof(dsfmt_t), 1, file) != 1)
+    return -1;
+  if (fread(&g_normdist_have, sizeof(int), 1, file) != 1)
+    return -1;
+  if (fread(&g_normdist_nd2, sizeof(double), 1, file) != 1)
+    return -1;
+  if (fread(&g_rng_buffer_pos, sizeof(int), 1, file) != 1)
+    return -1;
+  if (fread(g_rng_buffer, sizeof(double), RNG_BUFFER_SIZE, file) != RNG_BUFFER_SIZE)
+    return -1;
+  if (g_rng_buffer_pos < 0 || g_rng_buffer_pos > RNG_BUFFER_SIZE)
+    return -1;
+
+  return 0;
+}
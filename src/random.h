@@ -35,4 +35,8 @@ void init_rng(int seed);
 double eqdist();
 double normdist();
 
+// binary rng state, used by the optimizer checkpoints
+int rng_write_state(FILE* file);
+int rng_read_state(FILE* file);
+
 #endif  // RANDOM_H_INCLUDED
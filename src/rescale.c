@@ -32,14 +32,74 @@
 
 #if defined(RESCALE) && !defined(APOT)
 
+#include "eval_memo.h"
 #include "force.h"
 #include "memory.h"
+#include "rescale.h"
 #include "splines.h"
 
 /* Doesn't make much sense without EAM or ADP  */
 
 #if defined(EAM) || defined(ADP)
 
+#if !defined(MPI)
+
+/****************************************************************
+ *
+ * rescale_skip: decide from the tracked rho bounds whether no
+ *     update is needed, so the full dataset pass below only runs
+ *     when the domain actually has to move
+ *
+ ****************************************************************/
+
+static int rescale_skip(pot_table_t* pt, double upper)
+{
+  double minrho[g_param.ntypes];
+  double maxrho[g_param.ntypes];
+  double min = 1e100, max = -1e100;
+  int mincol = 999, maxcol = 0;
+
+  if (!rescale_track_bounds(minrho, maxrho))
+    return 0;
+
+  for (int i = 0; i < g_param.ntypes; i++) {
+    if (maxrho[i] > max) {
+      max = maxrho[i];
+      maxcol = i;
+    }
+    if (minrho[i] < min) {
+      min = minrho[i];
+      mincol = i;
+    }
+  }
+
+  int sign = (max >= -min) ? 1 : -1;
+
+  /* same expansion conditions as in the full pass below */
+  double left = 0.0, right = 0.0;
+  for (int i = 0; i < g_param.ntypes; i++) {
+    int j = g_calc.paircol + g_param.ntypes + i;
+    if (i == mincol)
+      left = minrho[i] - 0.3 * pt->step[j];
+    if (i == maxcol)
+      right = maxrho[i] + 0.3 * pt->step[j];
+    if (minrho[i] - pt->begin[j] < 0.0 ||
+        minrho[i] - pt->begin[j] > 0.95 * pt->step[j] ||
+        maxrho[i] - pt->end[j] > 0 ||
+        maxrho[i] - pt->end[j] < -0.95 * pt->step[j])
+      return 0;
+  }
+
+  double a = (sign == 1) ? upper / right : upper / left;
+
+  if (fabs(a) > 1.05 || fabs(a) < 0.95)
+    return 0;
+
+  return 1;
+}
+
+#endif  // !MPI
+
 /****************************************************************
  *
  * rescale: Routine used to automatically rescale
@@ -55,6 +115,13 @@ double rescale(pot_table_t* pt, double upper, int flag)
   double fnval, pos, grad, a;
   double min = 1e100, max = -1e100;
 
+#if !defined(MPI)
+  /* bounds tracked during the force evaluations make the common
+     "nothing moved" case cheap */
+  if (!flag && rescale_skip(pt, upper))
+    return 0.0;
+#endif  // !MPI
+
   double* xi = pt->table;
   int dimneuxi = pt->last[g_calc.paircol + 2 * g_param.ntypes - 1] -
                  pt->last[g_calc.paircol + g_param.ntypes - 1];
@@ -137,7 +204,7 @@ double rescale(pot_table_t* pt, double upper, int flag)
             }
             if (neigh->r < pt->end[col])
               g_config.atoms[neigh->nr].rho +=
-                  (*g_splint)(pt, xi, col, neigh->r);
+                  splint_fmt(pt, xi, col, neigh->r);
           }
         }
       }
@@ -181,6 +248,16 @@ double rescale(pot_table_t* pt, double upper, int flag)
   if (!flag)
     return 0.0; /* no */
 
+  /* the second derivatives are rewritten below, memoized evaluations
+     refer to the old gridding */
+  invalidate_spline_cache();
+  eval_memo_invalidate();
+
+#if !defined(MPI)
+  /* the tracked rho bounds scale with the transfer functions */
+  rescale_track_invalidate();
+#endif  // !MPI
+
   /* Let's update... */
   /* expand potential  */
   h = 0;
@@ -310,7 +387,7 @@ double rescale(pot_table_t* pt, double upper, int flag)
 
   /* correct gauge: U'(n_mean)=0 */
   for (i = 0; i < g_param.ntypes; i++) {
-    g_calc.lambda[i] = (*g_splint_grad)(
+    g_calc.lambda[i] = splint_grad_fmt(
         &g_pot.opt_pot, pt->table, g_calc.paircol + g_param.ntypes + i,
         0.5 * (pt->begin[g_calc.paircol + g_param.ntypes + i] +
                pt->end[g_calc.paircol + g_param.ntypes + i]));
@@ -337,24 +414,24 @@ double rescale(pot_table_t* pt, double upper, int flag)
       if (pt->table[pt->first[i] - 2] < 1e29) /* natural spline */
         pt->table[pt->first[i] - 2] +=
             (pt->begin[i] < pt->end[g_calc.paircol + col2]
-                 ? g_calc.lambda[col] * (*g_splint_grad)(pt, pt->table,
+                 ? g_calc.lambda[col] * splint_grad_fmt(pt, pt->table,
                                                          g_calc.paircol + col2,
                                                          pt->begin[i])
                  : 0.0) +
             (pt->begin[i] < pt->end[g_calc.paircol + col]
-                 ? g_calc.lambda[col2] * (*g_splint_grad)(pt, pt->table,
+                 ? g_calc.lambda[col2] * splint_grad_fmt(pt, pt->table,
                                                           g_calc.paircol + col,
                                                           pt->begin[i])
                  : 0.0);
       if (pt->table[pt->first[i] - 1] < 1e29) /* natural spline */
         pt->table[pt->first[i] - 1] +=
             (pt->end[i] < pt->end[g_calc.paircol + col2]
-                 ? g_calc.lambda[col] * (*g_splint_grad)(pt, pt->table,
+                 ? g_calc.lambda[col] * splint_grad_fmt(pt, pt->table,
                                                          g_calc.paircol + col2,
                                                          pt->end[i])
                  : 0.0) +
             (pt->end[i] < pt->end[g_calc.paircol + col]
-                 ? g_calc.lambda[col2] * (*g_splint_grad)(pt, pt->table,
+                 ? g_calc.lambda[col2] * splint_grad_fmt(pt, pt->table,
                                                           g_calc.paircol + col,
                                                           pt->end[i])
                  : 0.0);
@@ -412,6 +489,7 @@ void embed_shift(pot_table_t* pt)
   double* xi;
   int i, j, first;
   xi = pt->table;
+  invalidate_spline_cache();
   for (i = g_calc.paircol + g_param.ntypes;
        i < g_calc.paircol + 2 * g_param.ntypes; i++) {
     first = pt->first[i];
@@ -426,7 +504,7 @@ void embed_shift(pot_table_t* pt)
       else /* format == 4 ! */
         spline_ne(pt->xcoord + first, xi + first, pt->last[i] - first + 1,
                   *(xi + first - 2), *(xi + first - 1), pt->d2tab + first);
-      shift = (*g_splint)(pt, xi, i, 0.0);
+      shift = splint_fmt(pt, xi, i, 0.0);
 #if defined(DEBUG)
       printf("shifting by %f\n", shift);
 #endif  // DEBUG
@@ -33,6 +33,17 @@
 #if !defined APOT && (defined EAM || defined(ADP) || defined MEAM)
 double rescale(pot_table_t*, double, int);
 void embed_shift(pot_table_t*);
+
+#if defined(RESCALE) && !defined(MPI)
+// running per-configuration rho bounds, recorded by the force kernels
+// (force_common.c) so rescale can check the embedding domain without
+// re-walking every neighbor list
+void rescale_track_init(void);
+void rescale_track_start(int config_idx);
+void rescale_track_atom(int config_idx, int type, double rho);
+int rescale_track_bounds(double* minrho, double* maxrho);
+void rescale_track_invalidate(void);
+#endif  // RESCALE && !MPI
 #endif  // !APOT && (EAM || ADP || MEAM)
 
 #endif  // RESCALE_H_INCLUDED
@@ -31,13 +31,74 @@
 
 #if defined(RESCALE) && !defined(APOT)
 
+#include "eval_memo.h"
+#include "force.h"
 #include "memory.h"
+#include "rescale.h"
 #include "splines.h"
 
 /* Doesn't make much sense without MEAM */
 
 #if defined(MEAM)
 
+#if !defined(MPI)
+
+/****************************************************************
+ *
+ * rescale_skip: decide from the tracked rho bounds whether no
+ *     update is needed, so the dreaded recalculation below only
+ *     runs when the domain of F actually has to move
+ *
+ ****************************************************************/
+
+static int rescale_skip(pot_table_t* pt, double upper)
+{
+  double minrho[g_param.ntypes];
+  double maxrho[g_param.ntypes];
+  double min = 1e100, max = -1e100;
+  int mincol = 999, maxcol = 0;
+
+  if (!rescale_track_bounds(minrho, maxrho))
+    return 0;
+
+  for (int i = 0; i < g_param.ntypes; i++) {
+    if (maxrho[i] > max) {
+      max = maxrho[i];
+      maxcol = i;
+    }
+    if (minrho[i] < min) {
+      min = minrho[i];
+      mincol = i;
+    }
+  }
+
+  int sign = (max >= -min) ? 1 : -1;
+
+  // same expansion conditions as in the full pass below
+  double left = 0.0, right = 0.0;
+  for (int i = 0; i < g_param.ntypes; i++) {
+    int j = g_calc.paircol + g_param.ntypes + i;
+    if (i == mincol)
+      left = minrho[i] - 0.3 * pt->step[j];
+    if (i == maxcol)
+      right = maxrho[i] + 0.3 * pt->step[j];
+    if (minrho[i] - pt->begin[j] < 0.0 ||
+        minrho[i] - pt->begin[j] > 0.95 * pt->step[j] ||
+        maxrho[i] - pt->end[j] > 0 ||
+        maxrho[i] - pt->end[j] < -0.95 * pt->step[j])
+      return 0;
+  }
+
+  double a = (sign == 1) ? upper / right : upper / left;
+
+  if (fabs(a) > 1.05 || fabs(a) < 0.95)
+    return 0;
+
+  return 1;
+}
+
+#endif  // !MPI
+
 /****************************************************************
  *
  * rescale: Routine used to automatically rescale
@@ -54,6 +115,13 @@ double rescale(pot_table_t* pt, double upper, int flag)
   atom_t* atom;
   neigh_t* neigh;
 
+#if !defined(MPI)
+  // bounds tracked during the force evaluations make the common
+  // "nothing moved" case cheap
+  if (!flag && rescale_skip(pt, upper))
+    return 0.0;
+#endif  // !MPI
+
   int jj, kk, ijk;
   angle_t* angle;
   neigh_t *neigh_j, *neigh_k;
@@ -258,6 +326,16 @@ double rescale(pot_table_t* pt, double upper, int flag)
   if (!flag)
     return 0;
 
+  // the second derivatives are rewritten below, memoized evaluations
+  // refer to the old gridding
+  invalidate_spline_cache();
+  eval_memo_invalidate();
+
+#if !defined(MPI)
+  // the tracked rho bounds scale with the transfer functions
+  rescale_track_invalidate();
+#endif  // !MPI
+
   // BEGIN UPDATING F and other potentials
   ///////////////////////////////////////////////
 
@@ -0,0 +1,243 @@
+/****************************************************************
+ *
+ * server.c: persistent evaluation server
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+// getline and the unix socket interfaces are not visible under
+// plain -std=c99
+#define _DEFAULT_SOURCE
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "potfit.h"
+
+#include "force.h"
+#include "memory.h"
+#include "optimize.h"
+#include "server.h"
+#include "utils.h"
+
+/****************************************************************
+ *
+ *  server_evaluate
+ *      one full force calculation for the current parameters
+ *
+ ****************************************************************/
+
+static double server_evaluate(void)
+{
+#if defined(APOT) || defined(KIM)
+  return calc_forces(g_pot.opt_pot.table, g_calc.force, 0);
+#else
+  return calc_forces(g_pot.calc_pot.table, g_calc.force, 0);
+#endif  // APOT || KIM
+}
+
+/****************************************************************
+ *
+ *  server_error_components
+ *      split the error sum like the final error report does:
+ *      forces, energies and stresses, the remainder up to the
+ *      total are the constraint contributions
+ *
+ ****************************************************************/
+
+static void server_error_components(const double* forces, double* sums)
+{
+  sums[0] = 0.0;
+  sums[1] = 0.0;
+  sums[2] = 0.0;
+
+  for (int i = 0; i < 3 * g_config.natoms; i++) {
+#if defined(CONTRIB)
+    if (g_config.atoms[i / 3].contrib == 0)
+      continue;
+#endif  // CONTRIB
+    sums[0] +=
+        g_config.conf_weight[g_config.atoms[i / 3].conf] * dsquare(forces[i]);
+  }
+
+  for (int i = 0; i < g_config.nconf; i++)
+    sums[1] += g_config.conf_weight[i] * g_param.eweight *
+               dsquare(forces[g_calc.energy_p + i]);
+
+#if defined(STRESS)
+  for (int i = 0; i < 6 * g_config.nconf; i++)
+    sums[2] += g_config.conf_weight[i / 6] * g_param.sweight *
+               dsquare(forces[g_calc.stress_p + i]);
+#endif  // STRESS
+}
+
+/****************************************************************
+ *
+ *  server_handle_session
+ *      process the requests of one connection, returns 0 when the
+ *      client asked the server to shut down
+ *
+ ****************************************************************/
+
+static int server_handle_session(FILE* in, FILE* out, double* staged)
+{
+  char* line = NULL;
+  size_t line_size = 0;
+
+  while (getline(&line, &line_size, in) != -1) {
+    char* command = strtok(line, " \t\r\n");
+
+    if (command == NULL)
+      continue;
+
+    if (strcasecmp(command, "quit") == 0) {
+      fprintf(out, "ok\n");
+      fflush(out);
+      free(line);
+      return 0;
+    }
+
+    if (strcasecmp(command, "params") == 0) {
+      fprintf(out, "ok %d", g_calc.ndim);
+      for (int i = 0; i < g_calc.ndim; i++)
+        fprintf(out, " %.16e", g_pot.opt_pot.table[g_pot.opt_pot.idx[i]]);
+      fprintf(out, "\n");
+      fflush(out);
+      continue;
+    }
+
+    if (strcasecmp(command, "eval") == 0) {
+      int n = 0;
+      char* token = NULL;
+
+      while ((token = strtok(NULL, " \t\r\n")) != NULL && n < g_calc.ndim)
+        staged[n++] = atof(token);
+
+      if (n != g_calc.ndim || token != NULL) {
+        fprintf(out, "error eval expects %d parameters\n", g_calc.ndim);
+        fflush(out);
+        continue;
+      }
+
+      for (int i = 0; i < g_calc.ndim; i++)
+        g_pot.opt_pot.table[g_pot.opt_pot.idx[i]] = staged[i];
+
+      double tot = server_evaluate();
+      double sums[3];
+
+      server_error_components(g_calc.force, sums);
+
+      fprintf(out, "ok %.16e %.16e %.16e %.16e %.16e\n", tot, sums[0], sums[1],
+              sums[2], tot - sums[0] - sums[1] - sums[2]);
+      fflush(out);
+      continue;
+    }
+
+    if (strcasecmp(command, "optimize") == 0) {
+      run_optimization();
+      fprintf(out, "ok %.16e\n", server_evaluate());
+      fflush(out);
+      continue;
+    }
+
+    fprintf(out, "error unknown command %s\n", command);
+    fflush(out);
+  }
+
+  free(line);
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  run_evaluation_server
+ *      serve evaluate/optimize requests on the unix domain socket
+ *      until a client sends quit
+ *
+ ****************************************************************/
+
+void run_evaluation_server(void)
+{
+  struct sockaddr_un address;
+
+  if (strlen(g_files.socketfile) >= sizeof(address.sun_path))
+    error(1, "Server socket path %s is too long!\n", g_files.socketfile);
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (listen_fd < 0)
+    error(1, "Could not create server socket: %s\n", strerror(errno));
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, g_files.socketfile);
+
+  // a stale socket of a previous run would make bind fail
+  unlink(g_files.socketfile);
+
+  if (bind(listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    error(1, "Could not bind server socket %s: %s\n", g_files.socketfile,
+          strerror(errno));
+
+  if (listen(listen_fd, 1) < 0)
+    error(1, "Could not listen on server socket %s: %s\n", g_files.socketfile,
+          strerror(errno));
+
+  printf("\nEvaluation server listening on %s\n", g_files.socketfile);
+  fflush(stdout);
+
+  // parsed parameters are staged here so a malformed request does not
+  // clobber the current vector
+  double* staged = (double*)Malloc(g_calc.ndim * sizeof(double));
+
+  int keep_running = 1;
+
+  while (keep_running) {
+    int session_fd = accept(listen_fd, NULL, NULL);
+
+    if (session_fd < 0)
+      error(1, "Could not accept connection on server socket: %s\n",
+            strerror(errno));
+
+    FILE* in = fdopen(session_fd, "r");
+    FILE* out = fdopen(dup(session_fd), "w");
+
+    if (in == NULL || out == NULL)
+      error(1, "Could not open streams for server connection: %s\n",
+            strerror(errno));
+
+    keep_running = server_handle_session(in, out, staged);
+
+    fclose(in);
+    fclose(out);
+  }
+
+  close(listen_fd);
+  unlink(g_files.socketfile);
+
+  printf("Evaluation server on %s shut down.\n", g_files.socketfile);
+}
@@ -0,0 +1,68 @@
+/****************************************************************
+ *
+ * server.h: persistent evaluation server
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+/****************************************************************
+ *
+ *  Scripted pipelines which call potfit hundreds of times pay the
+ *  full startup - parameter file, potential, configurations and
+ *  neighbor lists - for every single evaluation. With the
+ *  server_socket parameter set, potfit keeps all of that state
+ *  resident and answers requests on a unix domain socket instead of
+ *  running a single optimization.
+ *
+ *  The protocol is line based, one request per line, one reply per
+ *  line, numbers in plain text:
+ *
+ *    eval <v_1> ... <v_ndim>
+ *        evaluate the given optimizable parameters, replies
+ *        "ok <total> <forces> <energies> <stresses> <constraints>"
+ *        with the error sum and its components
+ *    params
+ *        replies "ok <ndim> <v_1> ... <v_ndim>" with the current
+ *        optimizable parameters
+ *    optimize
+ *        run the configured optimization from the current
+ *        parameters, replies "ok <total>" when it is finished
+ *    quit
+ *        shut the server down
+ *
+ *  Malformed requests are answered with "error <reason>". A closed
+ *  connection only ends the session, the server keeps listening
+ *  until a client sends quit. After shutdown potfit writes the end
+ *  potential and the error reports for the last parameters as
+ *  usual.
+ *
+ ****************************************************************/
+
+void run_evaluation_server(void);
+
+#endif  // SERVER_H_INCLUDED
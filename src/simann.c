@@ -33,13 +33,21 @@
 
 #include <ctype.h>
 
+#include "bracket.h"
+#include "checkpoint.h"
+#include "eval_memo.h"
+#include "eval_float.h"
 #include "force.h"
+#include "force_abort.h"
+#include "force_batch.h"
 #include "memory.h"
 #include "optimize.h"
 #include "potential_input.h"
 #include "potential_output.h"
 #include "random.h"
 #include "rescale.h"
+#include "surrogate.h"
+#include "trace.h"
 #include "utils.h"
 
 #define EPS 0.1
@@ -50,6 +58,16 @@
 #define TEMPVAR 0.85
 #define KMAX 1000
 
+#if defined(MPI)
+// temperature ratio between neighboring replica-exchange chains
+#define REPLICA_TEMPVAR 1.5
+#define REPLICA_TAG 103
+// only the first replica chain reports its progress
+#define CHAIN_OUTPUT (g_mpi.world_id == 0)
+#else
+#define CHAIN_OUTPUT 1
+#endif  // MPI
+
 #define ONE_OVER_SQRT_2_PI 0.39894228040143267794
 #define GAUSS(a) (ONE_OVER_SQRT_2_PI * (exp(-((a) * (a)) / 2.0)))
 
@@ -142,7 +160,8 @@ double get_annealing_temperature(const double* xi, double* xi_new,
     int u = 10 * g_calc.ndim;
     int m1 = 0;
 
-    printf("Determining optimal starting temperature T ...\n");
+    if (CHAIN_OUTPUT)
+      printf("Determining optimal starting temperature T ...\n");
 
     for (int e = 0; e < u; e++) {
       memcpy(xi_new, xi, g_calc.ndimtot * sizeof(double));
@@ -158,7 +177,8 @@ double get_annealing_temperature(const double* xi, double* xi_new,
       }
     }
 
-    printf("Performed %d trial steps, %d of them were downhill.\n", u, m1);
+    if (CHAIN_OUTPUT)
+      printf("Performed %d trial steps, %d of them were downhill.\n", u, m1);
 
     u -= m1;
     dF /= u;
@@ -169,7 +189,8 @@ double get_annealing_temperature(const double* xi, double* xi_new,
     if (T < 0)
       T = -T;
 
-    printf("Setting T=%f\n\n", T);
+    if (CHAIN_OUTPUT)
+      printf("Setting T=%f\n\n", T);
   } else {
     T = atof(g_param.anneal_temp);
 
@@ -240,6 +261,11 @@ void restore_pot_data(const pot_data_t* pot_data)
 {
   int k = 0;
 
+  // the restored tables do not match the cached spline inputs or the
+  // memoized evaluations
+  invalidate_spline_cache();
+  eval_memo_invalidate();
+
   for (int i = g_calc.paircol + g_param.ntypes;
        i < g_calc.paircol + 2 * g_param.ntypes; ++i) {
     g_pot.opt_pot.begin[i] = pot_data->begin[k];
@@ -256,6 +282,63 @@ void restore_pot_data(const pot_data_t* pot_data)
 
 #endif // MEAM && !(APOT || KIM)
 
+#if defined(MPI)
+
+/****************************************************************
+ *
+ * replica_exchange
+ *      double* xi:     current parameter vector of this chain
+ *      double* F:      current cost of this chain
+ *      double T:       current temperature of this chain
+ *      int attempt:    swap attempt counter
+ *
+ * Attempt a configuration swap with a neighboring replica chain.
+ * Even and odd pairs alternate between attempts. The acceptance
+ * probability min(1, exp((1/T_i - 1/T_j) * (F_i - F_j))) lets good
+ * configurations migrate down the temperature ladder.
+ *
+ ****************************************************************/
+
+void replica_exchange(double* xi, double* F, double T, int attempt)
+{
+  const int chain = g_mpi.group;
+  const int partner = ((attempt + chain) % 2 == 0) ? chain + 1 : chain - 1;
+
+  if (partner < 0 || partner >= g_mpi.num_groups)
+    return;
+
+  double F_other = 0.0;
+
+  MPI_Sendrecv(F, 1, MPI_DOUBLE, partner, REPLICA_TAG, &F_other, 1, MPI_DOUBLE,
+               partner, REPLICA_TAG, g_mpi.leader_comm, MPI_STATUS_IGNORE);
+
+  // all chains cool down at the same rate, so the temperature ratio
+  // between neighbors stays fixed
+  const double T_other =
+      (partner > chain) ? T * REPLICA_TEMPVAR : T / REPLICA_TEMPVAR;
+
+  int swap = 0;
+
+  if (chain < partner) {
+    // the colder chain decides
+    double delta = (1.0 / T - 1.0 / T_other) * (*F - F_other);
+    swap = (delta > 0.0) || (eqdist() < exp(delta));
+    MPI_Send(&swap, 1, MPI_INT, partner, REPLICA_TAG, g_mpi.leader_comm);
+  } else {
+    MPI_Recv(&swap, 1, MPI_INT, partner, REPLICA_TAG, g_mpi.leader_comm,
+             MPI_STATUS_IGNORE);
+  }
+
+  if (swap) {
+    MPI_Sendrecv_replace(xi, g_calc.ndimtot, MPI_DOUBLE, partner, REPLICA_TAG,
+                         partner, REPLICA_TAG, g_mpi.leader_comm,
+                         MPI_STATUS_IGNORE);
+    *F = F_other;
+  }
+}
+
+#endif  // MPI
+
 /****************************************************************
  *
  * run_simulated_annealing
@@ -268,8 +351,17 @@ void restore_pot_data(const pot_data_t* pot_data)
 
 void run_simulated_annealing(double* const xi)
 {
+  /* a checkpoint from the powell stage means annealing already finished
+     in an interrupted earlier run */
+  if (checkpoint_stage() == CHECKPOINT_STAGE_POWELL)
+    return;
+
   int loop_counter = 0;
-  int loop_again = 0;
+  int loop_again = 1;
+
+#if defined(MPI)
+  int swap_attempt = 0;
+#endif  // MPI
 
 #if defined(RESCALE) && !(defined(APOT) || defined(KIM)) && (defined(EAM) || defined(ADP) || defined(MEAM))
   int do_rescale = 1;
@@ -306,30 +398,81 @@ void run_simulated_annealing(double* const xi)
   memcpy(xi_new, xi, g_calc.ndimtot * sizeof(double));
   memcpy(xi_opt, xi, g_calc.ndimtot * sizeof(double));
 
-  F = calc_forces(xi, forces, 0);
+  double T = 0.0;
+  double T_start = 0.0;
+
+  /* resume an interrupted annealing run from its checkpoint; the loop
+     state including the rng is restored completely, so the resumed
+     chain follows exactly the trajectory of the interrupted one */
+  int resumed = checkpoint_read_anneal(&loop_counter, &loop_again, &T, &T_start,
+                                       &F, &F_opt, v, F_old, NEPS, xi, xi_opt);
 
-  F_opt = F;
+  if (resumed) {
+    memcpy(xi_new, xi, g_calc.ndimtot * sizeof(double));
+    printf("Resuming annealing from checkpoint at T=%f, F=%f\n", T, F);
+  } else {
+    F = calc_forces(xi, forces, 0);
+
+    F_opt = F;
+
+    /* Temperature */
+    T = get_annealing_temperature(xi, xi_new, forces, v, F);
+  }
+
+#if defined(MPI)
+  if (g_mpi.num_groups > 1) {
+    /* all replicas start from the same base temperature and form a
+       geometric ladder, the hotter chains explore more aggressively */
+    MPI_Bcast(&T, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
 
-  /* Temperature */
-  double T = get_annealing_temperature(xi, xi_new, forces, v, F);
+    for (int i = 0; i < g_mpi.group; i++)
+      T *= REPLICA_TEMPVAR;
+  }
+#endif  // MPI
 
   /* don't anneal if starttemp equal zero */
   if (T == 0.0)
     return;
 
+  /* annealing only looks at the error sums, the deviation vectors can
+     stay distributed until powell needs them */
+  gather_forces_sum_only(1);
+
+  /* a few significant digits are plenty for the stochastic search */
+  eval_float_set(1);
+
+  /* reference for the mini-batch schedule */
+  if (!resumed)
+    T_start = T;
+
 #if defined(MEAM) && !(defined(APOT) || defined(KIM))
   store_pot_data(&pot_data);
 #endif // MEAM && !APOT
 
-  printf("  k\tT        \t  m\tF          \tF_opt\n");
-  printf("%3d\t%f\t%3d\t%f\t%f\n", 0, T, 0, F, F_opt);
-  fflush(stdout);
+  if (CHAIN_OUTPUT) {
+    printf("  k\tT        \t  m\tF          \tF_opt\n");
+    printf("%3d\t%f\t%3d\t%f\t%f\n", loop_counter, T, 0, F, F_opt);
+    fflush(stdout);
+  }
 
-  for (int n = 0; n < NEPS; n++)
-    F_old[n] = F;
+  if (!resumed)
+    for (int n = 0; n < NEPS; n++)
+      F_old[n] = F;
+
+  /* annealing loop; a resumed run whose checkpoint was written at the
+     final boundary enters converged and skips straight to powell */
+  while (loop_counter < KMAX && loop_again) {
+    /* while the chain is hot a rough error estimate is enough: draw a
+       subset of the configurations and grow it as the temperature
+       drops; F has to be recomputed since it is only comparable to
+       trial values estimated on the same subset */
+    if (g_force_batch.enabled) {
+      force_batch_select(1.0 - (1.0 - g_param.eval_batch) * (T / T_start));
+
+      if (g_force_batch.active)
+        F = calc_forces(xi, forces, 0);
+    }
 
-  /* annealing loop */
-  do {
     for (int m = 0; m < NTEMP; m++) {
       for (int j = 0; j < NSTEP; j++) {
         for (int h = 0; h < g_calc.ndim; h++) {
@@ -338,8 +481,40 @@ void run_simulated_annealing(double* const xi)
 
           randomize_parameter(h, xi_new, v);
 
+          /* candidates predicted to be hopeless count as rejected
+             without a force evaluation; the margin mirrors the
+             metropolis criterion, which practically never accepts a
+             trial more than 3 T above the incumbent. Mini-batch
+             estimates are not comparable between subsets and stay out
+             of the model. */
+          if (!g_force_batch.active && surrogate_screen(xi_new, F, 3.0 * T))
+            continue;
+
+          /* with early aborts the metropolis random number is drawn up
+             front: the trial is accepted iff F_new < F - T * ln(u), so
+             the evaluation can stop - and count as a rejection - as
+             soon as its partial error sum crosses that threshold */
+          double abort_u = 1.0;
+
+          if (g_force_abort.enabled) {
+            abort_u = eqdist();
+            force_abort_arm(F - T * log(abort_u));
+          }
+
           F_new = calc_forces(xi_new, forces, 0);
 
+          if (g_force_abort.enabled) {
+            int aborted = g_force_abort.rejected;
+
+            force_abort_disarm();
+
+            if (aborted)
+              continue;
+          }
+
+          if (!g_force_batch.active)
+            surrogate_store(xi_new, F_new);
+
           /* accept new point */
           if (F_new <= F) {
 #if defined(APOT) || defined(KIM)
@@ -351,6 +526,8 @@ void run_simulated_annealing(double* const xi)
 
             naccept[h]++;
 
+            trace_record(F_new, T, 1);
+
             if (F_new < F_opt) {
               memcpy(xi_opt, xi_new, g_calc.ndimtot * sizeof(double));
 
@@ -366,13 +543,17 @@ void run_simulated_annealing(double* const xi)
 #elif defined(KIM)
                 update_kim_table(xi);
 #endif
-                write_pot_table_potfit(g_files.tempfile);
+                write_pot_table_potfit_async(g_files.tempfile);
               }
             }
-          } else if (eqdist() < (exp((F - F_new) / T))) {
+          } else if ((g_force_abort.enabled ? abort_u : eqdist()) <
+                     (exp((F - F_new) / T))) {
             memcpy(xi, xi_new, g_calc.ndimtot * sizeof(double));
             F = F_new;
             naccept[h]++;
+            trace_record(F_new, T, 1);
+          } else {
+            trace_record(F_new, T, 0);
           }
         }  // loop over parameters
       }    // steps per temperature
@@ -386,8 +567,12 @@ void run_simulated_annealing(double* const xi)
         naccept[n] = 0;
       }
 
-      printf("%3d\t%f\t%3d\t%f\t%f\n", loop_counter, T, m + 1, F, F_opt);
-      fflush(stdout);
+      if (CHAIN_OUTPUT) {
+        printf("%3d\t%f\t%3d\t%f\t%f\n", loop_counter, T, m + 1, F, F_opt);
+        fflush(stdout);
+      }
+
+      int stop_annealing = 0;
 
       /* End annealing if break flagfile exists */
       if (g_files.flagfile && strlen(g_files.flagfile)) {
@@ -397,17 +582,31 @@ void run_simulated_annealing(double* const xi)
                  g_files.flagfile);
           printf("Temperature was %f, returning optimum configuration\n", T);
 
-          for (int n = 0; n < g_calc.ndimtot; n++)
-            xi[n] = xi_opt[n];
-
-          F = F_opt;
-          loop_counter = KMAX + 1;
+          stop_annealing = 1;
           fclose(ff);
           remove(g_files.flagfile);
-          break;
         }
       }
 
+#if defined(MPI)
+      if (g_mpi.num_groups > 1) {
+        /* keep the chains in lockstep, the first one decides when to stop */
+        MPI_Bcast(&stop_annealing, 1, MPI_INT, 0, g_mpi.leader_comm);
+
+        if (!stop_annealing)
+          replica_exchange(xi, &F, T, swap_attempt++);
+      }
+#endif  // MPI
+
+      if (stop_annealing) {
+        for (int n = 0; n < g_calc.ndimtot; n++)
+          xi[n] = xi_opt[n];
+
+        F = F_opt;
+        loop_counter = KMAX + 1;
+        break;
+      }
+
 #if defined(RESCALE) && !(defined(APOT) || defined(KIM)) && (defined(EAM) || defined(ADP) || defined(MEAM))
       /* Check for rescaling... every tenth step */
       if (((m + 1) % 10 == 0) && (do_rescale == 1)) {
@@ -422,6 +621,21 @@ void run_simulated_annealing(double* const xi)
 #endif  // RESCALE && !APOT && ( EAM || ADP || MEAM )
     }
 
+    /* full evaluations correct the drift of the stochastic estimates
+       before the convergence checks; the incumbent optimum was
+       estimated on a subset, too */
+    if (g_force_batch.active) {
+      force_batch_clear();
+
+      F_opt = calc_forces(xi_opt, forces, 0);
+      F = calc_forces(xi, forces, 0);
+
+      if (F < F_opt) {
+        memcpy(xi_opt, xi, g_calc.ndimtot * sizeof(double));
+        F_opt = F;
+      }
+    }
+
     /*Temp adjustment */
     T *= TEMPVAR;
     loop_counter++;
@@ -460,7 +674,17 @@ void run_simulated_annealing(double* const xi)
 
       loop_again = 1;
     }
-  } while (loop_counter < KMAX && loop_again);
+
+#if defined(MPI)
+    /* all replicas follow the convergence decision of the first chain */
+    if (g_mpi.num_groups > 1)
+      MPI_Bcast(&loop_again, 1, MPI_INT, 0, g_mpi.leader_comm);
+#endif  // MPI
+
+    /* the outer loop boundary is a consistent state to checkpoint */
+    checkpoint_write_anneal(loop_counter, loop_again, T, T_start, F, F_opt, v,
+                            F_old, NEPS, xi, xi_opt);
+  }
 
   memcpy(xi, xi_opt, g_calc.ndimtot * sizeof(double));
 
@@ -470,7 +694,41 @@ void run_simulated_annealing(double* const xi)
   // wake other threads and sync potentials
   F = calc_forces(xi, forces, 2);
 #endif  // MEAM && !APOT
-  printf("Finished annealing, starting powell minimization ...\n");
+
+#if defined(MPI)
+  if (g_mpi.num_groups > 1) {
+    /* hand the optimum of the best replica to the first chain, only its
+       result is polished further */
+    double* F_chains = (double*)Malloc(g_mpi.num_groups * sizeof(double));
+
+    MPI_Allgather(&F_opt, 1, MPI_DOUBLE, F_chains, 1, MPI_DOUBLE,
+                  g_mpi.leader_comm);
+
+    int best = 0;
+
+    for (int i = 1; i < g_mpi.num_groups; i++)
+      if (F_chains[i] < F_chains[best])
+        best = i;
+
+    MPI_Bcast(xi, g_calc.ndimtot, MPI_DOUBLE, best, g_mpi.leader_comm);
+
+    memcpy(xi_opt, xi, g_calc.ndimtot * sizeof(double));
+    F_opt = F_chains[best];
+
+    if (CHAIN_OUTPUT)
+      printf("Best annealing replica was chain %d with F=%f\n", best,
+             F_chains[best]);
+  }
+#endif  // MPI
+
+  /* powell polishes in full precision */
+  eval_float_set(0);
+
+  /* powell and the linmin helpers read the full vectors again */
+  gather_forces_sum_only(0);
+
+  if (CHAIN_OUTPUT)
+    printf("Finished annealing, starting powell minimization ...\n");
 
   if (g_files.tempfile && strlen(g_files.tempfile)) {
 #if defined(APOT)
@@ -478,8 +736,42 @@ void run_simulated_annealing(double* const xi)
 #elif defined(KIM)
     update_kim_table(xi_opt);
 #endif  // APOT
-    write_pot_table_potfit(g_files.tempfile);
+    write_pot_table_potfit_async(g_files.tempfile);
   }
 }
 
+#if defined(MPI)
+
+/****************************************************************
+ *
+ * run_anneal_replica
+ *
+ * Entry point for the leaders of the additional evaluation groups.
+ * Each one runs its own annealing chain and afterwards serves as a
+ * line search helper for the speculative evaluations of the root
+ * process until it is released.
+ *
+ ****************************************************************/
+
+void run_anneal_replica()
+{
+  // Select correct spline interpolation and other functions
+  // Root process has done this earlier
+
+  init_force_common(1);
+  init_force(1);
+
+  // each replica chain needs its own random number sequence
+  init_rng(g_param.rng_seed + g_mpi.group);
+
+  if (g_param.opt && g_calc.ndim > 0)
+    run_simulated_annealing(g_pot.opt_pot.table);
+
+  // evaluate speculative line search candidates for the root process,
+  // releases the workers of this group when done
+  run_linmin_helper(g_calc.force);
+}
+
+#endif  // MPI
+
 #endif  // !EVO
@@ -33,6 +33,68 @@
 #include "memory.h"
 #include "splines.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif  // __AVX2__
+
+/****************************************************************
+ *
+ * spline_decomp_ed: cached elimination factors for spline_ed
+ *
+ *            For equidistant sampling the elimination stage of the
+ *            tridiagonal solve does not depend on the function values:
+ *            the pivots and decomposition factors are a fixed
+ *            recurrence in n and the left boundary type. Line searches
+ *            rebuild every column on each evaluation, so these factors
+ *            are computed once per (n, boundary) pair and only the
+ *            y-dependent substitution runs per call - with bitwise
+ *            identical results, the factors are the same numbers the
+ *            full solve recomputed every time.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int n;
+  int natural; /* left boundary type */
+  double* p;   /* elimination pivots */
+  double* q;   /* decomposition factors */
+} spline_decomp_t;
+
+#define SPLINE_DECOMP_SLOTS 8
+
+static __thread spline_decomp_t g_spline_decomp[SPLINE_DECOMP_SLOTS];
+static __thread int g_spline_decomp_next = 0;
+
+static const spline_decomp_t* spline_decomp_ed(int n, int natural)
+{
+  for (int i = 0; i < SPLINE_DECOMP_SLOTS; i++)
+    if (g_spline_decomp[i].n == n && g_spline_decomp[i].natural == natural)
+      return &g_spline_decomp[i];
+
+  spline_decomp_t* d = &g_spline_decomp[g_spline_decomp_next];
+
+  g_spline_decomp_next = (g_spline_decomp_next + 1) % SPLINE_DECOMP_SLOTS;
+
+  // plain realloc, see the scratch buffer in spline_ed
+  d->p = (double*)realloc(d->p, n * sizeof(double));
+  d->q = (double*)realloc(d->q, n * sizeof(double));
+
+  if (d->p == NULL || d->q == NULL)
+    error(1, "Could not allocate spline decomposition buffer!\n");
+
+  d->n = n;
+  d->natural = natural;
+  d->q[0] = natural ? 0.0 : -0.5;
+
+  for (int i = 1; i < n - 1; i++) {
+    /* sig=(x[i]-x[i-1])/(x[i+1]-x[i-1])=.5; */
+    d->p[i] = 0.5 * d->q[i - 1] + 2.0;
+    d->q[i] = (-0.5) / d->p[i];
+  }
+
+  return d;
+}
+
 /****************************************************************
  *
  * spline_ed: initializes second derivatives used for spline interpolation
@@ -45,28 +107,31 @@ void spline_ed(double xstep, double* y, int n, double yp1, double ypn,
 {
   double qn = 0.0;
   double un = 0.0;
-  static double* u = NULL;
-  static int nmax = 0;
+  // per-thread scratch buffer, keeps the spline setup reentrant so
+  // columns and configurations can be processed concurrently; plain
+  // realloc is used because the registering allocator is not
+  // thread-safe
+  static __thread double* u = NULL;
+  static __thread int nmax = 0;
 
   if (n > nmax) {
-    u = (double*)Realloc(u, (n - 1) * sizeof(double));
+    u = (double*)realloc(u, (n - 1) * sizeof(double));
+    if (u == NULL)
+      error(1, "Could not allocate spline scratch buffer!\n");
     nmax = n;
   }
 
-  if (yp1 > 0.99e30) {
-    y2[0] = 0.0;
+  const spline_decomp_t* decomp = spline_decomp_ed(n, yp1 > 0.99e30);
+  const double* q = decomp->q;
+
+  if (yp1 > 0.99e30)
     u[0] = 0.0;
-  } else {
-    y2[0] = -0.5;
+  else
     u[0] = (3.0 / (xstep)) * ((y[1] - y[0]) / (xstep)-yp1);
-  }
 
   for (int i = 1; i < n - 1; i++) {
-    /* sig=(x[i]-x[i-1])/(x[i+1]-x[i-1])=.5; */
-    double p = 0.5 * y2[i - 1] + 2.0;
-    y2[i] = (-0.5) / p;
     u[i] = (y[i + 1] - y[i]) / xstep - (y[i] - y[i - 1]) / (xstep);
-    u[i] = (6.0 * u[i] / (2 * xstep) - 0.5 * u[i - 1]) / p;
+    u[i] = (6.0 * u[i] / (2 * xstep) - 0.5 * u[i - 1]) / decomp->p[i];
   }
 
   if (ypn > 0.99e30) {
@@ -77,181 +142,298 @@ void spline_ed(double xstep, double* y, int n, double yp1, double ypn,
     un = (3.0 / (xstep)) * (ypn - (y[n - 1] - y[n - 2]) / (xstep));
   }
 
-  y2[n - 1] = (un - qn * u[n - 2]) / (qn * y2[n - 2] + 1.0);
+  y2[n - 1] = (un - qn * u[n - 2]) / (qn * q[n - 2] + 1.0);
 
   for (int k = n - 2; k >= 0; --k)
-    y2[k] = y2[k] * y2[k + 1] + u[k];
+    y2[k] = q[k] * y2[k + 1] + u[k];
 }
 
 /****************************************************************
  *
- * splint_ed: interpolates the function with splines
- *            (equidistant x[i])
+ * splint_dir_batch: evaluates splint_dir for a whole list of
+ *            precalculated table positions (e.g. all neighbors of one
+ *            atom from the packed neighbor arrays)
  *
- ****************************************************************/
-
-double splint_ed(pot_table_t* pt, double* xi, int col, double r)
-{
-  /* check for distances shorter than minimal distance in table */
-  double rr = r - pt->begin[col];
-
-  if (rr < 0)
-    error(1, "%f %f %d\nShort distance\n", r, pt->begin[col], col);
-
-  /* indices into potential table */
-  int k = (int)(rr * pt->invstep[col]);
-  double b = (rr - k * pt->step[col]) * pt->invstep[col];
-  k += pt->first[col];
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-
-  return a * p1 + b * p2 +
-         ((a * a * a - a) * d21 + (b * b * b - b) * d22) /
-             (6.0 * pt->invstep[col] * pt->invstep[col]);
-}
-
-/****************************************************************
- *
- * splint_comb_ed: calculates spline interpolation of a function (return value)
- *            and its gradiend (grad), equidistant x[i]
+ *            The batched versions avoid the per-call overhead of the
+ *            scalar functions and process four entries at a time with
+ *            AVX2 when available. The results are identical to calling
+ *            the scalar functions entry by entry.
  *
  ****************************************************************/
 
-double splint_comb_ed(pot_table_t* pt, double* xi, int col, double r,
-                      double* grad)
+void splint_dir_batch(pot_table_t* pt, double* xi, int n, const int* slot,
+                      const double* shift, const double* step, double* val)
 {
-  /* check for distances shorter than minimal distance in table */
-  double rr = r - pt->begin[col];
-
-  if (rr < 0)
-    error(1, "short distance! in splint_comb_ed\n");
-
-  /* indices into potential table */
-  int k = (int)(rr * pt->invstep[col]);
-  double b = (rr - k * pt->step[col]) * pt->invstep[col];
-  k += pt->first[col];
-  /* This fixes some problems, but causes a lot more ... */
-  /*  if (rr = (pt->end[col] - pt->begin[col])) {*/
-  /*    return xi[k];*/
-  /*  }*/
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-  *grad = (p2 - p1) * pt->invstep[col] +
-          ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) /
-              (6.0 * pt->invstep[col]);
-
-  return a * p1 + b * p2 +
-         ((a * a * a - a) * d21 + (b * b * b - b) * d22) /
-             (6.0 * pt->invstep[col] * pt->invstep[col]);
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d six = _mm256_set1_pd(6.0);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(slot + i));
+    __m128i k1 = _mm_add_epi32(k, _mm_set1_epi32(1));
+    __m256d b = _mm256_loadu_pd(shift + i);
+    __m256d st = _mm256_loadu_pd(step + i);
+    __m256d p1 = _mm256_i32gather_pd(xi, k, 8);
+    __m256d p2 = _mm256_i32gather_pd(xi, k1, 8);
+    __m256d d21 = _mm256_i32gather_pd(pt->d2tab, k, 8);
+    __m256d d22 = _mm256_i32gather_pd(pt->d2tab, k1, 8);
+    __m256d a = _mm256_sub_pd(one, b);
+    __m256d a3 = _mm256_mul_pd(_mm256_mul_pd(a, a), a);
+    __m256d b3 = _mm256_mul_pd(_mm256_mul_pd(b, b), b);
+    __m256d d2sum = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(a3, a), d21),
+                                  _mm256_mul_pd(_mm256_sub_pd(b3, b), d22));
+    __m256d res =
+        _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, p1), _mm256_mul_pd(b, p2)),
+                      _mm256_div_pd(_mm256_mul_pd(d2sum, _mm256_mul_pd(st, st)), six));
+    _mm256_storeu_pd(val + i, res);
+  }
+#endif  // __AVX2__
+
+  for (; i < n; i++)
+    val[i] = splint_dir(pt, xi, slot[i], shift[i], step[i]);
 }
 
 /****************************************************************
  *
- * splint_grad_ed: calculates the first derivative from spline interpolation
- *            (equidistant x[i])
+ * splint_comb_dir_batch: evaluates splint_comb_dir for a whole list of
+ *            precalculated table positions
  *
  ****************************************************************/
 
-double splint_grad_ed(pot_table_t* pt, double* xi, int col, double r)
+void splint_comb_dir_batch(pot_table_t* pt, double* xi, int n, const int* slot,
+                           const double* shift, const double* step, double* val,
+                           double* grad)
 {
-  /* check for distances shorter than minimal distance in table */
-  double rr = r - pt->begin[col];
-
-  if (rr < 0)
-    error(1, "short distance! in splint_grad_ed\n");
-
-  /* indices into potential table */
-  int k = (int)(rr * pt->invstep[col]);
-  double b = (rr - k * pt->step[col]) * pt->invstep[col];
-  k += pt->first[col];
-  /* Check if we are at the last index */
-  if (k >= pt->last[col]) {
-    k--;
-    b += 1.0;
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d three = _mm256_set1_pd(3.0);
+  const __m256d six = _mm256_set1_pd(6.0);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(slot + i));
+    __m128i k1 = _mm_add_epi32(k, _mm_set1_epi32(1));
+    __m256d b = _mm256_loadu_pd(shift + i);
+    __m256d st = _mm256_loadu_pd(step + i);
+    __m256d p1 = _mm256_i32gather_pd(xi, k, 8);
+    __m256d p2 = _mm256_i32gather_pd(xi, k1, 8);
+    __m256d d21 = _mm256_i32gather_pd(pt->d2tab, k, 8);
+    __m256d d22 = _mm256_i32gather_pd(pt->d2tab, k1, 8);
+    __m256d a = _mm256_sub_pd(one, b);
+    __m256d a3 = _mm256_mul_pd(_mm256_mul_pd(a, a), a);
+    __m256d b3 = _mm256_mul_pd(_mm256_mul_pd(b, b), b);
+    __m256d d2diff = _mm256_sub_pd(
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(b, b)), one), d22),
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(a, a)), one), d21));
+    __m256d g =
+        _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(p2, p1), st),
+                      _mm256_div_pd(_mm256_mul_pd(d2diff, st), six));
+    _mm256_storeu_pd(grad + i, g);
+    __m256d d2sum = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(a3, a), d21),
+                                  _mm256_mul_pd(_mm256_sub_pd(b3, b), d22));
+    __m256d res =
+        _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(a, p1), _mm256_mul_pd(b, p2)),
+                      _mm256_div_pd(_mm256_mul_pd(d2sum, _mm256_mul_pd(st, st)), six));
+    _mm256_storeu_pd(val + i, res);
   }
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-
-  return (p2 - p1) * pt->invstep[col] +
-         ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) /
-             (6.0 * pt->invstep[col]);
+#endif  // __AVX2__
+
+  for (; i < n; i++)
+    val[i] = splint_comb_dir(pt, xi, slot[i], shift[i], step[i], grad + i);
 }
 
 /****************************************************************
  *
- * splint_dir: interpolates the function with splines
- *            (equidistant AND NON-eq.dist x[i])
- *            with known index position
+ * splint_grad_dir_batch: evaluates splint_grad_dir for a whole list of
+ *            precalculated table positions
  *
  ****************************************************************/
 
-double splint_dir(pot_table_t* pt, double* xi, int k, double b, double step)
+void splint_grad_dir_batch(pot_table_t* pt, double* xi, int n, const int* slot,
+                           const double* shift, const double* step,
+                           double* grad)
 {
-  /* indices into potential table */
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-
-  return a * p1 + b * p2 +
-         ((a * a * a - a) * d21 + (b * b * b - b) * d22) * (step * step) / 6.0;
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d three = _mm256_set1_pd(3.0);
+  const __m256d six = _mm256_set1_pd(6.0);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i k = _mm_loadu_si128((const __m128i*)(slot + i));
+    __m128i k1 = _mm_add_epi32(k, _mm_set1_epi32(1));
+    __m256d b = _mm256_loadu_pd(shift + i);
+    __m256d st = _mm256_loadu_pd(step + i);
+    __m256d p1 = _mm256_i32gather_pd(xi, k, 8);
+    __m256d p2 = _mm256_i32gather_pd(xi, k1, 8);
+    __m256d d21 = _mm256_i32gather_pd(pt->d2tab, k, 8);
+    __m256d d22 = _mm256_i32gather_pd(pt->d2tab, k1, 8);
+    __m256d a = _mm256_sub_pd(one, b);
+    __m256d d2diff = _mm256_sub_pd(
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(b, b)), one), d22),
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(a, a)), one), d21));
+    __m256d g =
+        _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(p2, p1), st),
+                      _mm256_div_pd(_mm256_mul_pd(d2diff, st), six));
+    _mm256_storeu_pd(grad + i, g);
+  }
+#endif  // __AVX2__
+
+  for (; i < n; i++)
+    grad[i] = splint_grad_dir(pt, xi, slot[i], shift[i], step[i]);
 }
 
 /****************************************************************
  *
- * splint_comb_dir: calculates spline interpolation of a function
- *            (return value)
- *            and its gradiend (grad), equidistant and non-eqd x[i]
- *            with known index position
+ * splint_dir_batch2: evaluates splint_dir for the same list of
+ *            neighbors in two potential table columns at once
+ *
+ *            The interactions that evaluate several columns per
+ *            neighbor (EAM, ADP, MEAM) walk the same slot arithmetic
+ *            once per column; fusing two columns into one pass shares
+ *            the loop overhead and lets the table gathers of both
+ *            columns overlap. The results are identical to two
+ *            separate batch calls.
  *
  ****************************************************************/
 
-double splint_comb_dir(pot_table_t* pt, double* xi, int k, double b,
-                       double step, double* grad)
+void splint_dir_batch2(pot_table_t* pt, double* xi, int n, const int* slot_a,
+                       const double* shift_a, const double* step_a,
+                       double* val_a, const int* slot_b,
+                       const double* shift_b, const double* step_b,
+                       double* val_b)
 {
-  /* indices into potential table */
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-  *grad = (p2 - p1) / step +
-          ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) * step / 6.0;
-
-  return a * p1 + b * p2 +
-         ((a * a * a - a) * d21 + (b * b * b - b) * d22) * (step * step) / 6.0;
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d six = _mm256_set1_pd(6.0);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i ka = _mm_loadu_si128((const __m128i*)(slot_a + i));
+    __m128i ka1 = _mm_add_epi32(ka, _mm_set1_epi32(1));
+    __m128i kb = _mm_loadu_si128((const __m128i*)(slot_b + i));
+    __m128i kb1 = _mm_add_epi32(kb, _mm_set1_epi32(1));
+    __m256d ba = _mm256_loadu_pd(shift_a + i);
+    __m256d bb = _mm256_loadu_pd(shift_b + i);
+    __m256d sta = _mm256_loadu_pd(step_a + i);
+    __m256d stb = _mm256_loadu_pd(step_b + i);
+    __m256d pa1 = _mm256_i32gather_pd(xi, ka, 8);
+    __m256d pa2 = _mm256_i32gather_pd(xi, ka1, 8);
+    __m256d pb1 = _mm256_i32gather_pd(xi, kb, 8);
+    __m256d pb2 = _mm256_i32gather_pd(xi, kb1, 8);
+    __m256d da1 = _mm256_i32gather_pd(pt->d2tab, ka, 8);
+    __m256d da2 = _mm256_i32gather_pd(pt->d2tab, ka1, 8);
+    __m256d db1 = _mm256_i32gather_pd(pt->d2tab, kb, 8);
+    __m256d db2 = _mm256_i32gather_pd(pt->d2tab, kb1, 8);
+    __m256d aa = _mm256_sub_pd(one, ba);
+    __m256d ab = _mm256_sub_pd(one, bb);
+    __m256d aa3 = _mm256_mul_pd(_mm256_mul_pd(aa, aa), aa);
+    __m256d ab3 = _mm256_mul_pd(_mm256_mul_pd(ab, ab), ab);
+    __m256d ba3 = _mm256_mul_pd(_mm256_mul_pd(ba, ba), ba);
+    __m256d bb3 = _mm256_mul_pd(_mm256_mul_pd(bb, bb), bb);
+    __m256d d2a = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(aa3, aa), da1),
+                                _mm256_mul_pd(_mm256_sub_pd(ba3, ba), da2));
+    __m256d d2b = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(ab3, ab), db1),
+                                _mm256_mul_pd(_mm256_sub_pd(bb3, bb), db2));
+    __m256d ra = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(aa, pa1), _mm256_mul_pd(ba, pa2)),
+        _mm256_div_pd(_mm256_mul_pd(d2a, _mm256_mul_pd(sta, sta)), six));
+    __m256d rb = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(ab, pb1), _mm256_mul_pd(bb, pb2)),
+        _mm256_div_pd(_mm256_mul_pd(d2b, _mm256_mul_pd(stb, stb)), six));
+    _mm256_storeu_pd(val_a + i, ra);
+    _mm256_storeu_pd(val_b + i, rb);
+  }
+#endif  // __AVX2__
+
+  for (; i < n; i++) {
+    val_a[i] = splint_dir(pt, xi, slot_a[i], shift_a[i], step_a[i]);
+    val_b[i] = splint_dir(pt, xi, slot_b[i], shift_b[i], step_b[i]);
+  }
 }
 
 /****************************************************************
  *
- * splint_grad_dir: calculates the first derivative
- *            from spline interpolation (equidistant and NON-eqd. x[i])
- *            with known index position
+ * splint_comb_dir_batch2: evaluates splint_comb_dir for the same list
+ *            of neighbors in two potential table columns at once
  *
  ****************************************************************/
 
-double splint_grad_dir(pot_table_t* pt, double* xi, int k, double b,
-                       double step)
+void splint_comb_dir_batch2(pot_table_t* pt, double* xi, int n,
+                            const int* slot_a, const double* shift_a,
+                            const double* step_a, double* val_a,
+                            double* grad_a, const int* slot_b,
+                            const double* shift_b, const double* step_b,
+                            double* val_b, double* grad_b)
 {
-  /* indices into potential table */
-  double a = 1.0 - b;
-  double p1 = xi[k];
-  double d21 = pt->d2tab[k++];
-  double p2 = xi[k];
-  double d22 = pt->d2tab[k];
-
-  return (p2 - p1) / step +
-         ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) * step / 6.0;
+  int i = 0;
+
+#if defined(__AVX2__)
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d three = _mm256_set1_pd(3.0);
+  const __m256d six = _mm256_set1_pd(6.0);
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i ka = _mm_loadu_si128((const __m128i*)(slot_a + i));
+    __m128i ka1 = _mm_add_epi32(ka, _mm_set1_epi32(1));
+    __m128i kb = _mm_loadu_si128((const __m128i*)(slot_b + i));
+    __m128i kb1 = _mm_add_epi32(kb, _mm_set1_epi32(1));
+    __m256d ba = _mm256_loadu_pd(shift_a + i);
+    __m256d bb = _mm256_loadu_pd(shift_b + i);
+    __m256d sta = _mm256_loadu_pd(step_a + i);
+    __m256d stb = _mm256_loadu_pd(step_b + i);
+    __m256d pa1 = _mm256_i32gather_pd(xi, ka, 8);
+    __m256d pa2 = _mm256_i32gather_pd(xi, ka1, 8);
+    __m256d pb1 = _mm256_i32gather_pd(xi, kb, 8);
+    __m256d pb2 = _mm256_i32gather_pd(xi, kb1, 8);
+    __m256d da1 = _mm256_i32gather_pd(pt->d2tab, ka, 8);
+    __m256d da2 = _mm256_i32gather_pd(pt->d2tab, ka1, 8);
+    __m256d db1 = _mm256_i32gather_pd(pt->d2tab, kb, 8);
+    __m256d db2 = _mm256_i32gather_pd(pt->d2tab, kb1, 8);
+    __m256d aa = _mm256_sub_pd(one, ba);
+    __m256d ab = _mm256_sub_pd(one, bb);
+    __m256d aa3 = _mm256_mul_pd(_mm256_mul_pd(aa, aa), aa);
+    __m256d ab3 = _mm256_mul_pd(_mm256_mul_pd(ab, ab), ab);
+    __m256d ba3 = _mm256_mul_pd(_mm256_mul_pd(ba, ba), ba);
+    __m256d bb3 = _mm256_mul_pd(_mm256_mul_pd(bb, bb), bb);
+    __m256d dda = _mm256_sub_pd(
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(ba, ba)), one), da2),
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(aa, aa)), one), da1));
+    __m256d ddb = _mm256_sub_pd(
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(bb, bb)), one), db2),
+        _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(three, _mm256_mul_pd(ab, ab)), one), db1));
+    __m256d ga =
+        _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(pa2, pa1), sta),
+                      _mm256_div_pd(_mm256_mul_pd(dda, sta), six));
+    __m256d gb =
+        _mm256_add_pd(_mm256_div_pd(_mm256_sub_pd(pb2, pb1), stb),
+                      _mm256_div_pd(_mm256_mul_pd(ddb, stb), six));
+    _mm256_storeu_pd(grad_a + i, ga);
+    _mm256_storeu_pd(grad_b + i, gb);
+    __m256d d2a = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(aa3, aa), da1),
+                                _mm256_mul_pd(_mm256_sub_pd(ba3, ba), da2));
+    __m256d d2b = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(ab3, ab), db1),
+                                _mm256_mul_pd(_mm256_sub_pd(bb3, bb), db2));
+    __m256d ra = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(aa, pa1), _mm256_mul_pd(ba, pa2)),
+        _mm256_div_pd(_mm256_mul_pd(d2a, _mm256_mul_pd(sta, sta)), six));
+    __m256d rb = _mm256_add_pd(
+        _mm256_add_pd(_mm256_mul_pd(ab, pb1), _mm256_mul_pd(bb, pb2)),
+        _mm256_div_pd(_mm256_mul_pd(d2b, _mm256_mul_pd(stb, stb)), six));
+    _mm256_storeu_pd(val_a + i, ra);
+    _mm256_storeu_pd(val_b + i, rb);
+  }
+#endif  // __AVX2__
+
+  for (; i < n; i++) {
+    val_a[i] = splint_comb_dir(pt, xi, slot_a[i], shift_a[i], step_a[i], grad_a + i);
+    val_b[i] = splint_comb_dir(pt, xi, slot_b[i], shift_b[i], step_b[i], grad_b + i);
+  }
 }
 
 /****************************************************************
@@ -265,11 +447,14 @@ void spline_ne(double* x, double* y, int n, double yp1, double ypn, double* y2)
 {
   double qn = 0.0;
   double un = 0.0;
-  static double* u = NULL;
-  static int nmax = 0;
+  // per-thread scratch buffer, see spline_ed
+  static __thread double* u = NULL;
+  static __thread int nmax = 0;
 
   if (n > nmax) {
-    u = (double*)Realloc(u, (n - 1) * sizeof(double));
+    u = (double*)realloc(u, (n - 1) * sizeof(double));
+    if (u == NULL)
+      error(1, "Could not allocate spline scratch buffer!\n");
     nmax = n;
   }
 
@@ -305,37 +490,6 @@ void spline_ne(double* x, double* y, int n, double yp1, double ypn, double* y2)
     y2[k] = y2[k] * y2[k + 1] + u[k];
 }
 
-/****************************************************************
- *
- * splint_ne: interpolates the function with splines
- *            (nonequidistant x[i])
- *
- ****************************************************************/
-
-double splint_ne(pot_table_t* pt, double* xi, int col, double r)
-{
-  int klo = pt->first[col];
-  int khi = pt->last[col];
-
-  /* Find index by bisection */
-  while (khi - klo > 1) {
-    int k = (khi + klo) >> 1;
-    if (pt->xcoord[k] > r)
-      khi = k;
-    else
-      klo = k;
-  }
-
-  double h = pt->xcoord[khi] - pt->xcoord[klo];
-
-  double b = (r - pt->xcoord[klo]) / h;
-  double a = (1.0 - b);
-
-  return a * xi[klo] + b * xi[khi] +
-         ((a * a * a - a) * pt->d2tab[klo] + (b * b * b - b) * pt->d2tab[khi]) *
-             (h * h) / 6.0;
-}
-
 /******************************************************************************
  *
  * splint_ne_lin: interpolates the function with splines,
@@ -385,72 +539,3 @@ double splint_ne_lin(pot_table_t* pt, double* xi, int col, double r)
          ((a * a * a - a) * pt->d2tab[klo] + (b * b * b - b) * pt->d2tab[khi]) *
              (h * h) / 6.0;
 }
-
-/****************************************************************
- *
- * splint_comb_ne: calculates spline interpolation of a function (return value)
- *            and its gradiend (grad), non-equidistant x[i]
- *
- ****************************************************************/
-
-double splint_comb_ne(pot_table_t* pt, double* xi, int col, double r,
-                      double* grad)
-{
-  int klo = pt->first[col];
-  int khi = pt->last[col];
-
-  /* Find index by bisection */
-  while (khi - klo > 1) {
-    int k = (khi + klo) >> 1;
-    if (pt->xcoord[k] > r)
-      khi = k;
-    else
-      klo = k;
-  }
-
-  double h = pt->xcoord[khi] - pt->xcoord[klo];
-
-  double b = (r - pt->xcoord[klo]) / h;
-  double a = (1.0 - b);
-
-  *grad = (xi[khi] - xi[klo]) / h +
-          ((3 * (b * b) - 1) * pt->d2tab[khi] -
-           (3 * (a * a) - 1) * pt->d2tab[klo]) *
-              h / 6.0;
-
-  return a * xi[klo] + b * xi[khi] +
-         ((a * a * a - a) * pt->d2tab[klo] + (b * b * b - b) * pt->d2tab[khi]) *
-             (h * h) / 6.0;
-}
-
-/****************************************************************
- *
- * splint_grad_ne: calculates the first derivative from spline interpolation
- *            (nonequidistant x[i])
- *
- ****************************************************************/
-
-double splint_grad_ne(pot_table_t* pt, double* xi, int col, double r)
-{
-  int klo = pt->first[col];
-  int khi = pt->last[col];
-
-  /* Find index by bisection */
-  while (khi - klo > 1) {
-    int k = (khi + klo) >> 1;
-    if (pt->xcoord[k] > r)
-      khi = k;
-    else
-      klo = k;
-  }
-
-  double h = pt->xcoord[khi] - pt->xcoord[klo];
-
-  double b = (r - pt->xcoord[klo]) / h;
-  double a = (1.0 - b);
-
-  return (xi[khi] - xi[klo]) / h +
-         ((3 * (b * b) - 1) * pt->d2tab[khi] -
-          (3 * (a * a) - 1) * pt->d2tab[klo]) *
-             h / 6.0;
-}
@@ -31,16 +31,343 @@
 #define SPLINES_H_INCLUDED
 
 void spline_ed(double, double*, int, double, double, double*);
-double splint_ed(pot_table_t*, double*, int, double);
-double splint_grad_ed(pot_table_t*, double*, int, double);
-double splint_comb_ed(pot_table_t*, double*, int, double, double*);
-double splint_dir(pot_table_t*, double*, int, double, double);
-double splint_comb_dir(pot_table_t*, double*, int, double, double, double*);
-double splint_grad_dir(pot_table_t*, double*, int, double, double);
+void splint_dir_batch(pot_table_t*, double*, int, const int*, const double*,
+                      const double*, double*);
+void splint_comb_dir_batch(pot_table_t*, double*, int, const int*,
+                           const double*, const double*, double*, double*);
+void splint_grad_dir_batch(pot_table_t*, double*, int, const int*,
+                           const double*, const double*, double*);
+void splint_dir_batch2(pot_table_t*, double*, int, const int*, const double*,
+                       const double*, double*, const int*, const double*,
+                       const double*, double*);
+void splint_comb_dir_batch2(pot_table_t*, double*, int, const int*,
+                            const double*, const double*, double*, double*,
+                            const int*, const double*, const double*, double*,
+                            double*);
 void spline_ne(double*, double*, int, double, double, double*);
-double splint_ne(pot_table_t*, double*, int, double);
 double splint_ne_lin(pot_table_t*, double*, int, double);
-double splint_comb_ne(pot_table_t*, double*, int, double, double*);
-double splint_grad_ne(pot_table_t*, double*, int, double);
+
+/****************************************************************
+ *
+ * The scalar interpolation routines live in this header so they can be
+ * inlined into the force kernels; an out-of-line call per table lookup
+ * is too expensive for the innermost loops.
+ *
+ ****************************************************************/
+
+/****************************************************************
+ *
+ * splint_ed: interpolates the function with splines
+ *            (equidistant x[i])
+ *
+ ****************************************************************/
+
+static inline double splint_ed(pot_table_t* pt, double* xi, int col, double r)
+{
+  /* check for distances shorter than minimal distance in table */
+  double rr = r - pt->begin[col];
+
+  if (rr < 0)
+    error(1, "%f %f %d\nShort distance\n", r, pt->begin[col], col);
+
+  /* indices into potential table */
+  int k = (int)(rr * pt->invstep[col]);
+  double b = (rr - k * pt->step[col]) * pt->invstep[col];
+  k += pt->first[col];
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+
+  return a * p1 + b * p2 +
+         ((a * a * a - a) * d21 + (b * b * b - b) * d22) /
+             (6.0 * pt->invstep[col] * pt->invstep[col]);
+}
+
+/****************************************************************
+ *
+ * splint_comb_ed: calculates spline interpolation of a function (return value)
+ *            and its gradiend (grad), equidistant x[i]
+ *
+ ****************************************************************/
+
+static inline double splint_comb_ed(pot_table_t* pt, double* xi, int col,
+                                    double r, double* grad)
+{
+  /* check for distances shorter than minimal distance in table */
+  double rr = r - pt->begin[col];
+
+  if (rr < 0)
+    error(1, "short distance! in splint_comb_ed\n");
+
+  /* indices into potential table */
+  int k = (int)(rr * pt->invstep[col]);
+  double b = (rr - k * pt->step[col]) * pt->invstep[col];
+  k += pt->first[col];
+  /* This fixes some problems, but causes a lot more ... */
+  /*  if (rr = (pt->end[col] - pt->begin[col])) {*/
+  /*    return xi[k];*/
+  /*  }*/
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+  *grad = (p2 - p1) * pt->invstep[col] +
+          ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) /
+              (6.0 * pt->invstep[col]);
+
+  return a * p1 + b * p2 +
+         ((a * a * a - a) * d21 + (b * b * b - b) * d22) /
+             (6.0 * pt->invstep[col] * pt->invstep[col]);
+}
+
+/****************************************************************
+ *
+ * splint_grad_ed: calculates the first derivative from spline interpolation
+ *            (equidistant x[i])
+ *
+ ****************************************************************/
+
+static inline double splint_grad_ed(pot_table_t* pt, double* xi, int col,
+                                    double r)
+{
+  /* check for distances shorter than minimal distance in table */
+  double rr = r - pt->begin[col];
+
+  if (rr < 0)
+    error(1, "short distance! in splint_grad_ed\n");
+
+  /* indices into potential table */
+  int k = (int)(rr * pt->invstep[col]);
+  double b = (rr - k * pt->step[col]) * pt->invstep[col];
+  k += pt->first[col];
+  /* Check if we are at the last index */
+  if (k >= pt->last[col]) {
+    k--;
+    b += 1.0;
+  }
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+
+  return (p2 - p1) * pt->invstep[col] +
+         ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) /
+             (6.0 * pt->invstep[col]);
+}
+
+/****************************************************************
+ *
+ * splint_dir: interpolates the function with splines
+ *            (equidistant AND NON-eq.dist x[i])
+ *            with known index position
+ *
+ ****************************************************************/
+
+static inline double splint_dir(pot_table_t* pt, double* xi, int k, double b,
+                                double step)
+{
+  /* indices into potential table */
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+
+  return a * p1 + b * p2 +
+         ((a * a * a - a) * d21 + (b * b * b - b) * d22) * (step * step) / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_comb_dir: calculates spline interpolation of a function
+ *            (return value)
+ *            and its gradiend (grad), equidistant and non-eqd x[i]
+ *            with known index position
+ *
+ ****************************************************************/
+
+static inline double splint_comb_dir(pot_table_t* pt, double* xi, int k,
+                                     double b, double step, double* grad)
+{
+  /* indices into potential table */
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+  *grad = (p2 - p1) / step +
+          ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) * step / 6.0;
+
+  return a * p1 + b * p2 +
+         ((a * a * a - a) * d21 + (b * b * b - b) * d22) * (step * step) / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_grad_dir: calculates the first derivative
+ *            from spline interpolation (equidistant and NON-eqd. x[i])
+ *            with known index position
+ *
+ ****************************************************************/
+
+static inline double splint_grad_dir(pot_table_t* pt, double* xi, int k,
+                                     double b, double step)
+{
+  /* indices into potential table */
+  double a = 1.0 - b;
+  double p1 = xi[k];
+  double d21 = pt->d2tab[k++];
+  double p2 = xi[k];
+  double d22 = pt->d2tab[k];
+
+  return (p2 - p1) / step +
+         ((3 * (b * b) - 1) * d22 - (3 * (a * a) - 1) * d21) * step / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_ne: interpolates the function with splines
+ *            (nonequidistant x[i])
+ *
+ ****************************************************************/
+
+static inline double splint_ne(pot_table_t* pt, double* xi, int col, double r)
+{
+  int klo = pt->first[col];
+  int khi = pt->last[col];
+
+  /* Find index by bisection */
+  while (khi - klo > 1) {
+    int k = (khi + klo) >> 1;
+    if (pt->xcoord[k] > r)
+      khi = k;
+    else
+      klo = k;
+  }
+
+  double h = pt->xcoord[khi] - pt->xcoord[klo];
+
+  double b = (r - pt->xcoord[klo]) / h;
+  double a = (1.0 - b);
+
+  return a * xi[klo] + b * xi[khi] +
+         ((a * a * a - a) * pt->d2tab[klo] + (b * b * b - b) * pt->d2tab[khi]) *
+             (h * h) / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_comb_ne: calculates spline interpolation of a function (return value)
+ *            and its gradiend (grad), non-equidistant x[i]
+ *
+ ****************************************************************/
+
+static inline double splint_comb_ne(pot_table_t* pt, double* xi, int col,
+                                    double r, double* grad)
+{
+  int klo = pt->first[col];
+  int khi = pt->last[col];
+
+  /* Find index by bisection */
+  while (khi - klo > 1) {
+    int k = (khi + klo) >> 1;
+    if (pt->xcoord[k] > r)
+      khi = k;
+    else
+      klo = k;
+  }
+
+  double h = pt->xcoord[khi] - pt->xcoord[klo];
+
+  double b = (r - pt->xcoord[klo]) / h;
+  double a = (1.0 - b);
+
+  *grad = (xi[khi] - xi[klo]) / h +
+          ((3 * (b * b) - 1) * pt->d2tab[khi] -
+           (3 * (a * a) - 1) * pt->d2tab[klo]) *
+              h / 6.0;
+
+  return a * xi[klo] + b * xi[khi] +
+         ((a * a * a - a) * pt->d2tab[klo] + (b * b * b - b) * pt->d2tab[khi]) *
+             (h * h) / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_grad_ne: calculates the first derivative from spline interpolation
+ *            (nonequidistant x[i])
+ *
+ ****************************************************************/
+
+static inline double splint_grad_ne(pot_table_t* pt, double* xi, int col,
+                                    double r)
+{
+  int klo = pt->first[col];
+  int khi = pt->last[col];
+
+  /* Find index by bisection */
+  while (khi - klo > 1) {
+    int k = (khi + klo) >> 1;
+    if (pt->xcoord[k] > r)
+      khi = k;
+    else
+      klo = k;
+  }
+
+  double h = pt->xcoord[khi] - pt->xcoord[klo];
+
+  double b = (r - pt->xcoord[klo]) / h;
+  double a = (1.0 - b);
+
+  return (xi[khi] - xi[klo]) / h +
+         ((3 * (b * b) - 1) * pt->d2tab[khi] -
+          (3 * (a * a) - 1) * pt->d2tab[klo]) *
+             h / 6.0;
+}
+
+/****************************************************************
+ *
+ * splint_fmt / splint_comb_fmt / splint_grad_fmt: select the spline
+ *            variant matching the potential format. The format is fixed
+ *            for a whole run, so the branch is perfectly predicted and
+ *            the compiler can inline both variants into the force
+ *            kernels; analytic potentials always use equidistant
+ *            tables, so for APOT builds the choice is made at compile
+ *            time.
+ *
+ ****************************************************************/
+
+static inline double splint_fmt(pot_table_t* pt, double* xi, int col, double r)
+{
+#if !defined(APOT)
+  if (g_pot.format_type == POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST)
+    return splint_ne(pt, xi, col, r);
+#endif  // !APOT
+  return splint_ed(pt, xi, col, r);
+}
+
+static inline double splint_comb_fmt(pot_table_t* pt, double* xi, int col,
+                                     double r, double* grad)
+{
+#if !defined(APOT)
+  if (g_pot.format_type == POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST)
+    return splint_comb_ne(pt, xi, col, r, grad);
+#endif  // !APOT
+  return splint_comb_ed(pt, xi, col, r, grad);
+}
+
+static inline double splint_grad_fmt(pot_table_t* pt, double* xi, int col,
+                                     double r)
+{
+#if !defined(APOT)
+  if (g_pot.format_type == POTENTIAL_FORMAT_TABULATED_NON_EQ_DIST)
+    return splint_grad_ne(pt, xi, col, r);
+#endif  // !APOT
+  return splint_grad_ed(pt, xi, col, r);
+}
 
 #endif  // SPLINES_H_INCLUDED
@@ -0,0 +1,197 @@
+/****************************************************************
+ *
+ * surrogate.c: surrogate-model pre-screening of trial vectors
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#include "potfit.h"
+
+#include "memory.h"
+#include "surrogate.h"
+#include "utils.h"
+
+// number of (parameter vector, error sum) pairs kept in the ring buffer
+#define SURROGATE_SIZE 64
+
+// safety factor on the running prediction error
+#define SURROGATE_ERR_MARGIN 2.0
+
+// one out of this many rejected candidates is evaluated anyway
+#define SURROGATE_VALIDATE 20
+
+surrogate_t g_surrogate;
+
+/****************************************************************
+ *
+ *  init_surrogate
+ *      enable surrogate pre-screening if requested
+ *
+ ****************************************************************/
+
+void init_surrogate(void)
+{
+  if (g_param.surrogate == 0 || g_calc.ndim == 0)
+    return;
+
+  g_surrogate.params =
+      (double*)Malloc(SURROGATE_SIZE * g_calc.ndim * sizeof(double));
+  g_surrogate.value = (double*)Malloc(SURROGATE_SIZE * sizeof(double));
+  g_surrogate.range = (double*)Malloc(g_calc.ndim * sizeof(double));
+
+  g_surrogate.enabled = 1;
+}
+
+/****************************************************************
+ *
+ *  surrogate_predict
+ *      score a candidate with gaussian radial basis weights over the
+ *      stored samples, distances are normalized with the parameter
+ *      ranges covered by the buffer
+ *
+ ****************************************************************/
+
+double surrogate_predict(const double* xi)
+{
+  const int n = g_surrogate.samples;
+  double dist[SURROGATE_SIZE];
+
+  // per-parameter range of the stored samples
+  for (int j = 0; j < g_calc.ndim; j++) {
+    double min = g_surrogate.params[j];
+    double max = min;
+
+    for (int i = 1; i < n; i++) {
+      double p = g_surrogate.params[i * g_calc.ndim + j];
+
+      if (p < min)
+        min = p;
+      if (p > max)
+        max = p;
+    }
+
+    g_surrogate.range[j] = (max > min) ? (max - min) : 1.0;
+  }
+
+  double dist_sum = 0.0;
+
+  for (int i = 0; i < n; i++) {
+    double d2 = 0.0;
+
+    for (int j = 0; j < g_calc.ndim; j++) {
+      double d = (xi[g_pot.opt_pot.idx[j]] -
+                  g_surrogate.params[i * g_calc.ndim + j]) /
+                 g_surrogate.range[j];
+      d2 += d * d;
+    }
+
+    dist[i] = sqrt(d2);
+    dist_sum += dist[i];
+  }
+
+  // all samples coincide with the candidate
+  if (dist_sum == 0.0)
+    return g_surrogate.value[0];
+
+  const double bandwidth = dist_sum / n;
+
+  double weight_sum = 0.0;
+  double value = 0.0;
+
+  for (int i = 0; i < n; i++) {
+    double w = exp(-dsquare(dist[i] / bandwidth));
+
+    weight_sum += w;
+    value += w * g_surrogate.value[i];
+  }
+
+  return value / weight_sum;
+}
+
+/****************************************************************
+ *
+ *  surrogate_screen
+ *      returns 1 if the candidate should be rejected without a force
+ *      evaluation; margin is the error sum excess the calling
+ *      optimizer would still accept (T * 3 for annealing, 0 for
+ *      differential evolution)
+ *
+ ****************************************************************/
+
+int surrogate_screen(const double* xi, double incumbent, double margin)
+{
+  if (!g_surrogate.enabled || g_surrogate.samples < SURROGATE_SIZE)
+    return 0;
+
+  double predicted = surrogate_predict(xi);
+
+  if (predicted - SURROGATE_ERR_MARGIN * g_surrogate.err <=
+      incumbent + margin)
+    return 0;
+
+  // let one out of SURROGATE_VALIDATE rejected candidates through to
+  // keep the prediction error estimate honest
+  if (++g_surrogate.rejected >= SURROGATE_VALIDATE) {
+    g_surrogate.rejected = 0;
+    return 0;
+  }
+
+  return 1;
+}
+
+/****************************************************************
+ *
+ *  surrogate_store
+ *      update the prediction error with the new sample and insert it
+ *      into the ring buffer
+ *
+ ****************************************************************/
+
+void surrogate_store(const double* xi, double value)
+{
+  if (!g_surrogate.enabled)
+    return;
+
+  if (g_surrogate.samples > 0) {
+    double residual = fabs(surrogate_predict(xi) - value);
+
+    if (g_surrogate.samples < SURROGATE_SIZE)
+      g_surrogate.err = (g_surrogate.err * (g_surrogate.samples - 1) +
+                         residual) / g_surrogate.samples;
+    else
+      g_surrogate.err = 0.9 * g_surrogate.err + 0.1 * residual;
+  }
+
+  for (int j = 0; j < g_calc.ndim; j++)
+    g_surrogate.params[g_surrogate.next * g_calc.ndim + j] =
+        xi[g_pot.opt_pot.idx[j]];
+
+  g_surrogate.value[g_surrogate.next] = value;
+
+  g_surrogate.next = (g_surrogate.next + 1) % SURROGATE_SIZE;
+
+  if (g_surrogate.samples < SURROGATE_SIZE)
+    g_surrogate.samples++;
+}
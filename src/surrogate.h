@@ -0,0 +1,66 @@
+/****************************************************************
+ *
+ * surrogate.h: surrogate-model pre-screening of trial vectors
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef SURROGATE_H_INCLUDED
+#define SURROGATE_H_INCLUDED
+
+/****************************************************************
+ *
+ *  The stochastic optimizers discard most of their trial vectors
+ *  after paying a full force evaluation. With the surrogate
+ *  parameter set, every evaluated (parameter vector, error sum) pair
+ *  is stored in a small ring buffer and new candidates are scored
+ *  first with a radial basis interpolation over the stored samples.
+ *  Candidates predicted to be far worse than the incumbent - by more
+ *  than the running prediction error plus the acceptance margin of
+ *  the optimizer - are rejected without a force evaluation. Every
+ *  few rejections one candidate is evaluated anyway, which keeps the
+ *  prediction error estimate honest.
+ *
+ ****************************************************************/
+
+typedef struct {
+  int enabled;    /* surrogate parameter is set */
+  int samples;    /* number of stored samples */
+  int next;       /* ring buffer insert position */
+  int rejected;   /* candidates rejected since the last validation */
+  double err;     /* running mean absolute prediction error */
+  double* params; /* stored free parameters, SURROGATE_SIZE x ndim */
+  double* value;  /* stored error sums */
+  double* range;  /* per-parameter normalization scratch */
+} surrogate_t;
+
+extern surrogate_t g_surrogate;
+
+void init_surrogate(void);
+double surrogate_predict(const double* xi);
+int surrogate_screen(const double* xi, double incumbent, double margin);
+void surrogate_store(const double* xi, double value);
+
+#endif  // SURROGATE_H_INCLUDED
@@ -0,0 +1,253 @@
+/****************************************************************
+ *
+ * timers.c: Lightweight phase timers for the force evaluation hot path
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <signal.h>
+#include <time.h>
+
+#include "potfit.h"
+
+#include "timers.h"
+
+static const char* g_timer_phase_names[TIMER_NUM_PHASES] = {
+    "potential update", "spline update", "config loop", "communication"};
+
+// per-rank accumulated seconds and the start stamp of a running phase
+static double g_timer_acc[TIMER_NUM_PHASES];
+static double g_timer_started[TIMER_NUM_PHASES];
+
+// one evaluation spans from the first table/spline update to the end of
+// gather_forces; the config loop share is derived from that span so the
+// per-configuration loops of the force kernels need no hooks of their own
+static int g_timer_eval_open = 0;
+static double g_timer_eval_begin = 0.0;
+static double g_timer_eval_phase_base = 0.0;
+
+static double g_timer_run_start = 0.0;
+static long g_timer_evals = 0;
+
+// set from the SIGUSR1 handler, checked at the end of each evaluation
+static volatile sig_atomic_t g_timer_dump_requested = 0;
+
+/****************************************************************
+  timer_now
+****************************************************************/
+
+static double timer_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/****************************************************************
+  timer_request_dump
+    SIGUSR1 handler; the snapshot itself is printed from the
+    evaluation path, the handler only raises a flag
+****************************************************************/
+
+static void timer_request_dump(int signum)
+{
+  (void)signum;
+
+  g_timer_dump_requested = 1;
+}
+
+/****************************************************************
+  init_timers
+****************************************************************/
+
+void init_timers()
+{
+  g_timer_run_start = timer_now();
+
+  signal(SIGUSR1, timer_request_dump);
+}
+
+/****************************************************************
+  timer_start
+****************************************************************/
+
+void timer_start(timer_phase_t phase)
+{
+  double now = timer_now();
+
+  // the table or spline update is the first timed phase of an
+  // evaluation, so it also opens the evaluation span
+  if ((phase == TIMER_POT_UPDATE || phase == TIMER_SPLINES) &&
+      !g_timer_eval_open) {
+    g_timer_eval_open = 1;
+    g_timer_eval_begin = now;
+    g_timer_eval_phase_base =
+        g_timer_acc[TIMER_POT_UPDATE] + g_timer_acc[TIMER_SPLINES];
+  }
+
+  g_timer_started[phase] = now;
+}
+
+/****************************************************************
+  timer_stop
+****************************************************************/
+
+void timer_stop(timer_phase_t phase)
+{
+  g_timer_acc[phase] += timer_now() - g_timer_started[phase];
+}
+
+/****************************************************************
+  timer_print
+    per-rank snapshot of the accumulated phase times
+****************************************************************/
+
+static void timer_print(FILE* outfile)
+{
+  double elapsed = timer_now() - g_timer_run_start;
+  double timed = 0.0;
+
+  for (int i = 0; i < TIMER_NUM_PHASES; i++)
+    timed += g_timer_acc[i];
+
+  fprintf(outfile, "Phase timers (rank %d): %ld evaluations in %.2f s",
+          g_mpi.myid, g_timer_evals, elapsed);
+  if (elapsed > 0.0)
+    fprintf(outfile, " (%.1f evals/s)", (double)g_timer_evals / elapsed);
+  fprintf(outfile, "\n");
+
+  for (int i = 0; i < TIMER_NUM_PHASES; i++)
+    fprintf(outfile, "  %-16s %10.3f s (%5.1f %%)\n", g_timer_phase_names[i],
+            g_timer_acc[i],
+            elapsed > 0.0 ? 100.0 * g_timer_acc[i] / elapsed : 0.0);
+
+  if (timed > 0.0)
+    fprintf(outfile, "  communication fraction: %.1f %%\n",
+            100.0 * g_timer_acc[TIMER_COMM] / timed);
+
+  fflush(outfile);
+}
+
+/****************************************************************
+  timer_eval_done
+    called at the end of gather_forces; closes the evaluation
+    span, attributes the remainder to the config loop and serves
+    pending snapshot requests
+****************************************************************/
+
+void timer_eval_done()
+{
+  if (g_timer_eval_open) {
+    // time from opening the span to the start of the collectives,
+    // minus the share already booked on the update phases
+    double loop = g_timer_started[TIMER_COMM] - g_timer_eval_begin -
+                  (g_timer_acc[TIMER_POT_UPDATE] + g_timer_acc[TIMER_SPLINES] -
+                   g_timer_eval_phase_base);
+
+    if (loop > 0.0)
+      g_timer_acc[TIMER_CONFIG_LOOP] += loop;
+
+    g_timer_eval_open = 0;
+    g_timer_evals++;
+  }
+
+  if (g_timer_dump_requested) {
+    g_timer_dump_requested = 0;
+    timer_print(stderr);
+  }
+}
+
+/****************************************************************
+  timer_report
+    breakdown of the root process, printed after the optimization
+****************************************************************/
+
+void timer_report()
+{
+  if (!g_param.phase_timers)
+    return;
+
+  timer_print(stdout);
+}
+
+/****************************************************************
+  timer_report_final
+    breakdown over all ranks, printed at shutdown; all processes
+    have left their evaluation loops at this point, so collectives
+    over MPI_COMM_WORLD are safe
+****************************************************************/
+
+void timer_report_final()
+{
+  if (!g_param.phase_timers)
+    return;
+
+#if defined(MPI)
+  double sum[TIMER_NUM_PHASES];
+  double max[TIMER_NUM_PHASES];
+  long evals = 0;
+
+  MPI_Reduce(g_timer_acc, sum, TIMER_NUM_PHASES, MPI_DOUBLE, MPI_SUM, 0,
+             MPI_COMM_WORLD);
+  MPI_Reduce(g_timer_acc, max, TIMER_NUM_PHASES, MPI_DOUBLE, MPI_MAX, 0,
+             MPI_COMM_WORLD);
+  MPI_Reduce(&g_timer_evals, &evals, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+  if (g_mpi.world_id != 0)
+    return;
+
+  double elapsed = timer_now() - g_timer_run_start;
+  double timed = 0.0;
+
+  for (int i = 0; i < TIMER_NUM_PHASES; i++)
+    timed += sum[i];
+
+  printf("\nPhase timer summary over %d ranks:\n", g_mpi.world_cpus);
+  printf("  %-16s %12s %12s %10s\n", "phase", "avg / rank", "max", "imbalance");
+
+  for (int i = 0; i < TIMER_NUM_PHASES; i++) {
+    double avg = sum[i] / g_mpi.world_cpus;
+
+    printf("  %-16s %10.3f s %10.3f s", g_timer_phase_names[i], avg, max[i]);
+    if (avg > 0.0)
+      printf("  %8.2f\n", max[i] / avg);
+    else
+      printf("         -\n");
+  }
+
+  if (timed > 0.0)
+    printf("  communication fraction: %.1f %%\n", sum[TIMER_COMM] / timed * 100.0);
+  if (elapsed > 0.0)
+    printf("  evaluation rate: %.1f rank evals/s\n", (double)evals / elapsed);
+
+  fflush(stdout);
+#else
+  timer_print(stdout);
+#endif  // MPI
+}
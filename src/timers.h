@@ -0,0 +1,61 @@
+/****************************************************************
+ *
+ * timers.h: potfit phase timer header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef TIMERS_H_INCLUDED
+#define TIMERS_H_INCLUDED
+
+/****************************************************************
+ *
+ *  Lightweight per-rank phase timers around the hot path of a
+ *  force evaluation. The phases are accumulated on every rank;
+ *  a per-phase breakdown (evaluation rate, communication fraction,
+ *  imbalance over the ranks) is printed at the end of the
+ *  optimization and at shutdown when the phase_timers parameter is
+ *  set, or on demand by sending SIGUSR1 to a rank. The bookkeeping
+ *  is two clock readings per phase and evaluation, so it is cheap
+ *  enough to stay enabled unconditionally.
+ *
+ ****************************************************************/
+
+typedef enum {
+  TIMER_POT_UPDATE = 0, /* update_calc_table (APOT) */
+  TIMER_SPLINES,        /* update_splines (tabulated formats) */
+  TIMER_CONFIG_LOOP,    /* per-configuration force loops */
+  TIMER_COMM,           /* collectives in gather_forces */
+  TIMER_NUM_PHASES
+} timer_phase_t;
+
+void init_timers(void);
+void timer_start(timer_phase_t phase);
+void timer_stop(timer_phase_t phase);
+void timer_eval_done(void);
+void timer_report(void);
+void timer_report_final(void);
+
+#endif  // TIMERS_H_INCLUDED
@@ -0,0 +1,160 @@
+/****************************************************************
+ *
+ * trace.c: Binary telemetry trace of the optimizers
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "potfit.h"
+
+#include "trace.h"
+
+// ring capacity; enough for hours of annealing, the trace file
+// stays around 3 MB independent of the run length
+#define TRACE_CAPACITY 65536
+
+static trace_header_t* g_trace_header = NULL;
+static trace_record_t* g_trace_records = NULL;
+static size_t g_trace_length = 0;
+static double g_trace_start = 0.0;
+
+/****************************************************************
+  trace_now
+****************************************************************/
+
+static double trace_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/****************************************************************
+  init_trace
+    map the ring file; only the root process traces, the trace
+    parameters are not broadcast to the other ranks
+****************************************************************/
+
+void init_trace()
+{
+  if (g_files.tracefile == NULL || g_mpi.myid != 0)
+    return;
+
+#if defined(MPI)
+  if (g_mpi.world_id != 0)
+    return;
+#endif  // MPI
+
+  g_trace_length =
+      sizeof(trace_header_t) + TRACE_CAPACITY * sizeof(trace_record_t);
+
+  int fd = open(g_files.tracefile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0) {
+    warning("Could not open trace file %s, tracing disabled!\n",
+            g_files.tracefile);
+    return;
+  }
+
+  if (ftruncate(fd, g_trace_length) != 0) {
+    warning("Could not resize trace file %s, tracing disabled!\n",
+            g_files.tracefile);
+    close(fd);
+    return;
+  }
+
+  void* map =
+      mmap(NULL, g_trace_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if (map == MAP_FAILED) {
+    warning("Could not map trace file %s, tracing disabled!\n",
+            g_files.tracefile);
+    return;
+  }
+
+  g_trace_header = (trace_header_t*)map;
+  g_trace_records = (trace_record_t*)((char*)map + sizeof(trace_header_t));
+
+  memcpy(g_trace_header->magic, "PFTRACE", 8);
+  g_trace_header->version = 1;
+  g_trace_header->record_size = sizeof(trace_record_t);
+  g_trace_header->capacity = TRACE_CAPACITY;
+  g_trace_header->count = 0;
+
+  g_trace_start = trace_now();
+}
+
+/****************************************************************
+  trace_record
+****************************************************************/
+
+void trace_record(double error_sum, double temperature, int accepted)
+{
+  if (g_trace_header == NULL)
+    return;
+
+  trace_record_t* rec =
+      g_trace_records + (g_trace_header->count % TRACE_CAPACITY);
+
+  rec->wall = trace_now() - g_trace_start;
+  rec->error_sum = error_sum;
+  rec->temperature = temperature;
+  rec->eval = g_calc.fcalls;
+  rec->accepted = accepted;
+
+  // bumped after the record is complete, so a concurrent reader
+  // never sees the counter point at a half-written slot
+  g_trace_header->count++;
+}
+
+/****************************************************************
+  shutdown_trace
+    the kernel flushes the mapping on exit anyway, the explicit
+    sync just gets the data out earlier on a clean shutdown
+****************************************************************/
+
+void shutdown_trace()
+{
+  if (g_trace_header == NULL)
+    return;
+
+  msync(g_trace_header, g_trace_length, MS_ASYNC);
+  munmap(g_trace_header, g_trace_length);
+
+  g_trace_header = NULL;
+  g_trace_records = NULL;
+}
@@ -0,0 +1,69 @@
+/****************************************************************
+ *
+ * trace.h: potfit optimizer telemetry trace header file
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include <stdint.h>
+
+/****************************************************************
+ *
+ *  Binary telemetry trace of the optimizers. With the tracefile
+ *  parameter set, every evaluated trial appends one fixed-size
+ *  record to a memory-mapped ring file; the write is a few stores
+ *  into the mapping, the kernel writes the pages back lazily, so
+ *  the hot loops see none of the formatted I/O cost of the text
+ *  progress lines. The ring keeps the most recent
+ *  TRACE_CAPACITY records; the monotonic counter in the header
+ *  tells a reader how many records were written in total and
+ *  where the ring currently wraps.
+ *
+ ****************************************************************/
+
+typedef struct {
+  char magic[8];        /* "PFTRACE" */
+  int32_t version;      /* trace format version */
+  int32_t record_size;  /* sizeof(trace_record_t) */
+  int64_t capacity;     /* number of record slots in the ring */
+  int64_t count;        /* records written so far (monotonic) */
+} trace_header_t;
+
+typedef struct {
+  double wall;        /* seconds since the trace was opened */
+  double error_sum;   /* cost of the evaluated trial */
+  double temperature; /* annealing temperature (0 for other optimizers) */
+  int32_t eval;       /* force calculation counter */
+  int32_t accepted;   /* trial was accepted */
+} trace_record_t;
+
+void init_trace(void);
+void trace_record(double error_sum, double temperature, int accepted);
+void shutdown_trace(void);
+
+#endif  // TRACE_H_INCLUDED
@@ -0,0 +1,173 @@
+/****************************************************************
+ *
+ * tune.c: Startup calibration of the evaluation geometry
+ *
+ ****************************************************************
+ *
+ * Copyright 2002-2018 - the potfit development team
+ *
+ * https://www.potfit.net/
+ *
+ ****************************************************************
+ *
+ * This file is part of potfit.
+ *
+ * potfit is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * potfit is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with potfit; if not, see <http://www.gnu.org/licenses/>.
+ *
+ ****************************************************************/
+
+/****************************************************************
+ *
+ *  With tune_geometry set a short calibration phase runs before
+ *  the optimization: a few jittered force evaluations are timed
+ *  under each candidate OpenMP thread count and the fastest one is
+ *  locked in for the rest of the run. Small datasets often run
+ *  fastest well below the machine thread count because the
+ *  parallel-region overhead outweighs the loop work, and users
+ *  rarely know the crossover point of their dataset. The MPI rank
+ *  count and the configuration partitioning are not varied here:
+ *  the rank count is fixed by the launcher and the partitioning
+ *  already follows the per-configuration neighbor cost model.
+ *
+ ****************************************************************/
+
+#define _DEFAULT_SOURCE
+
+#include <time.h>
+
+#if defined(OPENMP)
+#include <omp.h>
+#endif  // OPENMP
+
+#include "potfit.h"
+
+#include "force.h"
+#include "memory.h"
+#include "random.h"
+#include "tune.h"
+
+// jittered evaluations timed per candidate thread count
+#define TUNE_EVALS 5
+
+#if defined(OPENMP)
+
+/****************************************************************
+  tune_now
+****************************************************************/
+
+static double tune_now()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + 1.0e-9 * (double)ts.tv_nsec;
+}
+
+/****************************************************************
+  tune_time_candidate
+    time TUNE_EVALS force evaluations with jittered parameters,
+    the same +/- 1 % perturbation pattern the benchmark uses so
+    the incremental caches see realistic changes
+****************************************************************/
+
+static double tune_time_candidate(double* xi, double* forces,
+                                  const double* base)
+{
+  double start = tune_now();
+
+  for (int n = 0; n < TUNE_EVALS; n++) {
+    for (int i = 0; i < g_calc.ndim; i++) {
+      double jitter = 0.01 * (2.0 * eqdist() - 1.0);
+      xi[g_pot.opt_pot.idx[i]] =
+          base[i] != 0.0 ? base[i] * (1.0 + jitter) : jitter;
+    }
+    calc_forces(xi, forces, 0);
+  }
+
+  return tune_now() - start;
+}
+
+#endif  // OPENMP
+
+/****************************************************************
+  run_geometry_tuning
+****************************************************************/
+
+void run_geometry_tuning()
+{
+#if !defined(OPENMP)
+  printf("\nGeometry tuning: nothing to tune in this build.\n");
+  printf("Thread counts need a binary built with --enable-openmp,\n");
+  printf("the MPI rank count is fixed by the launcher.\n\n");
+#else
+
+#if defined(MPI)
+  if (g_mpi.num_cpus > 1) {
+    printf("\nGeometry tuning is skipped with more than one MPI process:\n");
+    printf("the worker thread counts cannot be changed from the root.\n\n");
+    return;
+  }
+#endif  // MPI
+
+  int max_threads = omp_get_max_threads();
+
+  if (max_threads <= 1) {
+    printf("\nGeometry tuning: only one OpenMP thread available.\n\n");
+    return;
+  }
+
+  double* xi = g_pot.opt_pot.table;
+  double* forces = g_calc.force;
+  double* base = (double*)Malloc(g_calc.ndim * sizeof(double));
+
+  for (int i = 0; i < g_calc.ndim; i++)
+    base[i] = xi[g_pot.opt_pot.idx[i]];
+
+  printf("\nTuning the evaluation geometry (%d evals per candidate) ...\n",
+         TUNE_EVALS);
+  fflush(stdout);
+
+  // warm the caches once so one-time setup does not bias a candidate
+  calc_forces(xi, forces, 0);
+
+  int best_threads = 0;
+  double best_time = 0.0;
+
+  // halving candidates from the machine thread count down to one
+  for (int threads = max_threads; threads >= 1; threads /= 2) {
+    omp_set_num_threads(threads);
+
+    double time = tune_time_candidate(xi, forces, base);
+
+    printf("  %2d thread%s: %8.3f ms per evaluation\n", threads,
+           threads == 1 ? " " : "s", 1000.0 * time / TUNE_EVALS);
+
+    if (best_threads == 0 || time < best_time) {
+      best_threads = threads;
+      best_time = time;
+    }
+  }
+
+  // leave the potential as it was read
+  for (int i = 0; i < g_calc.ndim; i++)
+    xi[g_pot.opt_pot.idx[i]] = base[i];
+
+  omp_set_num_threads(best_threads);
+
+  printf("Using %d OpenMP thread%s for this run.\n\n", best_threads,
+         best_threads == 1 ? "" : "s");
+  fflush(stdout);
+#endif  // !OPENMP
+}
@@ -111,6 +111,65 @@ typedef struct {
 #endif
 } neigh_t;
 
+// structure-of-arrays mirror of the neighbor tables
+//
+// The neigh_t records above are convenient to build, but the inner force
+// loops only touch a few fields per neighbor and stride over the fat
+// records. After the atom data has been distributed, the fields used by
+// the hot loops are repacked into contiguous arrays, one entry per
+// neighbor, to keep the traversal cache- and vectorization-friendly.
+
+typedef struct {
+  int num_entries; /* total number of neighbor entries of this process */
+  int* first;      /* first entry of each local atom (num_atoms + 1 values) */
+
+  int* type;      /* type of neighboring atom */
+  int* nr;        /* number of neighboring atom */
+  double* r;      /* r */
+  double* inv_r;  /* 1/r */
+  double* dist_x; /* real distance vector */
+  double* dist_y;
+  double* dist_z;
+  double* dist_r_x; /* normalized distance vector */
+  double* dist_r_y;
+  double* dist_r_z;
+
+  /* data to access the spline tables at the correct position */
+  int* slot[SLOTS];     /* the slot, belonging to the neighbor distance */
+  double* shift[SLOTS]; /* how far into the slot we have to go, in [0..1] */
+  double* step[SLOTS];  /* step size */
+  int* col[SLOTS];      /* coloumn of interaction for this neighbor */
+
+#if defined(EAM)
+  /* position in the transfer function of the own type, used for the
+     reverse direction when the neighbor has a different type */
+  int* slot_rev;
+  double* shift_rev;
+  double* step_rev;
+#if defined(TBEAM)
+  int* slot_rev_s;
+  double* shift_rev_s;
+  double* step_rev_s;
+#endif  // TBEAM
+#endif  // EAM
+
+#if defined(EAM) || defined(ADP)
+  /* transfer gradient of the current evaluation, filled by the density
+     loop and reused by the force pass */
+  double* rho_grad;
+#endif  // EAM || ADP
+
+#if defined(THREEBODY) && (defined(MEAM) || defined(ANG))
+  /* interpolation geometry of the angular table, one entry per stored
+     triple; cos(theta) is fixed, so this never changes between
+     evaluations */
+  int* ang_first; /* first triple of each local atom (num_atoms + 1 values) */
+  int* ang_slot;
+  double* ang_shift;
+  double* ang_step;
+#endif  // THREEBODY && (MEAM || ANG)
+} neigh_soa_t;
+
 // angular neighbor table (each atom has one for each triple of neighbors)
 
 #if defined(THREEBODY)
@@ -261,6 +320,13 @@ typedef struct {
 // function pointer for analytic potential evaluation
 typedef void (*fvalue_pointer)(const double, const double*, double*);
 
+// function pointer for batched analytic potential evaluation
+typedef void (*bvalue_pointer)(const int, const double*, const double*,
+                               double*);
+
+// function pointer for the parameter gradient of an analytic potential
+typedef void (*gvalue_pointer)(const double, const double*, double*);
+
 // potential table: holds analytic potential data
 
 typedef struct {
@@ -317,6 +383,8 @@ typedef struct {
 #endif
 
   fvalue_pointer* fvalue; /* function pointers for analytic potentials */
+  bvalue_pointer* bvalue; /* batched variants, NULL if none is available */
+  gvalue_pointer* gvalue; /* parameter gradients, NULL if none is available */
 } apot_table_t;
 
 #endif  // APOT
@@ -359,8 +427,14 @@ typedef struct {
   int natoms; /* total number of atoms */
   int nconf;  /* total number of configurations */
 
+  int num_datasets;   /* number of configuration files the data came from */
+  int* dataset_start; /* first configuration of each dataset (num_datasets+1) */
+
   atom_t* atoms;      /* atoms array */
   atom_t* conf_atoms; /* Atoms in configuration */
+  int* atom_orig_idx; /* config file positions of the Morton-ordered atoms */
+
+  neigh_soa_t neigh_soa; /* packed neighbor data for the force kernels */
 
   const char** elements; /* element names from configuration files */
 
@@ -411,10 +485,15 @@ typedef struct {
 // potfit_filenames: holds all kinds of filenames
 
 typedef struct {
-  const char* config;        /* file with atom configuration */
+  const char* config;        /* file with atom configuration (first dataset) */
+  const char** config_files; /* configuration file of each dataset */
+  double* config_weights;    /* weight factor of each dataset */
+  int num_config_files;      /* number of configuration datasets */
 #if defined(BINDIST)
   const char* bindistfile;   /* file for binned distributions */
 #endif // BINDIST
+  const char* checkpointfile; /* binary optimizer checkpoint */
+  const char* confindexfile; /* binary per-configuration importance index */
   const char* endpot;        /* file for end potential */
   const char* flagfile;      /* break if file exists */
   const char* imdpot;        /* file for IMD potential */
@@ -422,8 +501,10 @@ typedef struct {
   const char* output_prefix; /* prefix for all output files */
   const char* plotfile;      /* file for plotting */
   const char* plotpointfile; /* write points for plotting */
+  const char* socketfile;    /* unix socket of the evaluation server */
   const char* startpot;      /* file with start potential */
   const char* tempfile;      /* backup potential file */
+  const char* tracefile;     /* binary optimizer telemetry ring file */
 #if defined(UQ)
   const char* ensemblefile;  /* uq potential ensemble file */
 #endif // UQ
@@ -433,15 +514,37 @@ typedef struct {
 
 typedef struct {
   int init_done;  // potfit setup completed
-  int myid;       // index of current process
-  int num_cpus;   // total numer of processes
+  int myid;       // index of current process (in its evaluation group)
+  int num_cpus;   // total numer of processes (in its evaluation group)
 
   int firstatom; /* index of first atom for this process */
   int firstconf; /* index of first configuration for this process */
   int myatoms;   /* number of atoms for this process */
   int myconf;    /* number of configurations for this process */
 
+  /* second decomposition tier: several processes can share one
+     configuration and split its atom loop between them */
+  int conf_size;       /* processes sharing this process' configuration */
+  int conf_rank;       /* rank of this process among them */
+  int conf_atom_first; /* first atom of this process' slice (in the config) */
+  int conf_atom_count; /* number of atoms in this process' slice */
+
 #if defined(MPI)
+  MPI_Comm comm;        /* communicator of this process' evaluation group */
+  MPI_Comm leader_comm; /* communicator connecting the group leaders */
+  MPI_Comm conf_comm;   /* communicator of the processes sharing one config */
+
+  /* two-level parameter broadcast: one message per node across the
+     network, shared-memory fan-out inside the nodes */
+  MPI_Comm node_comm;      /* processes of this node (in the group) */
+  MPI_Comm internode_comm; /* the lowest rank of each node */
+  int node_rank;           /* rank of this process on its node */
+  int world_id;         /* rank in MPI_COMM_WORLD */
+  int world_cpus;       /* size of MPI_COMM_WORLD */
+  int num_groups;       /* number of independent evaluation groups */
+  int group;            /* evaluation group of this process */
+  int* group_leaders;   /* world ranks of the evaluation group leaders */
+
   int* atom_dist; /* atom distribution for each process (starting index) */
   int* atom_len;  /* atom distribution for each process (number of atoms) */
   int* conf_dist; /* config distribution for each process (starting index) */
@@ -470,10 +573,19 @@ typedef enum {
 #endif
 
 typedef struct {
-  int imdpotsteps; /* resolution of IMD potential */
-  int ntypes;      /* number of atom types */
+  int atom_order;    /* sort the atoms of each config along a Morton curve */
+  int bench_evals;   /* run a force kernel benchmark instead of fitting */
+  int config_cache;  /* use binary sidecar cache for the config file */
+  int config_stream; /* keep the packed neighbor data in file-backed mappings */
+  int huge_pages;   /* back large long-lived blocks with 2M huge pages */
+  int imdpotsteps;  /* resolution of IMD potential */
+  int lbfgs;        /* use L-BFGS instead of powell for the final stage */
+  int ntypes;       /* number of atom types */
   int opt;         /* optimization flag */
+  int phase_timers; /* print the per-phase timing breakdown */
+  int pot_cache;    /* use binary sidecar containers for tabulated potentials */
   int rng_seed;    /* seed for RNG */
+  int tune_geometry; /* calibrate the evaluation geometry at startup */
   int usemaxch;    /* use maximal changes file */
 
   int plot;  // plot output flag
@@ -481,17 +593,26 @@ typedef struct {
   int write_output_files;
   int write_pair_dist;
   int write_imd;
+  int imd_binary;   /* write IMD data blocks as raw doubles */
   int write_lammps; /* write output also in LAMMPS format */
+  int write_async;  /* write intermediate potentials asynchronously */
   int lammpspotsteps;
 
 #if defined(EVO)
   double evo_threshold;
+  int evo_groups;     /* number of concurrent trial evaluation groups */
+  double cmaes_sigma; /* initial CMA-ES step size (0 = differential evo.) */
 #else
   const char* anneal_temp;
+  int anneal_replicas; /* number of replica-exchange annealing chains */
 #endif  // EVO
   double eweight;
   double sweight;
-  double extend; /* how far should one extend imd pot */
+  double eval_batch; /* configuration fraction for mini-batch evaluations */
+  int eval_abort;    /* early abort of hopeless trial evaluations on/off */
+  int eval_float;    /* single-precision evaluations for the global search */
+  int surrogate;     /* surrogate pre-screening of trial vectors on/off */
+  double extend;     /* how far should one extend imd pot */
 #if defined(APOT)
   int compnodes; /* how many additional composition nodes */
   int enable_cp; /* switch chemical potential on/off */
@@ -551,6 +672,12 @@ typedef struct {
 typedef struct {
   int config;
   double* forces;
+  /* output locations registered with the compute-argument object once
+     at startup, so the per-evaluation loop only has to read them */
+  double energy;
+#if defined(STRESS)
+  double virial[6];
+#endif  // STRESS
 } potfit_compute_helper_t;
 
 typedef union value_t {
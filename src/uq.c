@@ -39,6 +39,12 @@
 #error No math library defined!
 #endif  // MKL
 
+#if defined(LAPACK)
+// the reference library only ships the Fortran entry point
+double dlamch_(const char*);
+#define DLAMCH dlamch_
+#endif  // LAPACK
+
 #include "errors.h"
 #include "force.h"
 #include "memory.h"
@@ -64,6 +70,12 @@ int calc_svd(double**, double**, double*);
 double generate_mc_sample(double** const, double** const, double, double, double*, int*, FILE*);
 int mc_moves(double**,double*, double*, double, FILE*);
 
+#if defined(MPI)
+static void ensemble_walk(double**, double*, double, FILE*);
+static void run_walker_chain(double**, double*, double, int, double*);
+static int walker_moves(int);
+#endif  // MPI
+
 /****************************************************************
  *
  *   main potential ensemble routine
@@ -86,6 +98,16 @@ void ensemble_generation(double cost_0)
     g_param.eig_max = 1;
   }
 
+#if defined(MPI)
+  /* the group leaders take part in the hessian construction, they need
+     the best fit parameters and the cost before the first evaluation */
+  if (g_mpi.num_groups > 1) {
+    MPI_Bcast(g_pot.opt_pot.table, g_calc.ndimtot, MPI_DOUBLE, 0,
+              g_mpi.leader_comm);
+    MPI_Bcast(&cost_0, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  }
+#endif  // MPI
+
   /* Calculate the best fit hessian */
   double** hessian = mat_double(g_pot.opt_pot.idxlen, g_pot.opt_pot.idxlen);
 
@@ -188,6 +210,18 @@ void ensemble_generation(double cost_0)
   fprintf(outfile, "cost       weight     accepted   attempts   acc_prob\n");
   fflush(outfile);
 
+#if defined(MPI)
+  /* With several evaluation groups each group leader runs its own chain,
+     the root process merges the samples afterwards */
+  if (g_mpi.num_groups > 1) {
+    ensemble_walk(v_0, eigenvalues, cost_0, outfile);
+
+    fclose(outfile);
+    printf("UQ ensemble parameters written to %s\n", g_files.ensemblefile);
+    return;
+  }
+#endif  // MPI
+
   /* Write initial cost to file */
   fprintf(outfile, "%-10d", pot_attempts);
   for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
@@ -264,6 +298,268 @@ void ensemble_generation(double cost_0)
   printf("UQ ensemble parameters written to %s\n", g_files.ensemblefile);
 }
 
+#if defined(MPI)
+
+/****************************************************************
+ *
+ *    Number of accepted moves walker <group> has to generate
+ *
+ ****************************************************************/
+
+static int walker_moves(int group)
+{
+  int moves = g_param.acc_moves / g_mpi.num_groups;
+
+  if (group < g_param.acc_moves % g_mpi.num_groups)
+    moves += 1;
+
+  return moves;
+}
+
+/****************************************************************
+ *
+ *    Run one MC chain and buffer the accepted samples
+ *
+ *    Each sample occupies (idxlen + 2) doubles:
+ *    the parameters, the cost and the weight (attempts)
+ *
+ ****************************************************************/
+
+static void run_walker_chain(double** v_0, double* w, double cost_0, int moves,
+                             double* samples)
+{
+  double cost_attempt = cost_0;
+  int weight = 1;
+
+  for (int i = 0; i < moves; i++) {
+    double cost =
+        generate_mc_sample(NULL, v_0, cost_attempt, cost_0, w, &weight, NULL);
+
+    cost_attempt = cost;
+
+    double* row = samples + i * (g_pot.opt_pot.idxlen + 2);
+
+    for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+      row[j] = g_pot.opt_pot.table[g_pot.opt_pot.idx[j]];
+    }
+    row[g_pot.opt_pot.idxlen] = cost;
+    row[g_pot.opt_pot.idxlen + 1] = (double)weight;
+  }
+}
+
+/****************************************************************
+ *
+ *    Multi-walker ensemble generation (root side)
+ *
+ *    Every group leader samples an independent chain from the
+ *    same cost landscape, the root process collects the samples
+ *    over the leader communicator and writes the merged ensemble
+ *    with cumulative acceptance statistics
+ *
+ ****************************************************************/
+
+static void ensemble_walk(double** v_0, double* w, double cost_0, FILE* outfile)
+{
+  const int idxlen = g_pot.opt_pot.idxlen;
+  const int stride = idxlen + 2;
+
+  printf("Beginning MCMC ensemble generation with %d parallel walkers.\n",
+         g_mpi.num_groups);
+  fflush(stdout);
+
+  /* The other group leaders hold stale parameters from their annealing
+     chains, send them the best fit and the hessian decomposition */
+  MPI_Bcast(g_pot.opt_pot.table, g_calc.ndimtot, MPI_DOUBLE, 0,
+            g_mpi.leader_comm);
+  MPI_Bcast(&cost_0, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  // eig_max may have been replaced by its default above
+  MPI_Bcast(&g_param.eig_max, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  MPI_Bcast(w, idxlen, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  MPI_Bcast(&v_0[0][0], idxlen * idxlen, MPI_DOUBLE, 0, g_mpi.leader_comm);
+
+  /* keep a copy, the chain leaves the table at its last sample */
+  double best_fit[idxlen];
+
+  for (int i = 0; i < idxlen; i++) {
+    best_fit[i] = g_pot.opt_pot.table[g_pot.opt_pot.idx[i]];
+  }
+
+  /* each walker samples with its own random number sequence, offset
+     so it does not repeat the stream of any annealing chain */
+  init_rng(g_param.rng_seed + g_mpi.num_groups + g_mpi.group);
+
+  int moves = walker_moves(g_mpi.group);
+  double* samples =
+      (double*)Malloc((moves > 0 ? moves : 1) * stride * sizeof(double));
+
+  run_walker_chain(v_0, w, cost_0, moves, samples);
+
+  /* every rank derives the same split, so no counts need to be sent */
+  int* counts = (int*)Malloc(g_mpi.num_groups * sizeof(int));
+  int* displs = (int*)Malloc(g_mpi.num_groups * sizeof(int));
+  int total = 0;
+
+  for (int n = 0; n < g_mpi.num_groups; n++) {
+    counts[n] = walker_moves(n) * stride;
+    displs[n] = total;
+    total += counts[n];
+  }
+
+  double* all = (double*)Malloc(total * sizeof(double));
+
+  MPI_Gatherv(samples, moves * stride, MPI_DOUBLE, all, counts, displs,
+              MPI_DOUBLE, 0, g_mpi.leader_comm);
+
+  /* Write the merged ensemble, one section per walker, each chain
+     starting from the best fit as in the serial case */
+  int id = 0;
+  int accepted = 0;
+  int pot_attempts = 0;
+  double acc_prob = 0.0;
+
+  for (int n = 0; n < g_mpi.num_groups; n++) {
+    int num_rows = counts[n] / stride;
+
+    if (num_rows == 0)
+      continue;
+
+    fprintf(outfile, "# walker %d\n", n);
+    fprintf(outfile, "%-10d", 0);
+    for (int i = 0; i < idxlen; i++) {
+      fprintf(outfile, "%-10.8lf ", best_fit[i]);
+    }
+    fprintf(outfile, "%.8lf ", cost_0);
+
+    int weight = 1;
+
+    for (int k = 0; k < num_rows; k++) {
+      double* row = all + displs[n] + k * stride;
+
+      weight = (int)row[idxlen + 1];
+      accepted += 1;
+      pot_attempts += weight;
+      acc_prob = (double)accepted / (double)pot_attempts;
+
+      /* Complete the previous line with the weight of this sample -
+         how many trials the chain spent there before moving on */
+      fprintf(outfile, "%-10d 1          %-10d %-10.2f\n", weight, pot_attempts,
+              acc_prob);
+
+      id += 1;
+      fprintf(outfile, "%-10d", id);
+      for (int i = 0; i < idxlen; i++) {
+        fprintf(outfile, "%-10.8lf ", row[i]);
+      }
+      fprintf(outfile, "%.8lf ", row[idxlen]);
+
+      char file[255];
+      sprintf(file, "%s.ensemble_pot_%d", g_files.output_prefix, id);
+
+      if (row[idxlen] < cost_0) {
+        for (int i = 0; i < idxlen; i++) {
+          g_pot.opt_pot.table[g_pot.opt_pot.idx[i]] = row[i];
+        }
+        update_apot_table(g_pot.opt_pot.table);
+        write_pot_table_potfit(file);
+
+        printf(
+            "WARNING: New best fit parameter set found for potential %s. Old "
+            "cost = %.8lf, new cost = %.8lf\n",
+            file, cost_0, row[idxlen]);
+      }
+      /* Write potential input files for parameter ensemble */
+      else if ((g_param.write_ensemble != 0) &&
+               (id % g_param.write_ensemble == 0)) {
+        for (int i = 0; i < idxlen; i++) {
+          g_pot.opt_pot.table[g_pot.opt_pot.idx[i]] = row[i];
+        }
+        update_apot_table(g_pot.opt_pot.table);
+        write_pot_table_potfit(file);
+      }
+    }
+
+    /* The chain ends here, repeat the weight of the last sample as
+       its duration estimate like the serial chain does */
+    pot_attempts += weight;
+    acc_prob = (double)accepted / (double)pot_attempts;
+    fprintf(outfile, "%-10d 1          %-10d %-10.2f\n", weight, pot_attempts,
+            acc_prob);
+  }
+
+  /* restore the best fit parameters */
+  for (int i = 0; i < idxlen; i++) {
+    g_pot.opt_pot.table[g_pot.opt_pot.idx[i]] = best_fit[i];
+  }
+  update_apot_table(g_pot.opt_pot.table);
+}
+
+/****************************************************************
+ *
+ *    Multi-walker ensemble generation (group leader side)
+ *
+ *    Entry point for the leaders of the other evaluation groups,
+ *    called after they have been released from line search duty
+ *    but before they wake up their workers
+ *
+ ****************************************************************/
+
+void run_uq_walker()
+{
+  const int idxlen = g_pot.opt_pot.idxlen;
+  const int stride = idxlen + 2;
+
+  /* receive the best fit from the root */
+  MPI_Bcast(g_pot.opt_pot.table, g_calc.ndimtot, MPI_DOUBLE, 0,
+            g_mpi.leader_comm);
+
+  double cost_0 = 0.0;
+
+  MPI_Bcast(&cost_0, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+
+  /* compute this walker's share of the hessian entries, mirroring the
+     restart loop of the root; the decomposition itself stays there */
+  double** hessian = mat_double(idxlen, idxlen);
+
+  int hess_counter = 1;
+  int flag = calc_hessian(hessian, &cost_0);
+  while (flag == 1) {
+    if (hess_counter == 10) {
+      error(1,
+            "Too many recalculations of the hessian implies the potential is "
+            "poorly fit.\nIt is advised to rerun parameter optimisation and "
+            "use the true minimum.\n");
+    }
+
+    hess_counter += 1;
+    flag = calc_hessian(hessian, &cost_0);
+  }
+
+  /* receive the refreshed best fit and the hessian decomposition */
+  MPI_Bcast(g_pot.opt_pot.table, g_calc.ndimtot, MPI_DOUBLE, 0,
+            g_mpi.leader_comm);
+
+  double eigenvalues[idxlen];
+  double** v_0 = mat_double(idxlen, idxlen);
+
+  MPI_Bcast(&cost_0, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  MPI_Bcast(&g_param.eig_max, 1, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  MPI_Bcast(eigenvalues, idxlen, MPI_DOUBLE, 0, g_mpi.leader_comm);
+  MPI_Bcast(&v_0[0][0], idxlen * idxlen, MPI_DOUBLE, 0, g_mpi.leader_comm);
+
+  init_rng(g_param.rng_seed + g_mpi.num_groups + g_mpi.group);
+
+  int moves = walker_moves(g_mpi.group);
+  double* samples =
+      (double*)Malloc((moves > 0 ? moves : 1) * stride * sizeof(double));
+
+  run_walker_chain(v_0, eigenvalues, cost_0, moves, samples);
+
+  MPI_Gatherv(samples, moves * stride, MPI_DOUBLE, NULL, NULL, NULL,
+              MPI_DOUBLE, 0, g_mpi.leader_comm);
+}
+
+#endif  // MPI
+
 /****************************************************************
  *
  *    Bracketing function for hessian finite difference
@@ -521,6 +817,48 @@ int calc_hessian(double** hessian, double* cost)
 
 
 
+  /* The cost evaluations for the individual entries are independent,
+     with several evaluation groups each one computes only its share
+     and a reduction assembles the full matrix */
+#if defined(MPI)
+  const int num_walkers = (g_mpi.num_groups > 1) ? g_mpi.num_groups : 1;
+  const int walker = (g_mpi.num_groups > 1) ? g_mpi.group : 0;
+#else
+  const int num_walkers = 1;
+  const int walker = 0;
+#endif  // MPI
+
+  /* Between restarts the minimum only moves along the few parameters
+     that were being probed when the lower cost appeared. Entries and
+     bracketed perturbations not involving a moved parameter are reused,
+     so a refresh costs O(ndim * k) evaluations instead of O(ndim^2).
+     The dense eigendecomposition is kept - at these dimensions it is
+     negligible next to a single force evaluation. */
+  static double** hess_entries; /* this rank's share of the entries */
+  static double* hess_center;   /* parameter values of that pass */
+  static double* pert_store;    /* perturbations bracketed there */
+
+  int dirty[g_pot.opt_pot.idxlen];
+
+  if (hess_center == NULL) {
+    hess_entries = mat_double(g_pot.opt_pot.idxlen, g_pot.opt_pot.idxlen);
+    hess_center = (double*)Malloc(g_pot.opt_pot.idxlen * sizeof(double));
+    pert_store = (double*)Malloc(g_pot.opt_pot.idxlen * sizeof(double));
+
+    for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+      dirty[j] = 1;
+    }
+  } else {
+    for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+      dirty[j] =
+          (g_pot.opt_pot.table[g_pot.opt_pot.idx[j]] != hess_center[j]);
+    }
+  }
+
+  for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+    hess_center[j] = g_pot.opt_pot.table[g_pot.opt_pot.idx[j]];
+  }
+
   /* Initialise values for possible better fit found */
   for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
     new_cost_param_values[j] = 0.0;
@@ -537,6 +875,18 @@ int calc_hessian(double** hessian, double* cost)
   for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
     /* If user specified perturbation, use this instead. */
     if (g_param.hess_pert < 0) {
+      /* the center did not move here, the stored bracket is valid */
+      if (!dirty[i]) {
+        pert[i] = pert_store[i];
+        continue;
+      }
+
+      /* each walker brackets only its share of the parameters */
+      if (i % num_walkers != walker) {
+        pert[i] = 0.0;
+        continue;
+      }
+
       printf("Cost aim = %g\n", cost_aim);
       fflush(stdout);
       /* Take the minimum perturbation of each direction */
@@ -568,6 +918,23 @@ int calc_hessian(double** hessian, double* cost)
     }
   } /* parameter loop */
 
+#if defined(MPI)
+  /* collect the bracketed perturbations from all walkers; reused values
+     are identical everywhere and may only enter the sum once */
+  if (num_walkers > 1 && g_param.hess_pert < 0) {
+    for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
+      if (walker != 0 && !dirty[i])
+        pert[i] = 0.0;
+    }
+    MPI_Allreduce(MPI_IN_PLACE, pert, g_pot.opt_pot.idxlen, MPI_DOUBLE,
+                  MPI_SUM, g_mpi.leader_comm);
+  }
+#endif  // MPI
+
+  for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
+    pert_store[i] = pert[i];
+  }
+
   /* Pre-calculate each parameter perturbation for diagonal entries */
   for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
     param_perturb_dist[j] = pert[j] * g_pot.opt_pot.table[g_pot.opt_pot.idx[j]];
@@ -586,6 +953,13 @@ int calc_hessian(double** hessian, double* cost)
   /* For diagonal entries, use (c_(i+1) - 2*cost +
    * c_(i-1))/(param_perturb_dist[i]^2) */
   for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
+    if (i % num_walkers != walker)
+      continue;
+
+    /* the entry from the previous pass is still a good estimate */
+    if (!dirty[i])
+      continue;
+
     double cost_plus;
     double cost_minus;
 
@@ -625,8 +999,8 @@ int calc_hessian(double** hessian, double* cost)
           "Consider changing the scale of cost perturbation. \n");
     }
 
-    hessian[i][i] = cost_plus - two_cost + cost_minus;
-    hessian[i][i] /= (param_perturb_dist[i] * param_perturb_dist[i]);
+    hess_entries[i][i] = cost_plus - two_cost + cost_minus;
+    hess_entries[i][i] /= (param_perturb_dist[i] * param_perturb_dist[i]);
 
 #if defined(DEBUG)
     if ((cost_plus > cost_aim) || (cost_minus > cost_aim)) {
@@ -650,8 +1024,17 @@ int calc_hessian(double** hessian, double* cost)
       "cost_pm_mp_diff\n");
 #endif
 
+  int elem = 0;
+
   for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
     for (int j = (i + 1); j < g_pot.opt_pot.idxlen; j++) {
+      if (elem++ % num_walkers != walker)
+        continue;
+
+      /* neither parameter moved, keep the stored entry */
+      if (!dirty[i] && !dirty[j])
+        continue;
+
       double cost_2plus;
       double cost_2minus;
       double cost_pm;
@@ -706,10 +1089,11 @@ int calc_hessian(double** hessian, double* cost)
             "Consider changing the scale of cost perturbation. \n");
       }
 
-      hessian[i][j] = cost_2plus + cost_2minus - cost_pm - cost_mp;
-      hessian[i][j] /= (4 * param_perturb_dist[i] * param_perturb_dist[j]);
+      hess_entries[i][j] = cost_2plus + cost_2minus - cost_pm - cost_mp;
+      hess_entries[i][j] /=
+          (4 * param_perturb_dist[i] * param_perturb_dist[j]);
 
-      hessian[j][i] = hessian[i][j];
+      hess_entries[j][i] = hess_entries[i][j];
 
 #if defined(DEBUG)
       if ((cost_2plus > cost_aim) || (cost_2minus > cost_aim) ||
@@ -727,27 +1111,67 @@ int calc_hessian(double** hessian, double* cost)
     }
   }
 
+  /* assemble: the own share, including the entries kept from earlier
+     passes (the other shares are all zero and vanish in the reduction) */
+  for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
+    for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+      hessian[i][j] = hess_entries[i][j];
+    }
+  }
+
+#if defined(MPI)
+  if (num_walkers > 1) {
+    /* assemble the full hessian on the root process */
+    if (walker == 0)
+      MPI_Reduce(MPI_IN_PLACE, &hessian[0][0],
+                 g_pot.opt_pot.idxlen * g_pot.opt_pot.idxlen, MPI_DOUBLE,
+                 MPI_SUM, 0, g_mpi.leader_comm);
+    else
+      MPI_Reduce(&hessian[0][0], NULL,
+                 g_pot.opt_pot.idxlen * g_pot.opt_pot.idxlen, MPI_DOUBLE,
+                 MPI_SUM, 0, g_mpi.leader_comm);
+
+    /* agree on the lowest cost any walker stumbled upon */
+    struct {
+      double cost;
+      int rank;
+    } my_min, glob_min;
+
+    my_min.cost = new_cost_param_values[g_pot.opt_pot.idxlen];
+    my_min.rank = walker; /* the leader ranks match the group indices */
+
+    MPI_Allreduce(&my_min, &glob_min, 1, MPI_DOUBLE_INT, MPI_MINLOC,
+                  g_mpi.leader_comm);
+
+    if (glob_min.cost < VERY_LARGE)
+      MPI_Bcast(new_cost_param_values, g_pot.opt_pot.idxlen + 1, MPI_DOUBLE,
+                glob_min.rank, g_mpi.leader_comm);
+  }
+#endif  // MPI
+
   /* If new cost value is found, return parameters */
   if (new_cost_param_values[g_pot.opt_pot.idxlen] != VERY_LARGE) {
-    printf(
-        "WARNING: A new cost minimum has been found.\nOriginal cost = %f,\t "
-        "New cost = %f.\nCalculation restarting with new best fit potential "
-        "values.\n\n",
-        *cost, new_cost_param_values[g_pot.opt_pot.idxlen]);
+    if (walker == 0) {
+      printf(
+          "WARNING: A new cost minimum has been found.\nOriginal cost = %f,\t "
+          "New cost = %f.\nCalculation restarting with new best fit potential "
+          "values.\n\n",
+          *cost, new_cost_param_values[g_pot.opt_pot.idxlen]);
 
-    printf("NEW COST MINIMA VALUES:\n");
-    for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
-      printf("Param %d = %.8lf\n", j, new_cost_param_values[j]);
-    }
-    printf("Cost = %f\n", new_cost_param_values[g_pot.opt_pot.idxlen]);
-    fflush(stdout);
+      printf("NEW COST MINIMA VALUES:\n");
+      for (int j = 0; j < g_pot.opt_pot.idxlen; j++) {
+        printf("Param %d = %.8lf\n", j, new_cost_param_values[j]);
+      }
+      printf("Cost = %f\n", new_cost_param_values[g_pot.opt_pot.idxlen]);
+      fflush(stdout);
 
-    /* Move old potential to temp file */
-    if (g_files.tempfile && strlen(g_files.tempfile)) {
+      /* Move old potential to temp file */
+      if (g_files.tempfile && strlen(g_files.tempfile)) {
 #if defined(APOT)
-      update_apot_table(g_pot.opt_pot.table);
+        update_apot_table(g_pot.opt_pot.table);
 #endif  // APOT
-      write_pot_table_potfit(g_files.tempfile);
+        write_pot_table_potfit(g_files.tempfile);
+      }
     }
 
     /* Set new cost potential parameters as the best fit potential  */
@@ -755,20 +1179,23 @@ int calc_hessian(double** hessian, double* cost)
       g_pot.opt_pot.table[g_pot.opt_pot.idx[j]] = new_cost_param_values[j];
     }
 
-    /* Write out new end potential */
+    if (walker == 0) {
+      /* Write out new end potential */
 #if defined(APOT)
-    update_apot_table(g_pot.opt_pot.table);
+      update_apot_table(g_pot.opt_pot.table);
 #endif  // APOT
-    write_pot_table_potfit(g_files.endpot);
+      write_pot_table_potfit(g_files.endpot);
 
-    // will not work with MPI
+      // will not work with MPI
 #if defined(PDIST) && !defined(MPI)
-    write_pairdist(&g_pot.opt_pot, g_files.distfile);
+      write_pairdist(&g_pot.opt_pot, g_files.distfile);
 #endif  // PDIST && !MPI
 
-    /* write the error files for forces, energies, stresses, ... */
-    write_errors(g_calc.force, new_cost_param_values[g_pot.opt_pot.idxlen]);
-    fflush(stdout);
+      /* write the error files for forces, energies, stresses, ... */
+      write_errors(g_calc.force, new_cost_param_values[g_pot.opt_pot.idxlen]);
+      fflush(stdout);
+    }
+
     /* Update new cost minima value and return flag of 1 to recalculate the Hessian */
     *cost = new_cost_param_values[g_pot.opt_pot.idxlen];
     return 1;
@@ -1024,12 +1451,16 @@ int mc_moves(double** v_0, double* w, double* cost_before, double cost_0,
   }
 
 #if defined(DEBUG)
-  /* Print out unsuccessful moves */
-  fprintf(outfile, "-          ");
-  for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
-    fprintf(outfile, "%-10.6g ", g_pot.opt_pot.table[g_pot.opt_pot.idx[i]]);
+  /* Print out unsuccessful moves (the parallel walkers buffer their
+     samples and pass no file handle) */
+  if (outfile != NULL) {
+    fprintf(outfile, "-          ");
+    for (int i = 0; i < g_pot.opt_pot.idxlen; i++) {
+      fprintf(outfile, "%-10.6g ", g_pot.opt_pot.table[g_pot.opt_pot.idx[i]]);
+    }
+    fprintf(outfile, "%-10.6g 1          0          -          -\n",
+            cost_after);
   }
-  fprintf(outfile, "%-10.6g 1          0          -          -\n", cost_after);
 #endif
 
   /* If move not accepted, return 0 */
@@ -34,6 +34,10 @@
 
 void ensemble_generation(double);
 
+#if defined(MPI)
+void run_uq_walker();
+#endif // MPI
+
 #endif // UQ
 
 #endif // UQ_H_INCLUDED
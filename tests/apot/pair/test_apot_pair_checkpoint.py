@@ -0,0 +1,37 @@
+import pytest
+
+# start far from the optimum so the anneal accepts moves and runs
+# several outer iterations, each of which commits a checkpoint
+POTENTIAL = '''
+#F 0 1
+#T PAIR
+#I 0
+#E
+
+type lj
+cutoff 6.0
+epsilon 0.9 0 1
+sigma 3.5 1 4
+'''
+
+def test_apot_pair_checkpoint_restart(potfit):
+    # the generated lattice is symmetric, so the fit is driven by the
+    # energy term
+    potfit.create_param_file(opt=1, seed=42, anneal_temp=0.3, eng_weight=10,
+                             checkpoint_file='checkpoint')
+    potfit.create_potential_file(POTENTIAL)
+    potfit.create_config_file(size=20)
+    potfit.register_artifact('checkpoint')
+    potfit.register_artifact('checkpoint.tmp')
+    # uninterrupted reference with the same seed
+    potfit.run()
+    assert potfit.has_no_error()
+    reference = potfit.endpot
+    # kill the run once the first checkpoint has been committed
+    assert potfit.run_until_file('checkpoint')
+    # the restarted run picks up the full annealing state including the
+    # rng from the checkpoint and must land on the same potential
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Resuming annealing from checkpoint' in potfit.stdout
+    assert potfit.endpot == reference
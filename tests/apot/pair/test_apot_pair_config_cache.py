@@ -0,0 +1,51 @@
+import pytest
+
+POTENTIAL = '''
+#F 0 1
+#T PAIR
+#I 0
+#E
+
+type lj
+cutoff 6.0
+epsilon 0.1 0 1
+sigma 2.5 1 4
+'''
+
+def test_apot_pair_config_cache_round_trip(potfit):
+    potfit.create_param_file(config_cache=1)
+    potfit.create_potential_file(POTENTIAL)
+    potfit.create_config_file()
+    potfit.register_artifact('config.cache')
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Wrote configuration cache file >> config.cache <<' in potfit.stdout
+    reference = potfit.force
+    # second run must be served from the cache and reproduce the
+    # parsed-path forces exactly
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Reading configuration cache file >> config.cache <<' in potfit.stdout
+    assert potfit.force == reference
+
+def test_apot_pair_config_cache_invalidation(potfit):
+    potfit.create_param_file(config_cache=1)
+    potfit.create_potential_file(POTENTIAL)
+    potfit.create_config_file()
+    potfit.register_artifact('config.cache')
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Wrote configuration cache file >> config.cache <<' in potfit.stdout
+    reference = potfit.force
+    # rewrite the config with a longer comment line - the size change
+    # must invalidate the cache and force a reparse
+    config = potfit.get_file_content('config')
+    f = potfit.create_file('config')
+    f.write(config.replace('## force file', '## regenerated force file', 1))
+    f.close()
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Reading configuration cache file' not in potfit.stdout
+    assert 'Reading configuration file >> config <<' in potfit.stdout
+    # only a comment changed, so the reparsed forces match
+    assert potfit.force == reference
@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+############################################################################
+#
+# perf.py: timed regression suite for the force kernels
+#
+# Builds one optimized binary per kernel, generates a synthetic
+# configuration set and runs the built-in benchmark mode (bench_evals
+# parameter) against it. The measured evaluation rate is compared to
+# the baseline recorded in baselines.json; a drop beyond the tolerance
+# fails the suite. Baselines are machine specific - record them once
+# per box with --update and keep baselines.json out of version
+# control.
+#
+# usage:
+#   perf.py                     compare against recorded baselines
+#   perf.py --update            re-record the baselines
+#   perf.py --kernels pair,eam  restrict the kernel set
+#
+# or via the top-level Makefile: make perf / make perf-baseline
+#
+############################################################################
+#
+# Copyright 2002-2018 - the potfit development team
+#
+# https://www.potfit.net/
+#
+############################################################################
+
+import argparse
+import json
+import os
+import random
+import re
+import subprocess
+import sys
+import time
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..'))
+WORK = os.path.join(os.path.dirname(__file__), 'work')
+BASELINE_FILE = os.path.join(os.path.dirname(__file__), 'baselines.json')
+
+# analytic model recipes per kernel: makeapot function list
+KERNELS = {
+    'pair': 'lj',
+    'eam': '3*lj',
+    'adp': '5*lj',
+}
+
+
+def run(cmd, cwd=ROOT):
+    p = subprocess.run(cmd, cwd=cwd, stdout=subprocess.PIPE,
+                       stderr=subprocess.STDOUT)
+    if p.returncode:
+        sys.exit('error running "{}":\n{}'.format(
+            ' '.join(cmd), p.stdout.decode()))
+    return p.stdout.decode()
+
+
+def build(kernel):
+    run(['./waf', 'distclean'])
+    run(['./waf', 'configure', '-c', 'no', '-m', 'apot', '-i', kernel,
+         '-l', 'lapack'])
+    out = run(['./waf', 'build'])
+    binary = [x for x in out.split('\n') if 'Linking' in x][0]
+    return os.path.join(ROOT, 'bin', binary.split(' ')[2].split('/')[-1])
+
+
+def write_config(path, cells, distance):
+    # two atoms per cell on a jittered grid, the same layout the
+    # correctness tests use, just scaled up
+    random.seed(42)
+    box = cells * distance
+
+    lines = []
+    for i in range(cells):
+        for j in range(cells):
+            for k in range(cells):
+                lines.append('0 {:.6f} {:.6f} {:.6f} {:.6f} {:.6f} {:.6f}'.format(
+                    i * distance, j * distance, k * distance,
+                    -random.random(), -random.random(), -random.random()))
+                lines.append('0 {:.6f} {:.6f} {:.6f} {:.6f} {:.6f} {:.6f}'.format(
+                    (i + 0.5) * distance + random.uniform(-0.2, 0.2),
+                    (j + 0.5) * distance + random.uniform(-0.2, 0.2),
+                    (k + 0.5) * distance + random.uniform(-0.2, 0.2),
+                    -random.random(), -random.random(), -random.random()))
+
+    with open(path, 'w') as f:
+        f.write('#N {} 1\n'.format(len(lines)))
+        f.write('#C 0\n')
+        f.write('## synthetic benchmark configuration\n')
+        f.write('#X {:.6f} 0 0\n'.format(box))
+        f.write('#Y 0 {:.6f} 0\n'.format(box))
+        f.write('#Z 0 0 {:.6f}\n'.format(box))
+        f.write('#E 0\n')
+        f.write('#W 1.0\n')
+        f.write('#F\n')
+        f.write('\n'.join(lines) + '\n')
+
+    return len(lines)
+
+
+def measure(kernel, binary, evals, cells):
+    workdir = os.path.join(WORK, kernel)
+    os.makedirs(workdir, exist_ok=True)
+
+    run([os.path.join(ROOT, 'util', 'makeapot'), '-o', 'startpot', '-n', '1',
+         '-i', kernel, '-f', KERNELS[kernel]], cwd=workdir)
+    natoms = write_config(os.path.join(workdir, 'config'), cells, 2.5)
+
+    with open(os.path.join(workdir, 'param_file'), 'w') as f:
+        f.write('ntypes 1\n'
+                'startpot startpot\n'
+                'endpot endpot\n'
+                'config config\n'
+                'tempfile tempfile\n'
+                'output_prefix output\n'
+                'bench_evals {}\n'.format(evals))
+
+    out = run([binary, 'param_file'], cwd=workdir)
+
+    match = re.search(r'\(([0-9.]+) evals/s\)', out)
+    if match is None:
+        sys.exit('no benchmark report in the output of {}:\n{}'.format(
+            kernel, out))
+
+    return float(match.group(1)), natoms
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='timed regression suite for the force kernels')
+    parser.add_argument('--update', action='store_true',
+                        help='re-record the baselines')
+    parser.add_argument('--tolerance', type=float, default=0.3,
+                        help='allowed fractional slowdown (default 0.3)')
+    parser.add_argument('--evals', type=int, default=100,
+                        help='benchmark evaluations per kernel (default 100)')
+    parser.add_argument('--cells', type=int, default=8,
+                        help='synthetic config cells per edge (default 8)')
+    parser.add_argument('--kernels', default=','.join(KERNELS),
+                        help='comma separated kernel list')
+    args = parser.parse_args()
+
+    kernels = args.kernels.split(',')
+    for kernel in kernels:
+        if kernel not in KERNELS:
+            sys.exit('unknown kernel "{}" (known: {})'.format(
+                kernel, ', '.join(KERNELS)))
+
+    baselines = {}
+    if os.path.isfile(BASELINE_FILE):
+        with open(BASELINE_FILE) as f:
+            baselines = json.load(f)
+
+    failed = []
+    for kernel in kernels:
+        binary = build(kernel)
+        rate, natoms = measure(kernel, binary, args.evals, args.cells)
+
+        baseline = baselines.get(kernel, {}).get('evals_per_sec')
+        if baseline is None or args.update:
+            baselines[kernel] = {
+                'evals_per_sec': rate,
+                'atoms': natoms,
+                'evals': args.evals,
+                'recorded': time.strftime('%Y-%m-%d %H:%M:%S'),
+            }
+            print('{:8s} {:10.1f} evals/s ({} atoms) - baseline recorded'.format(
+                kernel, rate, natoms))
+            continue
+
+        limit = baseline * (1.0 - args.tolerance)
+        status = 'ok' if rate >= limit else 'REGRESSION'
+        print('{:8s} {:10.1f} evals/s (baseline {:.1f}, limit {:.1f}) - {}'.format(
+            kernel, rate, baseline, limit, status))
+        if rate < limit:
+            failed.append(kernel)
+
+    with open(BASELINE_FILE, 'w') as f:
+        json.dump(baselines, f, indent=2, sort_keys=True)
+        f.write('\n')
+
+    if failed:
+        sys.exit('performance regression in: {}'.format(', '.join(failed)))
+
+
+if __name__ == '__main__':
+    main()
@@ -7,6 +7,7 @@ import random
 import re
 import string
 import subprocess
+import time
 
 from itertools import product
 
@@ -97,6 +98,12 @@ class Potfit:
         f.write(input)
         f.close()
 
+    def register_artifact(self, filename):
+        # track a file written by the binary itself, so clear() removes it
+        name = os.path.join(self.cwd, filename)
+        if not name in self.filenames:
+            self.filenames.append(name)
+
     def call_makeapot(self, filename, args):
         os.environ['PATH'] = '{}:'.format(os.path.abspath('../util')) + os.environ['PATH']
         p = subprocess.Popen(['makeapot', '-o', filename] + args.split(' '), stdout=subprocess.PIPE, stderr=subprocess.PIPE, cwd=self.cwd)
@@ -156,6 +163,28 @@ class Potfit:
         self.returncode = p.returncode
         self._check_asan_fail(asan_filename)
 
+    def run_until_file(self, filename, param_file='param_file', timeout=60):
+        # start a run and kill it hard once the given file shows up, like a
+        # job dying mid-fit; returns True if the run was interrupted
+        target = os.path.join(self.cwd, filename)
+        cmd = [os.path.join(os.path.abspath('../bin'), self.binary_name), param_file]
+        p = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, cwd=self.cwd)
+        interrupted = False
+        end = time.time() + timeout
+        while time.time() < end:
+            if os.path.isfile(target):
+                if p.poll() is None:
+                    p.kill()
+                    interrupted = True
+                break
+            if p.poll() is not None:
+                break
+            time.sleep(0.005)
+        if p.poll() is None:
+            p.kill()
+        p.communicate()
+        return interrupted
+
     def has_no_error(self):
         if self.returncode != 0:
             return False
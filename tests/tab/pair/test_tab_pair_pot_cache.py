@@ -0,0 +1,67 @@
+import pytest
+
+POTENTIAL = '''
+#F 3 1
+#I 0
+#E
+
+1.158337 10.883950976 15
+
+0.00119911169735
+7.20484717515e-06
+0.000595394899272
+0.000936445223073
+0.000484087727962
+0.000200648587256
+0.0000959327293262
+0.0000609377489204
+0.000049458009818
+0.0000457044379028
+0.0000444847462971
+0.0000440967362355
+0.0000439803740159
+0.0000439510638516
+0.0
+'''
+
+def test_tab_pair_pot_cache_round_trip(potfit):
+    # first run writes endpot plus its binary container
+    potfit.create_param_file(pot_cache=1)
+    potfit.create_potential_file(POTENTIAL)
+    potfit.create_config_file()
+    potfit.register_artifact('endpot.cache')
+    potfit.register_artifact('endpot2.cache')
+    potfit.register_artifact('endpot3.cache')
+    potfit.run()
+    assert potfit.has_no_error()
+    # parsed-path reference: read endpot back without the cache
+    potfit.create_param_file(startpot='endpot', endpot='endpot2')
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Serving the values block' not in potfit.stdout
+    reference = potfit.force
+    # cached path: the values block comes from the binary container
+    potfit.create_param_file(pot_cache=1, startpot='endpot', endpot='endpot3')
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Serving the values block from the binary container endpot.cache' in potfit.stdout
+    assert potfit.force == reference
+
+def test_tab_pair_pot_cache_invalidation(potfit):
+    potfit.create_param_file(pot_cache=1)
+    potfit.create_potential_file(POTENTIAL)
+    potfit.create_config_file()
+    potfit.register_artifact('endpot.cache')
+    potfit.register_artifact('endpot2.cache')
+    potfit.run()
+    assert potfit.has_no_error()
+    # editing the potential file changes its size, so the stale
+    # container must be ignored and the text parsed instead
+    endpot = potfit.get_file_content('endpot')
+    f = potfit.create_file('endpot')
+    f.write(endpot + '\n# touched\n')
+    f.close()
+    potfit.create_param_file(pot_cache=1, startpot='endpot', endpot='endpot2')
+    potfit.run()
+    assert potfit.has_no_error()
+    assert 'Serving the values block' not in potfit.stdout